@@ -1,110 +1,246 @@
+#include <algorithm>
+#include <ctime>
 #include "aaudio_render.h"
 #include "log.h"
 
 #define LOG_TAG "AAudioRender"
 
 AAudioRender::AAudioRender() {
-    this->paused = false;
-    this->sample_rate = 44100;
-    this->channel_count = 2;
-    this->format = AAUDIO_FORMAT_PCM_I16;
+    this->stream = nullptr;
+    this->user_data = nullptr;
+    this->playing = false;
+    this->flushRequests = 0;
+    this->flushesDone = 0;
+    this->mute = false;
+    this->transitionStart = 0;
+    this->transitionCount = 0;
+    this->transitionUs = 0;
+    this->transitionMaxUs = 0;
+    this->startRetries = 0;
+    this->startFailureCount = 0;
+    this->startGiveUpCount = 0;
+    this->sample_rate = 0;
+    this->channel_count = 0;
+    this->format_ = AAUDIO_FORMAT_UNSPECIFIED;
+    this->req_sample_rate = AAUDIO_UNSPECIFIED;
+    this->req_channel_count = 2;
+    this->req_format = AAUDIO_FORMAT_PCM_FLOAT;
     this->callback = nullptr;
+    this->req_exclusive = false;
+    this->sharing_mode = AAUDIO_SHARING_MODE_SHARED;
+    this->performance_mode = AAUDIO_PERFORMANCE_MODE_NONE;
+    this->frame_bytes = 0;
+    this->float_output = false;
+    this->disconnect = false;
+    this->reconfigure = false;
+    this->exclusiveFallbacks = 0;
+    this->reopenCount = 0;
+    this->bufferSize = 0;
+    this->xrunCount = 0;
+    this->streamXRuns = 0;
+    this->latency = -1;
 }
 
 AAudioRender::~AAudioRender() {
-    AAudioStream_close(stream);
+    std::lock_guard<std::mutex> lck(mtx);
+    closeLocked();
+}
+
+void AAudioRender::onError(AAudioStream *, void *userData, aaudio_result_t error) {
+    // 在 AAudio 的线程上调用，不能在这里关闭或重新打开流，只做标记
+    auto self = static_cast<AAudioRender *>(userData);
+    LOGW(LOG_TAG, "stream error: %s", AAudio_convertResultToText(error));
+    if (error == AAUDIO_ERROR_DISCONNECTED) self->disconnect = true;
 }
 
-int AAudioRender::start() {
+aaudio_result_t AAudioRender::openStream(aaudio_sharing_mode_t sharing) {
     AAudioStreamBuilder *builder;
     aaudio_result_t result = AAudio_createStreamBuilder(&builder);
     if (result != AAUDIO_OK) {
         LOGE(LOG_TAG, "createStreamBuilder failed: %s", AAudio_convertResultToText(result));
-        return -1;
+        return result;
     }
-    AAudioStreamBuilder_setSampleRate(builder, this->sample_rate);
-    AAudioStreamBuilder_setChannelCount(builder, this->channel_count);
-    AAudioStreamBuilder_setFormat(builder, this->format);
+    AAudioStreamBuilder_setSampleRate(builder, this->req_sample_rate);
+    AAudioStreamBuilder_setChannelCount(builder, this->req_channel_count);
+    AAudioStreamBuilder_setFormat(builder, this->req_format);
     AAudioStreamBuilder_setPerformanceMode(builder, AAUDIO_PERFORMANCE_MODE_LOW_LATENCY);
-    AAudioStreamBuilder_setSharingMode(builder, AAUDIO_SHARING_MODE_SHARED);
+    AAudioStreamBuilder_setSharingMode(builder, sharing);
+    AAudioStreamBuilder_setDataCallback(builder, callback, user_data);
+    AAudioStreamBuilder_setErrorCallback(builder, onError, this);
+    result = AAudioStreamBuilder_openStream(builder, &stream);
+    AAudioStreamBuilder_delete(builder);
+    if (result != AAUDIO_OK) stream = nullptr;
+    return result;
+}
+
+int AAudioRender::openLocked() {
+    if (stream != nullptr) return 0;
     if (!this->callback) {
         LOGE(LOG_TAG, "callback is nullptr");
         return -1;
     }
-    AAudioStreamBuilder_setDataCallback(builder, callback, user_data);
-    result = AAudioStreamBuilder_openStream(builder, &stream);
+    bool exclusive = req_exclusive;
+    aaudio_result_t result = openStream(exclusive ? AAUDIO_SHARING_MODE_EXCLUSIVE : AAUDIO_SHARING_MODE_SHARED);
+    if (result != AAUDIO_OK && exclusive) {
+        // 独占通路被其他应用占用或设备不支持 MMAP
+        LOGW(LOG_TAG, "exclusive stream failed: %s, fall back to shared", AAudio_convertResultToText(result));
+        result = openStream(AAUDIO_SHARING_MODE_SHARED);
+    }
     if (result != AAUDIO_OK) {
         LOGE(LOG_TAG, "openStream failed: %s", AAudio_convertResultToText(result));
         return -1;
     }
-    this->format = AAudioStream_getFormat(stream);
+    // 设备可能不接受请求的参数，以实际得到的为准。请求独占时系统也可能直接给共享模式
+    this->format_ = AAudioStream_getFormat(stream);
     this->channel_count = AAudioStream_getChannelCount(stream);
     this->sample_rate = AAudioStream_getSampleRate(stream);
-    result = AAudioStream_requestStart(stream);
+    this->sharing_mode = AAudioStream_getSharingMode(stream);
+    this->performance_mode = AAudioStream_getPerformanceMode(stream);
+    if (exclusive && sharing_mode != AAUDIO_SHARING_MODE_EXCLUSIVE) exclusiveFallbacks++;
+    float_output = format_ == AAUDIO_FORMAT_PCM_FLOAT;
+    frame_bytes = static_cast<size_t>(channel_count) *
+                  (format_ == AAUDIO_FORMAT_PCM_FLOAT ? sizeof(float) : sizeof(int16_t));
+    disconnect = false;
+    reconfigure = false;
+    // 缓冲区从最小的 burst 倍数开始，欠载时再逐步加大
+    int32_t burst = AAudioStream_getFramesPerBurst(stream);
+    int32_t size = tuner.reset(burst, AAudioStream_getBufferCapacityInFrames(stream));
+    result = AAudioStream_setBufferSizeInFrames(stream, size);
+    bufferSize = result > 0 ? result : AAudioStream_getBufferSizeInFrames(stream);
+    streamXRuns = 0;
+    latency = -1;
+    LOGI(LOG_TAG, "stream opened: %d Hz, %d channels, format %d, %s, burst %d frames, buffer %d frames",
+         sample_rate, channel_count, format_,
+         sharing_mode == AAUDIO_SHARING_MODE_EXCLUSIVE ? "exclusive" : "shared", burst, bufferSize.load());
+    return 0;
+}
+
+void AAudioRender::closeLocked() {
+    if (stream == nullptr) return;
+    // AAudioStream_close 等回调线程退出后才返回，之后回调不会再被调用
+    AAudioStream_requestStop(stream);
+    AAudioStream_close(stream);
+    stream = nullptr;
+}
+
+int AAudioRender::open() {
+    std::lock_guard<std::mutex> lck(mtx);
+    return openLocked();
+}
+
+void AAudioRender::close() {
+    std::lock_guard<std::mutex> lck(mtx);
+    // 目标状态改为暂停，control() 不会再把流打开
+    playing = false;
+    closeLocked();
+}
+
+int AAudioRender::reopen() {
+    std::lock_guard<std::mutex> lck(mtx);
+    closeLocked();
+    if (openLocked() < 0) return -1;
+    reopenCount++;
+    startRetries = 0;
+    if (!playing) return 0;
+    aaudio_result_t result = AAudioStream_requestStart(stream);
     if (result != AAUDIO_OK) {
+        // 没有人会再推进这个流，留给调用方下一次 reopen() 重试
         LOGE(LOG_TAG, "requestStart failed: %s", AAudio_convertResultToText(result));
+        startFailureCount++;
+        reconfigure = true;
         return -1;
     }
-    AAudioStreamBuilder_delete(builder);
     return 0;
 }
 
-int AAudioRender::flush() {
-    const int64_t timeout = 100000000; //100ms
-    AAudioStream_requestPause(stream);
-    aaudio_result_t result = AAUDIO_OK;
-    aaudio_stream_state_t currentState = AAudioStream_getState(stream);
-    aaudio_stream_state_t inputState = currentState;
-    while (result == AAUDIO_OK && currentState != AAUDIO_STREAM_STATE_PAUSED) {
-        result = AAudioStream_waitForStateChange(
-                stream, inputState, &currentState, timeout);
-        inputState = currentState;
-    }
-    AAudioStream_requestFlush(stream);
-    AAudioStream_requestStart(stream);
-    result = AAUDIO_OK;
-    currentState = AAudioStream_getState(stream);
-    inputState = currentState;
-    while (result == AAUDIO_OK && currentState != AAUDIO_STREAM_STATE_STARTED) {
-        result = AAudioStream_waitForStateChange(
-                stream, inputState, &currentState, timeout);
-        inputState = currentState;
-    }
-    return result;
+static int64_t monotonicUs() {
+    struct timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
 
+void AAudioRender::play(bool p) {
+    // 暂停时先静音，回调不再消费数据，恢复播放时从暂停的位置继续
+    if (!p) mute = true;
+    playing = p;
 }
 
-int AAudioRender::pause(bool p) {
-    if (p == paused) {
-        return 0;
+void AAudioRender::requestFlush() {
+    mute = true;
+    flushRequests++;
+}
+
+bool AAudioRender::muted() const {
+    return mute.load(std::memory_order_relaxed);
+}
+
+int64_t AAudioRender::control() {
+    std::lock_guard<std::mutex> lck(mtx);
+    if (playing && openLocked() < 0) return 0;
+    if (stream == nullptr) return 0;
+    if (transitionStart == 0) transitionStart = monotonicUs();
+    aaudio_stream_state_t state = AAudioStream_getState(stream);
+    switch (state) {
+        case AAUDIO_STREAM_STATE_STARTING:
+        case AAUDIO_STREAM_STATE_PAUSING:
+        case AAUDIO_STREAM_STATE_FLUSHING:
+        case AAUDIO_STREAM_STATE_STOPPING:
+            return AUDIO_CONTROL_POLL_US;
+        case AAUDIO_STREAM_STATE_DISCONNECTED:
+            // 由 reopen() 处理
+            finishTransition();
+            return 0;
+        default:
+            break;
     }
-    if (p) {
-        const int64_t timeout = 100000000; //100ms
-        AAudioStream_requestPause(stream);
-        aaudio_result_t result = AAUDIO_OK;
-        aaudio_stream_state_t currentState = AAudioStream_getState(stream);
-        aaudio_stream_state_t inputState = currentState;
-        while (result == AAUDIO_OK && currentState != AAUDIO_STREAM_STATE_PAUSED) {
-            result = AAudioStream_waitForStateChange(
-                    stream, inputState, &currentState, timeout);
-            inputState = currentState;
+    bool started = state == AAUDIO_STREAM_STATE_STARTED;
+    uint32_t flushes = flushRequests;
+    if (flushes != flushesDone) {
+        // 只能在暂停状态下刷新
+        if (started) {
+            AAudioStream_requestPause(stream);
+            return AUDIO_CONTROL_POLL_US;
         }
-        paused = true;
-        return result;
-    } else {
-        const int64_t timeout = 100000000; //100ms
-        AAudioStream_requestStart(stream);
-        aaudio_result_t result = AAUDIO_OK;
-        aaudio_stream_state_t currentState = AAudioStream_getState(stream);
-        aaudio_stream_state_t inputState = currentState;
-        while (result == AAUDIO_OK && currentState != AAUDIO_STREAM_STATE_STARTED) {
-            result = AAudioStream_waitForStateChange(
-                    stream, inputState, &currentState, timeout);
-            inputState = currentState;
+        AAudioStream_requestFlush(stream);
+        flushesDone = flushes;
+        return AUDIO_CONTROL_POLL_US;
+    }
+    if (playing && !started) {
+        aaudio_result_t result = AAudioStream_requestStart(stream);
+        if (result == AAUDIO_OK) {
+            startRetries = 0;
+            return AUDIO_CONTROL_POLL_US;
         }
-        paused = false;
-        return result;
+        startFailureCount++;
+        if (++startRetries < AUDIO_START_MAX_RETRIES) return AUDIO_CONTROL_POLL_US;
+        // 设备持续拒绝启动（被其他应用占用、音频服务重启中等），不再每 2ms 轮询，
+        // 由调用方按自己的间隔重新打开流
+        LOGE(LOG_TAG, "requestStart failed %d times: %s, reopen the stream", startRetries,
+             AAudio_convertResultToText(result));
+        startRetries = 0;
+        startGiveUpCount++;
+        reconfigure = true;
+        finishTransition();
+        return 0;
+    }
+    if (!playing && started) {
+        AAudioStream_requestPause(stream);
+        return AUDIO_CONTROL_POLL_US;
     }
+    // 已经到达目标状态。切换期间又来了新的请求时，下一次调用继续处理
+    if (flushRequests != flushesDone || playing != started) return AUDIO_CONTROL_POLL_US;
+    if (playing) mute = false;
+    finishTransition();
+    return 0;
+}
+
+void AAudioRender::finishTransition() {
+    if (transitionStart == 0) return;
+    int64_t cost = monotonicUs() - transitionStart;
+    transitionStart = 0;
+    transitionCount++;
+    transitionUs += cost;
+    if (cost > transitionMaxUs) transitionMaxUs = cost;
 }
 
 void AAudioRender::setCallback(AAudioCallback cb, void* data) {
@@ -113,8 +249,146 @@ void AAudioRender::setCallback(AAudioCallback cb, void* data) {
 }
 
 void AAudioRender::configure(int32_t sampleRate, int32_t channelCnt, aaudio_format_t fmt) {
-    this->sample_rate = sampleRate;
-    this->channel_count = channelCnt;
-    this->format = fmt;
+    this->req_sample_rate = sampleRate;
+    this->req_channel_count = channelCnt;
+    this->req_format = fmt;
+}
+
+void AAudioRender::setExclusive(bool exclusive) {
+    std::lock_guard<std::mutex> lck(mtx);
+    if (exclusive == req_exclusive) return;
+    req_exclusive = exclusive;
+    if (stream != nullptr) reconfigure = true;
+}
+
+bool AAudioRender::needsReopen() const {
+    return disconnect || reconfigure;
+}
+
+int32_t AAudioRender::sampleRate() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    return sample_rate;
+}
+
+int32_t AAudioRender::channelCount() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    return channel_count;
+}
+
+aaudio_format_t AAudioRender::format() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    return format_;
+}
+
+int AAudioRender::reopens() const {
+    return reopenCount;
+}
+
+size_t AAudioRender::frameBytes() const {
+    return frame_bytes.load(std::memory_order_relaxed);
+}
+
+bool AAudioRender::floatOutput() const {
+    return float_output.load(std::memory_order_relaxed);
+}
+
+bool AAudioRender::exclusiveRequested() const {
+    return req_exclusive;
+}
+
+aaudio_sharing_mode_t AAudioRender::sharingMode() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    return sharing_mode;
+}
+
+aaudio_performance_mode_t AAudioRender::performanceMode() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    return performance_mode;
+}
+
+int AAudioRender::fallbacks() const {
+    return exclusiveFallbacks;
+}
+
+int AAudioRender::transitions() const {
+    return transitionCount;
+}
+
+int64_t AAudioRender::transitionTotalUs() const {
+    return transitionUs;
+}
+
+int64_t AAudioRender::transitionPeakUs() const {
+    return transitionMaxUs;
 }
 
+int AAudioRender::startFailures() const {
+    return startFailureCount;
+}
+
+int AAudioRender::startGiveUps() const {
+    return startGiveUpCount;
+}
+
+void AAudioRender::tune(int64_t nowUs) {
+    std::lock_guard<std::mutex> lck(mtx);
+    if (stream == nullptr) return;
+    if (!playing || mute) {
+        tuner.hold(nowUs);
+        return;
+    }
+    int32_t xr = AAudioStream_getXRunCount(stream);
+    if (xr > streamXRuns) xrunCount += xr - streamXRuns;
+    streamXRuns = std::max(xr, 0);
+    int32_t size = tuner.update(xr, nowUs);
+    if (size > 0) {
+        aaudio_result_t result = AAudioStream_setBufferSizeInFrames(stream, size);
+        if (result > 0) {
+            LOGI(LOG_TAG, "buffer size %d -> %d frames, xruns %d", bufferSize.load(), result, xr);
+            bufferSize = result;
+        }
+    }
+    latency = measureLatencyLocked();
+}
+
+int64_t AAudioRender::measureLatencyLocked() const {
+    if (sample_rate <= 0) return -1;
+    int64_t framePosition, timeNanos;
+    if (AAudioStream_getTimestamp(stream, CLOCK_MONOTONIC, &framePosition, &timeNanos) != AAUDIO_OK) {
+        return -1;
+    }
+    // 时间戳是过去某一时刻正在播放的帧，按经过的时间推算现在播放到的位置
+    struct timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t now = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    int64_t playing = framePosition + (now - timeNanos) * sample_rate / 1000000000LL;
+    int64_t pending = AAudioStream_getFramesWritten(stream) - playing;
+    return pending > 0 ? pending * 1000000 / sample_rate : 0;
+}
+
+int64_t AAudioRender::latencyUs() const {
+    return latency;
+}
+
+int32_t AAudioRender::bufferFrames() const {
+    return bufferSize;
+}
+
+int32_t AAudioRender::burstFrames() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    return tuner.burstFrames();
+}
+
+int32_t AAudioRender::xruns() const {
+    return xrunCount;
+}
+
+int AAudioRender::bufferGrows() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    return tuner.grows();
+}
+
+int AAudioRender::bufferShrinks() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    return tuner.shrinks();
+}
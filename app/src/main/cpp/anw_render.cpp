@@ -1,34 +1,135 @@
 #include <cstring>
 #include "anw_render.h"
+#include "yuv_convert.h"
 #include "log.h"
 
-ANWRender::ANWRender(): native_window(nullptr), width(0), height(0) {}
+// HAL_PIXEL_FORMAT_YV12，NDK 头文件中没有定义。AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420 的
+// 平面布局由驱动决定，ANativeWindow_lock 只返回一个地址和 stride，无法可靠写入，所以不用
+#define WINDOW_FORMAT_YV12 0x32315659
+
+ANWRender::ANWRender(): native_window(nullptr), width(0), height(0), fmt(RenderFormat::RGBA),
+fallbackCount(0), dataSpace(ADATASPACE_UNKNOWN) {}
+
+ANWRender::~ANWRender() {
+    if (native_window != nullptr) {
+        ANativeWindow_release(native_window);
+    }
+}
 
 void ANWRender::init(ANativeWindow *window) {
+    // ANativeWindow_fromSurface 返回的窗口持有一个引用，替换时释放旧的
+    if (native_window != nullptr && native_window != window) {
+        ANativeWindow_release(native_window);
+    }
+    // 是否支持 YV12 是窗口（Surface）的属性，换了窗口重新尝试
+    if (native_window != window) {
+        fallbackCount = 0;
+        dataSpace = ADATASPACE_UNKNOWN;
+    }
     native_window = window;
 }
 
-int ANWRender::setBuffers(int videoWidth, int videoHeight) {
+int ANWRender::setBuffers(int videoWidth, int videoHeight, RenderFormat format) {
     width = videoWidth;
     height = videoHeight;
+    // YV12 的色度平面宽高各为一半，奇数尺寸无法表示
+    fmt = (videoWidth % 2 == 0 && videoHeight % 2 == 0) ? format : RenderFormat::RGBA;
     if (native_window == nullptr) return -1;
+    if (fmt == RenderFormat::YV12) {
+        if (ANativeWindow_setBuffersGeometry(native_window, videoWidth, videoHeight,
+                                             WINDOW_FORMAT_YV12) == 0) {
+            return 0;
+        }
+        LOGW(LOGTAG, "window does not accept YV12, fall back to RGBA");
+        fmt = RenderFormat::RGBA;
+        fallbackCount++;
+    }
     return ANativeWindow_setBuffersGeometry(native_window, videoWidth,
         videoHeight, WINDOW_FORMAT_RGBA_8888);
 }
 
-int ANWRender::render(uint8_t* rgba) {
-    if (native_window == nullptr || rgba == nullptr)
+RenderFormat ANWRender::format() const {
+    return fmt;
+}
+
+bool ANWRender::matches(int w, int h, RenderFormat format) const {
+    return width == w && height == h && fmt == format;
+}
+
+size_t ANWRender::frameBytes() const {
+    return frameBytes(width, height, fmt);
+}
+
+size_t ANWRender::frameBytes(int w, int h, RenderFormat format) {
+    if (format == RenderFormat::YV12) return yv12PackedLayout(w, h).size;
+    return static_cast<size_t>(w) * h * 4;
+}
+
+int ANWRender::fallbacks() const {
+    return fallbackCount;
+}
+
+void ANWRender::setDataSpace(int32_t space) {
+    if (native_window == nullptr || space == dataSpace) return;
+    // 失败时同样记下，不在之后的每一帧重试
+    int ret = ANativeWindow_setBuffersDataSpace(native_window, space);
+    if (ret != 0) LOGW(LOGTAG, "set window dataspace 0x%x failed: %d", space, ret);
+    dataSpace = space;
+}
+
+int ANWRender::render(const uint8_t* data) {
+    if (native_window == nullptr || data == nullptr)
         return -1;
+    if (fmt == RenderFormat::YV12) return renderYv12(data);
 
     ANativeWindow_Buffer out_buffer;
-    ANativeWindow_lock(native_window, &out_buffer, nullptr);
+    if (ANativeWindow_lock(native_window, &out_buffer, nullptr) != 0) return -1;
     int srcLineSize = width * 4;
     int dstLineSize = out_buffer.stride * 4;
     auto* dstBuffer = static_cast<uint8_t *>(out_buffer.bits);
     for (int i = 0; i < height; ++i) {
-        memcpy(dstBuffer + i * dstLineSize, rgba + i * srcLineSize, srcLineSize);
+        memcpy(dstBuffer + i * dstLineSize, data + i * srcLineSize, srcLineSize);
     }
     ANativeWindow_unlockAndPost(native_window);
 
     return 0;
 }
+
+int ANWRender::renderYv12(const uint8_t* data) {
+    ANativeWindow_Buffer out_buffer;
+    int ret = ANativeWindow_lock(native_window, &out_buffer, nullptr);
+    if (ret == 0 && out_buffer.format == WINDOW_FORMAT_YV12 &&
+        out_buffer.width >= width && out_buffer.height >= height) {
+        copyToYv12(yv12Image(data, width, height), static_cast<uint8_t *>(out_buffer.bits),
+                   yv12WindowLayout(out_buffer.stride, height));
+        ANativeWindow_unlockAndPost(native_window);
+        return 0;
+    }
+    // 部分设备接受 YV12 的几何设置但锁定失败，或者锁定后给出的是其他格式的缓冲区，之后改用 RGBA
+    LOGW(LOGTAG, "lock YV12 window buffer failed (ret %d, format 0x%x), fall back to RGBA",
+         ret, ret == 0 ? out_buffer.format : 0);
+    fallbackCount++;
+    if (ret == 0) {
+        // 已经锁定的缓冲区只能通过提交来解锁，先按它的实际格式写入这一帧，不提交未写入的内容
+        fillLocked(out_buffer, data);
+        ANativeWindow_unlockAndPost(native_window);
+    }
+    setBuffers(width, height, RenderFormat::RGBA);
+    return ret == 0 ? 0 : -1;
+}
+
+void ANWRender::fillLocked(const ANativeWindow_Buffer &buffer, const uint8_t *yv12) {
+    auto *bits = static_cast<uint8_t *>(buffer.bits);
+    bool rgba = buffer.format == WINDOW_FORMAT_RGBA_8888 || buffer.format == WINDOW_FORMAT_RGBX_8888;
+    if (rgba && buffer.width >= width && buffer.height >= height) {
+        // 与窗口显示 YV12 时默认的颜色标准一致
+        converter.convert(yv12Image(yv12, width, height), bits, buffer.stride * 4);
+        return;
+    }
+    // 不认识的格式或尺寸不符时写成黑色（RGB 各分量为 0）
+    int bpp = buffer.format == WINDOW_FORMAT_RGB_565 ? 2 : 4;
+    for (int i = 0; i < buffer.height; ++i) {
+        memset(bits + static_cast<size_t>(i) * buffer.stride * bpp, 0,
+               static_cast<size_t>(buffer.width) * bpp);
+    }
+}
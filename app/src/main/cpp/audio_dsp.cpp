@@ -0,0 +1,530 @@
+#include <algorithm>
+#include <cmath>
+#include "audio_dsp.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DSP_X86 1
+#endif
+
+#define S16_SCALE 32767.0f
+#define S16_INV_SCALE (1.0f / 32767.0f)  // 与 S16_SCALE 互逆，S16 往返转换不变
+
+// 软削波：u = (|x| - knee) / (1 - knee)，|y| = knee + (1 - knee) * u / (1 + u)，
+// 在 knee 处斜率为 1，|x| 趋于无穷时 |y| 趋于 1
+static const float kClipRange = 1.0f - AUDIO_SOFT_CLIP_KNEE;
+static const float kClipInvRange = 1.0f / (1.0f - AUDIO_SOFT_CLIP_KNEE);
+
+static void toS16Scalar(const float *in, int16_t *out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        float x = std::min(std::max(in[i] * S16_SCALE, -32768.0f), 32767.0f);
+        out[i] = static_cast<int16_t>(lrintf(x));
+    }
+}
+
+static void fromS16Scalar(const int16_t *in, float *out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = in[i] * S16_INV_SCALE;
+    }
+}
+
+// 第 i 个样本的增益为 from + step * i，SIMD 实现按同样的公式计算，不累加误差
+static void gainScalarFrom(float *buf, size_t begin, size_t n, float from, float step) {
+    for (size_t i = begin; i < n; ++i) {
+        buf[i] *= from + step * static_cast<float>(i);
+    }
+}
+
+static void gainScalar(float *buf, size_t n, float from, float to) {
+    if (n == 0) return;
+    gainScalarFrom(buf, 0, n, from, (to - from) / static_cast<float>(n));
+}
+
+static void downmixScalarFrom(const float *in, int channels, const float *m, float *out,
+                              size_t begin, size_t frames) {
+    for (size_t f = begin; f < frames; ++f) {
+        const float *s = in + f * channels;
+        float l = 0.0f, r = 0.0f;
+        for (int c = 0; c < channels; ++c) {
+            l += m[c] * s[c];
+            r += m[channels + c] * s[c];
+        }
+        out[f * 2] = l;
+        out[f * 2 + 1] = r;
+    }
+}
+
+static void downmixScalar(const float *in, int channels, const float *m, float *out, size_t frames) {
+    downmixScalarFrom(in, channels, m, out, 0, frames);
+}
+
+static size_t clipScalarFrom(float *buf, size_t begin, size_t n) {
+    size_t clipped = 0;
+    for (size_t i = begin; i < n; ++i) {
+        float ax = std::fabs(buf[i]);
+        if (ax <= AUDIO_SOFT_CLIP_KNEE) continue;
+        float u = (ax - AUDIO_SOFT_CLIP_KNEE) * kClipInvRange;
+        buf[i] = std::copysign(AUDIO_SOFT_CLIP_KNEE + kClipRange * u / (1.0f + u), buf[i]);
+        clipped++;
+    }
+    return clipped;
+}
+
+static size_t clipScalar(float *buf, size_t n) {
+    return clipScalarFrom(buf, 0, n);
+}
+
+static float peakScalarFrom(const float *buf, size_t begin, size_t n) {
+    float peak = 0.0f;
+    for (size_t i = begin; i < n; ++i) peak = std::max(peak, std::fabs(buf[i]));
+    return peak;
+}
+
+static float peakScalar(const float *buf, size_t n) {
+    return peakScalarFrom(buf, 0, n);
+}
+
+#if defined(__ARM_NEON)
+static inline int32x4_t roundNeon(float32x4_t x) {
+#if defined(__aarch64__)
+    return vcvtnq_s32_f32(x);
+#else
+    // ARMv7 没有按当前舍入模式转换的指令，改为四舍五入（远离零）
+    float32x4_t half = vbslq_f32(vdupq_n_u32(0x80000000u), x, vdupq_n_f32(0.5f));
+    return vcvtq_s32_f32(vaddq_f32(x, half));
+#endif
+}
+
+static void toS16Neon(const float *in, int16_t *out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        // 转换和收窄都是饱和的
+        int32x4_t a = roundNeon(vmulq_n_f32(vld1q_f32(in + i), S16_SCALE));
+        int32x4_t b = roundNeon(vmulq_n_f32(vld1q_f32(in + i + 4), S16_SCALE));
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+    }
+    toS16Scalar(in + i, out + i, n - i);
+}
+
+static void fromS16Neon(const int16_t *in, float *out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t s = vld1q_s16(in + i);
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))), S16_INV_SCALE));
+        vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))), S16_INV_SCALE));
+    }
+    fromS16Scalar(in + i, out + i, n - i);
+}
+
+static void gainNeon(float *buf, size_t n, float from, float to) {
+    if (n == 0) return;
+    float step = (to - from) / static_cast<float>(n);
+    const float lanes[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+    float32x4_t idx = vld1q_f32(lanes);
+    float32x4_t four = vdupq_n_f32(4.0f);
+    float32x4_t base = vdupq_n_f32(from);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t g = vmlaq_n_f32(base, idx, step);
+        vst1q_f32(buf + i, vmulq_f32(vld1q_f32(buf + i), g));
+        idx = vaddq_f32(idx, four);
+    }
+    gainScalarFrom(buf, i, n, from, step);
+}
+
+// 每帧左右两个点积，最后用一次成对相加得到 [L, R]
+static void downmixNeon(const float *in, int channels, const float *m, float *out, size_t frames) {
+    if (channels == 8) {
+        float32x4_t l0 = vld1q_f32(m), l1 = vld1q_f32(m + 4);
+        float32x4_t r0 = vld1q_f32(m + 8), r1 = vld1q_f32(m + 12);
+        for (size_t f = 0; f < frames; ++f) {
+            float32x4_t a = vld1q_f32(in + f * 8), b = vld1q_f32(in + f * 8 + 4);
+            float32x4_t l = vmlaq_f32(vmulq_f32(a, l0), b, l1);
+            float32x4_t r = vmlaq_f32(vmulq_f32(a, r0), b, r1);
+            float32x2_t lr = vpadd_f32(vadd_f32(vget_low_f32(l), vget_high_f32(l)),
+                                       vadd_f32(vget_low_f32(r), vget_high_f32(r)));
+            vst1_f32(out + f * 2, lr);
+        }
+    } else if (channels == 6) {
+        float32x4_t l0 = vld1q_f32(m), r0 = vld1q_f32(m + 6);
+        float32x2_t l1 = vld1_f32(m + 4), r1 = vld1_f32(m + 10);
+        for (size_t f = 0; f < frames; ++f) {
+            float32x4_t a = vld1q_f32(in + f * 6);
+            float32x2_t b = vld1_f32(in + f * 6 + 4);
+            float32x4_t l = vmulq_f32(a, l0);
+            float32x4_t r = vmulq_f32(a, r0);
+            float32x2_t l2 = vmla_f32(vadd_f32(vget_low_f32(l), vget_high_f32(l)), b, l1);
+            float32x2_t r2 = vmla_f32(vadd_f32(vget_low_f32(r), vget_high_f32(r)), b, r1);
+            vst1_f32(out + f * 2, vpadd_f32(l2, r2));
+        }
+    } else {
+        downmixScalar(in, channels, m, out, frames);
+    }
+}
+
+static size_t clipNeon(float *buf, size_t n) {
+    float32x4_t knee = vdupq_n_f32(AUDIO_SOFT_CLIP_KNEE);
+    float32x4_t one = vdupq_n_f32(1.0f);
+    float32x4_t zero = vdupq_n_f32(0.0f);
+    uint32x4_t sign = vdupq_n_u32(0x80000000u);
+    uint32x4_t count = vdupq_n_u32(0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t x = vld1q_f32(buf + i);
+        float32x4_t ax = vabsq_f32(x);
+        uint32x4_t over = vcgtq_f32(ax, knee);
+        count = vsubq_u32(count, over);
+        float32x4_t u = vmulq_n_f32(vmaxq_f32(vsubq_f32(ax, knee), zero), kClipInvRange);
+        // 1 / (1 + u)：倒数估计加两次牛顿迭代，ARMv7 没有除法指令
+        float32x4_t d = vaddq_f32(one, u);
+        float32x4_t r = vrecpeq_f32(d);
+        r = vmulq_f32(vrecpsq_f32(d, r), r);
+        r = vmulq_f32(vrecpsq_f32(d, r), r);
+        float32x4_t y = vmlaq_n_f32(vminq_f32(ax, knee), vmulq_f32(u, r), kClipRange);
+        vst1q_f32(buf + i, vbslq_f32(sign, x, y));
+    }
+    uint32x2_t c2 = vadd_u32(vget_low_u32(count), vget_high_u32(count));
+    size_t clipped = vget_lane_u32(vpadd_u32(c2, c2), 0);
+    return clipped + clipScalarFrom(buf, i, n);
+}
+
+static float peakNeon(const float *buf, size_t n) {
+    float32x4_t m = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) m = vmaxq_f32(m, vabsq_f32(vld1q_f32(buf + i)));
+    float32x2_t m2 = vpmax_f32(vget_low_f32(m), vget_high_f32(m));
+    float peak = vget_lane_f32(vpmax_f32(m2, m2), 0);
+    return std::max(peak, peakScalarFrom(buf, i, n));
+}
+#endif
+
+#if defined(DSP_X86)
+__attribute__((target("sse4.1")))
+static void toS16Sse41(const float *in, int16_t *out, size_t n) {
+    __m128 scale = _mm_set1_ps(S16_SCALE);
+    __m128 lo = _mm_set1_ps(-32768.0f), hi = _mm_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        // 先在 float 中截断，超出 int32 范围的值转换后会变成 0x80000000
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale), lo), hi);
+        __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), scale), lo), hi);
+        __m128i p = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), p);
+    }
+    toS16Scalar(in + i, out + i, n - i);
+}
+
+__attribute__((target("sse4.1")))
+static void fromS16Sse41(const int16_t *in, float *out, size_t n) {
+    __m128 scale = _mm_set1_ps(S16_INV_SCALE);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        __m128 a = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(s));
+        __m128 b = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_srli_si128(s, 8)));
+        _mm_storeu_ps(out + i, _mm_mul_ps(a, scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(b, scale));
+    }
+    fromS16Scalar(in + i, out + i, n - i);
+}
+
+__attribute__((target("sse4.1")))
+static void gainSse41(float *buf, size_t n, float from, float to) {
+    if (n == 0) return;
+    float step = (to - from) / static_cast<float>(n);
+    __m128 idx = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    __m128 four = _mm_set1_ps(4.0f);
+    __m128 base = _mm_set1_ps(from), vstep = _mm_set1_ps(step);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 g = _mm_add_ps(base, _mm_mul_ps(vstep, idx));
+        _mm_storeu_ps(buf + i, _mm_mul_ps(_mm_loadu_ps(buf + i), g));
+        idx = _mm_add_ps(idx, four);
+    }
+    gainScalarFrom(buf, i, n, from, step);
+}
+
+// 两次水平相加得到 [L, R, L, R]，只写低 64 位
+__attribute__((target("sse4.1")))
+static void downmixSse41(const float *in, int channels, const float *m, float *out, size_t frames) {
+    if (channels == 8) {
+        __m128 l0 = _mm_loadu_ps(m), l1 = _mm_loadu_ps(m + 4);
+        __m128 r0 = _mm_loadu_ps(m + 8), r1 = _mm_loadu_ps(m + 12);
+        for (size_t f = 0; f < frames; ++f) {
+            __m128 a = _mm_loadu_ps(in + f * 8), b = _mm_loadu_ps(in + f * 8 + 4);
+            __m128 l = _mm_add_ps(_mm_mul_ps(a, l0), _mm_mul_ps(b, l1));
+            __m128 r = _mm_add_ps(_mm_mul_ps(a, r0), _mm_mul_ps(b, r1));
+            __m128 h = _mm_hadd_ps(l, r);
+            _mm_storel_pi(reinterpret_cast<__m64 *>(out + f * 2), _mm_hadd_ps(h, h));
+        }
+    } else if (channels == 6) {
+        __m128 l0 = _mm_loadu_ps(m), r0 = _mm_loadu_ps(m + 6);
+        __m128 l1 = _mm_setr_ps(m[4], m[5], 0.0f, 0.0f), r1 = _mm_setr_ps(m[10], m[11], 0.0f, 0.0f);
+        for (size_t f = 0; f < frames; ++f) {
+            const float *s = in + f * 6;
+            __m128 a = _mm_loadu_ps(s);
+            __m128 b = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double *>(s + 4)));
+            __m128 l = _mm_add_ps(_mm_mul_ps(a, l0), _mm_mul_ps(b, l1));
+            __m128 r = _mm_add_ps(_mm_mul_ps(a, r0), _mm_mul_ps(b, r1));
+            __m128 h = _mm_hadd_ps(l, r);
+            _mm_storel_pi(reinterpret_cast<__m64 *>(out + f * 2), _mm_hadd_ps(h, h));
+        }
+    } else {
+        downmixScalar(in, channels, m, out, frames);
+    }
+}
+
+__attribute__((target("sse4.1,popcnt")))
+static size_t clipSse41(float *buf, size_t n) {
+    __m128 knee = _mm_set1_ps(AUDIO_SOFT_CLIP_KNEE);
+    __m128 one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps();
+    __m128 range = _mm_set1_ps(kClipRange), invRange = _mm_set1_ps(kClipInvRange);
+    __m128 sign = _mm_set1_ps(-0.0f);
+    size_t clipped = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(buf + i);
+        __m128 ax = _mm_andnot_ps(sign, x);
+        int over = _mm_movemask_ps(_mm_cmpgt_ps(ax, knee));
+        if (over == 0) continue;
+        clipped += _mm_popcnt_u32(over);
+        __m128 u = _mm_mul_ps(_mm_max_ps(_mm_sub_ps(ax, knee), zero), invRange);
+        __m128 y = _mm_add_ps(_mm_min_ps(ax, knee),
+                              _mm_mul_ps(range, _mm_div_ps(u, _mm_add_ps(one, u))));
+        _mm_storeu_ps(buf + i, _mm_or_ps(y, _mm_and_ps(sign, x)));
+    }
+    return clipped + clipScalarFrom(buf, i, n);
+}
+
+__attribute__((target("sse4.1")))
+static float peakSse41(const float *buf, size_t n) {
+    __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 m = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) m = _mm_max_ps(m, _mm_andnot_ps(sign, _mm_loadu_ps(buf + i)));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+    return std::max(_mm_cvtss_f32(m), peakScalarFrom(buf, i, n));
+}
+
+__attribute__((target("avx2")))
+static void toS16Avx2(const float *in, int16_t *out, size_t n) {
+    __m256 scale = _mm256_set1_ps(S16_SCALE);
+    __m256 lo = _mm256_set1_ps(-32768.0f), hi = _mm256_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 a = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i), scale), lo), hi);
+        __m256 b = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i + 8), scale), lo), hi);
+        // packs 在每个 128 位内交错两个输入，再按 64 位重排回顺序
+        __m256i p = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_permute4x64_epi64(p, 0xD8));
+    }
+    toS16Sse41(in + i, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void fromS16Avx2(const int16_t *in, float *out, size_t n) {
+    __m256 scale = _mm256_set1_ps(S16_INV_SCALE);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        __m256 a = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(s));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(a, scale));
+    }
+    fromS16Scalar(in + i, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void gainAvx2(float *buf, size_t n, float from, float to) {
+    if (n == 0) return;
+    float step = (to - from) / static_cast<float>(n);
+    __m256 idx = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    __m256 eight = _mm256_set1_ps(8.0f);
+    __m256 base = _mm256_set1_ps(from), vstep = _mm256_set1_ps(step);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 g = _mm256_add_ps(base, _mm256_mul_ps(vstep, idx));
+        _mm256_storeu_ps(buf + i, _mm256_mul_ps(_mm256_loadu_ps(buf + i), g));
+        idx = _mm256_add_ps(idx, eight);
+    }
+    gainScalarFrom(buf, i, n, from, step);
+}
+
+// 一帧正好一个（6 声道时带掩码的）256 位向量
+__attribute__((target("avx2")))
+static void downmixAvx2(const float *in, int channels, const float *m, float *out, size_t frames) {
+    if (channels != 8 && channels != 6) {
+        downmixScalar(in, channels, m, out, frames);
+        return;
+    }
+    __m256i mask = _mm256_setr_epi32(-1, -1, -1, -1, -1, -1, channels == 8 ? -1 : 0, channels == 8 ? -1 : 0);
+    __m256 l0 = _mm256_maskload_ps(m, mask), r0 = _mm256_maskload_ps(m + channels, mask);
+    for (size_t f = 0; f < frames; ++f) {
+        __m256 a = _mm256_maskload_ps(in + f * channels, mask);
+        __m256 h = _mm256_hadd_ps(_mm256_mul_ps(a, l0), _mm256_mul_ps(a, r0));
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(h), _mm256_extractf128_ps(h, 1));
+        _mm_storel_pi(reinterpret_cast<__m64 *>(out + f * 2), _mm_hadd_ps(s, s));
+    }
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t clipAvx2(float *buf, size_t n) {
+    __m256 knee = _mm256_set1_ps(AUDIO_SOFT_CLIP_KNEE);
+    __m256 one = _mm256_set1_ps(1.0f), zero = _mm256_setzero_ps();
+    __m256 range = _mm256_set1_ps(kClipRange), invRange = _mm256_set1_ps(kClipInvRange);
+    __m256 sign = _mm256_set1_ps(-0.0f);
+    size_t clipped = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(buf + i);
+        __m256 ax = _mm256_andnot_ps(sign, x);
+        int over = _mm256_movemask_ps(_mm256_cmp_ps(ax, knee, _CMP_GT_OQ));
+        if (over == 0) continue;
+        clipped += _mm_popcnt_u32(over);
+        __m256 u = _mm256_mul_ps(_mm256_max_ps(_mm256_sub_ps(ax, knee), zero), invRange);
+        __m256 y = _mm256_add_ps(_mm256_min_ps(ax, knee),
+                                 _mm256_mul_ps(range, _mm256_div_ps(u, _mm256_add_ps(one, u))));
+        _mm256_storeu_ps(buf + i, _mm256_or_ps(y, _mm256_and_ps(sign, x)));
+    }
+    return clipped + clipScalarFrom(buf, i, n);
+}
+
+__attribute__((target("avx2")))
+static float peakAvx2(const float *buf, size_t n) {
+    __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 m = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) m = _mm256_max_ps(m, _mm256_andnot_ps(sign, _mm256_loadu_ps(buf + i)));
+    __m128 h = _mm_max_ps(_mm256_castps256_ps128(m), _mm256_extractf128_ps(m, 1));
+    h = _mm_max_ps(h, _mm_movehl_ps(h, h));
+    h = _mm_max_ss(h, _mm_shuffle_ps(h, h, 1));
+    return std::max(_mm_cvtss_f32(h), peakScalarFrom(buf, i, n));
+}
+#endif
+
+AudioDsp::AudioDsp(SimdLevel level): simd(SimdLevel::Scalar), toS16(toS16Scalar),
+fromS16(fromS16Scalar), gain(gainScalar), downmix(downmixScalar), clip(clipScalar),
+peakOf(peakScalar) {
+    // 请求的级别在当前编译目标上不可用时退回标量实现
+#if defined(__ARM_NEON)
+    if (level == SimdLevel::Neon) {
+        simd = level;
+        toS16 = toS16Neon;
+        fromS16 = fromS16Neon;
+        gain = gainNeon;
+        downmix = downmixNeon;
+        clip = clipNeon;
+        peakOf = peakNeon;
+    }
+#elif defined(DSP_X86)
+    if (level == SimdLevel::Avx2) {
+        simd = level;
+        toS16 = toS16Avx2;
+        fromS16 = fromS16Avx2;
+        gain = gainAvx2;
+        downmix = downmixAvx2;
+        clip = clipAvx2;
+        peakOf = peakAvx2;
+    } else if (level == SimdLevel::Sse41) {
+        simd = level;
+        toS16 = toS16Sse41;
+        fromS16 = fromS16Sse41;
+        gain = gainSse41;
+        downmix = downmixSse41;
+        clip = clipSse41;
+        peakOf = peakSse41;
+    }
+#else
+    (void) level;
+#endif
+}
+
+SimdLevel AudioDsp::level() const {
+    return simd;
+}
+
+void AudioDsp::floatToS16(const float *in, int16_t *out, size_t samples) const {
+    toS16(in, out, samples);
+}
+
+void AudioDsp::s16ToFloat(const int16_t *in, float *out, size_t samples) const {
+    fromS16(in, out, samples);
+}
+
+void AudioDsp::gainRamp(float *buf, size_t samples, float from, float to) const {
+    gain(buf, samples, from, to);
+}
+
+void AudioDsp::downmixStereo(const float *in, int channels, const float *matrix, float *out,
+                             size_t frames) const {
+    downmix(in, channels, matrix, out, frames);
+}
+
+size_t AudioDsp::softClip(float *buf, size_t samples) const {
+    return clip(buf, samples);
+}
+
+float AudioDsp::peak(const float *buf, size_t samples) const {
+    return peakOf(buf, samples);
+}
+
+bool stereoDownmixMatrix(int channels, float center, float surround, float lfe, float *matrix) {
+    if (channels != 6 && channels != 8) return false;
+    float *l = matrix, *r = matrix + channels;
+    std::fill(matrix, matrix + 2 * channels, 0.0f);
+    l[0] = r[1] = 1.0f;
+    l[2] = r[2] = center;
+    l[3] = r[3] = lfe;
+    // 5.1 的 4、5 和 7.1 的 4 ~ 7 都是左右成对的环绕声道
+    for (int c = 4; c < channels; c += 2) {
+        l[c] = surround;
+        r[c + 1] = surround;
+    }
+    float sum = 0.0f;
+    for (int c = 0; c < channels; ++c) sum += std::fabs(l[c]);
+    if (sum > 1.0f) {
+        for (int c = 0; c < 2 * channels; ++c) matrix[c] /= sum;
+    }
+    return true;
+}
+
+void GainControl::setTarget(float g) {
+    targetGain.store(g, std::memory_order_relaxed);
+}
+
+float GainControl::target() const {
+    return targetGain.load(std::memory_order_relaxed);
+}
+
+float GainControl::step(size_t samples) {
+    float t = targetGain.load(std::memory_order_relaxed);
+    float maxDelta = static_cast<float>(samples) / AUDIO_GAIN_RAMP_SAMPLES;
+    current += std::min(std::max(t - current, -maxDelta), maxDelta);
+    return current;
+}
+
+void GainControl::process(const AudioDsp &dsp, float *buf, size_t samples) {
+    float from = current;
+    float to = step(samples);
+    if (from == 1.0f && to == 1.0f) return;
+    dsp.gainRamp(buf, samples, from, to);
+    if (std::max(from, to) > 1.0f) dsp.softClip(buf, samples);
+}
+
+void GainControl::process(const AudioDsp &dsp, int16_t *buf, size_t samples) {
+    float from = current;
+    float to = step(samples);
+    if (from == 1.0f && to == 1.0f) return;
+    // 分段转成 float 处理，栈上的缓冲区不需要分配
+    float tmp[256];
+    float delta = samples > 0 ? (to - from) / static_cast<float>(samples) : 0.0f;
+    for (size_t i = 0; i < samples; i += 256) {
+        size_t n = std::min<size_t>(256, samples - i);
+        float g0 = from + delta * static_cast<float>(i);
+        dsp.s16ToFloat(buf + i, tmp, n);
+        dsp.gainRamp(tmp, n, g0, g0 + delta * static_cast<float>(n));
+        dsp.floatToS16(tmp, buf + i, n);
+    }
+}
@@ -0,0 +1,68 @@
+#include <algorithm>
+#include "buffer_tuner.h"
+
+AudioBufferTuner::AudioBufferTuner(): burst(0), capacity(0), size(0), lastXRuns(-1),
+stableSince(0), stablePeriodUs(AUDIO_STABLE_PERIOD_US), shrunk(false), growCount(0),
+shrinkCount(0) {}
+
+int32_t AudioBufferTuner::reset(int32_t framesPerBurst, int32_t capacityFrames) {
+    burst = std::max(framesPerBurst, 1);
+    capacity = std::max(capacityFrames, burst);
+    size = std::min(burst * AUDIO_MIN_BUFFER_BURSTS, capacity);
+    lastXRuns = -1;
+    stablePeriodUs = AUDIO_STABLE_PERIOD_US;
+    shrunk = false;
+    return size;
+}
+
+int32_t AudioBufferTuner::update(int32_t xruns, int64_t nowUs) {
+    if (burst == 0) return 0;
+    if (lastXRuns < 0 || xruns < lastXRuns) {
+        // 第一次调用，或者流重新打开后计数从零开始
+        lastXRuns = xruns;
+        stableSince = nowUs;
+        return 0;
+    }
+    if (xruns > lastXRuns) {
+        lastXRuns = xruns;
+        stableSince = nowUs;
+        if (shrunk) {
+            stablePeriodUs = std::min<int64_t>(stablePeriodUs * 2, AUDIO_MAX_STABLE_PERIOD_US);
+            shrunk = false;
+        }
+        if (size + burst > capacity) return 0;
+        size += burst;
+        growCount++;
+        return size;
+    }
+    if (nowUs - stableSince < stablePeriodUs) return 0;
+    stableSince = nowUs;
+    if (size - burst < burst * AUDIO_MIN_BUFFER_BURSTS) {
+        shrunk = false;
+        return 0;
+    }
+    size -= burst;
+    shrunk = true;
+    shrinkCount++;
+    return size;
+}
+
+void AudioBufferTuner::hold(int64_t nowUs) {
+    stableSince = nowUs;
+}
+
+int32_t AudioBufferTuner::bufferFrames() const {
+    return size;
+}
+
+int32_t AudioBufferTuner::burstFrames() const {
+    return burst;
+}
+
+int AudioBufferTuner::grows() const {
+    return growCount;
+}
+
+int AudioBufferTuner::shrinks() const {
+    return shrinkCount;
+}
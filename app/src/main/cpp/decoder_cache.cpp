@@ -0,0 +1,116 @@
+#include "decoder_cache.h"
+
+// FNV-1a，extradata 只有几十到几百字节
+static uint64_t hashBytes(const uint8_t *data, int size) {
+    uint64_t h = 14695981039346656037ULL;
+    for (int i = 0; i < size; ++i) {
+        h ^= data[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+bool DecoderKey::sameStream(const DecoderKey &other) const {
+    return codecId == other.codecId && extradataHash == other.extradataHash &&
+           extradataSize == other.extradataSize;
+}
+
+bool DecoderKey::operator==(const DecoderKey &other) const {
+    return sameStream(other) && codecTag == other.codecTag && profile == other.profile &&
+           bitsPerCodedSample == other.bitsPerCodedSample && bitsPerRawSample == other.bitsPerRawSample &&
+           width == other.width && height == other.height &&
+           format == other.format && sampleRate == other.sampleRate &&
+           channels == other.channels && channelLayout == other.channelLayout &&
+           blockAlign == other.blockAlign && frameSize == other.frameSize &&
+           lowres == other.lowres && flags2 == other.flags2;
+}
+
+DecoderCache::~DecoderCache() {
+    clear();
+}
+
+DecoderKey DecoderCache::keyOf(const AVCodecParameters *par, int lowres, int flags2) {
+    DecoderKey key;
+    key.codecId = par->codec_id;
+    key.extradataHash = hashBytes(par->extradata, par->extradata ? par->extradata_size : 0);
+    key.extradataSize = par->extradata ? par->extradata_size : 0;
+    key.codecTag = par->codec_tag;
+    key.profile = par->profile;
+    key.bitsPerCodedSample = par->bits_per_coded_sample;
+    key.bitsPerRawSample = par->bits_per_raw_sample;
+    key.format = par->format;
+    key.lowres = lowres;
+    key.flags2 = flags2;
+    if (par->codec_type == AVMEDIA_TYPE_VIDEO) {
+        key.width = par->width;
+        key.height = par->height;
+    } else {
+        key.sampleRate = par->sample_rate;
+        key.channels = par->channels;
+        key.channelLayout = par->channel_layout;
+        key.blockAlign = par->block_align;
+        key.frameSize = par->frame_size;
+    }
+    return key;
+}
+
+AVCodecContext *DecoderCache::acquire(const DecoderKey &key) {
+    std::lock_guard<std::mutex> lck(mtx);
+    bool sameStream = false;
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (it->key == key) {
+            AVCodecContext *ctx = it->ctx;
+            entries.erase(it);
+            hitCount++;
+            return ctx;
+        }
+        sameStream = sameStream || it->key.sameStream(key);
+    }
+    if (sameStream) mismatchCount++;
+    missCount++;
+    return nullptr;
+}
+
+void DecoderCache::release(const DecoderKey &key, AVCodecContext *ctx) {
+    if (ctx == nullptr) return;
+    // 丢掉上一个文件残留的帧和排空状态，恢复默认的跳帧设置
+    avcodec_flush_buffers(ctx);
+    ctx->skip_frame = AVDISCARD_DEFAULT;
+    AVCodecContext *evicted = nullptr;
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        if (entries.size() >= DECODER_CACHE_SIZE) {
+            evicted = entries.front().ctx;
+            entries.erase(entries.begin());
+            evictCount++;
+        }
+        entries.push_back(Entry{key, ctx});
+    }
+    // 关闭解码器要等它的线程退出，不在锁内进行
+    avcodec_free_context(&evicted);
+}
+
+void DecoderCache::clear() {
+    std::vector<Entry> dropped;
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        dropped.swap(entries);
+    }
+    for (auto &e : dropped) avcodec_free_context(&e.ctx);
+}
+
+uint64_t DecoderCache::hits() const {
+    return hitCount;
+}
+
+uint64_t DecoderCache::misses() const {
+    return missCount;
+}
+
+uint64_t DecoderCache::mismatches() const {
+    return mismatchCount;
+}
+
+uint64_t DecoderCache::evictions() const {
+    return evictCount;
+}
@@ -0,0 +1,323 @@
+#include <cinttypes>
+#include <cstdio>
+#include "filter_graph.h"
+#include "log.h"
+
+extern "C" {
+#include "libavutil/channel_layout.h"
+#include "libavutil/time.h"
+}
+
+// 送入帧时立即处理完，格式变化由 send 检查并重建，不需要 buffersrc 再检查
+static const int kPushFlags = AV_BUFFERSRC_FLAG_PUSH | AV_BUFFERSRC_FLAG_NO_CHECK_FORMAT;
+
+// 按顶层的 "," 拆分滤镜链，跳过转义字符和引号中的内容。带标签或 ";" 的复杂描述不拆分
+static std::vector<std::string> splitChain(const std::string &desc) {
+    std::vector<std::string> parts;
+    if (desc.find_first_of("[;") != std::string::npos) {
+        parts.push_back(desc);
+        return parts;
+    }
+    std::string cur;
+    bool quoted = false;
+    for (size_t i = 0; i < desc.size(); ++i) {
+        char c = desc[i];
+        if (c == '\\' && i + 1 < desc.size()) {
+            cur += c;
+            cur += desc[++i];
+            continue;
+        }
+        if (c == '\'') quoted = !quoted;
+        if (c == ',' && !quoted) {
+            parts.push_back(cur);
+            cur.clear();
+            continue;
+        }
+        cur += c;
+    }
+    parts.push_back(cur);
+    // 去掉首尾空白，丢弃空段
+    std::vector<std::string> trimmed;
+    for (auto &p : parts) {
+        size_t b = p.find_first_not_of(" \t");
+        if (b == std::string::npos) continue;
+        size_t e = p.find_last_not_of(" \t");
+        trimmed.push_back(p.substr(b, e - b + 1));
+    }
+    return trimmed;
+}
+
+static std::string filterName(const std::string &segment) {
+    if (segment.find_first_of("[;") != std::string::npos) return "graph";
+    return segment.substr(0, segment.find('='));
+}
+
+FilterGraph::FilterGraph(AVMediaType type): mediaType(type), dirty(false), active(false),
+input{}, outTimeBase{0, 1}, failed(false), ended(false), rebuildCount(0), errorCount(0) {
+    scratch = av_frame_alloc();
+    for (int i = 0; i < MAX_FILTER_LINKS; ++i) {
+        linkFrames[i] = 0;
+        linkUs[i] = 0;
+    }
+}
+
+FilterGraph::~FilterGraph() {
+    destroy();
+    av_frame_free(&scratch);
+}
+
+void FilterGraph::setDescription(const std::string &desc) {
+    std::lock_guard<std::mutex> lck(mtx);
+    pendingDesc = desc;
+    active = !desc.empty();
+    dirty = true;
+}
+
+bool FilterGraph::enabled() const {
+    return active;
+}
+
+FilterGraph::Format FilterGraph::formatOf(const AVFrame *frame, AVRational timeBase) const {
+    Format f{};
+    f.format = frame->format;
+    f.timeBase = timeBase;
+    if (mediaType == AVMEDIA_TYPE_VIDEO) {
+        f.width = frame->width;
+        f.height = frame->height;
+        f.sar = frame->sample_aspect_ratio;
+    } else {
+        f.sampleRate = frame->sample_rate;
+        f.channelLayout = frame->channel_layout != 0 ? frame->channel_layout :
+                          av_get_default_channel_layout(frame->channels);
+    }
+    return f;
+}
+
+bool FilterGraph::sameFormat(const Format &a, const Format &b) const {
+    return a.format == b.format && a.width == b.width && a.height == b.height &&
+           av_cmp_q(a.sar, b.sar) == 0 && a.sampleRate == b.sampleRate &&
+           a.channelLayout == b.channelLayout && av_cmp_q(a.timeBase, b.timeBase) == 0;
+}
+
+bool FilterGraph::send(AVFrame *frame, AVRational timeBase) {
+    if (dirty.exchange(false)) {
+        // 描述变化：丢掉旧的图，统计从头开始
+        destroy();
+        std::lock_guard<std::mutex> lck(mtx);
+        segments = splitChain(pendingDesc);
+        if (segments.size() > MAX_FILTER_LINKS) {
+            LOGW(LOGTAG, "filter chain has %zu links, at most %d supported", segments.size(),
+                 MAX_FILTER_LINKS);
+            segments.clear();
+        }
+        names.clear();
+        for (size_t i = 0; i < segments.size(); ++i) {
+            names.push_back(filterName(segments[i]));
+            linkFrames[i] = 0;
+            linkUs[i] = 0;
+        }
+        input = Format{};
+        failed = false;
+    }
+    if (segments.empty()) return false;
+    // 已经送入过空帧的链不能再接收数据，剩余的输出已经由调用方取完
+    if (ended) destroy();
+
+    Format in = formatOf(frame, timeBase);
+    bool formatChanged = !sameFormat(in, input);
+    if (links.empty() || formatChanged) {
+        // 同样的描述和格式建图失败过就不再重试，每帧都重试代价太大
+        if (failed && !formatChanged) return false;
+        destroy();
+        input = in;
+        failed = !build(in);
+        if (failed) {
+            destroy();
+            return false;
+        }
+    }
+
+    // PUSH 让滤镜在送入时就处理完，耗时计入这一段
+    int64_t t0 = av_gettime_relative();
+    int ret = av_buffersrc_add_frame_flags(links[0].src, frame, kPushFlags);
+    linkUs[0] += av_gettime_relative() - t0;
+    linkFrames[0]++;
+    if (ret < 0) {
+        addFailed(0, ret);
+        av_frame_unref(frame);
+        return true;
+    }
+    for (size_t i = 0; i + 1 < links.size(); ++i) {
+        forward(i);
+    }
+    return true;
+}
+
+void FilterGraph::forward(size_t i) {
+    // 前一段的输出以引用送进下一段。某一帧送不进去时丢掉这一帧，继续处理后面的
+    while (av_buffersink_get_frame_flags(links[i].sink, scratch, AV_BUFFERSINK_FLAG_NO_REQUEST) >= 0) {
+        int64_t t0 = av_gettime_relative();
+        int ret = av_buffersrc_add_frame_flags(links[i + 1].src, scratch, kPushFlags);
+        linkUs[i + 1] += av_gettime_relative() - t0;
+        linkFrames[i + 1]++;
+        if (ret < 0) addFailed(i + 1, ret);
+        av_frame_unref(scratch);
+    }
+}
+
+void FilterGraph::addFailed(size_t i, int ret) {
+    char errBuf[256]{};
+    av_strerror(ret, errBuf, sizeof(errBuf) - 1);
+    LOGE(LOGTAG, "filter link %zu: av_buffersrc_add_frame failed: %s", i, errBuf);
+    errorCount++;
+}
+
+bool FilterGraph::flush() {
+    if (links.empty() || ended) return false;
+    // 逐段送入空帧：前一段冲出的帧先送进这一段，再结束这一段
+    for (size_t i = 0; i < links.size(); ++i) {
+        if (i > 0) forward(i - 1);
+        int ret = av_buffersrc_add_frame_flags(links[i].src, nullptr, AV_BUFFERSRC_FLAG_PUSH);
+        if (ret < 0) addFailed(i, ret);
+    }
+    ended = true;
+    return true;
+}
+
+bool FilterGraph::receive(AVFrame *frame) {
+    if (links.empty()) return false;
+    if (av_buffersink_get_frame_flags(links.back().sink, frame, AV_BUFFERSINK_FLAG_NO_REQUEST) < 0) {
+        return false;
+    }
+    // 滤镜可能改变时间基（如 yadif=1 输出两倍帧率），换回输入的时间基
+    if (frame->pts != AV_NOPTS_VALUE) {
+        frame->pts = av_rescale_q(frame->pts, outTimeBase, input.timeBase);
+    }
+    frame->pkt_duration = av_rescale_q(frame->pkt_duration, outTimeBase, input.timeBase);
+    return true;
+}
+
+void FilterGraph::reset() {
+    destroy();
+}
+
+bool FilterGraph::build(const Format &in) {
+    Format cur = in;
+    for (auto &desc : segments) {
+        Link link{};
+        Format out{};
+        if (!buildLink(link, desc, cur, out)) {
+            avfilter_graph_free(&link.graph);
+            LOGE(LOGTAG, "build filter \"%s\" failed", desc.c_str());
+            return false;
+        }
+        links.push_back(link);
+        cur = out;
+    }
+    outTimeBase = cur.timeBase;
+    rebuildCount++;
+    if (mediaType == AVMEDIA_TYPE_VIDEO) {
+        LOGI(LOGTAG, "video filter graph: %dx%d fmt %d -> %dx%d fmt %d", in.width, in.height,
+             in.format, cur.width, cur.height, cur.format);
+    } else {
+        LOGI(LOGTAG, "audio filter graph: %d Hz fmt %d -> %d Hz fmt %d", in.sampleRate, in.format,
+             cur.sampleRate, cur.format);
+    }
+    return true;
+}
+
+bool FilterGraph::buildLink(Link &link, const std::string &desc, const Format &in, Format &out) {
+    char args[512];
+    const AVFilter *srcFilter;
+    const AVFilter *sinkFilter;
+    if (mediaType == AVMEDIA_TYPE_VIDEO) {
+        AVRational sar = in.sar.den > 0 ? in.sar : AVRational{0, 1};
+        snprintf(args, sizeof(args), "video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:pixel_aspect=%d/%d",
+                 in.width, in.height, in.format, in.timeBase.num, in.timeBase.den, sar.num, sar.den);
+        srcFilter = avfilter_get_by_name("buffer");
+        sinkFilter = avfilter_get_by_name("buffersink");
+    } else {
+        snprintf(args, sizeof(args),
+                 "time_base=%d/%d:sample_rate=%d:sample_fmt=%s:channel_layout=0x%" PRIx64,
+                 in.timeBase.num, in.timeBase.den, in.sampleRate,
+                 av_get_sample_fmt_name(static_cast<AVSampleFormat>(in.format)), in.channelLayout);
+        srcFilter = avfilter_get_by_name("abuffer");
+        sinkFilter = avfilter_get_by_name("abuffersink");
+    }
+
+    link.graph = avfilter_graph_alloc();
+    if (link.graph == nullptr) return false;
+    // 滤镜内部不另开线程，耗时都算在所在的流水线阶段上，线程数由 WorkerPool 统一控制
+    link.graph->nb_threads = 1;
+    if (avfilter_graph_create_filter(&link.src, srcFilter, "in", args, nullptr, link.graph) < 0 ||
+        avfilter_graph_create_filter(&link.sink, sinkFilter, "out", nullptr, nullptr, link.graph) < 0) {
+        return false;
+    }
+
+    AVFilterInOut *outputs = avfilter_inout_alloc();
+    AVFilterInOut *inputs = avfilter_inout_alloc();
+    if (outputs == nullptr || inputs == nullptr) {
+        avfilter_inout_free(&outputs);
+        avfilter_inout_free(&inputs);
+        return false;
+    }
+    outputs->name = av_strdup("in");
+    outputs->filter_ctx = link.src;
+    outputs->pad_idx = 0;
+    outputs->next = nullptr;
+    inputs->name = av_strdup("out");
+    inputs->filter_ctx = link.sink;
+    inputs->pad_idx = 0;
+    inputs->next = nullptr;
+    int ret = avfilter_graph_parse_ptr(link.graph, desc.c_str(), &inputs, &outputs, nullptr);
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    if (ret >= 0) ret = avfilter_graph_config(link.graph, nullptr);
+    if (ret < 0) {
+        char errBuf[256]{};
+        av_strerror(ret, errBuf, sizeof(errBuf) - 1);
+        LOGE(LOGTAG, "avfilter graph error: %s", errBuf);
+        return false;
+    }
+
+    out = Format{};
+    out.format = av_buffersink_get_format(link.sink);
+    out.timeBase = av_buffersink_get_time_base(link.sink);
+    if (mediaType == AVMEDIA_TYPE_VIDEO) {
+        out.width = av_buffersink_get_w(link.sink);
+        out.height = av_buffersink_get_h(link.sink);
+        out.sar = av_buffersink_get_sample_aspect_ratio(link.sink);
+    } else {
+        out.sampleRate = av_buffersink_get_sample_rate(link.sink);
+        out.channelLayout = av_buffersink_get_channel_layout(link.sink);
+        if (out.channelLayout == 0) {
+            out.channelLayout = av_get_default_channel_layout(av_buffersink_get_channels(link.sink));
+        }
+    }
+    return true;
+}
+
+void FilterGraph::destroy() {
+    for (auto &link : links) {
+        avfilter_graph_free(&link.graph);
+    }
+    links.clear();
+    ended = false;
+}
+
+std::vector<FilterGraph::Timing> FilterGraph::timings() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    std::vector<Timing> result;
+    for (size_t i = 0; i < names.size(); ++i) {
+        result.push_back({names[i], linkFrames[i].load(), linkUs[i].load()});
+    }
+    return result;
+}
+
+int FilterGraph::rebuilds() const {
+    return rebuildCount;
+}
+
+int FilterGraph::errors() const {
+    return errorCount;
+}
@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cstdlib>
+#include "frame_ring.h"
+
+#define NO_PTS INT64_MIN            // 与 AV_NOPTS_VALUE 相同
+#define MAX_RING_FRAMES 32
+#define MIN_RING_FRAMES 2
+
+FrameRing::FrameRing(size_t budget):
+oldest(0), maxEntries(MIN_RING_FRAMES), budget(budget), frameBytes(0) {}
+
+FrameRing::~FrameRing() {
+    clear();
+}
+
+void FrameRing::configure(size_t bytes) {
+    if (bytes == frameBytes) return;
+    clear();
+    frameBytes = bytes;
+    maxEntries = bytes > 0 ? budget / bytes : MAX_RING_FRAMES;
+    maxEntries = std::min<size_t>(std::max<size_t>(maxEntries, MIN_RING_FRAMES), MAX_RING_FRAMES);
+}
+
+static std::shared_ptr<uint8_t> allocFrame(size_t bytes) {
+    auto data = static_cast<uint8_t *>(malloc(bytes));
+    if (data == nullptr) return nullptr;
+    return std::shared_ptr<uint8_t>(data, free);
+}
+
+bool FrameRing::makeWritable(Entry &e) {
+    // 显示阶段还没用完这块缓冲区，不能覆盖
+    if (e.data.use_count() > 1) e.data = allocFrame(frameBytes);
+    return e.data != nullptr;
+}
+
+std::shared_ptr<uint8_t> FrameRing::insert(int64_t pts) {
+    if (frameBytes == 0) return nullptr;
+    for (auto &e : entries) {
+        if (e.pts == pts && pts != NO_PTS) {
+            return makeWritable(e) ? e.data : nullptr;
+        }
+    }
+    if (entries.size() < maxEntries) {
+        auto data = allocFrame(frameBytes);
+        if (data == nullptr) return nullptr;
+        entries.push_back({pts, NO_PTS, data});
+        return data;
+    }
+    Entry &e = entries[oldest];
+    oldest = (oldest + 1) % entries.size();
+    e.pts = pts;
+    e.prevPts = NO_PTS;
+    return makeWritable(e) ? e.data : nullptr;
+}
+
+void FrameRing::link(int64_t prevPts, int64_t pts) {
+    if (prevPts == NO_PTS || pts == NO_PTS) return;
+    for (auto &e : entries) {
+        if (e.pts == pts) {
+            e.prevPts = prevPts;
+            return;
+        }
+    }
+}
+
+const FrameRing::Entry * FrameRing::lookup(int64_t pts) const {
+    if (pts == NO_PTS) return nullptr;
+    for (auto &e : entries) {
+        if (e.pts == pts) return &e;
+    }
+    return nullptr;
+}
+
+const uint8_t * FrameRing::before(int64_t pts, int64_t &found) const {
+    const Entry *cur = lookup(pts);
+    if (cur == nullptr) return nullptr;
+    const Entry *prev = lookup(cur->prevPts);
+    if (prev == nullptr) return nullptr;
+    found = prev->pts;
+    return prev->data.get();
+}
+
+const uint8_t * FrameRing::after(int64_t pts, int64_t &found) const {
+    if (pts == NO_PTS) return nullptr;
+    for (auto &e : entries) {
+        if (e.prevPts == pts) {
+            found = e.pts;
+            return e.data.get();
+        }
+    }
+    return nullptr;
+}
+
+const uint8_t * FrameRing::find(int64_t pts) const {
+    const Entry *e = lookup(pts);
+    return e != nullptr ? e->data.get() : nullptr;
+}
+
+size_t FrameRing::capacity() const {
+    return maxEntries;
+}
+
+void FrameRing::clear() {
+    // 仍被显示阶段持有的缓冲区在对方释放后才真正回收
+    entries.clear();
+    oldest = 0;
+}
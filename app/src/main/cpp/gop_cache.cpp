@@ -0,0 +1,98 @@
+#include <algorithm>
+#include "gop_cache.h"
+
+extern "C" {
+#include "libavutil/imgutils.h"
+}
+
+#define MAX_SCALE_SHIFT 2
+
+GopCache::GopCache(size_t budget):
+startPts(AV_NOPTS_VALUE), downscaledFrames(0), droppedFrames(0),
+usedBytes(0), budget(budget), scaleShift(0), swsCtx(nullptr) {}
+
+GopCache::~GopCache() {
+    clear();
+    sws_freeContext(swsCtx);
+}
+
+void GopCache::setBudget(size_t bytes) {
+    budget = bytes;
+}
+
+size_t GopCache::frameBytes(int format, int width, int height) {
+    int size = av_image_get_buffer_size(static_cast<AVPixelFormat>(format), width, height, 1);
+    return size > 0 ? static_cast<size_t>(size) : 0;
+}
+
+bool GopCache::add(AVFrame *frame) {
+    // 放不下时逐级缩小，之后的帧沿用缩小后的尺寸，避免同一个 GOP 内尺寸来回变化
+    while (scaleShift < MAX_SCALE_SHIFT &&
+           usedBytes + frameBytes(frame->format, frame->width >> scaleShift,
+                                  frame->height >> scaleShift) > budget) {
+        scaleShift++;
+    }
+    int w = frame->width >> scaleShift;
+    int h = frame->height >> scaleShift;
+    size_t need = frameBytes(frame->format, w, h);
+    if (usedBytes + need > budget || w == 0 || h == 0) {
+        droppedFrames++;
+        av_frame_free(&frame);
+        return false;
+    }
+
+    if (scaleShift > 0) {
+        AVFrame *small = av_frame_alloc();
+        small->format = frame->format;
+        small->width = w;
+        small->height = h;
+        if (av_frame_get_buffer(small, 0) < 0) {
+            av_frame_free(&small);
+            av_frame_free(&frame);
+            droppedFrames++;
+            return false;
+        }
+        swsCtx = sws_getCachedContext(swsCtx, frame->width, frame->height,
+                                      static_cast<AVPixelFormat>(frame->format),
+                                      w, h, static_cast<AVPixelFormat>(frame->format),
+                                      SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+        sws_scale(swsCtx, frame->data, frame->linesize, 0, frame->height,
+                  small->data, small->linesize);
+        av_frame_copy_props(small, frame);
+        av_frame_free(&frame);
+        frame = small;
+        downscaledFrames++;
+    }
+
+    frames.push_back(frame);
+    usedBytes += need;
+    return true;
+}
+
+AVFrame * GopCache::popLast() {
+    if (frames.empty()) return nullptr;
+    AVFrame *frame = frames.back();
+    frames.pop_back();
+    usedBytes -= std::min(usedBytes, frameBytes(frame->format, frame->width, frame->height));
+    return frame;
+}
+
+bool GopCache::empty() const {
+    return frames.empty();
+}
+
+size_t GopCache::bytes() const {
+    return usedBytes;
+}
+
+void GopCache::clear() {
+    for (auto &f : frames) {
+        av_frame_free(&f);
+    }
+    frames.clear();
+    usedBytes = 0;
+    scaleShift = 0;
+    startPts = AV_NOPTS_VALUE;
+    downscaledFrames = 0;
+    droppedFrames = 0;
+}
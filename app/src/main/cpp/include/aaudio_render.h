@@ -1,7 +1,13 @@
 #ifndef TINY_PLAYER_AAUDIO_RENDER_H
 #define TINY_PLAYER_AAUDIO_RENDER_H
 
+#include <atomic>
+#include <mutex>
 #include <aaudio/AAudio.h>
+#include "buffer_tuner.h"
+
+#define AUDIO_CONTROL_POLL_US 2000      // 状态切换中查询流状态的间隔
+#define AUDIO_START_MAX_RETRIES 10      // requestStart 连续失败这么多次后放弃，改为重新打开流
 
 // AAudio使用的回调函数定义。第一个参数为当前的音频流，第二个参数是用户设置的数据指针，
 // 第三个参数是AAudio提供的音频缓冲区，需要在回调中向该缓冲区写入pcm数据，需要写入的
@@ -9,34 +15,136 @@
 // 这个回调，返回1表示希望AAudio停止调用回调。
 using AAudioCallback = int(*)(AAudioStream*, void*, void*, int32_t);
 
+// 音频输出。默认不指定采样率，由设备选择原生采样率，格式优先 float，实际得到的参数在
+// open() 之后通过 sampleRate()/channelCount()/format() 查询，调用方按此重采样，避免系统
+// 混音器再做一次重采样。设备断开（如拔出耳机、切换蓝牙）后 disconnected() 返回 true，
+// 由调用方在非回调线程调用 reopen()。
+//
+// 可以请求独占（EXCLUSIVE）模式，设备支持时走 MMAP 通路，绕过系统混音器，延迟最低；
+// 设备不支持或已被占用时退回共享模式。独占模式下回调周期只有一个 burst，回调里不能
+// 加锁、分配内存或写日志，需要的参数用 frameBytes() 这类原子读取的接口获取。
+//
+// 播放、暂停、刷新只记录目标状态并立即返回，由调用方在后台定期调用 control() 推进，
+// control() 不等待状态切换完成，调用线程（通常是 UI 线程）不会被阻塞。切换期间 muted()
+// 为 true，回调输出静音且不消费数据。
 class AAudioRender{
     AAudioStream* stream;
     int32_t channel_count;
     int32_t sample_rate;
-    bool paused;
+    std::atomic<bool> playing;          // 目标状态
+    std::atomic<uint32_t> flushRequests;
+    uint32_t flushesDone;
+    std::atomic<bool> mute;
+    int64_t transitionStart;            // 当前切换开始的时间，0 表示没有在切换
+    std::atomic<int> transitionCount;
+    std::atomic<int64_t> transitionUs;  // 切换累计耗时
+    std::atomic<int64_t> transitionMaxUs;
+    int startRetries;                   // 当前这次启动连续失败的次数
+    std::atomic<int> startFailureCount; // 累计失败的 requestStart 调用
+    std::atomic<int> startGiveUpCount;  // 连续失败后放弃、请求重新打开的次数
     AAudioCallback callback;
     void* user_data;
-    aaudio_format_t format;
+    aaudio_format_t format_;
+    int32_t req_channel_count;          // 请求的参数，AAUDIO_UNSPECIFIED 表示由设备决定
+    int32_t req_sample_rate;
+    aaudio_format_t req_format;
+    std::atomic<bool> req_exclusive;
+    aaudio_sharing_mode_t sharing_mode;     // 实际得到的共享模式
+    aaudio_performance_mode_t performance_mode;
+    std::atomic<size_t> frame_bytes;        // 每帧字节数，供实时回调读取
+    std::atomic<bool> float_output;
+    std::atomic<bool> disconnect;
+    std::atomic<bool> reconfigure;          // 请求的共享模式变化，需要重新打开
+    std::atomic<int> exclusiveFallbacks;    // 请求独占但只能以共享模式打开的次数
+    std::atomic<int> reopenCount;
+    mutable std::mutex mtx;             // 保护 stream、实际参数和 tuner，回调中不使用
+    AudioBufferTuner tuner;
+    std::atomic<int32_t> bufferSize;    // 当前的缓冲区大小（帧）
+    std::atomic<int32_t> xrunCount;     // 所有打开过的流累计的欠载次数
+    int32_t streamXRuns;                // 当前流上一次读到的欠载次数
+    std::atomic<int64_t> latency;       // 最近一次测得的输出延迟（微秒），-1 为未知
+
+    static void onError(AAudioStream *s, void *userData, aaudio_result_t error);
+    int openLocked();
+    aaudio_result_t openStream(aaudio_sharing_mode_t sharing);
+    void closeLocked();
+    int64_t measureLatencyLocked() const;
+    void finishTransition();
 
 public:
     ~AAudioRender() ;
 
     AAudioRender();
 
-    // 指定采样率，通道数和数据格式，否则使用默认
+    // 指定采样率，通道数和数据格式，否则使用默认（设备原生采样率、双声道、float）
     void configure(int32_t sampleRate, int32_t channelCnt, aaudio_format_t fmt);
 
     // 设置AAudio的回调，指定user_data为你需要的数据指针，user_data会传递给callback的第二个参数
     void setCallback(AAudioCallback cb, void* data);
 
-    // AAudioStream开始工作，成功返回0，失败返回<0
-    int start();
+    // 请求独占模式，失败时退回共享模式。流已经打开时在下一次 reopen() 生效，
+    // 调用方通过 needsReopen() 得知
+    void setExclusive(bool exclusive);
+
+    // 打开AAudioStream但不开始，已经打开时直接返回。成功返回0，失败返回<0
+    int open();
+
+    // 同步停止并关闭流，返回时回调已经结束，不会再被调用。回调用到的数据在这之后才能释放
+    void close();
+
+    // 关闭当前的流并按同样的参数重新打开，目标状态为播放时重新开始。
+    // 设备断开后调用，新设备的采样率和格式可能不同
+    int reopen();
+
+    // 设置目标状态：true 为播放，false 为暂停。立即返回，由 control() 执行
+    void play(bool p);
+
+    // 请求丢弃 AAudio 内部缓冲区中还没播放的数据（跳转后调用）。立即返回，由 control() 执行
+    void requestFlush();
+
+    // 向目标状态推进一步，不阻塞。返回 0 表示已经到达目标状态，大于 0 表示状态还在切换，
+    // 需要在这么多微秒之后再次调用。requestStart 连续失败 AUDIO_START_MAX_RETRIES 次后
+    // 不再重试，返回 0 并通过 needsReopen() 要求调用方重新打开流
+    int64_t control();
+
+    // 状态切换中，回调应输出静音。实时回调中调用
+    bool muted() const;
+
+    // 设备已断开或请求的共享模式变化，需要 reopen()
+    bool needsReopen() const;
+
+    int32_t sampleRate() const;
+    int32_t channelCount() const;
+    aaudio_format_t format() const;
+    int reopens() const;
+    // 实时回调中调用，不加锁
+    size_t frameBytes() const;
+    bool floatOutput() const;
+    bool exclusiveRequested() const;
+    aaudio_sharing_mode_t sharingMode() const;
+    aaudio_performance_mode_t performanceMode() const;
+    int fallbacks() const;
+    int transitions() const;
+    int64_t transitionTotalUs() const;
+    int64_t transitionPeakUs() const;
+    int startFailures() const;
+    int startGiveUps() const;
 
-    // 刷新AAudio的内部缓冲区
-    int flush();
+    /**
+     * @brief 定期在非回调线程调用：按欠载次数调整缓冲区大小，并重新测量输出延迟
+     */
+    void tune(int64_t nowUs);
 
-    // 参数p为true时表示暂停，为false时表示取消暂停
-    int pause(bool p);
+    /**
+     * @brief 已写入设备但还没播放出来的时长（微秒），由 tune() 按 AAudioStream_getTimestamp
+     * 推算，流还没有开始输出时返回 -1
+     */
+    int64_t latencyUs() const;
+    int32_t bufferFrames() const;
+    int32_t burstFrames() const;
+    int32_t xruns() const;
+    int bufferGrows() const;
+    int bufferShrinks() const;
 };
 
-#endif //TINY_PLAYER_AAUDIO_RENDER_H
\ No newline at end of file
+#endif //TINY_PLAYER_AAUDIO_RENDER_H
@@ -1,21 +1,68 @@
 #ifndef TINY_PLAYER_ANW_RENDER_H
 #define TINY_PLAYER_ANW_RENDER_H
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <android/data_space.h>
 #include <android/native_window.h>
 #include <android/native_window_jni.h>
+#include "yuv_convert.h"
+
+// 窗口缓冲区格式。YV12 每像素 12 位，可以省掉 CPU 上的 YUV -> RGBA 转换，
+// 窗口不支持时自动退回 RGBA
+enum class RenderFormat {
+    RGBA,
+    YV12,
+};
 
 class ANWRender{
 public:
     ANWRender();
+    ~ANWRender();
     void init(ANativeWindow *window);
-    int setBuffers(int videoWidth, int videoHeight);
-    int render(uint8_t* rgba);
+    int setBuffers(int videoWidth, int videoHeight, RenderFormat fmt = RenderFormat::RGBA);
+
+    /**
+     * @brief 显示一帧。RGBA 格式每行 width * 4 字节；YV12 格式为紧凑排列的 YV12（见 yv12PackedLayout）
+     */
+    int render(const uint8_t* data);
+
+    RenderFormat format() const;
+
+    /**
+     * @brief 窗口缓冲区是否已经按这个尺寸和格式设置好
+     */
+    bool matches(int w, int h, RenderFormat format) const;
+
+    /**
+     * @brief 当前格式下 render() 需要的一帧数据大小
+     */
+    size_t frameBytes() const;
+    static size_t frameBytes(int w, int h, RenderFormat format);
+
+    /**
+     * @brief 当前窗口拒绝 YV12、退回 RGBA 的次数，可以在其他线程读取。init() 换了窗口后清零
+     */
+    int fallbacks() const;
+
+    /**
+     * @brief 设置之后提交的缓冲区的 dataspace（ADataSpace），与当前相同时不调用系统接口
+     */
+    void setDataSpace(int32_t space);
 
 private:
+    int renderYv12(const uint8_t* data);
+    // 锁定的缓冲区不是 YV12 时按它的实际格式写入 YV12 数据 yv12
+    void fillLocked(const ANativeWindow_Buffer &buffer, const uint8_t *yv12);
+
     ANativeWindow *native_window;
     int width;
     int height;
+    RenderFormat fmt;
+    std::atomic<int> fallbackCount;
+    int32_t dataSpace;              // 已经设置给窗口的 dataspace，新窗口为 ADATASPACE_UNKNOWN
+    YuvConverter converter;         // 只在退回 RGBA 的那一帧使用
 };
 
-#endif //TINY_PLAYER_ANW_RENDER_H
\ No newline at end of file
+#endif //TINY_PLAYER_ANW_RENDER_H
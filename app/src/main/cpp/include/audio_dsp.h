@@ -0,0 +1,99 @@
+#ifndef TINY_PLAYER_AUDIO_DSP_H
+#define TINY_PLAYER_AUDIO_DSP_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "yuv_convert.h"
+
+#define AUDIO_GAIN_RAMP_SAMPLES 4096    // 增益从 0 变到 1 经过的样本数，双声道 48kHz 约 43ms
+#define AUDIO_SOFT_CLIP_KNEE 0.9f       // 软削波的起点，绝对值低于它的样本不变
+#define MAX_DOWNMIX_CHANNELS 8
+
+// 音频 DSP 基本运算，样本都是交错排列的：float/S16 互转、带斜坡的增益、5.1/7.1 下混成
+// 立体声、软削波、求峰值。
+//
+// 与 YuvConverter 一样按编译目标和运行时检测到的 CPU 特性选择 SIMD 实现（NEON、SSE4.1、
+// AVX2），各实现与标量实现的差别在浮点舍入误差以内，float 转 S16 逐样本一致（ARMv7 上
+// 舍入方式不同，相差不超过 1）。所有运算都不分配内存、不加锁，可以在实时回调中调用。
+class AudioDsp {
+public:
+    explicit AudioDsp(SimdLevel level = YuvConverter::detect());
+
+    SimdLevel level() const;
+
+    /**
+     * @brief [-1, 1] 的 float 转 S16，四舍五入，超出范围的饱和
+     */
+    void floatToS16(const float *in, int16_t *out, size_t samples) const;
+
+    void s16ToFloat(const int16_t *in, float *out, size_t samples) const;
+
+    /**
+     * @brief 原地乘以增益，增益从 from 线性变化到 to（最后一个样本之后达到 to）
+     */
+    void gainRamp(float *buf, size_t samples, float from, float to) const;
+
+    /**
+     * @brief 下混成立体声。matrix 为 2 行 channels 列（先左后右），out 写入 frames * 2 个样本。
+     * 6、8 声道使用 SIMD 实现，其他声道数逐样本计算
+     */
+    void downmixStereo(const float *in, int channels, const float *matrix, float *out,
+                       size_t frames) const;
+
+    /**
+     * @brief 原地软削波：绝对值超过 AUDIO_SOFT_CLIP_KNEE 的部分平滑压缩，输出不超过 1。
+     * 返回被压缩的样本数
+     */
+    size_t softClip(float *buf, size_t samples) const;
+
+    /**
+     * @brief 样本绝对值的最大值，用于判断一段 PCM 是否超出满幅
+     */
+    float peak(const float *buf, size_t samples) const;
+
+    using ConvertF = void (*)(const float *, int16_t *, size_t);
+    using ConvertS = void (*)(const int16_t *, float *, size_t);
+    using Gain = void (*)(float *, size_t, float, float);
+    using Downmix = void (*)(const float *, int, const float *, float *, size_t);
+    using Clip = size_t (*)(float *, size_t);
+    using Peak = float (*)(const float *, size_t);
+
+private:
+    SimdLevel simd;
+    ConvertF toS16;
+    ConvertS fromS16;
+    Gain gain;
+    Downmix downmix;
+    Clip clip;
+    Peak peakOf;
+};
+
+/**
+ * @brief 按 ITU-R BS.775 生成 5.1 / 7.1 下混到立体声的矩阵（2 行 channels 列），
+ * 声道顺序为 FFmpeg 的默认顺序（FL FR FC LFE 之后是左右环绕）。center、surround、lfe 是
+ * 对应声道混入的系数，结果按行和归一化，与 swresample 默认的下混一样不会超出范围。
+ * 不支持的声道数返回 false
+ */
+bool stereoDownmixMatrix(int channels, float center, float surround, float lfe, float *matrix);
+
+// 平滑增益。目标值可以在任意线程设置，process 在同一个音频线程（可以是实时回调）调用，
+// 每次最多变化 samples / AUDIO_GAIN_RAMP_SAMPLES，避免增益突变产生爆音。
+// 增益大于 1 时对 float 输出做软削波，S16 输出饱和截断
+class GainControl {
+public:
+    void setTarget(float gain);
+    float target() const;
+
+    void process(const AudioDsp &dsp, float *buf, size_t samples);
+    void process(const AudioDsp &dsp, int16_t *buf, size_t samples);
+
+private:
+    // 返回这一段结束时的增益，current 更新为该值
+    float step(size_t samples);
+
+    std::atomic<float> targetGain{1.0f};
+    float current = 1.0f;
+};
+
+#endif //TINY_PLAYER_AUDIO_DSP_H
@@ -0,0 +1,52 @@
+#ifndef TINY_PLAYER_BUFFER_TUNER_H
+#define TINY_PLAYER_BUFFER_TUNER_H
+
+#include <cstdint>
+
+#define AUDIO_MIN_BUFFER_BURSTS 1           // 缓冲区最小为一个 burst
+#define AUDIO_STABLE_PERIOD_US 5000000      // 这么长时间没有欠载才缩小一个 burst
+#define AUDIO_MAX_STABLE_PERIOD_US 80000000 // 缩小后很快又欠载时等待时间加倍，最多到这里
+
+// 根据欠载（XRun）次数调整音频输出缓冲区大小。
+//
+// 从最小的 burst 倍数开始，欠载次数增加时加大一个 burst，稳定一段时间后减小一个 burst。
+// 缩小后在稳定期内又欠载，说明已经到了设备能承受的下限，之后的稳定期加倍，避免在两个
+// 大小之间反复切换。只做计算，不依赖 AAudio，由调用方读取欠载次数、设置缓冲区大小。
+class AudioBufferTuner {
+public:
+    AudioBufferTuner();
+
+    /**
+     * @brief 流打开后重新开始，返回初始的缓冲区大小（帧）
+     */
+    int32_t reset(int32_t framesPerBurst, int32_t capacityFrames);
+
+    /**
+     * @brief 定期调用，xruns 是累计的欠载次数，nowUs 是单调时钟。
+     * 返回新的缓冲区大小，不需要调整时返回 0
+     */
+    int32_t update(int32_t xruns, int64_t nowUs);
+
+    /**
+     * @brief 暂停期间不会欠载，不计入稳定时间
+     */
+    void hold(int64_t nowUs);
+
+    int32_t bufferFrames() const;
+    int32_t burstFrames() const;
+    int grows() const;
+    int shrinks() const;
+
+private:
+    int32_t burst;
+    int32_t capacity;
+    int32_t size;
+    int32_t lastXRuns;          // -1 表示还没有基准
+    int64_t stableSince;        // 上次欠载或调整的时间
+    int64_t stablePeriodUs;
+    bool shrunk;                // 上次调整是缩小，且还在它之后的稳定期内
+    int growCount;
+    int shrinkCount;
+};
+
+#endif //TINY_PLAYER_BUFFER_TUNER_H
@@ -0,0 +1,43 @@
+#ifndef TINY_PLAYER_COUNTED_MUTEX_H
+#define TINY_PLAYER_COUNTED_MUTEX_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+// 带计数的互斥锁，记录加锁次数和发生竞争（需要等待）的次数，用法与 std::mutex 相同
+class CountedMutex {
+public:
+    void lock() {
+        if (!m.try_lock()) {
+            contended.fetch_add(1, std::memory_order_relaxed);
+            m.lock();
+        }
+        acquired.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool try_lock() {
+        if (!m.try_lock()) return false;
+        acquired.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void unlock() {
+        m.unlock();
+    }
+
+    uint64_t acquisitions() const {
+        return acquired.load(std::memory_order_relaxed);
+    }
+
+    uint64_t contentions() const {
+        return contended.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::mutex m;
+    std::atomic<uint64_t> acquired{0};
+    std::atomic<uint64_t> contended{0};
+};
+
+#endif //TINY_PLAYER_COUNTED_MUTEX_H
@@ -0,0 +1,82 @@
+#ifndef TINY_PLAYER_DECODER_CACHE_H
+#define TINY_PLAYER_DECODER_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+}
+
+#define DECODER_CACHE_SIZE 4        // 最多保留的空闲解码器，播放列表前后两项的音视频各一个
+
+// 决定解码器能否复用的参数。codec id 和 extradata 的哈希先做粗匹配，其余参数必须全部相同
+struct DecoderKey {
+    AVCodecID codecId = AV_CODEC_ID_NONE;
+    uint64_t extradataHash = 0;
+    int extradataSize = 0;
+    uint32_t codecTag = 0;          // 同一 codec 的不同封装方式（如 avc1 / avc3）
+    int profile = 0;
+    int bitsPerCodedSample = 0;
+    int bitsPerRawSample = 0;
+    int width = 0;                  // 视频
+    int height = 0;
+    int format = -1;                // 像素格式或采样格式
+    int sampleRate = 0;             // 音频
+    int channels = 0;
+    uint64_t channelLayout = 0;
+    int blockAlign = 0;             // PCM、ADPCM 等按块解码的格式依赖这两个参数
+    int frameSize = 0;
+    int lowres = 0;                 // 打开前设置的选项，打开之后不能再改
+    int flags2 = 0;
+
+    bool sameStream(const DecoderKey &other) const;
+    bool operator==(const DecoderKey &other) const;
+};
+
+// 已经打开的解码器缓存。播放列表中同样格式的片段不再重新打开解码器：条目释放时解码器
+// 清空缓冲后放进缓存，下一项参数相同时直接取出使用，帧线程等内部状态一起复用。
+// 参数不一致时由调用者重新打开。可以在任意线程调用
+class DecoderCache {
+public:
+    DecoderCache() = default;
+    ~DecoderCache();
+    DecoderCache(const DecoderCache &) = delete;
+    DecoderCache &operator=(const DecoderCache &) = delete;
+
+    static DecoderKey keyOf(const AVCodecParameters *par, int lowres, int flags2);
+
+    /**
+     * @brief 取出参数为 key 的解码器，没有时返回 nullptr
+     */
+    AVCodecContext *acquire(const DecoderKey &key);
+
+    /**
+     * @brief 清空解码器的缓冲后放回缓存，缓存已满时释放最早放入的
+     */
+    void release(const DecoderKey &key, AVCodecContext *ctx);
+
+    void clear();
+
+    uint64_t hits() const;
+    uint64_t misses() const;
+    uint64_t mismatches() const;      // codec 和 extradata 相同但其他参数不同
+    uint64_t evictions() const;
+
+private:
+    struct Entry {
+        DecoderKey key;
+        AVCodecContext *ctx;
+    };
+
+    std::mutex mtx;
+    std::vector<Entry> entries;     // 按放入的顺序
+    std::atomic<uint64_t> hitCount{0};
+    std::atomic<uint64_t> missCount{0};
+    std::atomic<uint64_t> mismatchCount{0};
+    std::atomic<uint64_t> evictCount{0};
+};
+
+#endif //TINY_PLAYER_DECODER_CACHE_H
@@ -0,0 +1,116 @@
+#ifndef TINY_PLAYER_FILTER_GRAPH_H
+#define TINY_PLAYER_FILTER_GRAPH_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+#include "libavutil/frame.h"
+}
+
+#define MAX_FILTER_LINKS 8          // 滤镜链最多拆成的段数
+
+// 可选的 libavfilter 滤镜链（如 "yadif,crop=1280:720"、"loudnorm"）。
+//
+// 按顶层的 "," 拆成若干段，每段单独建一个 buffersrc -> 滤镜 -> buffersink 的图，
+// 帧以引用在段之间传递，不复制数据，这样可以单独统计每个滤镜的耗时。描述中有标签
+// 或 ";" 时整体作为一段。图在第一帧到达时按帧的格式建立，之后只有输入格式或描述变化
+// 才重建。除 setDescription 和 timings 外只能在同一个线程调用。
+class FilterGraph {
+public:
+    explicit FilterGraph(AVMediaType type);
+    ~FilterGraph();
+    FilterGraph(const FilterGraph &) = delete;
+    FilterGraph &operator=(const FilterGraph &) = delete;
+
+    /**
+     * @brief 设置滤镜描述，可以在任意线程调用，下一帧生效。空字符串关闭滤镜
+     */
+    void setDescription(const std::string &desc);
+    bool enabled() const;
+
+    /**
+     * @brief 送入一帧，时间基为 timeBase。成功时帧中的数据引用交给滤镜，frame 变为空帧；
+     * 滤镜无法建立时返回 false，frame 保持不变，调用方按未过滤处理
+     */
+    bool send(AVFrame *frame, AVRational timeBase);
+
+    /**
+     * @brief 取出一帧输出，pts 已换回送入时的时间基。没有输出时返回 false
+     */
+    bool receive(AVFrame *frame);
+
+    /**
+     * @brief 输入结束（这一项解码完）：向滤镜链逐段送入空帧，yadif、loudnorm 等缓存了帧的滤镜
+     * 输出剩余的帧，之后用 receive 取出。下一次 send 时重新建立。没有可以结束的链时返回 false
+     */
+    bool flush();
+
+    /**
+     * @brief 丢弃滤镜中缓存的帧（跳转时调用），下一帧到达时重新建立
+     */
+    void reset();
+
+    struct Timing {
+        std::string name;
+        uint64_t frames;
+        uint64_t us;
+    };
+    std::vector<Timing> timings() const;
+    int rebuilds() const;
+    // 帧送不进某一段滤镜（被丢弃）的次数
+    int errors() const;
+
+private:
+    // 一段滤镜的输入格式，与新帧比较决定是否重建
+    struct Format {
+        int format;
+        int width;
+        int height;
+        AVRational sar;
+        int sampleRate;
+        uint64_t channelLayout;
+        AVRational timeBase;
+    };
+
+    struct Link {
+        AVFilterGraph *graph;
+        AVFilterContext *src;
+        AVFilterContext *sink;
+    };
+
+    bool build(const Format &in);
+    void forward(size_t i);
+    void addFailed(size_t i, int ret);
+    bool buildLink(Link &link, const std::string &desc, const Format &in, Format &out);
+    bool sameFormat(const Format &a, const Format &b) const;
+    Format formatOf(const AVFrame *frame, AVRational timeBase) const;
+    void destroy();
+
+    AVMediaType mediaType;
+    mutable std::mutex mtx;             // 保护 pendingDesc 和 names
+    std::string pendingDesc;
+    std::atomic<bool> dirty;
+    std::atomic<bool> active;
+    std::vector<std::string> segments;  // 当前描述拆分后的各段
+    std::vector<std::string> names;     // 各段的滤镜名，用于统计
+    std::vector<Link> links;
+    Format input;
+    AVRational outTimeBase;
+    bool failed;                        // 当前描述和格式下建图失败，不再重试
+    bool ended;                         // 已经送入空帧，取完输出后重建
+    AVFrame *scratch;
+    std::atomic<int> rebuildCount;
+    std::atomic<int> errorCount;
+    std::atomic<uint64_t> linkFrames[MAX_FILTER_LINKS];
+    std::atomic<uint64_t> linkUs[MAX_FILTER_LINKS];
+};
+
+#endif //TINY_PLAYER_FILTER_GRAPH_H
@@ -0,0 +1,68 @@
+#ifndef TINY_PLAYER_FRAME_RING_H
+#define TINY_PLAYER_FRAME_RING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// 最近显示过的画面（已转换成窗口格式）的环形缓存，供单步播放使用。
+// 每一项记录 pts 以及显示顺序上紧挨着它的前一帧 pts，只有确认相邻的两帧才能直接单步，
+// 避免缓存里有空缺时跳过画面。缓存满了以后复用最早写入的一项，显示时不再分配内存。
+// 缓冲区以 shared_ptr 交给转换之后的显示阶段，仍被持有的缓冲区不会被复用或释放。
+class FrameRing {
+public:
+    explicit FrameRing(size_t budget);
+    ~FrameRing();
+    FrameRing(const FrameRing &) = delete;
+    FrameRing &operator=(const FrameRing &) = delete;
+
+    /**
+     * @brief 设置每帧的字节数，变化时清空缓存并按预算重新计算容量
+     */
+    void configure(size_t bytes);
+
+    /**
+     * @brief 返回用于写入 pts 这一帧的缓冲区（大小为 configure 设置的字节数）。
+     * 已有相同 pts 时复用那一项，否则占用一个新位置或最早写入的一项。
+     * 要复用的缓冲区还被外部持有时改为分配一块新的
+     */
+    std::shared_ptr<uint8_t> insert(int64_t pts);
+
+    /**
+     * @brief 记录 prevPts 与 pts 在显示顺序上相邻
+     */
+    void link(int64_t prevPts, int64_t pts);
+
+    /**
+     * @brief 查找 pts 之前紧挨着的一帧，找不到返回 nullptr
+     */
+    const uint8_t *before(int64_t pts, int64_t &found) const;
+
+    /**
+     * @brief 查找 pts 之后紧挨着的一帧，找不到返回 nullptr
+     */
+    const uint8_t *after(int64_t pts, int64_t &found) const;
+
+    const uint8_t *find(int64_t pts) const;
+    size_t capacity() const;
+    void clear();
+
+private:
+    struct Entry {
+        int64_t pts;
+        int64_t prevPts;
+        std::shared_ptr<uint8_t> data;
+    };
+
+    const Entry *lookup(int64_t pts) const;
+    bool makeWritable(Entry &e);
+
+    std::vector<Entry> entries;
+    size_t oldest;          // 满了以后下一次覆盖的位置
+    size_t maxEntries;
+    size_t budget;
+    size_t frameBytes;
+};
+
+#endif //TINY_PLAYER_FRAME_RING_H
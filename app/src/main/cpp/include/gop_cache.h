@@ -0,0 +1,55 @@
+#ifndef TINY_PLAYER_GOP_CACHE_H
+#define TINY_PLAYER_GOP_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+extern "C" {
+#include "libavutil/frame.h"
+#include "libswscale/swscale.h"
+}
+
+// 倒放使用的 GOP 缓存：按解码顺序保存一个 GOP 的解码帧，再从末尾逐帧取出。
+// 占用内存不超过预算，超出时后续帧缩小到 1/2、1/4 再保存，仍然放不下的帧被丢弃。
+class GopCache {
+public:
+    explicit GopCache(size_t budget);
+    ~GopCache();
+    GopCache(const GopCache &) = delete;
+    GopCache &operator=(const GopCache &) = delete;
+
+    void setBudget(size_t bytes);
+
+    /**
+     * @brief 加入一帧，缓存接管 frame 的所有权。返回 false 表示因超出预算被丢弃
+     */
+    bool add(AVFrame *frame);
+
+    /**
+     * @brief 取出最后一帧，调用者负责释放。缓存为空时返回 nullptr
+     */
+    AVFrame *popLast();
+
+    bool empty() const;
+    size_t bytes() const;
+    /**
+     * @brief 释放所有帧，并把 startPts 和统计计数复位
+     */
+    void clear();
+
+    int64_t startPts;           // GOP 第一帧（关键帧）的 pts
+    uint64_t downscaledFrames;  // 因预算不足被缩小的帧数
+    uint64_t droppedFrames;     // 因预算不足被丢弃的帧数
+
+private:
+    static size_t frameBytes(int format, int width, int height);
+
+    std::vector<AVFrame *> frames;
+    size_t usedBytes;
+    size_t budget;
+    int scaleShift;             // 当前缩小倍数：0 原尺寸，1 为 1/2，2 为 1/4
+    SwsContext *swsCtx;
+};
+
+#endif //TINY_PLAYER_GOP_CACHE_H
@@ -0,0 +1,92 @@
+#ifndef TINY_PLAYER_LOOP_CACHE_H
+#define TINY_PLAYER_LOOP_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+}
+
+enum class LoopStream {
+    Video,
+    Audio,
+};
+
+// A-B 循环的片段缓存。第一遍播放时保存读到的 packet，之后每一遍直接从内存重放，不再读文件和跳转；
+// 片段很短时解码阶段还保存解码后的音视频帧，重放时连解码也省掉。
+// packet 和两路帧共用一个预算，某一类数据放不下时整类丢弃，这一类照旧读文件或解码，直到 clear。
+// packet 只由解复用阶段访问，视频帧、音频帧分别只由对应的解码阶段访问，只有占用的字节数是共享的
+class LoopCache {
+public:
+    explicit LoopCache(size_t budget);
+    ~LoopCache();
+    LoopCache(const LoopCache &) = delete;
+    LoopCache &operator=(const LoopCache &) = delete;
+
+    /**
+     * @brief 下一次 clear 之后生效
+     */
+    void setBudget(size_t bytes);
+
+    /**
+     * @brief 保存 pkt 的引用（不复制数据）。超出预算时释放已保存的 packet 并返回 false
+     */
+    bool addPacket(const AVPacket *pkt);
+    /**
+     * @brief 一遍的 packet 已经全部保存，之后可以重放
+     */
+    void finishPackets();
+    bool packetsReady() const;
+    bool packetsFailed() const;
+    size_t packetCount() const;
+    const AVPacket *packet(size_t i) const;
+
+    /**
+     * @brief 保存解码帧的引用，超出预算时释放这一路已保存的帧并返回 false
+     */
+    bool addFrame(LoopStream stream, const AVFrame *frame);
+    void finishFrames(LoopStream stream);
+    bool framesReady(LoopStream stream) const;
+    bool framesFailed(LoopStream stream) const;
+    size_t frameCount(LoopStream stream) const;
+    const AVFrame *frame(LoopStream stream, size_t i) const;
+
+    size_t bytes() const;
+    size_t packetBytes() const;
+    /**
+     * @brief 丢掉还没有保存完的 packet 和帧，已经完成的和失败的标记保留
+     */
+    void discardPartial();
+    /**
+     * @brief 释放所有数据，并清除完成、失败的标记
+     */
+    void clear();
+
+private:
+    struct Frames {
+        std::vector<AVFrame *> frames;
+        size_t bytes = 0;
+        bool ready = false;
+        bool failed = false;
+    };
+
+    static size_t frameBytes(const AVFrame *frame);
+    bool reserve(size_t bytes);
+    void dropFrames(Frames &part);
+    Frames &framesOf(LoopStream stream);
+    const Frames &framesOf(LoopStream stream) const;
+
+    size_t budget;
+    std::atomic<size_t> usedBytes;
+    std::vector<AVPacket *> packets;
+    size_t packetSize;
+    bool packetReady;
+    bool packetFailed;
+    Frames video;
+    Frames audio;
+};
+
+#endif //TINY_PLAYER_LOOP_CACHE_H
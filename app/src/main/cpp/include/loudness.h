@@ -0,0 +1,140 @@
+#ifndef TINY_PLAYER_LOUDNESS_H
+#define TINY_PLAYER_LOUDNESS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "audio_dsp.h"
+
+#define LOUDNESS_TARGET_LUFS -18.0f     // 默认目标响度，与 ReplayGain 2.0 的参考响度相同
+#define LOUDNESS_MAX_BOOST_DB 12.0f     // 最多提升的增益
+#define LOUDNESS_MAX_CUT_DB 24.0f       // 最多衰减的增益
+#define LOUDNESS_GAIN_SLEW_DB 3.0f      // 估计响度时增益每秒最多变化的分贝数
+#define LOUDNESS_TRACK_GAIN_SLEW_DB 400.0f  // 使用元数据时每秒最多变化的分贝数，12dB 约 30ms
+#define LOUDNESS_MIN_BLOCKS 10          // 至少有这么多个有效的 400ms 块（约 1 秒）才开始调整
+#define LIMITER_CEILING_DB -1.0f        // 限幅器的真峰值上限（dBTP）
+#define LIMITER_LOOKAHEAD_MS 5          // 限幅器的前视时间，也是它带来的延迟
+#define LIMITER_RELEASE_MS 100
+#define TRUE_PEAK_TAPS 12               // 4 倍过采样插值滤波器每相的抽头数
+
+// 响度归一化。
+//
+// 有 ReplayGain（或 Opus 的 R128_TRACK_GAIN）时使用元数据中的增益，在几十毫秒内从当前增益过渡过去；否则按 ITU-R BS.1770 /
+// EBU R128 增量估计响度：K 计权后每 100ms 累计一次能量，得到瞬时（400ms）和短时（3s）响度，
+// 400ms 块按 0.1 LU 的直方图做绝对门限（-70 LUFS）和相对门限（-10 LU），得到到目前为止的
+// 综合响度，增益按它平滑调整，每秒最多变化 LOUDNESS_GAIN_SLEW_DB。
+//
+// 增益之后经过前视真峰值限幅器：4 倍过采样估计采样点之间的峰值，输出不超过
+// LIMITER_CEILING_DB。信号明显低于上限时跳过过采样计算。限幅器带来 LIMITER_LOOKAHEAD_MS 的延迟。
+//
+// 只在音频解码阶段调用，统计值可以在其他线程读取。
+class LoudnessNormalizer {
+public:
+    LoudnessNormalizer();
+
+    /**
+     * @brief 设置采样率和声道数，清空所有状态（包括已经估计的响度）
+     */
+    void configure(int sampleRate, int channels);
+
+    /**
+     * @brief 开始新的曲目：清空响度估计和 ReplayGain，不清空延迟线，前后两首无缝衔接
+     */
+    void restart();
+
+    /**
+     * @brief 跳转后调用：清空滤波器、限幅器的延迟线，保留已经估计的响度
+     */
+    void clear();
+
+    void setTarget(float lufs);
+
+    /**
+     * @brief 使用元数据中的增益（相对于 target 的分贝数），不再估计响度。
+     * 增益在之后的 process() 中按 LOUDNESS_TRACK_GAIN_SLEW_DB 平滑过渡
+     */
+    void setTrackGain(float gainDb);
+
+    /**
+     * @brief 原地处理 frames 帧交错的 float 样本，输出比输入晚 latencyFrames() 帧
+     */
+    void process(float *buf, size_t frames);
+
+    size_t latencyFrames() const;
+
+    bool usingMetadata() const;
+    float momentaryLufs() const;
+    float shortTermLufs() const;
+    float integratedLufs() const;
+    float gainDb() const;
+    float limiterReductionDb() const;   // 最近一段时间限幅器的最大衰减
+    uint64_t truePeakFrames() const;    // 做了过采样峰值估计的帧数
+    uint64_t processedFrames() const;
+
+private:
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+
+    void measure(const float *buf, size_t frames);
+    void finishBlock();
+    // 按目标平滑调整增益，返回调整之前的线性增益
+    float updateGain(size_t frames);
+    // 从 from 到 currentGain 做增益斜坡，然后限幅
+    void limit(float *buf, size_t frames, float from);
+    float truePeak(int ch);
+
+    int rate;
+    int channels;
+    AudioDsp dsp;
+    float target;
+    std::atomic<bool> haveTrackGain;
+    float trackGain;
+
+    // K 计权滤波器和 100ms 子块能量
+    Biquad shelf;
+    Biquad highPass;
+    std::vector<double> filterState;    // 每声道 4 个状态
+    std::vector<float> weights;         // 每声道的加权系数
+    size_t blockFrames;                 // 100ms 的帧数
+    size_t blockPos;
+    double blockEnergy;
+    std::vector<double> subBlocks;      // 最近 30 个子块（3 秒）的平均能量，环形
+    size_t subBlockCount;
+    std::vector<uint32_t> histogram;    // 400ms 块的响度直方图
+    std::vector<double> binEnergy;
+    uint32_t gatedBlocks;
+
+    // 增益
+    float currentGain;                  // 线性
+    std::atomic<float> momentary;
+    std::atomic<float> shortTerm;
+    std::atomic<float> integrated;
+    std::atomic<float> appliedDb;
+
+    // 真峰值限幅器
+    float ceiling;
+    float tpThreshold;                  // 最近 TRUE_PEAK_TAPS 帧都低于它时真峰值不可能超过上限
+    float phases[3][TRUE_PEAK_TAPS];    // 4 倍过采样的第 1 ~ 3 相
+    std::vector<float> history;         // 每声道最近 TRUE_PEAK_TAPS 个样本，环形
+    size_t historyPos;
+    size_t quietFrames;
+    size_t lookahead;
+    std::vector<float> delay;           // 前视延迟线，环形
+    std::vector<float> minValues;       // 滑动窗口最小值的单调队列，环形
+    std::vector<size_t> minIndex;
+    size_t minHead;
+    size_t minTail;
+    uint64_t frameIndex;
+    float envelope;
+    float attackStep;
+    float releaseCoef;
+    float peakReduction;
+    uint64_t reductionSince;
+    std::atomic<float> reductionDb;
+    std::atomic<uint64_t> tpFrames;
+    std::atomic<uint64_t> totalFrames;
+};
+
+#endif //TINY_PLAYER_LOUDNESS_H
@@ -1,12 +1,32 @@
 #ifndef TINY_PLAYER_PLAYER_H
 #define TINY_PLAYER_PLAYER_H
 
-#include <thread>
+#include <atomic>
+#include <cmath>
+#include <deque>
 #include <mutex>
-#include <condition_variable>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
 #include "anw_render.h"
 #include "aaudio_render.h"
 #include "queue.hpp"
+#include "ring_buffer.hpp"
+#include "tempo_processor.h"
+#include "audio_dsp.h"
+#include "loudness.h"
+#include "gop_cache.h"
+#include "frame_ring.h"
+#include "yuv_convert.h"
+#include "tone_map.h"
+#include "filter_graph.h"
+#include "decoder_cache.h"
+#include "loop_cache.h"
+#include "stage.h"
+#include "worker_pool.h"
+#include "player_stats.h"
+#include "counted_mutex.h"
 #include "log.h"
 
 extern "C" {
@@ -16,13 +36,128 @@ extern "C" {
 #include "libswresample/swresample.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/time.h"
+#include "libavutil/mastering_display_metadata.h"
+#include "libavutil/display.h"
+#include "libavutil/replaygain.h"
+#include "libavutil/intreadwrite.h"
 }
 
 #define BUFF_SIZE 1024
+#define AUDIO_CHANNELS 2            // 请求的输出声道数，实际以设备为准
+#define AUDIO_RING_SIZE 65536       // 音频环形缓冲区大小，48kHz float 双声道约 170ms
+#define AUDIO_POLL_US 5000          // 环形缓冲区满时音频阶段的重试间隔
+#define AUDIO_REOPEN_RETRY_US 100000  // 重新打开音频输出失败时的重试间隔
+#define AUDIO_TUNE_INTERVAL_US 100000 // 检查欠载、调整设备缓冲区和测量输出延迟的间隔
+#define AV_SYNC_MAX_DIFF 10.0       // 画面与音频时钟相差超过该值（秒）时不按音频时钟同步
+#define MAX_VOLUME 4.0f             // 音量大于 1 时放大，超出范围的部分软削波
+#define DOWNMIX_CENTER_LEVEL 0.7071f  // 默认下混系数（-3dB），与 swresample 相同
+#define DOWNMIX_SURROUND_LEVEL 0.7071f
+#define REPLAYGAIN_REFERENCE_LUFS -18.0f  // ReplayGain 增益对应的参考响度
+#define R128_REFERENCE_LUFS -23.0f        // Opus R128_TRACK_GAIN 标签对应的参考响度
+#define TRICK_PLAY_SPEED 4.0f       // 达到该速度时进入只解码关键帧的快速浏览模式
+#define MAX_SPEED 32.0f
+#define TRICK_FRAME_INTERVAL 0.125  // 快速浏览时期望的画面间隔（秒）
+#define MAX_REVERSE_SPEED 4.0f
+#define MIN_REVERSE_SPEED 0.25f     // 更慢的倒放每秒要解码的 GOP 太少，画面长时间不动
+#define REVERSE_CACHE_BUDGET (64 * 1024 * 1024)  // 倒放缓存默认预算，两个 GOP 各占一半
+#define STEP_CACHE_BUDGET (64 * 1024 * 1024)     // 单步播放画面缓存预算
+#define MAX_LOWRES 2                // 最多按 1/4 分辨率解码
+// 映射到 8 位的 BT.2020 内容以 YV12 显示时窗口的 dataspace：仍是 BT.2020 原色、limited range，
+// 传递函数与 SDR 视频相同，由合成器转换到显示的色域
+#define YV12_BT2020_DATASPACE (ADATASPACE_STANDARD_BT2020 | ADATASPACE_TRANSFER_SMPTE_170M | \
+                               ADATASPACE_RANGE_LIMITED)
+#define SLICE_MIN_PIXELS (256 * 1024)  // 每个转换分片至少处理的像素数
+#define READY_QUEUE_SIZE 2          // 转换阶段最多提前准备好的画面数
+#define PRELOAD_MAX_PACKETS 256     // 预加载下一项时最多读取的 packet 数，通常在第一个视频帧解出时就停止
+#define ITEM_SWITCH_POLL_US 2000    // 新条目的第一帧等待上一项音频播放完时的检查间隔
+#define LOOP_CACHE_BUDGET (32 * 1024 * 1024)  // A-B 循环片段缓存默认预算
+#define LOOP_FRAME_MAX_SECONDS 2.0  // 不超过该长度、解码后估计放得下预算的片段直接缓存解码帧
+#define LOOP_PREROLL 0.1            // 每一遍从 A 之前这么多秒的关键帧读起，音频解码器在 A 之前恢复状态
+#define LOOP_PERIOD_MARGIN 0.01     // 相邻两遍 packet 的时间戳之间额外留出的间隔（秒）
 
+// 一个播放条目（open() 打开的文件或播放列表中预加载的下一项）：封装、解码器以及按码流算好的
+// 显示和音频参数，发布之后除 next 和预热数据外不再修改。
+//
+// 各流水线阶段各自持有正在处理的条目：解复用可能已经读到下一项，显示阶段还在显示上一项的
+// 最后几帧。Player::session 是正在显示的条目，控制接口和显示阶段通过 std::atomic_load 读取。
+// 条目以 shared_ptr 管理，最后一个持有者放手时关闭文件，解码器放回 decoders 供后面的条目复用
+struct PlaybackSession {
+    AVFormatContext *formatCtx = nullptr;
+    AVCodecContext *videoCodecCtx = nullptr;
+    AVCodecContext *audioCodecCtx = nullptr;
+    std::shared_ptr<DecoderCache> decoders;
+    DecoderKey videoKey;
+    DecoderKey audioKey;
+    int videoStreamId = -1;
+    int audioStreamId = -1;
+    AVRational videoTimeBase{0, 1};
+    AVRational audioTimeBase{0, 1};
+    uint64_t serial = 0;                // 打开的顺序，用于区分音频时钟属于哪一项
+    std::string path;
+    // 显示参数，转换阶段切换到这个条目时应用
+    int codedWidth = 0;
+    int codedHeight = 0;
+    AVRational sar{0, 1};
+    Rotation rotation = Rotation::None;
+    int lowres = 0;
+    RenderFormat preferredFormat = RenderFormat::RGBA;
+    double hdrPeakNits = DEFAULT_HDR_PEAK_NITS;
+    // 编码器在开头、结尾填充的样本数。解码器没有通过 AV_FRAME_DATA_SKIP_SAMPLES 给出裁剪
+    // 位置时由音频阶段按这两个值裁掉，前后两项才能逐样本衔接
+    int initialPadding = 0;
+    int trailingPadding = 0;
+    float loudnessGainDb = NAN;         // 元数据中的增益，换算到 REPLAYGAIN_REFERENCE_LUFS
+    const char *loudnessGainSource = "none";
+    // 预加载时预热解码器：送进视频解码器的 packet 解出的帧，以及同时读到的音频 packet。
+    // 切换到这个条目后分别由视频解码阶段和解复用阶段先送出
+    std::deque<AVFrame *> primedVideo;
+    std::deque<AVPacket *> primedAudio;
+    int64_t openUs = 0;                 // 打开和预热的耗时
+    int64_t primeUs = 0;
+
+    PlaybackSession() = default;
+    PlaybackSession(const PlaybackSession &) = delete;
+    PlaybackSession &operator=(const PlaybackSession &) = delete;
+    ~PlaybackSession();
+
+    /**
+     * @brief 播放列表中紧接着的一项，解复用阶段读完这一项切换过去时设置
+     */
+    std::shared_ptr<PlaybackSession> next() const;
+    void setNext(const std::shared_ptr<PlaybackSession> &item);
+
+private:
+    std::shared_ptr<PlaybackSession> nextItem;  // 只通过 std::atomic_load / atomic_store 访问
+};
+
+// 转换阶段输出、等待显示的画面。data 与单步缓存 frameRing 共享，显示完释放引用
+struct ReadyImage {
+    std::shared_ptr<uint8_t> data;
+    int64_t pts;
+    int64_t duration;       // pkt_duration，视频时间基
+    int width;
+    int height;
+    RenderFormat format;
+    std::shared_ptr<PlaybackSession> item;  // 非空表示这是新条目的第一帧，显示时切换 session
+};
+
+// 需要停下流水线才能执行的操作，投递给 controlling 阶段按顺序执行，调用线程不等待
+struct PlayerCommand {
+    enum Type { Step, Seek, SetLoop, ClearLoop, ClearPlaylist };
+    Type type;
+    bool forward;           // Step：方向
+    int64_t postTime;       // 投递时间（av_gettime_relative），统计从请求到完成的延时
+    double position;        // Seek：目标位置（秒），NAN 表示执行时的当前位置；SetLoop：A 点
+    double end;             // SetLoop：B 点
+    int flags;              // Seek：av_seek_frame 的标志
+};
+
+// 每个 Player 实例对应 Java 层的一个 Player 对象（通过 nativeContext 关联），
+// 多个实例可以同时播放，它们的流水线阶段共享同一个有界的 WorkerPool。
 class Player {
 public:
-    static Player *getInstance();
+    Player();
+    virtual ~Player();
 
     void init(ANativeWindow *w);
     bool open(const std::string &filepath);
@@ -30,54 +165,387 @@ public:
     void startPlay();
     void resume();
     void pause();
+    /**
+     * @brief 设置播放速度，负数表示倒放（-4 ~ -0.25）。成功返回 0
+     */
     int setSpeed(float speed);
+    /**
+     * @brief 倒放缓存的预算（字节），必须大于 0。成功返回 0
+     */
+    int setReverseCacheBudget(int64_t bytes);
+    /**
+     * @brief 暂停并显示下一帧 / 上一帧。请求在后台执行，不等待解码，已经打开时返回 0
+     */
+    int stepForward();
+    int stepBackward();
+    /**
+     * @brief Surface 尺寸变化，下一帧开始按新尺寸输出
+     */
+    void setSurfaceSize(int width, int height);
+    /**
+     * @brief 颜色转换的分片数，0 表示按核数和帧大小自动选择
+     */
+    void setConvertSlices(int slices);
+    /**
+     * @brief 设置视频 / 音频滤镜链（libavfilter 语法），空字符串关闭，下一帧生效
+     */
+    void setVideoFilter(const std::string &desc);
+    void setAudioFilter(const std::string &desc);
+    /**
+     * @brief 请求独占（MMAP）音频输出以获得最低延迟，不可用时自动退回共享模式
+     */
+    void setExclusiveAudio(bool exclusive);
+    /**
+     * @brief 输出音量（0 ~ MAX_VOLUME），在音频回调中平滑过渡到新值，立即生效
+     */
+    void setVolume(float volume);
+    /**
+     * @brief 5.1 / 7.1 下混到立体声时中置、环绕、低音声道的系数，下一帧生效
+     */
+    void setDownmixLevels(float center, float surround, float lfe);
+    /**
+     * @brief 响度归一化到 targetLufs，有 ReplayGain / R128 元数据时使用元数据，否则边播放边估计。
+     * 默认关闭，下一帧生效
+     */
+    void setLoudnessNormalization(bool enabled, float targetLufs);
+    /**
+     * @brief 把文件加入播放列表，在当前项之后无缝播放。下一项在后台提前打开并预热解码器
+     */
+    void enqueue(const std::string &filepath);
+    /**
+     * @brief 清空还没有开始播放的列表项，已经打开的下一项也一并丢弃。解复用阶段已经读到
+     * 下一项时异步地从当前位置重新开始，当前项播放完后停止
+     */
+    void clearPlaylist();
+    /**
+     * @brief 正在显示的是 open() 之后的第几项，open() 打开的文件为 0
+     */
+    int itemIndex() const;
+    /**
+     * @brief A-B 循环播放 [start, end)，与 seek 一样按时长的比例。片段在预算内时第一遍之后
+     * 从内存重放，不再读文件和跳转。跳转到区间外、快速浏览或倒放时取消。
+     * 与 seek 一样在后台执行，参数有效时返回 0
+     */
+    int setLoop(double start, double end);
+    void clearLoop();
+    /**
+     * @brief 循环片段缓存的预算（字节），下一次 setLoop 生效
+     */
+    void setLoopCacheBudget(size_t bytes);
+    /**
+     * @brief 跳转到时长的 position 比例处。请求由 controlling 阶段执行，调用线程不加锁、不等待
+     * 流水线停止。已经打开时返回 0，只表示请求已经接受，执行失败计入 stats.seekFailures
+     */
     int seek(double position);
     double getDuration();
     double getPosition() const;
+    std::string dumpStats();
 private:
-    using lock_guard = std::lock_guard<std::mutex>;
-    using unique_lock = std::unique_lock<std::mutex>;
+    using lock_guard = std::lock_guard<CountedMutex>;
+    using unique_lock = std::unique_lock<CountedMutex>;
 private:
-    Player();
-    virtual ~Player();
-
-    void addPacket();
-    void decodeVideoPacket();
-    void renderVideo();
-    void decodeAudioPacket();
-    void renderAudio();
-    AVStream* getVideoStream();
-    AVStream* getAudioStream();
-    bool openVideoDecoder();
-    bool openAudioDecoder();
+    // 流水线各阶段的单步函数，返回值含义见 Stage::Step
+    int64_t addPacket();
+    // 把 pendingPacket 送进对应的队列，队列已满时保留
+    int64_t pushPacket(const PlaybackSession *s);
+    int64_t addLoopPacket(const PlaybackSession *s);
+    // 一遍读完，下一遍从缓存重放或者跳回 A 之前的关键帧重新读文件
+    void finishLoopPass(const PlaybackSession *s);
+    // 解码帧属于第几遍，raw 为减去这一遍的时间戳偏移后文件中的 pts
+    int loopPassOf(int64_t pts, AVRational timeBase, int64_t &raw) const;
+    // 循环时把解码出的帧裁到 [A, B) 并换算成连续的显示时间，整帧都在区间外时返回 false。
+    // 保存解码帧的一遍结束后改为重放缓存的帧，同样返回 false
+    bool loopVideoFrame(const PlaybackSession *s, AVFrame *frame);
+    bool loopAudioFrame(const PlaybackSession *s, AVFrame *frame);
+    bool startLoopFrames(LoopStream stream, int pass);
+    int64_t replayLoopVideo(const PlaybackSession *s);
+    int64_t replayLoopAudio(const PlaybackSession *s);
+    // 显示时间换算回片段中的位置，同时统计每一遍第一帧的延迟
+    double loopPosition(double t);
+    // 跳转后从第一遍开始，只在流水线停止时调用
+    void resetLoop(double position);
+    void cancelLoop();
+    int64_t decodeVideoPacket();
+    int64_t convertVideo();
+    // 取下一帧待转换的画面；开启滤镜时 frame 可能为空，表示输入已送进滤镜但还没有输出
+    bool nextVideoFrame(const PlaybackSession *s, AVFrame *&frame, bool &filtered);
+    // 视频帧队列中的空帧表示解码阶段切换到了下一项，转换阶段随之切换
+    void switchConvertItem();
+    // 按条目的码流参数设置显示尺寸、旋转和输出格式
+    void applyVideoParams(const PlaybackSession &item);
+    // 按 AV_FRAME_DATA_SKIP_SAMPLES 或编码器填充裁剪音频帧，返回裁掉的样本数
+    int trimAudio(const PlaybackSession *s, AVFrame *frame);
+    // 经过音频滤镜后交给 outputAudio
+    void playAudioFrame(const PlaybackSession *s, AVFrame *frame);
+    // 重采样、变速后追加到 pendingPcm
+    void outputAudio(const PlaybackSession *s, const AVFrame *frame);
+    // 设备断开或切换独占模式后重新打开音频输出，只在音频解码阶段调用
+    bool reopenAudioOutput();
+    bool flushPendingPcm();
+    // 把目标响度和元数据中的增益交给 loudness，只在音频解码阶段调用
+    void applyLoudnessSettings();
+    // 正在播放的是 item 的音频时返回音频时钟，否则返回 NAN
+    double audioClock(const PlaybackSession *item) const;
+    int64_t renderVideo();
+    // 新条目的第一帧：上一项的音频还在播放时返回需要等待的时间，可以切换时返回 0
+    int64_t itemSwitchDelay(const PlaybackSession *shown, const ReadyImage *image);
+    void switchItem(const std::shared_ptr<PlaybackSession> &item);
+    int64_t decodeAudioPacket();
+    int64_t decodeReverseGop();
+    int64_t renderReverse();
+    void finishReverseGop();
+    void presentFrame(const AVFrame *frame);
+    // 按 outFormat（RGBA 或紧凑 YV12）把帧写入 out
+    void convertFrame(const AVFrame *frame, uint8_t *out);
+    int sliceCount(int width, int height);
+    void configureToneMap(const AVFrame *frame);
+    // 10 位帧映射成 8 位 YUV420P，供需要缩放的路径使用
+    const AVFrame *toneMapToFrame(const AVFrame *frame, const Yuv10Image &src);
+    // 需要旋转的画面尺寸不同时，先由 swscale 缩放成旋转前的尺寸（YUV420P），再旋转着转换
+    const AVFrame *scaleToFrame(const AVFrame *frame, int width, int height, int flags);
+    // 每次映射两行到分片自己的缓冲区，随即转换成 RGBA
+    void toneMapToRgba(const Yuv10Image &src, uint8_t *out, int rowBegin, int rowEnd, int slice,
+                       bool toBt709);
+    // 把已经转换好的画面复制到窗口，窗口尺寸或格式不同时先重新设置
+    bool showImage(const uint8_t *data, int width, int height, RenderFormat format);
+    int requestStep(bool forward);
+    // 投递命令。连续的跳转与队尾的跳转合并，只执行最后一次
+    void postCommand(const PlayerCommand &cmd);
+    int64_t runCommand();
+    // 执行一次单步，hit 表示命中了画面缓存
+    bool step(bool forward, bool &hit);
+    bool runSeek(const PlayerCommand &cmd);
+    bool runSetLoop(double start, double end);
+    void runClearLoop();
+    // 摘掉链接在正在显示的条目之后的条目，流水线已经读到它们时从当前位置重新开始
+    bool runClearPlaylist();
+    // 清空列表和预加载好的条目，不碰已经链接的条目
+    void discardPlaylist();
+    void refreshOutput();
+    void configureOutput();
+    bool decodeStep(const PlaybackSession *s, bool forward);
+    void startStages();
+    void stopStages();
+    void wakeStages();
+    void clearQueues();
+    // 打开文件和解码器，失败返回空
+    std::shared_ptr<PlaybackSession> openItem(const std::string &path);
+    bool openVideoDecoder(PlaybackSession &item);
+    bool openAudioDecoder(PlaybackSession &item);
+    // 缓存中有参数相同的解码器时直接使用，否则新打开一个。失败返回 nullptr
+    AVCodecContext *openDecoder(const AVCodecParameters *par, const AVCodec *codec,
+                                const DecoderKey &key);
+    // 读到第一个视频帧解出为止，解出的帧和期间读到的音频 packet 留在 item 中
+    void primeItem(PlaybackSession &item);
+    int64_t preloadNext();
+    // 各阶段都回到 item（open、跳转之后），播放列表中已经读过的后几项回到开头
+    void resetCursors(const std::shared_ptr<PlaybackSession> &item, bool atStart);
+    int64_t advanceDemux();
+    int seekTo(double position, int flags);
+    void skipToNextKeyframe(const PlaybackSession *s, const AVPacket *pkt);
 
-    mutable std::mutex mtx;
-    std::condition_variable worker;
+    // 只保护 open/stop 等控制接口与 controlling 阶段执行的命令之间的互斥，流水线阶段不使用。
+    // seek/resume/setLoop/setSpeed 在 UI 线程上调用，不使用这把锁，不会等待正在执行的单步和跳转
+    mutable CountedMutex mtx;
+    std::mutex speedMtx;                // setSpeed() 中速度和模式一起更新
+    // 正在显示的条目，只通过 std::atomic_load / atomic_store 访问
+    std::shared_ptr<PlaybackSession> session;
+    // 各阶段正在处理的条目，只在各自的阶段中访问，控制接口在停止流水线之后重置
+    std::shared_ptr<PlaybackSession> demuxItem;
+    std::shared_ptr<PlaybackSession> videoItem;
+    std::shared_ptr<PlaybackSession> convertItem;
+    std::shared_ptr<PlaybackSession> audioItem;
+    // 播放列表：preloading 打开列表中的下一项放进 preloaded，解复用阶段读完当前项后取走。
+    // 显示阶段切换后不再使用的条目交给 preloading 释放，关闭文件不占用流水线的时间
+    std::mutex playlistMtx;
+    std::deque<std::string> playlist;
+    std::shared_ptr<PlaybackSession> preloaded;
+    std::vector<std::shared_ptr<PlaybackSession>> retired;
+    uint64_t playlistGeneration;        // stop、清空列表时加一，丢弃之前开始打开的条目
+    std::atomic<uint64_t> itemSerial;
+    std::atomic<int> shownItem;         // 正在显示的是第几项
+    std::shared_ptr<DecoderCache> decoderCache;  // 条目持有引用，释放时把解码器放回来
+    // A-B 循环：片段为正在显示的条目中的 [loopStart, loopEnd)（秒）。第 pass 遍的 packet 时间戳
+    // 整体后移 pass * loopPeriod，解码器看到的时间戳一直递增，不需要清空；解码后减去偏移、裁掉
+    // A 之前和 B 之后的部分，再后移 pass 倍片段长度，排成连续的显示时间。
+    // 控制接口只在流水线停止时修改这些成员
+    std::atomic<bool> looping;
+    double loopStart;
+    double loopEnd;
+    LoopCache loopCache;
+    std::atomic<size_t> loopBudget;
+    bool loopFrameCapture;              // 片段足够短，解码阶段尝试保存解码帧
+    int loopFramePass;                  // 在第几遍保存解码帧，-1 表示不保存
+    std::atomic<double> loopOrigin;     // 一遍中最早的时间戳（秒）
+    std::atomic<double> loopPeriod;     // 相邻两遍时间戳的偏移（秒），第一遍读完之前为 0
+    // 解复用阶段
+    int loopPass;
+    bool loopReplaying;                 // 这一遍从 loopCache 重放
+    size_t loopCursor;
+    bool loopCapturing;                 // 这一遍的 packet 存进 loopCache
+    bool loopVideoEnded;                // 这一遍中已经读到 B 的流
+    bool loopAudioEnded;
+    double loopFirst;                   // 这一遍读到的 packet 的时间范围
+    double loopLast;
+    // 解码阶段改为重放缓存的解码帧后不再解码，解复用阶段也不再送这一路的 packet
+    std::atomic<bool> loopVideoFrames;
+    std::atomic<bool> loopAudioFrames;
+    int loopVideoPass;
+    size_t loopVideoCursor;
+    int loopAudioPass;
+    size_t loopAudioCursor;
+    int loopShownPass;                  // 显示阶段
     bool isInit;
-    bool isOpen;
-    bool closed;
-    uint64_t startTime;
-    float m_speed;
-    AVFormatContext *pFormatCtx;
-    AVCodec *pVideoCodec;
-    AVCodec *pAudioCodec;
-    AVCodecContext  *pVideoCodecCtx;
-    AVCodecContext  *pAudioCodecCtx;
-    int videoStreamId{};
-    int audioStreamId{};
-    double startPosition;
-    double currPosition;
+    std::atomic<bool> isOpen;
+    std::atomic<uint64_t> startTime;
+    std::atomic<float> m_speed;         // 速度的绝对值，方向由 reversePlay 决定
+    std::atomic<bool> trickPlay;        // 快速浏览模式：只解码关键帧，不输出音频
+    std::atomic<bool> reversePlay;      // 倒放模式：按 GOP 解码到缓存后逆序显示，不输出音频
+    std::atomic<bool> paused;
+    std::atomic<double> startPosition;
+    std::atomic<double> currPosition;
     ANWRender videoRender;
     AAudioRender audioRender;
     Queue<AVPacket *> videoPacketQ;
     Queue<AVPacket *> audioPacketQ;
     Queue<AVFrame *> videoFrameQ;
-    uint8_t audioUserData[88200]{};
-    std::thread demuxing;           // 解复用线程
-    std::thread videoDecoding;      // 视频解码线程
-    std::thread videoRendering;     // 视频渲染线程
-    std::thread audioDecoding;      // 音频解码线程
-    AAudioCallback aAudioCb{};
+    Queue<ReadyImage *> readyQ;         // 视频转换阶段 -> 视频显示阶段
+    RingBuffer audioRing;               // 音频解码阶段 -> AAudio 回调
+    FilterGraph videoFilter;            // 视频解码之后、颜色转换之前，在转换阶段执行
+    FilterGraph audioFilter;            // 音频解码之后、重采样之前
+    SwrContext *swrCtx;
+    int swrInFormat;                    // swrCtx 对应的输入格式，滤镜输出变化时重建
+    int swrInRate;
+    uint64_t swrInLayout;
+    int audioOutRate;                   // 重采样输出的采样率和声道数，即设备的参数
+    int audioOutChannels;
+    bool audioOutFloat;                 // 设备接受 float，否则写入 S16
+    TempoProcessor tempo;               // 重采样之后、写入环形缓冲区之前做变速不变调
+    AudioDsp audioDsp;                  // 只读，解码阶段和实时回调共用
+    GainControl outputGain;             // 音量，在实时回调中应用
+    // 5.1 / 7.1 到立体声的下混由 audioDsp 完成，swresample 只做格式转换和重采样
+    int swrOutChannels;
+    std::atomic<int> downmixChannels;   // 0 表示不需要下混；dumpStats 在其他线程读取
+    float downmixMatrix[2 * MAX_DOWNMIX_CHANNELS];
+    std::atomic<float> downmixCenter;
+    std::atomic<float> downmixSurround;
+    std::atomic<float> downmixLfe;
+    std::atomic<bool> downmixDirty;
+    std::vector<float> mixed;
+    // 响度归一化在下混之后、变速之前，只在音频解码阶段访问
+    LoudnessNormalizer loudness;
+    std::atomic<bool> loudnessEnabled;
+    std::atomic<float> loudnessTarget;
+    std::atomic<bool> loudnessDirty;
+    bool loudnessActive;                // 上一帧是否做了归一化
+    float metadataGainDb;               // 元数据中的增益，换算到 REPLAYGAIN_REFERENCE_LUFS，NAN 表示没有
+    std::atomic<const char *> metadataGainSource;
+    std::vector<float> resampled;
+    std::vector<float> stretched;
+    std::vector<uint8_t> pendingPcm;    // 因环形缓冲区已满暂未写入的 PCM
+    // 编码器延迟和填充的裁剪：audioSkipLeft 是还要从开头裁掉的样本数（可能跨越多帧）。
+    // 有 trailing_padding 时保留最后几帧，解码结束后从末尾裁掉
+    int64_t audioSkipLeft;
+    bool audioAtStart;                  // 从条目开头解码，还没有输出过帧
+    bool audioSideTrimmed;              // 解码器给出了开头的裁剪位置，不再按 initial_padding 裁剪
+    bool audioEndTrimmed;               // 解码器给出了结尾的裁剪位置
+    std::deque<AVFrame *> heldAudio;
+    int heldAudioSamples;
+    // 音频时钟：写入环形缓冲区的数据结束处对应的媒体时间，减去环形缓冲区和设备中还没播放的
+    // 部分，得到正在播放的位置。没有有效数据（刚打开、跳转后）时为 NAN
+    double pendingPcmEnd;               // pendingPcm 结束处的媒体时间（秒）
+    std::atomic<double> audioRingEnd;
+    uint64_t pendingPcmSerial;          // pendingPcm 和环形缓冲区中最新的数据属于哪个条目
+    std::atomic<uint64_t> audioRingSerial;
+    std::atomic<int> audioBytesPerSec;  // 环形缓冲区中数据的字节率，按设备参数计算
+    int64_t lastTuneTime;
+    AVPacket *pendingPacket;            // 因队列已满暂未送出的 packet
+    AVFrame *pendingVideoFrame;         // 因队列已满暂未送出的视频帧
+    ReadyImage *pendingImage;           // 因队列已满暂未送出的画面
+    bool convertSwitched;               // 转换阶段刚切换到新条目，下一个画面带上条目
+    bool convertEnded;                  // 转换阶段收到了这一项的结束标记，取完滤镜的输出后切换
+    bool videoEndQueued;                // 视频解码阶段已经为这一项放入结束标记
+    bool audioFilterFlushed;            // 音频解码阶段已经在这一项的结尾冲出滤镜中的帧
+    ReadyImage *heldImage;              // 等待上一项音频播放完的新条目第一帧
+    int64_t heldSince;
+    int64_t lastPresentTime;            // 上一帧的显示时间和按速度换算的显示时长，用于统计切换间隔
+    int64_t lastPresentUs;
+    std::atomic<uint64_t> switchSilenceBase;  // 音频阶段切换到新条目时的静音帧数
+    int64_t lastConvertedPts;
+    int64_t trickStartPts;              // 进入快速浏览后渲染的第一帧
+    int64_t trickStartTime;
+    int64_t lastRenderPts;
+    // 倒放：gopDecoding 把 gopEnd 之前的一个 GOP 解码到 prefetchGop，reverseRendering
+    // 逆序显示 shownGop。shownGop 显示完后两者交换，并请求解码更早的 GOP。
+    // gopRequested/gopReady 负责两个阶段之间的交接，交接之外各自只访问自己的缓存
+    GopCache gopCaches[2];
+    GopCache *shownGop;
+    GopCache *prefetchGop;
+    std::atomic<size_t> reverseBudget;
+    std::atomic<bool> gopRequested;
+    std::atomic<bool> gopReady;
+    int64_t gopEnd;                     // 要解码的 GOP 不包含 pts >= gopEnd 的帧
+    bool gopSeeked;
+    bool reverseEof;                    // 已经到达文件开头
+    bool reverseWaiting;
+    int64_t gopDecodeStart;
+    int64_t lastReversePts;
+    // 单步播放：最近显示过的画面保存在 frameRing 中，shownPts 是当前显示的帧。
+    // 单步时流水线处于停止状态，由 controlling 阶段直接操作解码器，resume 时再重新同步
+    FrameRing frameRing;
+    YuvConverter yuvConverter;          // 同尺寸 YUV 4:2:0 的快速转换，其他情况使用 swscale
+    ToneMapper toneMapper;              // 10 位内容转 8 位，PQ/HLG 同时做色调映射
+    double hdrPeakNits;                 // 最近一次从元数据得到的内容峰值亮度
+    AVFrame *toneFrame;
+    std::vector<uint8_t> toneScratch;   // 每个分片两行 8 位 YUV
+    AVFrame *scaledFrame;               // 旋转前先缩放的中间结果
+    // 输出尺寸和格式：视频按比例缩小到不超过 Surface 的大小，只由转换阶段（倒放、单步时
+    // 为显示线程）修改。窗口缓冲区由显示阶段按画面自带的尺寸和格式设置
+    std::atomic<int> surfaceWidth;
+    std::atomic<int> surfaceHeight;
+    std::atomic<bool> surfaceResized;
+    int codedWidth;                     // 码流中的尺寸
+    int codedHeight;
+    int videoWidth;                     // 要显示的画面尺寸，滤镜可能改变它
+    int videoHeight;
+    AVRational streamSar;               // 容器或码流中的像素宽高比
+    AVRational videoSar;                // 当前画面的像素宽高比，帧上没有时用 streamSar
+    Rotation displayRotation;           // 显示矩阵要求的顺时针旋转，outWidth/outHeight 是旋转后的尺寸
+    // 以下几项由转换阶段修改，dumpStats 在调用者线程读取
+    std::atomic<int> outWidth;
+    std::atomic<int> outHeight;
+    std::atomic<int> decoderLowres;
+    RenderFormat preferredFormat;       // 解码输出为 YUV 4:2:0 时为 YV12
+    RenderFormat outFormat;             // 实际输出的格式，窗口拒绝 YV12 后改为 RGBA
+    std::atomic<int32_t> outDataSpace;  // 以 YV12 显示时窗口的 dataspace，由转换阶段按帧的原色设置
+    SwsContext *scaleCtx;               // 尺寸或格式不同时使用，参数不变时复用
+    int64_t convertCostUs;              // 转换耗时的滑动平均
+    bool fastScale;                     // 转换跟不上帧率时改用快速双线性缩放
+    std::atomic<int> convertSlices;     // 指定的分片数，0 为自动
+    std::atomic<int> lastSlices;
+    int64_t shownPts;
+    int64_t stepDecoderPts;             // 解码器刚输出的帧，等于 shownPts 时向前单步不需要跳转
+    std::atomic<bool> stepping;         // resume() 不加锁读取
+    int64_t dropVideoBefore;            // 向后跳转到关键帧后丢弃目标位置之前的帧
+    double dropAudioBefore;
+    bool demuxEof;
+    bool videoEofSent;
+    bool audioEofSent;
+    uint64_t openTime;
+    struct rusage openUsage;            // 打开时的 CPU 时间和上下文切换次数
+    PlayerStats stats;
+    std::shared_ptr<Stage> demuxing;        // 解复用
+    std::shared_ptr<Stage> videoDecoding;   // 视频解码
+    std::shared_ptr<Stage> videoConverting; // 视频颜色转换和缩放
+    std::shared_ptr<Stage> videoRendering;  // 视频渲染
+    std::shared_ptr<Stage> audioDecoding;   // 音频解码
+    std::shared_ptr<Stage> gopDecoding;     // 倒放 GOP 解码
+    std::shared_ptr<Stage> reverseRendering;// 倒放渲染
+    std::shared_ptr<Stage> audioControl;    // 音频流状态切换
+    std::shared_ptr<Stage> preloading;      // 预加载播放列表的下一项
+    std::shared_ptr<Stage> controlling;     // 执行 commands
+    std::mutex commandMtx;
+    std::deque<PlayerCommand> commands;
 };
 
 #endif //TINY_PLAYER_PLAYER_H
@@ -0,0 +1,187 @@
+#ifndef TINY_PLAYER_PLAYER_STATS_H
+#define TINY_PLAYER_PLAYER_STATS_H
+
+#include <atomic>
+#include <cstdint>
+
+#define MAX_CONVERT_SLICES 8        // 颜色转换最多分成的片数
+
+// 播放器运行时统计，各流水线阶段直接累加，读取时不需要加锁
+struct PlayerStats {
+    std::atomic<uint64_t> demuxedPackets{0};
+    std::atomic<uint64_t> decodedVideoFrames{0};
+    std::atomic<uint64_t> renderedVideoFrames{0};
+    std::atomic<uint64_t> decodedAudioFrames{0};
+    std::atomic<uint64_t> tempoProcessUs{0};      // 变速处理累计耗时
+    std::atomic<uint64_t> tempoOutputFrames{0};   // 变速处理输出的音频帧数
+    std::atomic<uint64_t> resampleUs{0};          // 重采样累计耗时
+    std::atomic<uint64_t> audioSilenceFrames{0};  // 音频回调中因环形缓冲区没有数据补的静音帧
+    std::atomic<uint64_t> downmixFrames{0};       // 由 AudioDsp 下混的帧数和耗时
+    std::atomic<uint64_t> downmixUs{0};
+    std::atomic<uint64_t> softClipSamples{0};     // 检查峰值（超出满幅时软削波）的样本数和耗时
+    std::atomic<uint64_t> softClipUs{0};
+    std::atomic<uint64_t> softClippedSamples{0};  // 其中被压缩的样本
+    std::atomic<uint64_t> s16Samples{0};          // 转换成 S16 的样本数和耗时
+    std::atomic<uint64_t> s16Us{0};
+    std::atomic<uint64_t> loudnessFrames{0};      // 经过响度归一化的帧数和耗时
+    std::atomic<uint64_t> loudnessUs{0};
+    std::atomic<double> avSyncDiff{0};            // 最近一帧画面的 pts 减去音频时钟（秒）
+    std::atomic<uint64_t> audioClockedFrames{0};  // 按音频时钟决定显示时刻的画面
+    std::atomic<uint64_t> trickDroppedPackets{0}; // 快速浏览时在解复用阶段丢弃的 packet
+    std::atomic<double> trickEffectiveSpeed{0};   // 快速浏览时实际达到的速度
+    std::atomic<uint64_t> reverseGops{0};         // 倒放解码的 GOP 数
+    std::atomic<uint64_t> reverseGopDecodeUs{0};  // 倒放解码 GOP 的累计耗时
+    std::atomic<uint64_t> reverseDownscaledFrames{0};
+    std::atomic<uint64_t> reverseDroppedFrames{0};
+    std::atomic<uint64_t> reverseStalls{0};       // 显示完一个 GOP 时下一个还没解码好的次数
+    std::atomic<uint64_t> stepHits{0};            // 单步命中画面缓存的次数
+    std::atomic<uint64_t> stepHitUs{0};
+    std::atomic<uint64_t> stepMisses{0};          // 单步需要跳转解码的次数
+    std::atomic<uint64_t> stepMissUs{0};
+    std::atomic<uint64_t> stepFailures{0};        // 单步没有找到可以显示的画面
+    std::atomic<uint64_t> stepCacheFailures{0};   // 显示的画面没能放进单步缓存
+    std::atomic<uint64_t> convertedPixels{0};     // 转换成 RGBA 的像素数
+    std::atomic<uint64_t> convertUs{0};           // 颜色转换累计耗时
+    std::atomic<uint64_t> simdConvertedFrames{0}; // 使用 YuvConverter 转换的帧
+    std::atomic<uint64_t> swsConvertedFrames{0};  // 使用 swscale 转换的帧
+    std::atomic<uint64_t> yuvDirectFrames{0};     // 不做颜色转换直接以 YV12 显示的帧
+    std::atomic<uint64_t> renderedBytes{0};       // 复制到窗口缓冲区的数据量
+    std::atomic<uint64_t> sourcePixels{0};        // 转换前的像素数（解码输出尺寸）
+    std::atomic<uint64_t> fastScaleFrames{0};     // 负载高时用快速双线性缩放的帧
+    std::atomic<uint64_t> presentedImages{0};     // 显示阶段从 readyQ 取出的画面
+    std::atomic<uint64_t> readyAheadSum{0};       // 每次取出后队列中剩余画面数之和
+    std::atomic<uint64_t> presentUs{0};           // 锁定窗口、复制、提交的累计耗时
+    std::atomic<uint64_t> toneMappedFrames{0};    // 经过 10 位 -> 8 位映射的帧
+    std::atomic<uint64_t> toneMapPixels{0};
+    std::atomic<uint64_t> toneMapUs{0};           // 这些帧从 10 位到输出格式的累计耗时
+    std::atomic<double> toneMapPeakNits{0};       // 当前映射使用的内容峰值亮度
+    std::atomic<uint64_t> gamutMappedFrames{0};   // RGBA 输出从 BT.2020 换算到 BT.709 原色的帧
+    // 同尺寸直接转换（RGBA 或 YV12）的像素数和耗时，按是否旋转分开，比较旋转的额外开销
+    std::atomic<uint64_t> uprightPixels{0};
+    std::atomic<uint64_t> uprightUs{0};
+    std::atomic<uint64_t> rotatedFrames{0};
+    std::atomic<uint64_t> rotatedPixels{0};
+    std::atomic<uint64_t> rotatedUs{0};
+    std::atomic<uint64_t> rotateScaledFrames{0};  // 旋转前需要先缩放的帧
+    // 按分片数统计的 SIMD 转换像素数和耗时，用于比较 1 ~ N 个线程的加速比
+    std::atomic<uint64_t> slicedPixels[MAX_CONVERT_SLICES + 1]{};
+    std::atomic<uint64_t> slicedUs[MAX_CONVERT_SLICES + 1]{};
+    // Java 层 seek / pause 调用在 native 中的耗时
+    std::atomic<uint64_t> seekCalls{0};
+    std::atomic<uint64_t> seekCallUs{0};
+    std::atomic<uint64_t> seekCallMaxUs{0};
+    std::atomic<uint64_t> pauseCalls{0};
+    std::atomic<uint64_t> pauseCallUs{0};
+    std::atomic<uint64_t> pauseCallMaxUs{0};
+    // 跳转在 controlling 阶段执行完成的次数和从请求到完成的耗时，被后来的跳转合并掉的请求，
+    // 以及执行时已经停止或 av_seek_frame 失败的跳转（seek() 投递后就返回，失败只能在这里看到）
+    std::atomic<uint64_t> seeksDone{0};
+    std::atomic<uint64_t> seekDoneUs{0};
+    std::atomic<uint64_t> seekDoneMaxUs{0};
+    std::atomic<uint64_t> seeksCoalesced{0};
+    std::atomic<uint64_t> seekFailures{0};
+    // 播放列表：预加载（打开 + 预热解码器）的耗时，切换时画面的额外间隔和音频欠载
+    std::atomic<uint64_t> playlistSwitches{0};
+    std::atomic<uint64_t> preloadedItems{0};
+    std::atomic<uint64_t> preloadFailures{0};
+    std::atomic<uint64_t> preloadUs{0};
+    std::atomic<uint64_t> preloadMaxUs{0};
+    std::atomic<uint64_t> primedFrames{0};        // 预热时解出的视频帧
+    std::atomic<int64_t> switchGapUs{0};          // 最近一次切换的第一帧比预定时刻晚多少
+    std::atomic<int64_t> switchGapMaxUs{0};
+    std::atomic<uint64_t> switchSilenceFrames{0}; // 音频跨越条目边界期间输出的静音帧
+    std::atomic<uint64_t> trimmedAudioSamples{0}; // 按编码器延迟和填充裁掉的样本
+    // 新打开解码器与复用缓存中的解码器的次数和耗时
+    std::atomic<uint64_t> decoderOpens{0};
+    std::atomic<uint64_t> decoderOpenUs{0};
+    std::atomic<uint64_t> decoderReuses{0};
+    std::atomic<uint64_t> decoderReuseUs{0};
+    // A-B 循环：每一遍的数据来源，以及回到 A 时第一帧比预定时刻晚了多少
+    std::atomic<uint64_t> loopPasses{0};
+    std::atomic<uint64_t> loopPacketPasses{0};    // 重放缓存的 packet
+    std::atomic<uint64_t> loopSeekPasses{0};      // 缓存放不下，跳转后重新读文件
+    std::atomic<uint64_t> loopFramePasses{0};     // 重放缓存的解码帧（按视频计）
+    std::atomic<uint64_t> loopReplayedPackets{0};
+    std::atomic<uint64_t> loopReplayedBytes{0};
+    std::atomic<uint64_t> loopReplayedFrames{0};
+    std::atomic<int64_t> loopGapUs{0};
+    std::atomic<int64_t> loopGapMaxUs{0};
+
+    // 记录一次调用的耗时
+    static void addCall(std::atomic<uint64_t> &calls, std::atomic<uint64_t> &total,
+                        std::atomic<uint64_t> &peak, uint64_t us) {
+        calls++;
+        total += us;
+        uint64_t prev = peak;
+        while (us > prev && !peak.compare_exchange_weak(prev, us)) {}
+    }
+
+    void reset() {
+        demuxedPackets = 0;
+        decodedVideoFrames = 0;
+        renderedVideoFrames = 0;
+        decodedAudioFrames = 0;
+        tempoProcessUs = 0;
+        tempoOutputFrames = 0;
+        resampleUs = 0;
+        audioSilenceFrames = 0;
+        downmixFrames = downmixUs = 0;
+        softClipSamples = softClipUs = softClippedSamples = 0;
+        s16Samples = s16Us = 0;
+        loudnessFrames = loudnessUs = 0;
+        avSyncDiff = 0;
+        audioClockedFrames = 0;
+        trickDroppedPackets = 0;
+        trickEffectiveSpeed = 0;
+        reverseGops = 0;
+        reverseGopDecodeUs = 0;
+        reverseDownscaledFrames = 0;
+        reverseDroppedFrames = 0;
+        reverseStalls = 0;
+        stepHits = 0;
+        stepHitUs = 0;
+        stepMisses = 0;
+        stepMissUs = 0;
+        stepFailures = 0;
+        stepCacheFailures = 0;
+        convertedPixels = 0;
+        convertUs = 0;
+        simdConvertedFrames = 0;
+        swsConvertedFrames = 0;
+        yuvDirectFrames = 0;
+        renderedBytes = 0;
+        sourcePixels = 0;
+        fastScaleFrames = 0;
+        presentedImages = 0;
+        readyAheadSum = 0;
+        presentUs = 0;
+        toneMappedFrames = 0;
+        toneMapPixels = 0;
+        toneMapUs = 0;
+        toneMapPeakNits = 0;
+        gamutMappedFrames = 0;
+        uprightPixels = 0;
+        uprightUs = 0;
+        rotatedFrames = 0;
+        rotatedPixels = 0;
+        rotatedUs = 0;
+        rotateScaledFrames = 0;
+        seekCalls = seekCallUs = seekCallMaxUs = 0;
+        pauseCalls = pauseCallUs = pauseCallMaxUs = 0;
+        seeksDone = seekDoneUs = seekDoneMaxUs = seeksCoalesced = seekFailures = 0;
+        playlistSwitches = preloadedItems = preloadFailures = 0;
+        preloadUs = preloadMaxUs = primedFrames = 0;
+        switchGapUs = switchGapMaxUs = 0;
+        switchSilenceFrames = trimmedAudioSamples = 0;
+        decoderOpens = decoderOpenUs = decoderReuses = decoderReuseUs = 0;
+        loopPasses = loopPacketPasses = loopSeekPasses = loopFramePasses = 0;
+        loopReplayedPackets = loopReplayedBytes = loopReplayedFrames = 0;
+        loopGapUs = loopGapMaxUs = 0;
+        for (int i = 0; i <= MAX_CONVERT_SLICES; ++i) {
+            slicedPixels[i] = 0;
+            slicedUs[i] = 0;
+        }
+    }
+};
+
+#endif //TINY_PLAYER_PLAYER_STATS_H
@@ -2,6 +2,7 @@
 #define TINY_PLAYER_QUEUE_HPP
 
 #include <deque>
+#include <functional>
 #include <condition_variable>
 #include <mutex>
 
@@ -30,6 +31,21 @@ public:
     void push(const T &ele);
     bool pop(T &ele);
 
+    /**
+     * @brief 非阻塞地添加元素，队列已满或处于暂停状态时返回 false
+     */
+    bool tryPush(const T &ele);
+
+    /**
+     * @brief 非阻塞地获取元素，队列为空或处于暂停状态时返回 false
+     */
+    bool tryPop(T &ele);
+
+    /**
+     * @brief 取出队列中的全部元素并逐个交给 fn 处理（通常是释放），不受暂停状态影响
+     */
+    void drain(const std::function<void(T &)> &fn);
+
     /**
      * @brief 暂停队列，既不能向中添加元素也不能从队列中获取元素
      */
@@ -121,6 +137,45 @@ bool Queue<T>::pop(T &ele) {
     return true;
 }
 
+template <typename T>
+bool Queue<T>::tryPush(const T &ele) {
+    {
+        lock_guard lck(mtx);
+        if (deq.size() >= m_cap || is_pause || is_close) {
+            return false;
+        }
+        deq.push_back(ele);
+    }
+    consumer.notify_one();
+    return true;
+}
+
+template <typename T>
+bool Queue<T>::tryPop(T &ele) {
+    {
+        lock_guard lck(mtx);
+        if (deq.empty() || is_pause) {
+            return false;
+        }
+        ele = deq.front();
+        deq.pop_front();
+    }
+    producer.notify_one();
+    return true;
+}
+
+template <typename T>
+void Queue<T>::drain(const std::function<void(T &)> &fn) {
+    {
+        lock_guard lck(mtx);
+        for (auto &ele : deq) {
+            fn(ele);
+        }
+        deq.clear();
+    }
+    producer.notify_all();
+}
+
 template <typename T>
 void Queue<T>::pause() {
     {
@@ -0,0 +1,96 @@
+#ifndef TINY_PLAYER_RING_BUFFER_HPP
+#define TINY_PLAYER_RING_BUFFER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// 单生产者单消费者的无锁字节环形缓冲区。生产者是音频解码阶段，消费者是 AAudio 的
+// 实时回调，两端都不会阻塞，也不会分配内存。
+class RingBuffer {
+public:
+    /**
+     * @brief 创建缓冲区，容量向上取整到 2 的幂
+     */
+    explicit RingBuffer(size_t cap) {
+        size_t n = 1;
+        while (n < cap) n <<= 1;
+        buf.resize(n);
+        mask = n - 1;
+    }
+
+    size_t capacity() const { return buf.size(); }
+
+    // 可读字节数，clear() 丢弃的数据不计在内
+    size_t readable() const {
+        uint64_t w = writeIdx.load(std::memory_order_acquire);
+        uint64_t r = readIdx.load(std::memory_order_acquire);
+        return w - std::max(r, discardIdx.load(std::memory_order_acquire));
+    }
+
+    // 可写字节数（生产者调用）。clear() 丢弃的数据不等消费者 read() 就算作空闲，
+    // 除非消费者正在从丢弃的位置读取
+    size_t writable() const {
+        uint64_t w = writeIdx.load(std::memory_order_relaxed);
+        uint64_t r = readIdx.load(std::memory_order_acquire);
+        uint64_t d = discardIdx.load(std::memory_order_seq_cst);
+        uint64_t c = readingIdx.load(std::memory_order_seq_cst);
+        return buf.size() - (w - std::max(r, std::min(d, c)));
+    }
+
+    /**
+     * @brief 写入 len 字节，空间不足时不写入并返回 false
+     */
+    bool write(const uint8_t *data, size_t len) {
+        if (writable() < len) return false;
+        uint64_t w = writeIdx.load(std::memory_order_relaxed);
+        size_t off = w & mask;
+        size_t first = std::min(len, buf.size() - off);
+        memcpy(buf.data() + off, data, first);
+        memcpy(buf.data(), data + first, len - first);
+        writeIdx.store(w + len, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 读取最多 len 字节，返回实际读取的字节数
+     */
+    size_t read(uint8_t *data, size_t len) {
+        uint64_t r = readIdx.load(std::memory_order_relaxed);
+        // 先公布读取的起点再读 discardIdx（与 clear()、writable() 的顺序相反）：要么这里看到新的
+        // discardIdx，要么生产者看到这个起点，不会覆盖正在读取的数据
+        readingIdx.store(r, std::memory_order_seq_cst);
+        uint64_t d = discardIdx.load(std::memory_order_seq_cst);
+        uint64_t w = writeIdx.load(std::memory_order_acquire);
+        // 处理 clear() 请求：跳过请求时刻之前写入的数据
+        if (d > r && d <= w) r = d;
+        size_t n = std::min<uint64_t>(len, w - r);
+        size_t off = r & mask;
+        size_t first = std::min(n, buf.size() - off);
+        memcpy(data, buf.data() + off, first);
+        memcpy(data + first, buf.data(), n - first);
+        readIdx.store(r + n, std::memory_order_release);
+        readingIdx.store(UINT64_MAX, std::memory_order_release);
+        return n;
+    }
+
+    /**
+     * @brief 丢弃当前已写入的数据（生产者调用）。readable()/writable() 立即生效，
+     * 读取位置由消费者在下一次 read() 时跳过
+     */
+    void clear() {
+        discardIdx.store(writeIdx.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+    }
+
+private:
+    std::vector<uint8_t> buf;
+    size_t mask;
+    std::atomic<uint64_t> writeIdx{0};
+    std::atomic<uint64_t> readIdx{0};
+    std::atomic<uint64_t> discardIdx{0};
+    std::atomic<uint64_t> readingIdx{UINT64_MAX};   // 消费者正在读取的起点，不在 read() 中时为 UINT64_MAX
+};
+
+#endif //TINY_PLAYER_RING_BUFFER_HPP
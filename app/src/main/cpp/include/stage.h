@@ -0,0 +1,68 @@
+#ifndef TINY_PLAYER_STAGE_H
+#define TINY_PLAYER_STAGE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "worker_pool.h"
+#include "thread_policy.h"
+
+// 流水线中的一个阶段（解复用、解码、渲染……）。阶段的单步函数在线程池上串行执行：
+// 同一时刻最多只有一个线程在执行某个阶段，因此阶段内部不需要再加锁保护自己的状态。
+// 单步函数不能阻塞：输入为空或输出已满时返回 kIdle，由上下游在状态变化时调用 wake() 重新调度；
+// 需要按时间节奏执行（如按帧率渲染）时返回延时的微秒数。
+class Stage : public std::enable_shared_from_this<Stage> {
+public:
+    static constexpr int64_t kProgress = 0;     // 有进展，可以继续执行
+    static constexpr int64_t kIdle = -1;        // 没有可做的工作，等待 wake()
+
+    using Step = std::function<int64_t()>;
+
+    /**
+     * @brief 创建阶段，role 决定阶段在哪类核心上运行以及线程名和优先级
+     */
+    static std::shared_ptr<Stage> create(WorkerPool *pool, Step step,
+                                         ThreadRole role = ThreadRole::General);
+
+    /**
+     * @brief 允许阶段被调度，并立即调度一次
+     */
+    void start();
+
+    /**
+     * @brief 通知阶段有新的工作（输入队列有数据或输出队列有空间）
+     */
+    void wake();
+
+    /**
+     * @brief 停止阶段，返回时单步函数已经不在执行，之后也不会再被调用
+     */
+    void stop();
+
+private:
+    enum State { IDLE, SCHEDULED, RUNNING, RERUN, STOPPED };
+    static constexpr int kBatch = 8;    // 单次调度最多连续执行的步数，避免长期占用工作线程
+
+    Stage(WorkerPool *pool, Step step, ThreadRole role);
+    void run(uint64_t ticket);
+    void schedule(uint64_t ticket, int64_t delayUs);
+    void notifyStopper();
+
+    // 状态和调度序号放在同一个原子变量里：每次进入 SCHEDULED 都换一个新序号，
+    // 投递的任务只能认领自己那个序号的调度，stop() 之前投递的延时任务不会提前抢走之后的调度
+    static uint64_t pack(int s, uint64_t ticket) { return ticket << 3 | static_cast<uint64_t>(s); }
+    static int stateOf(uint64_t v) { return static_cast<int>(v & 7); }
+    static uint64_t ticketOf(uint64_t v) { return v >> 3; }
+
+    WorkerPool *pool;
+    Step step;
+    ThreadRole role;
+    std::atomic<uint64_t> state;
+    std::atomic<int> stoppers;          // 正在 stop() 中等待的线程数
+    std::mutex mtx;
+    std::condition_variable idle;       // stop() 等待正在执行的单步结束
+};
+
+#endif //TINY_PLAYER_STAGE_H
@@ -0,0 +1,60 @@
+#ifndef TINY_PLAYER_TEMPO_PROCESSOR_H
+#define TINY_PLAYER_TEMPO_PROCESSOR_H
+
+#include <cstddef>
+#include <vector>
+
+// 基于 WSOLA 的变速不变调处理。输入输出都是交错排列的 float PCM。
+//
+// 每次从输入中取一段 sequence 长的数据，在 seekWindow 范围内找到与上一段尾部（overlap 长）
+// 最相似的位置，交叉淡化后拼接输出，然后按 tempo 跳过输入。tempo 为 1 且没有变化时沿用
+// 上一次的位置，不做相关性搜索，输出与输入逐样本一致。
+class TempoProcessor {
+public:
+    TempoProcessor();
+
+    /**
+     * @brief 设置采样率和声道数，会清空内部缓存
+     */
+    void configure(int sampleRate, int channels);
+
+    /**
+     * @brief 设置目标速度（0.25 ~ 4），实际速度每处理一段向目标逼近一步，避免突变
+     */
+    void setTempo(float tempo);
+
+    /**
+     * @brief 清空内部缓存（跳转后调用）
+     */
+    void clear();
+
+    /**
+     * @brief 追加 frames 帧输入，并把能输出的结果追加到 out 末尾，返回输出的帧数
+     */
+    size_t process(const float *in, size_t frames, std::vector<float> &out);
+
+    /**
+     * @brief 已经输入但还没有处理的帧数，用于推算输出对应的媒体时间
+     */
+    size_t bufferedFrames() const;
+
+private:
+    size_t seekBestOffset(const float *input) const;
+    void compact();
+
+    int channels;
+    size_t sequence;        // 每段长度（帧）
+    size_t seekWindow;      // 搜索范围（帧）
+    size_t overlap;         // 交叉淡化长度（帧）
+    float target;           // 目标速度
+    float current;          // 当前速度
+    double skipFract;       // 按速度跳过输入时累计的小数部分
+    size_t lastOffset;
+    bool lastWasUnity;      // 上一段速度为 1
+    bool midValid;
+    std::vector<float> input;   // 待处理的输入
+    size_t inputStart;          // input 中有效数据的起点（样本）
+    std::vector<float> mid;     // 上一段的尾部，等待与下一段交叉淡化
+};
+
+#endif //TINY_PLAYER_TEMPO_PROCESSOR_H
@@ -0,0 +1,73 @@
+#ifndef TINY_PLAYER_THREAD_POLICY_H
+#define TINY_PLAYER_THREAD_POLICY_H
+
+#include <string>
+#include <vector>
+
+// 核心类型：大核、小核，Any 表示不区分（同构 CPU 或无法读取频率信息时）
+enum class CoreClass { Any, Big, Little };
+
+// 流水线阶段的角色，决定在哪类核心上运行、线程优先级和线程名
+enum class ThreadRole { General, Demux, VideoDecode, VideoRender, AudioDecode, VideoConvert };
+
+// 频率相同的一组 CPU
+struct CpuCluster {
+    long maxFreqKHz;
+    std::vector<int> cpus;
+};
+
+// CPU 拓扑，根据 sysfs 中每个核的 cpufreq/cpuinfo_max_freq 把核心划分成簇。
+// 最低频率的簇视为小核，其余（包括超大核）都视为大核。
+class CpuTopology {
+public:
+    /**
+     * @brief 读取 CPU 拓扑。root 默认为 /sys/devices/system/cpu，在普通 Linux 主机上
+     *        也可以用同样的逻辑读取（或指向一个模拟的目录）来验证划分结果
+     */
+    static CpuTopology detect(const std::string &root = "/sys/devices/system/cpu");
+
+    // 按最高频率从低到高排列
+    const std::vector<CpuCluster> &clusters() const;
+    bool isHeterogeneous() const;
+    std::vector<int> cpus(CoreClass cls) const;
+
+private:
+    std::vector<CpuCluster> m_clusters;
+};
+
+// 线程放置和优先级策略：线程池的工作线程按大小核分组并绑定到对应的簇，
+// 阶段任务按角色投递到对应的分组，音频阶段运行时临时提高线程优先级。
+class ThreadPolicy {
+public:
+    static ThreadPolicy *shared();
+
+    const CpuTopology &topology() const;
+
+    /**
+     * @brief 为线程池的 n 个工作线程分配核心类型，大核线程数不超过大核个数
+     */
+    std::vector<CoreClass> workerClasses(size_t n) const;
+
+    /**
+     * @brief 在工作线程启动时调用：绑定到对应簇的核心并设置线程名
+     */
+    void bindWorker(CoreClass cls, size_t index) const;
+
+    /**
+     * @brief 角色偏好的核心类型：解码和渲染在大核，解复用（I/O）在小核
+     */
+    static CoreClass preferredClass(ThreadRole role);
+
+    /**
+     * @brief 当前线程开始执行某个角色的任务：更新线程名，音频角色提高优先级。
+     *        角色没有变化时不做系统调用
+     */
+    static void enterRole(ThreadRole role);
+
+private:
+    ThreadPolicy();
+
+    CpuTopology m_topology;
+};
+
+#endif //TINY_PLAYER_THREAD_POLICY_H
@@ -0,0 +1,91 @@
+#ifndef TINY_PLAYER_TONE_MAP_H
+#define TINY_PLAYER_TONE_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define SDR_WHITE_NITS 203.0        // BT.2408 的 HDR 参考白，映射为 SDR 的 100%
+#define DEFAULT_HDR_PEAK_NITS 1000.0  // 没有亮度元数据时假定的内容峰值
+#define GAMUT_ENCODE_OCTAVES 20     // 色域转换后重新编码覆盖的线性亮度范围 [2^-20, 1]
+#define GAMUT_ENCODE_STEPS 256      // 其中每倍亮度的查找表级数
+
+// 10 位视频的传递函数
+enum class HdrTransfer {
+    SDR,        // BT.709 / BT.2020 gamma，只做位深转换
+    PQ,         // SMPTE ST 2084（HDR10）
+    HLG,        // ARIB STD-B67
+};
+
+// 10 位 4:2:0 图像。yuv420p10 的样本在低 10 位，P010 的样本在高 10 位且色度交错
+struct Yuv10Image {
+    const uint16_t *y;
+    const uint16_t *u;      // 交错时指向 UV 平面
+    const uint16_t *v;      // 交错时不使用
+    int yStride;            // 以样本（uint16_t）计
+    int uvStride;
+    int width;
+    int height;
+    int shift;              // 样本右移多少位得到 10 位值
+    bool interleaved;
+};
+
+// 8 位 YUV420P 输出，总是 limited range。转换一段行时各平面指向这一段的第一行
+struct Yuv8Planes {
+    uint8_t *y;
+    uint8_t *u;
+    uint8_t *v;
+    int yStride;
+    int uvStride;
+};
+
+// 10 位 -> 8 位转换，PQ/HLG 内容同时做色调映射。
+//
+// 映射只作用在亮度上：亮度码值经 EOTF 得到绝对亮度，按 BT.2390 的 EETF 把内容峰值压缩到
+// SDR 参考白，再按 BT.1886（gamma 2.4）编码成 8 位。色度按映射前后亮度码值之比缩放，
+// 保持饱和度大致不变。两者都预先算成 1024 项的查找表，每个样本只需要查一次表，
+// 参数（传递函数、峰值亮度、范围）不变时不重建。输出的 YUV 仍是 BT.2020 色域：
+// 显示 RGBA 时由 toBt709 在线性光下把 BT.2020 原色换算成 BT.709，显示 YV12 时由窗口的
+// dataspace 标明 BT.2020，交给合成器转换。
+class ToneMapper {
+public:
+    ToneMapper();
+
+    /**
+     * @brief 设置传递函数和内容峰值亮度（nits），返回是否重建了查找表
+     */
+    bool configure(HdrTransfer transfer, double peakNits, bool fullRange);
+
+    HdrTransfer transfer() const;
+    double peakNits() const;
+
+    /**
+     * @brief 转换 [rowBegin, rowEnd) 这些行写入 dst（dst 的第一行对应 rowBegin）。
+     * rowBegin 需为偶数，各行互不依赖，可以分片并行调用，也可以每次两行与 RGBA 转换交替进行
+     */
+    void convertRows(const Yuv10Image &src, const Yuv8Planes &dst, int rowBegin, int rowEnd) const;
+
+    /**
+     * @brief 10 位亮度码值映射后的 8 位码值，用于检查曲线
+     */
+    uint8_t mapLuma(int code) const;
+
+    /**
+     * @brief 把按 BT.2020 原色、BT.1886 编码的 RGBA 就地转换成 BT.709 原色：查表还原线性光，
+     * 乘 3x3 矩阵，超出 BT.709 色域的分量截断到 [0, 1] 后重新编码。alpha 不变
+     */
+    void toBt709(uint8_t *rgba, int pixels) const;
+
+private:
+    HdrTransfer curve;
+    double peak;
+    bool full;
+    bool built;
+    uint8_t lumaLut[1024];
+    int16_t chromaGain[1024];   // 色度增益，放大 4096 倍，已包含 10 位到 8 位的缩放
+    // 色域转换：8 位码值 -> 线性光；线性光 -> 8 位码值。后者按 float 的指数和尾数高位查表，
+    // 每倍亮度分成同样多级，暗部也有足够的精度，不需要开方或求幂
+    float linearLut[256];
+    uint8_t encodeLut[GAMUT_ENCODE_OCTAVES * GAMUT_ENCODE_STEPS + 1];
+};
+
+#endif //TINY_PLAYER_TONE_MAP_H
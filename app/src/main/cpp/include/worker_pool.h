@@ -0,0 +1,111 @@
+#ifndef TINY_PLAYER_WORKER_POOL_H
+#define TINY_PLAYER_WORKER_POOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <queue>
+#include <chrono>
+#include "thread_policy.h"
+
+// 进程内所有 Player 共享的工作线程池。线程数有上限，与播放器个数无关；
+// 解复用、解码、渲染等流水线阶段都以任务的形式投递到这里执行，任务本身不能阻塞等待。
+//
+// 每个工作线程有自己的任务双端队列：工作线程投递的任务放进自己的队列尾部并从尾部取出执行
+// （刚被唤醒的下游阶段通常紧接着在同一个核上运行，数据还在缓存里）；自己的队列为空时从
+// 其他线程的队列头部窃取任务，只有所有队列都为空时才休眠。
+//
+// 在大小核 CPU 上工作线程按 ThreadPolicy 分成大核组和小核组并绑定到对应的簇，
+// 投递任务时可以指定偏好的核心类型；窃取时优先从同组线程窃取，其次才跨组。
+class WorkerPool {
+public:
+    using Task = std::function<void()>;
+
+    /**
+     * @brief 获取进程内共享的线程池，线程数为 CPU 核数（限制在 [2, 8] 之间）
+     */
+    static WorkerPool *shared();
+
+    explicit WorkerPool(size_t nThreads);
+    ~WorkerPool();
+
+    /**
+     * @brief 投递一个任务，尽快执行，cls 指定偏好的核心类型
+     */
+    void post(Task task, CoreClass cls = CoreClass::Any);
+
+    /**
+     * @brief 投递一个任务，在 delayUs 微秒之后执行
+     */
+    void postDelayed(Task task, int64_t delayUs, CoreClass cls = CoreClass::Any);
+
+    /**
+     * @brief 把 [0, count) 分给调用线程和工作线程并行执行 fn，全部完成后返回。
+     * 调用线程自己也领取分片，只等待已经被其他线程领走的分片，可以在池内任务中调用。
+     * 辅助任务直接放进其他工作线程的队列，不经过调用线程自己的队列
+     */
+    void parallelFor(int count, const std::function<void(int)> &fn, CoreClass cls = CoreClass::Any);
+
+    size_t threadCount() const;
+
+    // 从其他线程队列窃取成功的次数
+    uint64_t stealCount() const;
+
+    // 工作线程进入休眠的次数
+    uint64_t parkCount() const;
+
+private:
+    using clock = std::chrono::steady_clock;
+    using lock_guard = std::lock_guard<std::mutex>;
+    using unique_lock = std::unique_lock<std::mutex>;
+
+    struct TimedTask {
+        clock::time_point due;
+        uint64_t seq;       // 相同到期时间时保持投递顺序
+        CoreClass cls;
+        Task task;
+        bool operator>(const TimedTask &rhs) const {
+            return due != rhs.due ? due > rhs.due : seq > rhs.seq;
+        }
+    };
+
+    struct Worker {
+        std::mutex mtx;
+        std::deque<Task> deq;
+        std::thread thread;
+        CoreClass cls;
+    };
+
+    const std::vector<size_t> &laneOf(CoreClass cls) const;
+    void push(size_t index, Task task);
+    void workerLoop(size_t index);
+    bool popLocal(size_t index, Task &task);
+    bool steal(size_t index, Task &task);
+    bool popDueTimer(size_t index, Task &task);
+    bool accepts(size_t index, CoreClass cls) const;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<size_t> lanes[3];       // 按 CoreClass 分组的工作线程下标
+    std::atomic<size_t> nextWorker;     // 投递到其他线程时轮流选择队列
+    std::atomic<int64_t> pending;       // 所有队列中的任务总数
+    std::atomic<int> sleepers;          // 正在休眠的工作线程数
+    std::atomic<uint64_t> steals;
+    std::atomic<uint64_t> parks;
+
+    std::atomic<int64_t> earliestDue;   // 最早到期的定时任务（steady_clock 计数）
+    std::mutex timerMtx;
+    std::priority_queue<TimedTask, std::vector<TimedTask>, std::greater<>> timers; // 延时任务
+    uint64_t timerSeq;
+
+    std::mutex sleepMtx;
+    std::condition_variable sleepCv;
+    bool closed;
+};
+
+#endif //TINY_PLAYER_WORKER_POOL_H
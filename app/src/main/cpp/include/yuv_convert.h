@@ -0,0 +1,140 @@
+#ifndef TINY_PLAYER_YUV_CONVERT_H
+#define TINY_PLAYER_YUV_CONVERT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// 色度平面的排列方式，都是 4:2:0 采样
+enum class ChromaLayout {
+    Planar,     // YUV420P：U、V 各占一个平面
+    NV12,       // UV 交错
+    NV21,       // VU 交错
+};
+
+enum class YuvMatrix {
+    BT601,
+    BT709,
+    BT2020,     // 非恒定亮度
+};
+
+// 显示时顺时针旋转的角度
+enum class Rotation {
+    None,
+    Cw90,
+    Cw180,
+    Cw270,
+};
+
+enum class SimdLevel {
+    Scalar,
+    Neon,
+    Sse41,
+    Avx2,
+};
+
+struct YuvImage {
+    const uint8_t *y;
+    const uint8_t *u;       // NV12/NV21 时指向交错的色度平面
+    const uint8_t *v;       // NV12/NV21 时不使用
+    int yStride;
+    int uvStride;
+    int width;
+    int height;
+    ChromaLayout layout;
+};
+
+// 同尺寸的 YUV 4:2:0 -> RGBA 转换，不做缩放。
+//
+// 系数为 6 位定点数，中间结果按 16 位饱和运算，标量和各 SIMD 实现逐像素结果一致，
+// 与浮点公式相差不超过 3。SIMD 版本按编译目标和运行时检测到的 CPU 特性选择。
+class YuvConverter {
+public:
+    /**
+     * @brief 检测当前 CPU 支持的最高 SIMD 级别
+     */
+    static SimdLevel detect();
+    static const char *levelName(SimdLevel level);
+
+    explicit YuvConverter(SimdLevel level = detect());
+
+    void setColor(YuvMatrix matrix, bool fullRange);
+    SimdLevel level() const;
+
+    /**
+     * @brief 转换整幅图像，dst 每行 width * 4 字节，行距 dstStride
+     */
+    void convert(const YuvImage &src, uint8_t *dst, int dstStride) const;
+
+    /**
+     * @brief 只转换 [rowBegin, rowEnd) 这些行，各行互不依赖，可以分片并行调用
+     */
+    void convertRows(const YuvImage &src, uint8_t *dst, int dstStride, int rowBegin, int rowEnd) const;
+
+    /**
+     * @brief 转换的同时顺时针旋转 rotation，dst 是旋转后的图像，[rowBegin, rowEnd) 是 dst 中的行，
+     * 分片方式与 convertRows 相同。源图像按小块转换到栈上的缓冲区，在缓存中转置后写出，
+     * 不需要整帧的中间缓冲区
+     */
+    void convertRotated(const YuvImage &src, uint8_t *dst, int dstStride, Rotation rotation,
+                        int rowBegin, int rowEnd) const;
+
+    // 定点系数，公式见 yuv_convert.cpp
+    struct Coeffs {
+        int16_t yOffset;
+        int16_t yMul;
+        int16_t rv;
+        int16_t gu;
+        int16_t gv;
+        int16_t bu;
+    };
+
+    using RowFunc = void (*)(const uint8_t *y, const uint8_t *u, const uint8_t *v, int uvStep,
+                             uint8_t *dst, int width, bool mirror, const Coeffs &c);
+
+private:
+    // 转换源图像第 r 行从第 x 列（偶数）开始的 width 个像素，mirror 时左右翻转写出
+    void convertSpan(const YuvImage &src, int r, int x, int width, bool mirror, uint8_t *out) const;
+
+    SimdLevel simd;
+    RowFunc row;
+    Coeffs coeffs;
+};
+
+// YV12 的平面布局：Y 平面之后是 Cr（V）平面，再之后是 Cb（U）平面，色度宽高各为一半
+struct Yv12Layout {
+    int yStride;
+    int cStride;
+    size_t crOffset;
+    size_t cbOffset;
+    size_t size;
+};
+
+/**
+ * @brief 按 Android HAL_PIXEL_FORMAT_YV12 的规定计算布局：yStride 是窗口缓冲区的 stride
+ * （16 对齐），cStride = ALIGN(yStride / 2, 16)
+ */
+Yv12Layout yv12WindowLayout(int yStride, int height);
+
+/**
+ * @brief 没有行间填充的紧凑 YV12 布局，单步缓存中保存的就是这种格式
+ */
+Yv12Layout yv12PackedLayout(int width, int height);
+
+/**
+ * @brief 把 4:2:0 图像按 layout 复制到 dst，NV12/NV21 的色度在复制时拆分成两个平面
+ */
+void copyToYv12(const YuvImage &src, uint8_t *dst, const Yv12Layout &layout);
+
+/**
+ * @brief 把 4:2:0 图像顺时针旋转 rotation 后按 layout 写入 dst，只写旋转后图像的 [rowBegin, rowEnd)
+ * 这些行（rowBegin 为偶数），可以分片并行调用。源图像宽高需为偶数
+ */
+void rotateToYv12(const YuvImage &src, uint8_t *dst, const Yv12Layout &layout, Rotation rotation,
+                  int rowBegin, int rowEnd);
+
+/**
+ * @brief 以紧凑 YV12 数据构造 YuvImage
+ */
+YuvImage yv12Image(const uint8_t *packed, int width, int height);
+
+#endif //TINY_PLAYER_YUV_CONVERT_H
@@ -0,0 +1,158 @@
+#include "loop_cache.h"
+
+extern "C" {
+#include "libavutil/imgutils.h"
+#include "libavutil/samplefmt.h"
+}
+
+LoopCache::LoopCache(size_t budget):
+budget(budget), usedBytes(0), packetSize(0), packetReady(false), packetFailed(false) {}
+
+LoopCache::~LoopCache() {
+    clear();
+}
+
+void LoopCache::setBudget(size_t bytes) {
+    budget = bytes;
+}
+
+size_t LoopCache::frameBytes(const AVFrame *frame) {
+    int size;
+    if (frame->nb_samples > 0) {
+        size = av_samples_get_buffer_size(nullptr, frame->channels, frame->nb_samples,
+                                          static_cast<AVSampleFormat>(frame->format), 1);
+    } else {
+        size = av_image_get_buffer_size(static_cast<AVPixelFormat>(frame->format),
+                                        frame->width, frame->height, 1);
+    }
+    return size > 0 ? static_cast<size_t>(size) : 0;
+}
+
+bool LoopCache::reserve(size_t bytes) {
+    // 三个阶段同时加入数据，先占用再检查，超出时退回
+    if (usedBytes.fetch_add(bytes) + bytes <= budget) return true;
+    usedBytes -= bytes;
+    return false;
+}
+
+bool LoopCache::addPacket(const AVPacket *pkt) {
+    if (packetReady || packetFailed) return false;
+    size_t size = pkt->size > 0 ? static_cast<size_t>(pkt->size) : 0;
+    AVPacket *ref = nullptr;
+    if (reserve(size) && (ref = av_packet_clone(pkt)) == nullptr) usedBytes -= size;
+    if (ref == nullptr) {
+        for (auto &p : packets) av_packet_free(&p);
+        packets.clear();
+        usedBytes -= packetSize;
+        packetSize = 0;
+        packetFailed = true;
+        return false;
+    }
+    packets.push_back(ref);
+    packetSize += size;
+    return true;
+}
+
+void LoopCache::finishPackets() {
+    if (!packetFailed) packetReady = true;
+}
+
+bool LoopCache::packetsReady() const {
+    return packetReady;
+}
+
+bool LoopCache::packetsFailed() const {
+    return packetFailed;
+}
+
+size_t LoopCache::packetCount() const {
+    return packets.size();
+}
+
+const AVPacket *LoopCache::packet(size_t i) const {
+    return packets[i];
+}
+
+LoopCache::Frames &LoopCache::framesOf(LoopStream stream) {
+    return stream == LoopStream::Video ? video : audio;
+}
+
+const LoopCache::Frames &LoopCache::framesOf(LoopStream stream) const {
+    return stream == LoopStream::Video ? video : audio;
+}
+
+void LoopCache::dropFrames(Frames &part) {
+    for (auto &f : part.frames) av_frame_free(&f);
+    part.frames.clear();
+    usedBytes -= part.bytes;
+    part.bytes = 0;
+}
+
+bool LoopCache::addFrame(LoopStream stream, const AVFrame *frame) {
+    Frames &part = framesOf(stream);
+    if (part.ready || part.failed) return false;
+    size_t size = frameBytes(frame);
+    AVFrame *ref = nullptr;
+    if (reserve(size) && (ref = av_frame_clone(frame)) == nullptr) usedBytes -= size;
+    if (ref == nullptr) {
+        dropFrames(part);
+        part.failed = true;
+        return false;
+    }
+    part.frames.push_back(ref);
+    part.bytes += size;
+    return true;
+}
+
+void LoopCache::finishFrames(LoopStream stream) {
+    Frames &part = framesOf(stream);
+    if (!part.failed && !part.frames.empty()) part.ready = true;
+}
+
+bool LoopCache::framesReady(LoopStream stream) const {
+    return framesOf(stream).ready;
+}
+
+bool LoopCache::framesFailed(LoopStream stream) const {
+    return framesOf(stream).failed;
+}
+
+size_t LoopCache::frameCount(LoopStream stream) const {
+    return framesOf(stream).frames.size();
+}
+
+const AVFrame *LoopCache::frame(LoopStream stream, size_t i) const {
+    return framesOf(stream).frames[i];
+}
+
+size_t LoopCache::bytes() const {
+    return usedBytes;
+}
+
+size_t LoopCache::packetBytes() const {
+    return packetSize;
+}
+
+void LoopCache::discardPartial() {
+    if (!packetReady) {
+        for (auto &p : packets) av_packet_free(&p);
+        packets.clear();
+        usedBytes -= packetSize;
+        packetSize = 0;
+    }
+    for (Frames *part : {&video, &audio}) {
+        if (!part->ready) dropFrames(*part);
+    }
+}
+
+void LoopCache::clear() {
+    for (auto &p : packets) av_packet_free(&p);
+    packets.clear();
+    packetSize = 0;
+    packetReady = packetFailed = false;
+    for (Frames *part : {&video, &audio}) {
+        dropFrames(*part);
+        part->ready = part->failed = false;
+    }
+    usedBytes = 0;
+}
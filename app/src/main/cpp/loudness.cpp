@@ -0,0 +1,396 @@
+#include <algorithm>
+#include <cmath>
+#include "loudness.h"
+
+#define LOUDNESS_ABS_GATE -70.0         // 绝对门限（LUFS）
+#define LOUDNESS_REL_GATE -10.0         // 相对门限（LU）
+#define LOUDNESS_HIST_MAX 5.0           // 直方图覆盖 -70 ~ +5 LUFS
+#define LOUDNESS_HIST_STEP 0.1
+#define SUB_BLOCKS_MOMENTARY 4          // 400ms
+#define SUB_BLOCKS_SHORT_TERM 30        // 3s
+#define REDUCTION_REPORT_MS 500         // 限幅衰减统计的周期
+
+static double energyToLufs(double e) {
+    return -0.691 + 10.0 * std::log10(e);
+}
+
+static float dbToGain(float db) {
+    return std::pow(10.0f, db / 20.0f);
+}
+
+// 把 K 计权的两级滤波器写成采样率无关的形式（与 libebur128 相同的参数），
+// 48kHz 时与 BS.1770 给出的系数一致
+static void designShelf(double rate, double &b0, double &b1, double &b2, double &a1, double &a2) {
+    const double f0 = 1681.974450955533;
+    const double G = 3.999843853973347;
+    const double Q = 0.7071752369554196;
+    double K = std::tan(M_PI * f0 / rate);
+    double Vh = std::pow(10.0, G / 20.0);
+    double Vb = std::pow(Vh, 0.4996667741545416);
+    double a0 = 1.0 + K / Q + K * K;
+    b0 = (Vh + Vb * K / Q + K * K) / a0;
+    b1 = 2.0 * (K * K - Vh) / a0;
+    b2 = (Vh - Vb * K / Q + K * K) / a0;
+    a1 = 2.0 * (K * K - 1.0) / a0;
+    a2 = (1.0 - K / Q + K * K) / a0;
+}
+
+static void designHighPass(double rate, double &b0, double &b1, double &b2, double &a1, double &a2) {
+    const double f0 = 38.13547087602444;
+    const double Q = 0.5003270373238773;
+    double K = std::tan(M_PI * f0 / rate);
+    double a0 = 1.0 + K / Q + K * K;
+    b0 = 1.0;
+    b1 = -2.0;
+    b2 = 1.0;
+    a1 = 2.0 * (K * K - 1.0) / a0;
+    a2 = (1.0 - K / Q + K * K) / a0;
+}
+
+LoudnessNormalizer::LoudnessNormalizer()
+        : rate(0), channels(0), target(LOUDNESS_TARGET_LUFS), haveTrackGain(false), trackGain(0.0f),
+          shelf{}, highPass{}, blockFrames(0), blockPos(0), blockEnergy(0.0), subBlockCount(0),
+          gatedBlocks(0), currentGain(1.0f), momentary(NAN), shortTerm(NAN), integrated(NAN),
+          appliedDb(0.0f), ceiling(dbToGain(LIMITER_CEILING_DB)), tpThreshold(0.0f), historyPos(0),
+          quietFrames(0), lookahead(0), minHead(0), minTail(0), frameIndex(0), envelope(1.0f),
+          attackStep(0.0f), releaseCoef(0.0f), peakReduction(1.0f), reductionSince(0),
+          reductionDb(0.0f), tpFrames(0), totalFrames(0) {
+    // 4 倍过采样的插值滤波器：第 k 相在窗口第 5、6 个样本之间 k/4 处插值，
+    // Hann 窗截断的 sinc，每相归一化为直流增益 1。第 0 相就是原样本，不需要计算
+    float maxSum = 1.0f;
+    const int mid = TRUE_PEAK_TAPS / 2 - 1;
+    for (int k = 1; k < 4; ++k) {
+        double frac = k / 4.0;
+        double sum = 0.0;
+        double h[TRUE_PEAK_TAPS];
+        for (int j = 0; j < TRUE_PEAK_TAPS; ++j) {
+            double t = j - mid - frac;
+            double sinc = std::sin(M_PI * t) / (M_PI * t);
+            double w = 0.5 * (1.0 + std::cos(M_PI * t / (TRUE_PEAK_TAPS / 2)));
+            h[j] = sinc * w;
+            sum += h[j];
+        }
+        float absSum = 0.0f;
+        for (int j = 0; j < TRUE_PEAK_TAPS; ++j) {
+            phases[k - 1][j] = static_cast<float>(h[j] / sum);
+            absSum += std::fabs(phases[k - 1][j]);
+        }
+        maxSum = std::max(maxSum, absSum);
+    }
+    // 窗口内所有样本都低于 ceiling / maxSum 时，插值结果不可能超过 ceiling
+    tpThreshold = ceiling / maxSum;
+}
+
+void LoudnessNormalizer::configure(int sampleRate, int ch) {
+    rate = sampleRate;
+    channels = ch;
+    designShelf(rate, shelf.b0, shelf.b1, shelf.b2, shelf.a1, shelf.a2);
+    designHighPass(rate, highPass.b0, highPass.b1, highPass.b2, highPass.a1, highPass.a2);
+    filterState.assign(static_cast<size_t>(channels) * 4, 0.0);
+    // BS.1770 的声道加权：LFE 不计入，5.1 / 7.1 的环绕声道乘 1.41
+    weights.assign(channels, 1.0f);
+    if (channels >= 6) {
+        weights[3] = 0.0f;
+        for (int c = 4; c < channels; ++c) weights[c] = 1.41f;
+    }
+    blockFrames = std::max<size_t>(1, rate / 10);
+    subBlocks.assign(SUB_BLOCKS_SHORT_TERM, 0.0);
+    size_t bins = static_cast<size_t>(
+            (LOUDNESS_HIST_MAX - LOUDNESS_ABS_GATE) / LOUDNESS_HIST_STEP + 0.5);
+    histogram.assign(bins, 0);
+    binEnergy.assign(bins, 0.0);
+
+    history.assign(static_cast<size_t>(channels) * TRUE_PEAK_TAPS * 2, 0.0f);
+    lookahead = std::max<size_t>(TRUE_PEAK_TAPS * 2,
+                                 static_cast<size_t>(rate) * LIMITER_LOOKAHEAD_MS / 1000);
+    delay.assign(lookahead * channels, 0.0f);
+    minValues.assign(lookahead + 2, 1.0f);
+    minIndex.assign(lookahead + 2, 0);
+    releaseCoef = std::exp(-1.0f / (rate * LIMITER_RELEASE_MS / 1000.0f));
+    clear();
+    restart();
+    currentGain = 1.0f;
+    appliedDb.store(0.0f, std::memory_order_relaxed);
+}
+
+void LoudnessNormalizer::restart() {
+    // 延迟线中上一曲目的结尾已经乘过增益，照常输出；新曲目的增益从当前值开始平滑调整
+    std::fill(histogram.begin(), histogram.end(), 0);
+    std::fill(binEnergy.begin(), binEnergy.end(), 0.0);
+    gatedBlocks = 0;
+    haveTrackGain.store(false, std::memory_order_relaxed);
+    trackGain = 0.0f;
+    integrated.store(NAN, std::memory_order_relaxed);
+    tpFrames.store(0, std::memory_order_relaxed);
+    totalFrames.store(0, std::memory_order_relaxed);
+}
+
+void LoudnessNormalizer::clear() {
+    std::fill(filterState.begin(), filterState.end(), 0.0);
+    blockPos = 0;
+    blockEnergy = 0.0;
+    std::fill(subBlocks.begin(), subBlocks.end(), 0.0);
+    subBlockCount = 0;
+    momentary.store(NAN, std::memory_order_relaxed);
+    shortTerm.store(NAN, std::memory_order_relaxed);
+
+    std::fill(history.begin(), history.end(), 0.0f);
+    historyPos = 0;
+    quietFrames = TRUE_PEAK_TAPS;
+    std::fill(delay.begin(), delay.end(), 0.0f);
+    minHead = minTail = 0;
+    frameIndex = 0;
+    envelope = 1.0f;
+    attackStep = 0.0f;
+    peakReduction = 1.0f;
+    reductionSince = 0;
+    reductionDb.store(0.0f, std::memory_order_relaxed);
+}
+
+void LoudnessNormalizer::setTarget(float lufs) {
+    target = lufs;
+}
+
+void LoudnessNormalizer::setTrackGain(float gainDb) {
+    haveTrackGain.store(true, std::memory_order_relaxed);
+    trackGain = std::min(std::max(gainDb, -LOUDNESS_MAX_CUT_DB), LOUDNESS_MAX_BOOST_DB);
+    // 增益由 updateGain() 从当前值过渡过去：无缝衔接时延迟线里还是上一曲目按旧增益处理的结尾，
+    // 直接跳到新值会在衔接处产生爆音
+}
+
+size_t LoudnessNormalizer::latencyFrames() const {
+    return lookahead;
+}
+
+void LoudnessNormalizer::process(float *buf, size_t frames) {
+    if (channels <= 0 || frames == 0) return;
+    measure(buf, frames);
+    float from = updateGain(frames);
+    limit(buf, frames, from);
+    totalFrames.fetch_add(frames, std::memory_order_relaxed);
+}
+
+void LoudnessNormalizer::measure(const float *buf, size_t frames) {
+    // 逐声道滤波，先把本次数据每个子块的能量累加起来
+    size_t pos = blockPos;
+    size_t done = 0;
+    while (done < frames) {
+        size_t n = std::min(frames - done, blockFrames - pos);
+        double energy = 0.0;
+        for (int c = 0; c < channels; ++c) {
+            if (weights[c] == 0.0f) continue;
+            double *s = &filterState[c * 4];
+            double s0 = s[0], s1 = s[1], s2 = s[2], s3 = s[3];
+            double sum = 0.0;
+            const float *in = buf + done * channels + c;
+            for (size_t i = 0; i < n; ++i) {
+                // 两级直接 II 型转置结构
+                double x = in[i * channels];
+                double y = shelf.b0 * x + s0;
+                s0 = shelf.b1 * x - shelf.a1 * y + s1;
+                s1 = shelf.b2 * x - shelf.a2 * y;
+                double z = highPass.b0 * y + s2;
+                s2 = highPass.b1 * y - highPass.a1 * z + s3;
+                s3 = highPass.b2 * y - highPass.a2 * z;
+                sum += z * z;
+            }
+            s[0] = s0; s[1] = s1; s[2] = s2; s[3] = s3;
+            energy += weights[c] * sum;
+        }
+        blockEnergy += energy;
+        pos += n;
+        done += n;
+        if (pos == blockFrames) {
+            finishBlock();
+            pos = 0;
+        }
+    }
+    blockPos = pos;
+}
+
+void LoudnessNormalizer::finishBlock() {
+    subBlocks[subBlockCount % SUB_BLOCKS_SHORT_TERM] = blockEnergy / blockFrames;
+    blockEnergy = 0.0;
+    ++subBlockCount;
+
+    size_t shortCount = std::min<size_t>(subBlockCount, SUB_BLOCKS_SHORT_TERM);
+    double shortSum = 0.0;
+    double momentarySum = 0.0;
+    for (size_t i = 0; i < shortCount; ++i) {
+        double e = subBlocks[(subBlockCount - 1 - i) % SUB_BLOCKS_SHORT_TERM];
+        shortSum += e;
+        if (i < SUB_BLOCKS_MOMENTARY) momentarySum += e;
+    }
+    shortTerm.store(static_cast<float>(energyToLufs(shortSum / shortCount)),
+                    std::memory_order_relaxed);
+    if (subBlockCount < SUB_BLOCKS_MOMENTARY) return;
+
+    // 每 100ms 得到一个 400ms 的块（75% 重叠），按响度放进直方图
+    double e = momentarySum / SUB_BLOCKS_MOMENTARY;
+    double l = energyToLufs(e);
+    momentary.store(static_cast<float>(l), std::memory_order_relaxed);
+    if (!(l > LOUDNESS_ABS_GATE)) return;
+    size_t bin = std::min(histogram.size() - 1,
+                          static_cast<size_t>((l - LOUDNESS_ABS_GATE) / LOUDNESS_HIST_STEP));
+    ++histogram[bin];
+    binEnergy[bin] += e;
+    ++gatedBlocks;
+
+    // 相对门限：绝对门限之后的平均响度减 10 LU，再对门限以上的块求平均
+    double total = 0.0;
+    for (double be : binEnergy) total += be;
+    double relGate = energyToLufs(total / gatedBlocks) + LOUDNESS_REL_GATE;
+    size_t first = relGate > LOUDNESS_ABS_GATE
+                   ? static_cast<size_t>((relGate - LOUDNESS_ABS_GATE) / LOUDNESS_HIST_STEP) : 0;
+    double gatedSum = 0.0;
+    uint32_t count = 0;
+    for (size_t i = first; i < histogram.size(); ++i) {
+        gatedSum += binEnergy[i];
+        count += histogram[i];
+    }
+    if (count > 0) {
+        integrated.store(static_cast<float>(energyToLufs(gatedSum / count)),
+                         std::memory_order_relaxed);
+    }
+}
+
+float LoudnessNormalizer::updateGain(size_t frames) {
+    float from = currentGain;
+    float db = appliedDb.load(std::memory_order_relaxed);
+    float want = db;
+    float slew = LOUDNESS_GAIN_SLEW_DB;
+    if (haveTrackGain.load(std::memory_order_relaxed)) {
+        // 元数据的增益是确定的，只需要避免突变，很快过渡到位
+        want = trackGain;
+        slew = LOUDNESS_TRACK_GAIN_SLEW_DB;
+    } else if (gatedBlocks >= LOUDNESS_MIN_BLOCKS) {
+        float l = integrated.load(std::memory_order_relaxed);
+        if (!std::isnan(l)) want = target - l;
+    }
+    want = std::min(std::max(want, -LOUDNESS_MAX_CUT_DB), LOUDNESS_MAX_BOOST_DB);
+    if (want != db) {
+        float maxDelta = slew * static_cast<float>(frames) / rate;
+        db += std::min(std::max(want - db, -maxDelta), maxDelta);
+        appliedDb.store(db, std::memory_order_relaxed);
+        currentGain = dbToGain(db);
+    }
+    return from;
+}
+
+float LoudnessNormalizer::truePeak(int ch) {
+    // 窗口从旧到新为 history[historyPos .. historyPos + TRUE_PEAK_TAPS)
+    const float *w = &history[static_cast<size_t>(ch) * TRUE_PEAK_TAPS * 2 + historyPos];
+    float peak = 0.0f;
+    for (const float *h : phases) {
+        float acc = 0.0f;
+        for (int j = 0; j < TRUE_PEAK_TAPS; ++j) acc += h[j] * w[j];
+        peak = std::max(peak, std::fabs(acc));
+    }
+    return peak;
+}
+
+void LoudnessNormalizer::limit(float *buf, size_t frames, float from) {
+    const size_t cap = minValues.size();
+    // 限幅之前先按平滑增益放大，得到的就是需要限制的信号
+    float to = currentGain;
+    if (from != 1.0f || to != 1.0f) {
+        dsp.gainRamp(buf, frames * channels, from, to);
+    }
+    // 真峰值估计晚 TRUE_PEAK_TAPS / 2 帧，起音要在剩下的前视时间内完成
+    const float attackFrames = static_cast<float>(lookahead - TRUE_PEAK_TAPS / 2);
+    size_t delayPos = (frameIndex % lookahead) * channels;
+    uint64_t tp = 0;
+    for (size_t i = 0; i < frames; ++i) {
+        float *frame = buf + i * channels;
+        float peak = 0.0f;
+        for (int c = 0; c < channels; ++c) peak = std::max(peak, std::fabs(frame[c]));
+        if (peak < tpThreshold) {
+            ++quietFrames;
+        } else {
+            quietFrames = 0;
+        }
+        // 插值历史只有在可能超过上限时才需要，但一直保持更新
+        for (int c = 0; c < channels; ++c) {
+            float *h = &history[static_cast<size_t>(c) * TRUE_PEAK_TAPS * 2];
+            h[historyPos] = frame[c];
+            h[historyPos + TRUE_PEAK_TAPS] = frame[c];
+        }
+        historyPos = (historyPos + 1) % TRUE_PEAK_TAPS;
+        if (quietFrames < TRUE_PEAK_TAPS) {
+            for (int c = 0; c < channels; ++c) peak = std::max(peak, truePeak(c));
+            ++tp;
+        }
+        float need = peak > ceiling ? ceiling / peak : 1.0f;
+
+        // 窗口 [n - lookahead, n] 内需要的最小增益，单调队列维护
+        uint64_t n = frameIndex++;
+        while (minHead != minTail && minIndex[minHead] + lookahead < n) {
+            minHead = (minHead + 1) % cap;
+        }
+        while (minTail != minHead && minValues[(minTail + cap - 1) % cap] >= need) {
+            minTail = (minTail + cap - 1) % cap;
+        }
+        minValues[minTail] = need;
+        minIndex[minTail] = n;
+        minTail = (minTail + 1) % cap;
+        float floor = minValues[minHead];
+
+        if (floor < envelope) {
+            // 线性起音，保证最新的峰值输出之前包络已经降到位
+            attackStep = std::max(attackStep, (envelope - floor) / attackFrames);
+            envelope = std::max(envelope - attackStep, floor);
+        } else {
+            attackStep = 0.0f;
+            envelope = floor + (envelope - floor) * releaseCoef;
+        }
+        peakReduction = std::min(peakReduction, envelope);
+
+        float *d = &delay[delayPos];
+        for (int c = 0; c < channels; ++c) {
+            float out = d[c] * envelope;
+            d[c] = frame[c];
+            frame[c] = out;
+        }
+        delayPos += channels;
+        if (delayPos == delay.size()) delayPos = 0;
+    }
+
+    if (frameIndex - reductionSince >= static_cast<uint64_t>(rate) * REDUCTION_REPORT_MS / 1000) {
+        reductionDb.store(-20.0f * std::log10(peakReduction), std::memory_order_relaxed);
+        peakReduction = 1.0f;
+        reductionSince = frameIndex;
+    }
+    tpFrames.fetch_add(tp, std::memory_order_relaxed);
+}
+
+bool LoudnessNormalizer::usingMetadata() const {
+    return haveTrackGain.load(std::memory_order_relaxed);
+}
+
+float LoudnessNormalizer::momentaryLufs() const {
+    return momentary.load(std::memory_order_relaxed);
+}
+
+float LoudnessNormalizer::shortTermLufs() const {
+    return shortTerm.load(std::memory_order_relaxed);
+}
+
+float LoudnessNormalizer::integratedLufs() const {
+    return integrated.load(std::memory_order_relaxed);
+}
+
+float LoudnessNormalizer::gainDb() const {
+    return appliedDb.load(std::memory_order_relaxed);
+}
+
+float LoudnessNormalizer::limiterReductionDb() const {
+    return reductionDb.load(std::memory_order_relaxed);
+}
+
+uint64_t LoudnessNormalizer::truePeakFrames() const {
+    return tpFrames.load(std::memory_order_relaxed);
+}
+
+uint64_t LoudnessNormalizer::processedFrames() const {
+    return totalFrames.load(std::memory_order_relaxed);
+}
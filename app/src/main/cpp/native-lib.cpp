@@ -1,20 +1,52 @@
 #include <jni.h>
 #include "player.h"
 
+// Java 层 Player.nativeContext 中保存着对应的 native Player 指针
+static jfieldID getContextField(JNIEnv *env, jobject thiz) {
+    return env->GetFieldID(env->GetObjectClass(thiz), "nativeContext", "J");
+}
+
+// release() 之后 nativeContext 为 0，返回 nullptr，各接口什么也不做
+static Player *getPlayer(JNIEnv *env, jobject thiz) {
+    return reinterpret_cast<Player *>(env->GetLongField(thiz, getContextField(env, thiz)));
+}
+
 extern "C" {
+JNIEXPORT void JNICALL
+Java_com_example_tinyplayer_Player_nativeSetup(
+    JNIEnv *env, jobject thiz
+) {
+    auto player = new Player();
+    env->SetLongField(thiz, getContextField(env, thiz), reinterpret_cast<jlong>(player));
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_tinyplayer_Player_nativeRelease(
+    JNIEnv *env, jobject thiz
+) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return;
+    env->SetLongField(thiz, getContextField(env, thiz), 0);
+    delete player;
+}
+
 JNIEXPORT jint JNICALL
 Java_com_example_tinyplayer_Player_nativePlay(
     JNIEnv *env, jobject thiz,
     jstring file, jobject surface
 ) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return -1;
     const char *filepath = env->GetStringUTFChars(file, nullptr);
-    Player::getInstance()->init(ANativeWindow_fromSurface(env, surface));
+    player->init(ANativeWindow_fromSurface(env, surface));
 
-    if (!Player::getInstance()->open(filepath)) {
+    bool opened = player->open(filepath);
+    env->ReleaseStringUTFChars(file, filepath);
+    if (!opened) {
         return -1;
     }
 
-    Player::getInstance()->startPlay();
+    player->startPlay();
 
     return 0;
 }
@@ -24,10 +56,12 @@ Java_com_example_tinyplayer_Player_nativePause(
     JNIEnv *env, jobject thiz,
     jboolean p
 ) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return;
     if (p) {
-        Player::getInstance()->pause();
+        player->pause();
     } else {
-        Player::getInstance()->resume();
+        player->resume();
     }
 }
 
@@ -36,30 +70,174 @@ Java_com_example_tinyplayer_Player_nativeSeek(
     JNIEnv *env, jobject thiz,
     jdouble position
 ) {
-    return Player::getInstance()->seek(position);
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return -1;
+    return player->seek(position);
 }
 
 JNIEXPORT void JNICALL
 Java_com_example_tinyplayer_Player_nativeStop(
     JNIEnv *env, jobject thiz
 ) {
-    Player::getInstance()->stop();
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return;
+    player->stop();
 }
 
 JNIEXPORT jint JNICALL
 Java_com_example_tinyplayer_Player_nativeSetSpeed(
 JNIEnv *env, jobject thiz, jfloat speed) {
-    return Player::getInstance()->setSpeed(speed);
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return -1;
+    return player->setSpeed(speed);
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_tinyplayer_Player_nativeSetSurfaceSize(JNIEnv *env, jobject thiz, jint width, jint height) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return;
+    player->setSurfaceSize(width, height);
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_tinyplayer_Player_nativeSetConvertSlices(JNIEnv *env, jobject thiz, jint slices) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return;
+    player->setConvertSlices(slices);
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_tinyplayer_Player_nativeSetVideoFilter(JNIEnv *env, jobject thiz, jstring desc) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return;
+    const char *str = env->GetStringUTFChars(desc, nullptr);
+    player->setVideoFilter(str);
+    env->ReleaseStringUTFChars(desc, str);
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_tinyplayer_Player_nativeSetAudioFilter(JNIEnv *env, jobject thiz, jstring desc) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return;
+    const char *str = env->GetStringUTFChars(desc, nullptr);
+    player->setAudioFilter(str);
+    env->ReleaseStringUTFChars(desc, str);
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_tinyplayer_Player_nativeSetExclusiveAudio(JNIEnv *env, jobject thiz, jboolean exclusive) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return;
+    player->setExclusiveAudio(exclusive);
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_tinyplayer_Player_nativeSetVolume(JNIEnv *env, jobject thiz, jfloat volume) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return;
+    player->setVolume(volume);
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_tinyplayer_Player_nativeSetDownmixLevels(JNIEnv *env, jobject thiz, jfloat center,
+                                                          jfloat surround, jfloat lfe) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return;
+    player->setDownmixLevels(center, surround, lfe);
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_tinyplayer_Player_nativeSetLoudnessNormalization(JNIEnv *env, jobject thiz,
+                                                                  jboolean enabled, jfloat targetLufs) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return;
+    player->setLoudnessNormalization(enabled, targetLufs);
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_tinyplayer_Player_nativeEnqueue(JNIEnv *env, jobject thiz, jstring file) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return;
+    const char *filepath = env->GetStringUTFChars(file, nullptr);
+    player->enqueue(filepath);
+    env->ReleaseStringUTFChars(file, filepath);
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_tinyplayer_Player_nativeClearQueue(JNIEnv *env, jobject thiz) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return;
+    player->clearPlaylist();
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_tinyplayer_Player_nativeGetItemIndex(JNIEnv *env, jobject thiz) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return -1;
+    return player->itemIndex();
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_tinyplayer_Player_nativeSetLoop(JNIEnv *env, jobject thiz, jdouble start, jdouble end) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return -1;
+    return player->setLoop(start, end);
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_tinyplayer_Player_nativeClearLoop(JNIEnv *env, jobject thiz) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return;
+    player->clearLoop();
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_tinyplayer_Player_nativeSetLoopCacheBudget(JNIEnv *env, jobject thiz, jlong bytes) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return;
+    player->setLoopCacheBudget(static_cast<size_t>(bytes));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_tinyplayer_Player_nativeStepForward(JNIEnv *env, jobject thiz) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return -1;
+    return player->stepForward();
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_tinyplayer_Player_nativeStepBackward(JNIEnv *env, jobject thiz) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return -1;
+    return player->stepBackward();
 }
 
 JNIEXPORT jdouble JNICALL
 Java_com_example_tinyplayer_Player_nativeGetPosition(JNIEnv *env, jobject thiz) {
-    return Player::getInstance()->getPosition();
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return 0;
+    return player->getPosition();
 }
 
 JNIEXPORT jdouble JNICALL
 Java_com_example_tinyplayer_Player_nativeGetDuration(JNIEnv *env, jobject thiz) {
-    return Player::getInstance()->getDuration();
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return 0;
+    return player->getDuration();
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_tinyplayer_Player_nativeSetReverseCacheBudget(JNIEnv *env, jobject thiz, jlong bytes) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return -1;
+    return player->setReverseCacheBudget(bytes);
+}
+
+JNIEXPORT jstring JNICALL
+Java_com_example_tinyplayer_Player_nativeGetStats(JNIEnv *env, jobject thiz) {
+    auto player = getPlayer(env, thiz);
+    if (player == nullptr) return nullptr;
+    return env->NewStringUTF(player->dumpStats().c_str());
 }
 
-}
\ No newline at end of file
+}
@@ -1,20 +1,60 @@
 #include "player.h"
 
-Player * Player::getInstance() {
-    static Player player;
-    return &player;
+PlaybackSession::~PlaybackSession() {
+    for (auto &f : primedVideo) av_frame_free(&f);
+    for (auto &p : primedAudio) av_packet_free(&p);
+    if (decoders != nullptr) {
+        decoders->release(videoKey, videoCodecCtx);
+        decoders->release(audioKey, audioCodecCtx);
+        videoCodecCtx = audioCodecCtx = nullptr;
+    }
+    avcodec_free_context(&videoCodecCtx);
+    avcodec_free_context(&audioCodecCtx);
+    avformat_close_input(&formatCtx);
+}
+
+std::shared_ptr<PlaybackSession> PlaybackSession::next() const {
+    return std::atomic_load(&nextItem);
+}
+
+void PlaybackSession::setNext(const std::shared_ptr<PlaybackSession> &item) {
+    std::atomic_store(&nextItem, item);
 }
 
 void Player::init(ANativeWindow *w) {
     lock_guard lck(mtx);
     if (isInit) return;
     videoRender.init(w);
+    // 新窗口可能接受 YV12，下一帧重新选择输出格式
+    surfaceResized = true;
+    // 不指定采样率，使用设备的原生采样率，解码阶段直接重采样到这个采样率
+    audioRender.configure(AAUDIO_UNSPECIFIED, AUDIO_CHANNELS, AAUDIO_FORMAT_PCM_FLOAT);
     audioRender.setCallback([] (AAudioStreamStruct *stream, void *userData,
         void *audioData, int32_t numFrames) -> int {
-        aaudio_result_t ret;
-        memcpy(audioData, userData, sizeof(userData)*numFrames);
+        // 实时回调（独占模式下每个 burst 一次）中只做无锁读取和原子计数，不加锁、不分配
+        // 内存、不写日志。数据不够时补静音
+        auto player = static_cast<Player *>(userData);
+        auto out = static_cast<uint8_t *>(audioData);
+        size_t frameBytes = player->audioRender.frameBytes();
+        size_t len = static_cast<size_t>(numFrames) * frameBytes;
+        // 暂停、刷新的切换过程中不消费数据
+        if (player->audioRender.muted()) {
+            memset(out, 0, len);
+            return 0;
+        }
+        size_t n = player->audioRing.read(out, len);
+        if (n < len) {
+            memset(out + n, 0, len - n);
+            player->stats.audioSilenceFrames.fetch_add((len - n) / frameBytes, std::memory_order_relaxed);
+        }
+        // 音量在这里应用，不经过环形缓冲区的延迟
+        if (player->audioRender.floatOutput()) {
+            player->outputGain.process(player->audioDsp, reinterpret_cast<float *>(out), len / sizeof(float));
+        } else {
+            player->outputGain.process(player->audioDsp, reinterpret_cast<int16_t *>(out), len / sizeof(int16_t));
+        }
         return 0;
-    }, audioUserData);
+    }, this);
     isInit = true;
 }
 
@@ -22,459 +62,2987 @@ void Player::startPlay() {
     audioPacketQ.resume();
     videoPacketQ.resume();
     videoFrameQ.resume();
-    audioRender.start();
-    audioRender.flush();
+    readyQ.resume();
+    audioRender.requestFlush();
+    audioRender.play(true);
+    audioControl->wake();
     {
         lock_guard lck(mtx);
         startTime = av_gettime(); // in microseconds
         startPosition = currPosition = 0.0;  // in seconds
         m_speed = 1.0;
+        trickPlay = false;
+        paused = false;
     }
+    wakeStages();
 }
 
 void Player::resume() {
+    int64_t t0 = av_gettime_relative();
     audioPacketQ.resume();
     videoPacketQ.resume();
     videoFrameQ.resume();
-    audioRender.pause(false);
-    {
-        lock_guard lck(mtx);
-        startTime = av_gettime();
-        startPosition = currPosition;
+    readyQ.resume();
+    audioRender.play(true);
+    audioControl->wake();
+    // 不加 mtx，单步（controlling 阶段持锁解码）时也不等待
+    startTime = av_gettime();
+    startPosition = currPosition.load();
+    // 先清除 paused 再读 stepping，与 step() 的顺序相反：要么这里看到 stepping，要么 step() 看到
+    // 已经恢复播放而放弃单步
+    paused = false;
+    // 单步之后解码器和队列的状态与当前画面不一致，从当前位置重新开始
+    if (stepping && isOpen) {
+        postCommand({PlayerCommand::Seek, false, av_gettime_relative(), NAN, 0, AVSEEK_FLAG_BACKWARD});
     }
+    wakeStages();
+    PlayerStats::addCall(stats.pauseCalls, stats.pauseCallUs, stats.pauseCallMaxUs,
+                         av_gettime_relative() - t0);
 }
 
 void Player::pause() {
+    int64_t t0 = av_gettime_relative();
+    paused = true;
     audioPacketQ.pause();
-    audioRender.pause(true);
+    // 音频流的暂停由 audioControl 在后台完成，这里不等待
+    audioRender.play(false);
+    audioControl->wake();
     videoFrameQ.pause();
+    readyQ.pause();
     videoPacketQ.pause();
+    PlayerStats::addCall(stats.pauseCalls, stats.pauseCallUs, stats.pauseCallMaxUs,
+                         av_gettime_relative() - t0);
 }
 
 int Player::seek(double position) {
-    unique_lock lck(mtx);
-    if (!isOpen) return -1;
-    audioRender.flush();
+    int64_t t0 = av_gettime_relative();
+    // 不加 mtx：时长在条目打开后不再变化，条目由 shared_ptr 保持，stop() 之后也能安全读取
+    auto s = std::atomic_load(&session);
+    if (!isOpen || s == nullptr) return -1;
+    position = position * static_cast<double>(s->formatCtx->duration) / AV_TIME_BASE;
+    // 停止流水线要等正在执行的单步（可能是一帧的解码）结束，交给 controlling 阶段
+    postCommand({PlayerCommand::Seek, false, t0, position, 0, AVSEEK_FLAG_ANY});
+    PlayerStats::addCall(stats.seekCalls, stats.seekCallUs, stats.seekCallMaxUs,
+                         av_gettime_relative() - t0);
+    return 0;
+}
+
+bool Player::runSeek(const PlayerCommand &cmd) {
+    // 流水线阶段不使用 mtx，持锁停止阶段不会死锁
+    lock_guard lck(mtx);
+    auto s = std::atomic_load(&session);
+    if (!isOpen || s == nullptr) return false;
+    double position = std::isnan(cmd.position) ? currPosition.load() : cmd.position;
+    if (seekTo(position, cmd.flags) < 0) {
+        LOGW(LOGTAG, "seek to %.3f s failed", position);
+        return false;
+    }
+    return true;
+}
+
+int Player::seekTo(double position, int flags) {
+    // 先让流水线停下来，再跳转并清掉跳转前的数据。设备缓冲区的刷新由 audioControl 在后台完成，
+    // 刷新完成前回调输出静音
+    stopStages();
+    audioRender.requestFlush();
+    audioControl->wake();
+    // 跳转以正在显示的条目为准，流水线中已经读到的后几项回到开头
+    auto s = std::atomic_load(&session);
+    // A-B 循环：跳到区间外、进入快速浏览或倒放时取消循环。区间内的跳转也从 A 之前的关键帧读起，
+    // 每一遍的 packet 都从同一个关键帧开始，目标位置之前的帧解码后丢弃
+    if (looping && (position < loopStart || position >= loopEnd || trickPlay || reversePlay)) {
+        cancelLoop();
+    }
+    bool loop = looping;
+    double target = loop ? std::max(0.0, loopStart - LOOP_PREROLL) : position;
+    if (loop) flags = AVSEEK_FLAG_BACKWARD;
     int ret;
-    position = position * static_cast<double>(pFormatCtx->duration) / AV_TIME_BASE;
-    uint64_t ts = position * av_q2d(av_inv_q(pFormatCtx->streams[videoStreamId]->time_base));
-    ret = av_seek_frame(pFormatCtx, videoStreamId, ts, AVSEEK_FLAG_ANY);
+    uint64_t ts = position * av_q2d(av_inv_q(s->videoTimeBase));
+    ret = av_seek_frame(s->formatCtx, s->videoStreamId,
+                        static_cast<int64_t>(target * av_q2d(av_inv_q(s->videoTimeBase))), flags);
     if (ret >= 0) {
         startTime = av_gettime();
         startPosition = currPosition = position;
+        clearQueues();
+        avcodec_flush_buffers(s->videoCodecCtx);
+        avcodec_flush_buffers(s->audioCodecCtx);
+        resetCursors(s, target <= 0);
+        if (loop) resetLoop(position);
     }
+    // 跳到前一个关键帧时，目标位置之前的帧解码后直接丢弃
+    bool accurate = (flags & AVSEEK_FLAG_BACKWARD) != 0;
+    dropVideoBefore = accurate ? static_cast<int64_t>(ts) : AV_NOPTS_VALUE;
+    dropAudioBefore = accurate ? position : -1.0;
+    shownPts = stepDecoderPts = AV_NOPTS_VALUE;
+    stepping = false;
+    // 快速浏览模式下解码器直接丢弃非关键帧
+    s->videoCodecCtx->skip_frame = trickPlay ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+    trickStartPts = lastRenderPts = AV_NOPTS_VALUE;
+    startStages();
     return ret;
 }
 
 bool Player::open(const std::string &filepath) {
     unique_lock lck(mtx);
     if (isOpen) return true;
-    // 打开封装格式
-    int ret = avformat_open_input(&pFormatCtx, filepath.c_str(),
-                                  nullptr, nullptr);
-    char errBuf[BUFF_SIZE]{};
-    if (ret < 0) {
-        av_strerror(ret, errBuf, sizeof(errBuf) - 1);
-        LOGE(LOGTAG, "打开 %s 失败, ffmpeg avformat_open_input error: %s", filepath.c_str(), errBuf);
-        return false;
-    }
+    auto item = openItem(filepath);
+    if (item == nullptr) return false;
 
-    LOGD(LOGTAG, "打开 %s 成功", filepath.c_str());
-    ret = avformat_find_stream_info(pFormatCtx, nullptr);
-    if (ret < 0) {
-        av_strerror(ret, errBuf, sizeof(errBuf) - 1);
-        LOGE(LOGTAG, "获取流信息失败, ffmpeg avformat_find_stream_info error: %s", errBuf);
-        avformat_free_context(pFormatCtx);
-        return false;
+    applyVideoParams(*item);
+    outWidth = outHeight = 0;
+    surfaceResized = false;
+    configureOutput();
+    // 先设置一次窗口，窗口不接受 YV12 时转换阶段从第一帧开始就输出 RGBA
+    videoRender.setBuffers(outWidth, outHeight, outFormat);
+    configureOutput();
+    // 先打开输出流，解码阶段按设备实际的采样率和格式重采样
+    if (audioRender.open() < 0) {
+        LOGW(LOGTAG, "open audio output failed, resample to the stream rate");
     }
 
-    LOGD(LOGTAG, "Format %s, duration %ld us", pFormatCtx->iformat->long_name,
-         pFormatCtx->duration);
-
-    if (!openVideoDecoder()) return false;
-    if (!openAudioDecoder()) return false;
-
+    resetCursors(item, true);
+    std::atomic_store(&session, item);
+    shownItem = 0;
     isOpen = true;
+    openTime = av_gettime();
+    getrusage(RUSAGE_SELF, &openUsage);
+    stats.reset();
     lck.unlock();
-    worker.notify_all();
+    startStages();
+    // 打开之前加入的列表项现在开始预加载
+    preloading->wake();
     return true;
 }
 
 void Player::stop() {
+    {
+        std::lock_guard<std::mutex> cmdLck(commandMtx);
+        commands.clear();
+    }
     unique_lock lck(mtx);
+    // 先停掉流水线，保证之后没有阶段再访问解码器和封装上下文
+    stopStages();
+    discardPlaylist();
+    cancelLoop();
+    // 所有阶段都已停止，条目只剩这里的引用，释放时关闭文件和解码器
+    std::atomic_store(&session, std::shared_ptr<PlaybackSession>());
+    demuxItem = videoItem = convertItem = audioItem = nullptr;
     isOpen = false;
     isInit = false;
+    reversePlay = false;
+    stepping = false;
+    shownPts = stepDecoderPts = AV_NOPTS_VALUE;
+    frameRing.clear();
     startPosition = currPosition = 0;
-    audioRender.flush();
-    audioRender.pause(true);
-    avformat_close_input(&pFormatCtx);
-    avcodec_close(pVideoCodecCtx);
-    avcodec_close(pAudioCodecCtx);
+    audioRender.requestFlush();
+    audioRender.play(false);
+    audioControl->wake();
+    swr_free(&swrCtx);
+    audioOutRate = 0;               // 下次打开时重新配置变速处理
+    sws_freeContext(scaleCtx);
+    scaleCtx = nullptr;
+    av_frame_free(&toneFrame);
+    av_frame_free(&scaledFrame);
     lck.unlock();
-    videoPacketQ.clear();
-    videoFrameQ.clear();
-    audioPacketQ.clear();
-    worker.notify_all();
+    clearQueues();
+    // 已经切换过的条目还在 retired 中，由 preloading 关闭
+    preloading->wake();
 }
 
-int Player::setSpeed(float speed) {
+void Player::enqueue(const std::string &filepath) {
+    LOGI(LOGTAG, "enqueue %s", filepath.c_str());
+    {
+        std::lock_guard<std::mutex> lck(playlistMtx);
+        playlist.push_back(filepath);
+    }
+    preloading->wake();
+}
+
+void Player::clearPlaylist() {
+    discardPlaylist();
+    // 已经链接在当前项之后的条目要停下流水线才能摘掉，交给 controlling 阶段
+    postCommand({PlayerCommand::ClearPlaylist, false, av_gettime_relative(), 0, 0, 0});
+}
+
+void Player::discardPlaylist() {
+    std::shared_ptr<PlaybackSession> dropped;
+    {
+        std::lock_guard<std::mutex> lck(playlistMtx);
+        playlist.clear();
+        dropped.swap(preloaded);
+        // 正在打开的条目打开后直接丢弃
+        playlistGeneration++;
+    }
+}
+
+bool Player::runClearPlaylist() {
+    lock_guard lck(mtx);
+    auto s = std::atomic_load(&session);
+    if (!isOpen || s == nullptr || s->next() == nullptr) return false;
+    stopStages();
+    // 解复用阶段读完当前项后已经把下一项链接上，各阶段可能已经在处理它
+    bool advanced = demuxItem != s || videoItem != s || convertItem != s || audioItem != s;
+    auto dropped = s->next();
+    s->setNext(nullptr);
+    {
+        std::lock_guard<std::mutex> plck(playlistMtx);
+        retired.push_back(std::move(dropped));
+    }
+    preloading->wake();
+    LOGI(LOGTAG, "clear playlist, pipeline %s", advanced ? "restarts at current position" : "unchanged");
+    if (advanced) {
+        // 队列中有后面条目的数据，从正在显示的位置重新开始，解复用读到当前项结尾后停下
+        return seekTo(currPosition, AVSEEK_FLAG_BACKWARD) >= 0;
+    }
+    startStages();
+    return true;
+}
+
+int Player::itemIndex() const {
+    return shownItem;
+}
+
+// 按帧率和解码输出的格式估计片段解码后的大小，加上这段时间的 packet
+static size_t decodedBytes(const PlaybackSession &s, double seconds) {
+    AVStream *vs = s.formatCtx->streams[s.videoStreamId];
+    double fps = vs->avg_frame_rate.num > 0 && vs->avg_frame_rate.den > 0 ? av_q2d(vs->avg_frame_rate) : 30.0;
+    const AVCodecContext *v = s.videoCodecCtx;
+    int w = s.codedWidth >> s.lowres;
+    int h = s.codedHeight >> s.lowres;
+    int frameSize = av_image_get_buffer_size(v->pix_fmt, w, h, 1);
+    if (frameSize <= 0) frameSize = w * h * 3 / 2;
+    const AVCodecContext *a = s.audioCodecCtx;
+    int sampleSize = av_get_bytes_per_sample(a->sample_fmt);
+    if (sampleSize <= 0) sampleSize = sizeof(float);
+    double bytes = frameSize * std::ceil(seconds * fps + 1) +
+                   seconds * a->sample_rate * a->channels * sampleSize +
+                   (seconds + LOOP_PREROLL) * std::max<int64_t>(s.formatCtx->bit_rate, 0) / 8;
+    return static_cast<size_t>(bytes);
+}
+
+int Player::setLoop(double start, double end) {
+    // 与 seek() 一样不加 mtx，runSetLoop() 执行前再检查一次
+    auto s = std::atomic_load(&session);
+    if (!isOpen || s == nullptr || trickPlay || reversePlay) return -1;
+    double duration = static_cast<double>(s->formatCtx->duration) / AV_TIME_BASE;
+    start = std::max(start * duration, 0.0);
+    end = std::min(end * duration, duration);
+    if (end <= start) return -1;
+    postCommand({PlayerCommand::SetLoop, false, av_gettime_relative(), start, end, 0});
+    return 0;
+}
+
+bool Player::runSetLoop(double start, double end) {
+    lock_guard lck(mtx);
+    auto s = std::atomic_load(&session);
+    // 投递之后进入了快速浏览或倒放
+    if (!isOpen || s == nullptr || trickPlay || reversePlay) return false;
+    // 旧的片段和缓存在流水线停止后丢掉，新片段从 A 开始的第一遍边播放边缓存
+    stopStages();
+    cancelLoop();
+    loopStart = start;
+    loopEnd = end;
+    size_t budget = loopBudget;
+    loopCache.setBudget(budget);
+    size_t estimate = decodedBytes(*s, end - start);
+    loopFrameCapture = end - start <= LOOP_FRAME_MAX_SECONDS && estimate <= budget;
+    looping = true;
+    LOGI(LOGTAG, "loop %.3f - %.3f s, budget %zu, decoded estimate %zu, cache frames %d",
+         start, end, budget, estimate, loopFrameCapture);
+    return seekTo(start, AVSEEK_FLAG_BACKWARD) >= 0;
+}
+
+void Player::clearLoop() {
+    postCommand({PlayerCommand::ClearLoop, false, av_gettime_relative(), 0, 0, 0});
+}
+
+void Player::runClearLoop() {
     lock_guard lck(mtx);
+    if (!looping) return;
+    stopStages();
+    cancelLoop();
+    // 已经解码、排好的数据使用的是循环的显示时间，从当前位置重新跳转一次。
+    // 单步时流水线已经停止，resume 时会重新跳转
+    if (isOpen && !stepping) seekTo(currPosition, AVSEEK_FLAG_BACKWARD);
+}
+
+void Player::setLoopCacheBudget(size_t bytes) {
+    loopBudget = bytes;
+}
+
+void Player::resetLoop(double position) {
+    loopPass = 0;
+    loopReplaying = false;
+    loopCursor = 0;
+    loopVideoEnded = loopAudioEnded = false;
+    loopFirst = INFINITY;
+    loopLast = -INFINITY;
+    loopVideoFrames = loopAudioFrames = false;
+    loopVideoPass = loopAudioPass = 0;
+    loopVideoCursor = loopAudioCursor = 0;
+    loopShownPass = 0;
+    // 保存到一半的数据来自被打断的那一遍，丢掉重新保存
+    loopCache.discardPartial();
+    loopCapturing = !loopCache.packetsReady() && !loopCache.packetsFailed();
+    // 从 A 开始的一遍可以完整地保存解码帧，从区间中间开始时在下一遍保存。
+    // 已经保存好的帧在这一遍之后直接重放
+    loopFramePass = -1;
+    if (loopFrameCapture) loopFramePass = position <= loopStart ? 0 : 1;
+}
+
+void Player::cancelLoop() {
+    looping = false;
+    loopCache.clear();
+    loopFrameCapture = false;
+    loopFramePass = -1;
+    loopOrigin = 0.0;
+    loopPeriod = 0.0;
+    loopVideoFrames = loopAudioFrames = false;
+}
+
+void Player::resetCursors(const std::shared_ptr<PlaybackSession> &item, bool atStart) {
+    // 已经链接在 item 之后的条目被读过、解码过，回到开头重新开始。预热的数据已经不完整，丢掉
+    for (auto next = item->next(); next != nullptr; next = next->next()) {
+        AVStream *st = next->formatCtx->streams[next->videoStreamId];
+        int64_t start = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+        if (av_seek_frame(next->formatCtx, next->videoStreamId, start, AVSEEK_FLAG_BACKWARD) < 0) {
+            LOGW(LOGTAG, "rewind %s failed", next->path.c_str());
+        }
+        avcodec_flush_buffers(next->videoCodecCtx);
+        avcodec_flush_buffers(next->audioCodecCtx);
+        for (auto &f : next->primedVideo) av_frame_free(&f);
+        for (auto &p : next->primedAudio) av_packet_free(&p);
+        next->primedVideo.clear();
+        next->primedAudio.clear();
+    }
+    // 转换阶段已经按后面的条目设置了显示参数
+    if (convertItem != nullptr && convertItem != item) applyVideoParams(*item);
+    demuxItem = videoItem = convertItem = audioItem = item;
+    demuxEof = videoEofSent = audioEofSent = false;
+    convertSwitched = convertEnded = videoEndQueued = audioFilterFlushed = false;
+    audioAtStart = atStart;
+    audioSkipLeft = 0;
+    audioSideTrimmed = audioEndTrimmed = false;
+    metadataGainDb = item->loudnessGainDb;
+    metadataGainSource = item->loudnessGainSource;
+    loudnessDirty = true;
+}
+
+int Player::setSpeed(float speed) {
+    if (speed == 0 || speed > MAX_SPEED || speed < -MAX_REVERSE_SPEED ||
+        (speed < 0 && speed > -MIN_REVERSE_SPEED)) {
+        LOGW(LOGTAG, "invalid speed %.3f", speed);
+        return -1;
+    }
+    // 速度和模式在同一把锁内更新，并发的两次调用不会一个写速度、另一个按旧模式判断是否要重新跳转。
+    // 用单独的锁，不等待持有 mtx 的单步和跳转
+    std::lock_guard<std::mutex> lck(speedMtx);
     if (!isOpen) return -1;
-    m_speed = speed;
+    bool reverse = speed < 0;
+    bool trick = speed >= TRICK_PLAY_SPEED;
+    // 各阶段只看速度的绝对值，方向由 reversePlay 决定
+    m_speed = std::fabs(speed);
+    if (trick == trickPlay && reverse == reversePlay) return 0;
+    // 切换快速浏览或倒放模式时在当前位置重新跳转（到前一个关键帧），丢掉已经解码的数据
+    trickPlay = trick;
+    reversePlay = reverse;
+    LOGI(LOGTAG, "set speed %.2fx, trick play %d, reverse %d", speed, trick, reverse);
+    postCommand({PlayerCommand::Seek, false, av_gettime_relative(), NAN, 0, AVSEEK_FLAG_BACKWARD});
+    return 0;
+}
+
+void Player::setSurfaceSize(int width, int height) {
+    surfaceWidth = width;
+    surfaceHeight = height;
+    surfaceResized = true;
+}
+
+// 视频按比例缩小到不超过 Surface 的尺寸（不放大），宽高取偶数。Surface 尺寸未知时用视频尺寸
+static void fitSize(int videoW, int videoH, int surfaceW, int surfaceH, int &outW, int &outH) {
+    outW = videoW;
+    outH = videoH;
+    if (surfaceW <= 0 || surfaceH <= 0 || videoW <= 0 || videoH <= 0) return;
+    double scale = std::min(1.0, std::min(static_cast<double>(surfaceW) / videoW,
+                                          static_cast<double>(surfaceH) / videoH));
+    if (scale >= 1.0) return;
+    outW = std::max(2, static_cast<int>(videoW * scale) & ~1);
+    outH = std::max(2, static_cast<int>(videoH * scale) & ~1);
+}
+
+// 显示尺寸：宽度按像素宽高比拉伸（取偶数），旋转 90°/270° 时交换宽高
+static void displaySize(int videoW, int videoH, AVRational sar, Rotation rotation,
+                        int &displayW, int &displayH) {
+    displayW = videoW;
+    displayH = videoH;
+    if (sar.num > 0 && sar.den > 0 && sar.num != sar.den) {
+        displayW = std::max(2, static_cast<int>(av_rescale(videoW, sar.num, sar.den)) & ~1);
+    }
+    if (rotation == Rotation::Cw90 || rotation == Rotation::Cw270) std::swap(displayW, displayH);
+}
+
+// 容器中的显示矩阵给出逆时针的旋转角度，换成显示时顺时针旋转的 90° 的倍数，镜像忽略
+static Rotation rotationOf(const AVStream *stream) {
+    auto matrix = reinterpret_cast<const int32_t *>(
+            av_stream_get_side_data(stream, AV_PKT_DATA_DISPLAYMATRIX, nullptr));
+    if (matrix == nullptr) return Rotation::None;
+    double angle = av_display_rotation_get(matrix);
+    if (std::isnan(angle)) return Rotation::None;
+    return static_cast<Rotation>(static_cast<int>(std::lround(-angle / 90)) & 3);
+}
+
+void Player::refreshOutput() {
+    // Surface 尺寸变化，或者显示阶段发现窗口不接受 YV12
+    if (surfaceResized.exchange(false) ||
+        (outFormat == RenderFormat::YV12 && videoRender.fallbacks() > 0)) {
+        configureOutput();
+    }
+}
+
+void Player::configureOutput() {
+    int displayW, displayH, w, h;
+    displaySize(videoWidth, videoHeight, videoSar, displayRotation, displayW, displayH);
+    fitSize(displayW, displayH, surfaceWidth, surfaceHeight, w, h);
+    // YV12 的色度平面宽高各为一半，奇数尺寸或窗口拒绝过 YV12 时只能输出 RGBA
+    RenderFormat fmt = preferredFormat;
+    if (w % 2 != 0 || h % 2 != 0 || videoRender.fallbacks() > 0) fmt = RenderFormat::RGBA;
+    if (w == outWidth && h == outHeight && fmt == outFormat) return;
+    LOGI(LOGTAG, "output size %dx%d -> %dx%d, yv12 %d", outWidth.load(), outHeight.load(), w, h,
+         fmt == RenderFormat::YV12);
+    outWidth = w;
+    outHeight = h;
+    outFormat = fmt;
+    frameRing.configure(ANWRender::frameBytes(w, h, fmt));
+}
+
+void Player::setConvertSlices(int slices) {
+    convertSlices = std::min(std::max(slices, 0), MAX_CONVERT_SLICES);
+}
+
+void Player::setVideoFilter(const std::string &desc) {
+    LOGI(LOGTAG, "video filter \"%s\"", desc.c_str());
+    videoFilter.setDescription(desc);
+}
+
+void Player::setAudioFilter(const std::string &desc) {
+    LOGI(LOGTAG, "audio filter \"%s\"", desc.c_str());
+    audioFilter.setDescription(desc);
+}
+
+void Player::setExclusiveAudio(bool exclusive) {
+    LOGI(LOGTAG, "exclusive audio %d", exclusive);
+    // 流已经打开时由音频解码阶段重新打开
+    audioRender.setExclusive(exclusive);
+    if (audioDecoding) audioDecoding->wake();
+}
+
+void Player::setVolume(float volume) {
+    outputGain.setTarget(std::min(std::max(volume, 0.0f), MAX_VOLUME));
+}
+
+void Player::setDownmixLevels(float center, float surround, float lfe) {
+    LOGI(LOGTAG, "downmix levels: center %.3f, surround %.3f, lfe %.3f", center, surround, lfe);
+    downmixCenter = center;
+    downmixSurround = surround;
+    downmixLfe = lfe;
+    downmixDirty = true;
+}
+
+void Player::setLoudnessNormalization(bool enabled, float targetLufs) {
+    LOGI(LOGTAG, "loudness normalization %d, target %.1f LUFS", enabled, targetLufs);
+    loudnessTarget = targetLufs;
+    loudnessEnabled = enabled;
+    loudnessDirty = true;
+}
+
+int Player::setReverseCacheBudget(int64_t bytes) {
+    if (bytes <= 0) {
+        LOGW(LOGTAG, "invalid reverse cache budget %lld", static_cast<long long>(bytes));
+        return -1;
+    }
+    // 下一个开始解码的 GOP 生效
+    reverseBudget = static_cast<size_t>(bytes);
     return 0;
 }
 
 Player::Player():
-videoPacketQ(5), audioPacketQ(5), videoFrameQ(5) {
+loopCache(LOOP_CACHE_BUDGET),
+videoPacketQ(5), audioPacketQ(5), videoFrameQ(5), readyQ(READY_QUEUE_SIZE),
+audioRing(AUDIO_RING_SIZE),
+videoFilter(AVMEDIA_TYPE_VIDEO), audioFilter(AVMEDIA_TYPE_AUDIO),
+gopCaches{GopCache(REVERSE_CACHE_BUDGET / 2), GopCache(REVERSE_CACHE_BUDGET / 2)},
+frameRing(STEP_CACHE_BUDGET) {
     isInit = false;
     isOpen = false;
-    closed = false;
-    pFormatCtx = nullptr;
-    pVideoCodec = nullptr;
-    pAudioCodec = nullptr;
-    pVideoCodecCtx = nullptr;
-    pAudioCodecCtx = nullptr;
+    playlistGeneration = 0;
+    itemSerial = 0;
+    shownItem = 0;
+    decoderCache = std::make_shared<DecoderCache>();
+    looping = false;
+    loopStart = loopEnd = 0.0;
+    loopBudget = LOOP_CACHE_BUDGET;
+    loopFrameCapture = false;
+    loopFramePass = -1;
+    loopOrigin = 0.0;
+    loopPeriod = 0.0;
+    loopPass = 0;
+    loopReplaying = false;
+    loopCursor = 0;
+    loopCapturing = false;
+    loopVideoEnded = loopAudioEnded = false;
+    loopFirst = loopLast = 0.0;
+    loopVideoFrames = loopAudioFrames = false;
+    loopVideoPass = loopAudioPass = 0;
+    loopVideoCursor = loopAudioCursor = 0;
+    loopShownPass = 0;
     startTime = 0;
     startPosition = 0.0;
     currPosition = 0.0;
     m_speed = 1;
-    demuxing = std::thread([this] { addPacket(); });
-    videoDecoding = std::thread([this] { decodeVideoPacket(); });
-    videoRendering = std::thread([this] { renderVideo(); });
-    audioDecoding = std::thread([this] { decodeAudioPacket(); });
+    trickPlay = false;
+    reversePlay = false;
+    paused = false;
+    shownGop = &gopCaches[0];
+    prefetchGop = &gopCaches[1];
+    reverseBudget = REVERSE_CACHE_BUDGET;
+    gopRequested = gopReady = false;
+    gopEnd = AV_NOPTS_VALUE;
+    gopSeeked = reverseEof = reverseWaiting = false;
+    gopDecodeStart = 0;
+    lastReversePts = AV_NOPTS_VALUE;
+    shownPts = stepDecoderPts = AV_NOPTS_VALUE;
+    stepping = false;
+    dropVideoBefore = AV_NOPTS_VALUE;
+    dropAudioBefore = -1.0;
+    surfaceWidth = surfaceHeight = 0;
+    surfaceResized = false;
+    codedWidth = codedHeight = videoWidth = videoHeight = outWidth = outHeight = 0;
+    decoderLowres = 0;
+    preferredFormat = outFormat = RenderFormat::RGBA;
+    outDataSpace = ADATASPACE_UNKNOWN;
+    scaleCtx = nullptr;
+    hdrPeakNits = DEFAULT_HDR_PEAK_NITS;
+    toneFrame = nullptr;
+    scaledFrame = nullptr;
+    streamSar = videoSar = AVRational{0, 1};
+    displayRotation = Rotation::None;
+    convertCostUs = 0;
+    fastScale = false;
+    convertSlices = 0;
+    lastSlices = 1;
+    trickStartPts = lastRenderPts = AV_NOPTS_VALUE;
+    trickStartTime = 0;
+    pendingPacket = nullptr;
+    pendingVideoFrame = nullptr;
+    pendingImage = nullptr;
+    convertSwitched = convertEnded = videoEndQueued = audioFilterFlushed = false;
+    heldImage = nullptr;
+    heldSince = 0;
+    lastPresentTime = lastPresentUs = 0;
+    switchSilenceBase = 0;
+    lastConvertedPts = AV_NOPTS_VALUE;
+    audioSkipLeft = 0;
+    audioAtStart = false;
+    audioSideTrimmed = audioEndTrimmed = false;
+    heldAudioSamples = 0;
+    swrCtx = nullptr;
+    swrInFormat = swrInRate = 0;
+    swrInLayout = 0;
+    audioOutRate = 0;
+    audioOutChannels = AUDIO_CHANNELS;
+    audioOutFloat = false;
+    swrOutChannels = AUDIO_CHANNELS;
+    downmixChannels = 0;
+    downmixCenter = DOWNMIX_CENTER_LEVEL;
+    downmixSurround = DOWNMIX_SURROUND_LEVEL;
+    downmixLfe = 0.0f;
+    downmixDirty = false;
+    loudnessEnabled = false;
+    loudnessTarget = LOUDNESS_TARGET_LUFS;
+    loudnessDirty = false;
+    loudnessActive = false;
+    metadataGainDb = NAN;
+    metadataGainSource = "none";
+    pendingPcmEnd = NAN;
+    audioRingEnd = NAN;
+    pendingPcmSerial = 0;
+    audioRingSerial = 0;
+    audioBytesPerSec = 0;
+    lastTuneTime = 0;
+    demuxEof = videoEofSent = audioEofSent = false;
+    openTime = 0;
+    openUsage = {};
+    auto pool = WorkerPool::shared();
+    demuxing = Stage::create(pool, [this] { return addPacket(); }, ThreadRole::Demux);
+    videoDecoding = Stage::create(pool, [this] { return decodeVideoPacket(); },
+                                  ThreadRole::VideoDecode);
+    videoConverting = Stage::create(pool, [this] { return convertVideo(); },
+                                    ThreadRole::VideoConvert);
+    videoRendering = Stage::create(pool, [this] { return renderVideo(); },
+                                   ThreadRole::VideoRender);
+    audioDecoding = Stage::create(pool, [this] { return decodeAudioPacket(); },
+                                  ThreadRole::AudioDecode);
+    gopDecoding = Stage::create(pool, [this] { return decodeReverseGop(); },
+                                ThreadRole::VideoDecode);
+    reverseRendering = Stage::create(pool, [this] { return renderReverse(); },
+                                     ThreadRole::VideoRender);
+    // 音频流的播放、暂停、刷新在这里异步执行，不随其他阶段停止
+    audioControl = Stage::create(pool, [this] {
+        int64_t delay = audioRender.control();
+        return delay > 0 ? delay : Stage::kIdle;
+    }, ThreadRole::AudioDecode);
+    audioControl->start();
+    // 打开文件属于 I/O，与解复用使用同一类线程；同样不随其他阶段停止
+    preloading = Stage::create(pool, [this] { return preloadNext(); }, ThreadRole::Demux);
+    preloading->start();
+    // 单步等需要停下流水线的操作在这里执行，调用线程（UI 线程）只投递请求
+    controlling = Stage::create(pool, [this] { return runCommand(); }, ThreadRole::General);
+    controlling->start();
 }
 
 Player::~Player() {
-    unique_lock lck(mtx);
-    closed = true;
-    lck.unlock();
-    worker.notify_all();
-    demuxing.join();
-    videoDecoding.join();
-    videoRendering.join();
-    audioDecoding.join();
-    avformat_close_input(&pFormatCtx);
-    avcodec_close(pVideoCodecCtx);
-    avcodec_close(pAudioCodecCtx);
+    // 实时回调读取 audioRing、stats、outputGain、audioDsp，它们在 audioRender 之前析构，
+    // 先关闭输出流，保证之后没有回调在执行
+    audioRender.close();
+    controlling->stop();
+    audioControl->stop();
+    preloading->stop();
+    stopStages();
+    discardPlaylist();
+    retired.clear();
+    std::atomic_store(&session, std::shared_ptr<PlaybackSession>());
+    demuxItem = videoItem = convertItem = audioItem = nullptr;
+    clearQueues();
+    swr_free(&swrCtx);
+    sws_freeContext(scaleCtx);
+    scaleCtx = nullptr;
+    av_frame_free(&toneFrame);
+    av_frame_free(&scaledFrame);
+}
+
+void Player::startStages() {
+    auto s = std::atomic_load(&session);
+    if (reversePlay && s != nullptr) {
+        // 倒放从当前位置（包含当前帧）所在的 GOP 开始
+        gopEnd = llround(currPosition / av_q2d(s->videoTimeBase)) + 1;
+        gopRequested = true;
+        gopDecoding->start();
+        reverseRendering->start();
+        return;
+    }
+    demuxing->start();
+    videoDecoding->start();
+    videoConverting->start();
+    videoRendering->start();
+    audioDecoding->start();
+}
+
+void Player::stopStages() {
+    demuxing->stop();
+    videoDecoding->stop();
+    videoConverting->stop();
+    videoRendering->stop();
+    audioDecoding->stop();
+    gopDecoding->stop();
+    reverseRendering->stop();
+}
+
+void Player::wakeStages() {
+    demuxing->wake();
+    videoDecoding->wake();
+    videoConverting->wake();
+    videoRendering->wake();
+    audioDecoding->wake();
+    gopDecoding->wake();
+    reverseRendering->wake();
+}
+
+void Player::clearQueues() {
+    // 队列里保存的是裸指针，清空前需要逐个释放
+    // 跳转时队列可能处于暂停状态，tryPop 取不出元素，用 drain 释放
+    videoPacketQ.drain([](AVPacket *&pkt) { av_packet_free(&pkt); });
+    audioPacketQ.drain([](AVPacket *&pkt) { av_packet_free(&pkt); });
+    videoFrameQ.drain([](AVFrame *&frame) { av_frame_free(&frame); });
+    readyQ.drain([](ReadyImage *&image) { delete image; });
+    av_packet_free(&pendingPacket);
+    av_frame_free(&pendingVideoFrame);
+    delete pendingImage;
+    pendingImage = nullptr;
+    delete heldImage;
+    heldImage = nullptr;
+    heldSince = 0;
+    lastConvertedPts = AV_NOPTS_VALUE;
+    for (auto &f : heldAudio) av_frame_free(&f);
+    heldAudio.clear();
+    heldAudioSamples = 0;
+    pendingPcm.clear();
+    audioRing.clear();
+    tempo.clear();
+    loudness.clear();
+    pendingPcmEnd = NAN;
+    audioRingEnd = NAN;
+    // 滤镜中缓存的是跳转前的帧
+    videoFilter.reset();
+    audioFilter.reset();
+    shownGop->clear();
+    prefetchGop->clear();
+    gopRequested = gopReady = false;
+    gopSeeked = reverseEof = reverseWaiting = false;
+    lastReversePts = AV_NOPTS_VALUE;
 }
 
-void Player::addPacket() {
+int64_t Player::addPacket() {
     char errBuf[BUFF_SIZE]{};
-    while (true) {
-        unique_lock lck(mtx);
-        if (closed) break;
-        worker.wait(lck, [this]{ return isOpen; });
-        auto pFormatCtx_ = pFormatCtx;
-        auto videoStreamId_ = videoStreamId;
-        lck.unlock();
+    auto s = demuxItem.get();
+    if (s == nullptr) return Stage::kIdle;
+    if (looping) return addLoopPacket(s);
+    auto pFormatCtx_ = s->formatCtx;
+    auto videoStreamId_ = s->videoStreamId;
+    auto audioStreamId_ = s->audioStreamId;
+
+    if (pendingPacket == nullptr && demuxEof) {
+        // 文件读完后向两个解码阶段各送一个空 packet，让解码器输出缓存的帧
+        if (!videoEofSent && (videoEofSent = videoPacketQ.tryPush(nullptr))) {
+            videoDecoding->wake();
+        }
+        if (!audioEofSent && (audioEofSent = audioPacketQ.tryPush(nullptr))) {
+            audioDecoding->wake();
+        }
+        if (!videoEofSent || !audioEofSent) return Stage::kIdle;
+        // 空 packet 之后的数据属于播放列表的下一项
+        return advanceDemux();
+    }
+
+    if (pendingPacket == nullptr && !s->primedAudio.empty()) {
+        // 预加载时读到的音频 packet 先送出，之后接着读文件
+        pendingPacket = s->primedAudio.front();
+        s->primedAudio.pop_front();
+    }
 
+    if (pendingPacket == nullptr) {
         AVPacket *pkt = av_packet_alloc();
         int ret = av_read_frame(pFormatCtx_, pkt);
         if (ret < 0) {
+            av_packet_free(&pkt);
             av_strerror(ret, errBuf, sizeof(errBuf)-1);
             LOGE(LOGTAG, "ffmpeg av_read_frame error: %s", errBuf);
             if (AVERROR_EOF == ret) {
-                lck.lock();
-                isOpen = false;
-                lck.unlock();
+                demuxEof = true;
+                return Stage::kProgress;
             }
+            return 10000; // 其他错误 10ms 后重试
         }
-
-        if (pkt->stream_index == videoStreamId_) {
-            videoPacketQ.push(pkt);
-            LOGD(LOGTAG, "添加一个 raw packet 到 videoPacketQ: dts=%ld, pts=%ld, duration=%ld",
-                 pkt->dts, pkt->pts, pkt->duration);
-        } else if (pkt->stream_index == audioStreamId) {
-             audioPacketQ.push(pkt);
-             LOGD(LOGTAG, "添加一个 raw packet 到 audioPacketQ: dts=%ld, pts = %ld, duration=%ld",
-                  pkt->dts, pkt->pts, pkt->duration);
+        if (pkt->stream_index != videoStreamId_ && pkt->stream_index != audioStreamId_) {
+            av_packet_free(&pkt);
+            return Stage::kProgress;
+        }
+        stats.demuxedPackets++;
+        // 快速浏览时只保留视频关键帧
+        if (trickPlay && (pkt->stream_index != videoStreamId_ || !(pkt->flags & AV_PKT_FLAG_KEY))) {
+            stats.trickDroppedPackets++;
+            av_packet_free(&pkt);
+            return Stage::kProgress;
         }
+        if (trickPlay) skipToNextKeyframe(s, pkt);
+        pendingPacket = pkt;
     }
+    return pushPacket(s);
 }
 
-void Player::decodeVideoPacket() {
-    char errBuf[BUFF_SIZE]{};
-    while (true) {
-        unique_lock lck(mtx);
-        if (closed) break;
-        worker.wait(lck, [this]{ return isOpen; });
-        auto pVideoCodecCtx_ = pVideoCodecCtx;
-        lck.unlock();
-
-        AVPacket *pkt = nullptr;
-        videoPacketQ.pop(pkt);
-        if (pkt == nullptr) continue;
-        LOGD(LOGTAG, "从 videoPacketQ 获取到一个 raw package: dts=%ld, pts=%ld, duration=%ld",
-             pkt->dts, pkt->pts, pkt->duration);
-        int ret = avcodec_send_packet(pVideoCodecCtx_, pkt);
-        av_packet_free(&pkt);
-        if (ret < 0) {
-            av_strerror(ret, errBuf, sizeof(errBuf)-1);
-            LOGE(LOGTAG, "ffmpeg avcodec_send_packet error: %s", errBuf);
-            if (AVERROR_EOF == ret) {
-                lck.lock();
-                isOpen = false;
-                lck.unlock();
-            }
-        }
-
-        AVFrame *frame = av_frame_alloc();
-        ret = avcodec_receive_frame(pVideoCodecCtx_, frame);
-        if (ret == 0) {
-            videoFrameQ.push(frame);
-            LOGD(LOGTAG, "添加一个 video frame 到 videoFrameQ: pts=%ld, width=%d, height=%d",
-                frame->pts, frame->width, frame->height);
-        } else {
-            av_strerror(ret, errBuf, sizeof(errBuf)-1);
-            LOGE(LOGTAG, "ffmpeg avcodec_receive_frame error: %s", errBuf);
-            if (AVERROR_EOF == ret) {
-                lck.lock();
-                isOpen = false;
-                lck.unlock();
-            }
-        }
+int64_t Player::pushPacket(const PlaybackSession *s) {
+    // 队列已满时保留 packet，等解码阶段取走数据后再被唤醒
+    if (pendingPacket->stream_index == s->videoStreamId) {
+        LOGD(LOGTAG, "添加一个 raw packet 到 videoPacketQ: dts=%ld, pts=%ld, duration=%ld",
+             pendingPacket->dts, pendingPacket->pts, pendingPacket->duration);
+        if (!videoPacketQ.tryPush(pendingPacket)) return Stage::kIdle;
+        videoDecoding->wake();
+    } else {
+        LOGD(LOGTAG, "添加一个 raw packet 到 audioPacketQ: dts=%ld, pts = %ld, duration=%ld",
+             pendingPacket->dts, pendingPacket->pts, pendingPacket->duration);
+        if (!audioPacketQ.tryPush(pendingPacket)) return Stage::kIdle;
+        audioDecoding->wake();
     }
+    pendingPacket = nullptr;
+    return Stage::kProgress;
+}
+
+// 第 pass 遍的时间偏移换算到 timeBase，解复用和解码阶段用同一个公式，减回去时没有误差
+static int64_t loopOffset(int pass, double seconds, AVRational timeBase) {
+    return llround(pass * seconds / av_q2d(timeBase));
 }
 
-void Player::decodeAudioPacket() {
+int64_t Player::addLoopPacket(const PlaybackSession *s) {
     char errBuf[BUFF_SIZE]{};
-    while (true) {
-        unique_lock lck(mtx);
-        worker.wait(lck, [this]{ return isOpen; });
-        auto pAudioCodecCtx_ = pAudioCodecCtx;
-        lck.unlock();
+    if (pendingPacket != nullptr) return pushPacket(s);
+    // 两路都改为重放解码帧之后不再需要 packet，文件也不再读取
+    if (loopVideoFrames && loopAudioFrames) return Stage::kIdle;
 
-        AVPacket *pkt = nullptr;
-        audioPacketQ.pop(pkt);
-        if (pkt == nullptr) continue;
-        LOGD(LOGTAG, "从 audioPacketQ 获取到一个 raw package: dts=%ld, pts=%ld, duration=%ld",
-             pkt->dts, pkt->pts, pkt->duration);
-        int ret = avcodec_send_packet(pAudioCodecCtx_, pkt);
-        av_packet_free(&pkt);
+    AVPacket *pkt = nullptr;
+    if (loopReplaying) {
+        if (loopCursor >= loopCache.packetCount()) {
+            finishLoopPass(s);
+            return Stage::kProgress;
+        }
+        pkt = av_packet_clone(loopCache.packet(loopCursor++));
+        if (pkt == nullptr) return Stage::kProgress;
+        stats.loopReplayedPackets++;
+        stats.loopReplayedBytes += pkt->size;
+    } else {
+        pkt = av_packet_alloc();
+        int ret = av_read_frame(s->formatCtx, pkt);
         if (ret < 0) {
-            av_strerror(ret, errBuf, sizeof(errBuf)-1);
-            LOGE(LOGTAG, "ffmpeg avcodec_send_packet error: %s", errBuf);
-            if (AVERROR_EOF == ret) {
-                lck.lock();
-                isOpen = false;
-                lck.unlock();
+            av_packet_free(&pkt);
+            if (ret != AVERROR_EOF) {
+                av_strerror(ret, errBuf, sizeof(errBuf)-1);
+                LOGE(LOGTAG, "ffmpeg av_read_frame error: %s", errBuf);
+                return 10000;
             }
+            // B 在文件末尾，读完就是一遍
+            finishLoopPass(s);
+            return Stage::kProgress;
         }
-
-        AVFrame *frame = av_frame_alloc();
-        ret = avcodec_receive_frame(pAudioCodecCtx_, frame);
-        if (ret == 0) {
-            LOGD(LOGTAG, "audio frame format: %d", frame->format);
-
-            // 设置音频重采样上下文
-            AVSampleFormat inSampleFmt = pAudioCodecCtx_->sample_fmt;
-            uint64_t inChannelLayout = pAudioCodecCtx_->channel_layout;
-            int inSampleRate = pAudioCodecCtx_->sample_rate;
-            AVSampleFormat outSampleFmt = AV_SAMPLE_FMT_S16;
-            uint64_t outChannelLayout = AV_CH_LAYOUT_STEREO;
-            int outSampleRate = inSampleRate;
-            SwrContext *swrCtx = swr_alloc();
-            swr_alloc_set_opts(swrCtx, outChannelLayout, outSampleFmt, outSampleRate,
-                               inChannelLayout, inSampleFmt, inSampleRate, 0, nullptr);
-            swr_init(swrCtx);
-
-            // 音频缓存
-            int nbChannels = av_get_channel_layout_nb_channels(outChannelLayout);
-            int pcmBufSize = nbChannels * inSampleRate;
-            uint8_t *pcmBuf = static_cast<uint8_t *>(av_malloc(pcmBufSize));
-
-            swr_convert(swrCtx, &pcmBuf, pcmBufSize,
-                (const uint8_t* *)frame->data, frame->nb_samples);
-            lck.lock();
-            memcpy(audioUserData, pcmBuf, pcmBufSize);
-
-            // 根据每一帧的 duration 进行延时
-            AVRational timebase = pFormatCtx->streams[audioStreamId]->time_base;
-            double duration = frame->pkt_duration * av_q2d(timebase);
-            av_usleep(duration * 1000000 / m_speed);
-            lck.unlock();
-
-            swr_free(&swrCtx);
-            av_free(pcmBuf);
-            av_frame_free(&frame);
-        } else {
-            av_strerror(ret, errBuf, sizeof(errBuf)-1);
-            LOGE(LOGTAG, "ffmpeg avcodec_receive_frame error: %s", errBuf);
-            if (AVERROR_EOF == ret) {
-                lck.lock();
-                isOpen = false;
-                lck.unlock();
-            }
+        if (pkt->stream_index != s->videoStreamId && pkt->stream_index != s->audioStreamId) {
+            av_packet_free(&pkt);
+            return Stage::kProgress;
+        }
+        stats.demuxedPackets++;
+        // dts 到达 B 之后的 packet 不会再解出 B 之前的帧（参考帧都在它之前解码），这一路的这一遍结束
+        bool video = pkt->stream_index == s->videoStreamId;
+        AVRational tb = video ? s->videoTimeBase : s->audioTimeBase;
+        int64_t dts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+        bool &ended = video ? loopVideoEnded : loopAudioEnded;
+        if (ended || (dts != AV_NOPTS_VALUE && dts * av_q2d(tb) >= loopEnd)) {
+            ended = true;
+            av_packet_free(&pkt);
+            if (loopVideoEnded && loopAudioEnded) finishLoopPass(s);
+            return Stage::kProgress;
+        }
+        if (dts != AV_NOPTS_VALUE) {
+            int64_t pts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : dts;
+            loopFirst = std::min(loopFirst, std::min(pts, dts) * av_q2d(tb));
+            loopLast = std::max(loopLast, (std::max(pts, dts) + pkt->duration) * av_q2d(tb));
+        }
+        if (loopCapturing && !loopCache.addPacket(pkt)) {
+            loopCapturing = false;
+            LOGW(LOGTAG, "loop segment exceeds the cache budget, read the file every pass");
         }
     }
-}
-
-void Player::renderVideo() {
-    while (true) {
-        unique_lock lck(mtx);
-        if (closed) break;
-        worker.wait(lck, [this]{ return isOpen; });
-        auto pVideoCodecCtx_ = pVideoCodecCtx;
-        auto pFormatCtx_ = pFormatCtx;
-        auto speed = m_speed;
-        lck.unlock();
-
-        AVFrame *frame = nullptr;
-        videoFrameQ.pop(frame);
-        if (frame == nullptr) continue;
-        LOGD(LOGTAG, "从 videoFrameQ 获取到一个 frame: pts=%ld, width: %d, height: %d",
-             frame->pts, frame->width, frame->height);
 
-        // SRC_PIX_FMT 转 RGBA
-        SwsContext *swsCtx = sws_getContext(
-        pVideoCodecCtx_->width, pVideoCodecCtx_->height, pVideoCodecCtx_->pix_fmt,
-        pVideoCodecCtx_->width, pVideoCodecCtx_->height, AV_PIX_FMT_RGBA,
-        SWS_BICUBIC, nullptr, nullptr, nullptr);
-        uint8_t* dstData[4];
-        int dstLineSize[4];
-        av_image_alloc(dstData, dstLineSize,
-           pVideoCodecCtx_->width, pVideoCodecCtx_->height, AV_PIX_FMT_RGBA, 1);
-        sws_scale(swsCtx, frame->data, frame->linesize, 0, frame->height,
-            dstData, dstLineSize);
-
-        // 渲染画面与时钟同步
-//        while ((av_gettime() - startTime)*m_speed < (currPosition - startPosition) * 1000000) {
-//            av_usleep(100);
-//        }
-        lck.lock();
-        videoRender.render(dstData[0]);
-        AVRational timebase = pFormatCtx_->streams[videoStreamId]->time_base;
-        currPosition = frame->pts * static_cast<double>(timebase.num) / timebase.den; // in seconds
-        lck.unlock();
-
-        // 根据每一帧的 duration 进行延时
-        double duration = frame->pkt_duration * av_q2d(timebase);
-        av_usleep(duration * 1000000 / speed);
-
-        // 根据帧率延时
-        // AVRational frameRate = pFormatCtx_->streams[videoStreamId]->avg_frame_rate;
-        // double duration = av_q2d(av_inv_q(frameRate));
-        // av_usleep(duration * 1000000 / speed);
-
-        av_freep(&dstData[0]);
-        sws_freeContext(swsCtx);
-        av_frame_free(&frame);
+    // 时间戳整体后移，解码器看到的是一直递增的时间戳
+    bool video = pkt->stream_index == s->videoStreamId;
+    if (loopPass > 0) {
+        int64_t offset = loopOffset(loopPass, loopPeriod, video ? s->videoTimeBase : s->audioTimeBase);
+        if (pkt->pts != AV_NOPTS_VALUE) pkt->pts += offset;
+        if (pkt->dts != AV_NOPTS_VALUE) pkt->dts += offset;
     }
+    // 已经改为重放解码帧的一路直接丢弃
+    if (video ? loopVideoFrames : loopAudioFrames) {
+        av_packet_free(&pkt);
+        return Stage::kProgress;
+    }
+    pendingPacket = pkt;
+    return pushPacket(s);
 }
 
-double Player::getDuration() {
-    lock_guard lck(mtx);
-    return static_cast<double>(pFormatCtx->duration) / AV_TIME_BASE;
-}
-
-double Player::getPosition() const {
-    lock_guard lck(mtx);
-    return currPosition;
+void Player::finishLoopPass(const PlaybackSession *s) {
+    // 每一遍都从同一个关键帧开始，第一遍读到的时间范围就是一遍的长度
+    if (loopPeriod <= 0) {
+        if (loopLast <= loopFirst) {
+            loopFirst = loopStart;
+            loopLast = loopEnd;
+        }
+        loopOrigin = loopFirst;
+        loopPeriod = loopLast - loopFirst + LOOP_PERIOD_MARGIN;
+    }
+    if (loopCapturing) {
+        loopCache.finishPackets();
+        loopCapturing = false;
+        LOGI(LOGTAG, "loop cached %zu packets, %.2f MB", loopCache.packetCount(),
+             loopCache.packetBytes() / 1048576.0);
+    }
+    loopPass++;
+    loopVideoEnded = loopAudioEnded = false;
+    loopCursor = 0;
+    loopReplaying = loopCache.packetsReady();
+    if (loopReplaying) {
+        stats.loopPacketPasses++;
+        return;
+    }
+    // 缓存放不下：跳回 A 之前的关键帧重新读。解码器不清空，时间戳照样后移
+    double target = std::max(0.0, loopStart - LOOP_PREROLL);
+    int64_t ts = static_cast<int64_t>(target * av_q2d(av_inv_q(s->videoTimeBase)));
+    if (av_seek_frame(s->formatCtx, s->videoStreamId, ts, AVSEEK_FLAG_BACKWARD) < 0) {
+        LOGW(LOGTAG, "loop seek to %.3f failed", target);
+    }
+    stats.loopSeekPasses++;
 }
 
-AVStream * Player::getVideoStream() {
-    for (int i = 0; i < pFormatCtx->nb_streams; ++i) {
-        if (pFormatCtx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-            videoStreamId = i;
-            return pFormatCtx->streams[i];
-        }
+int64_t Player::advanceDemux() {
+    // 跳转之后后一项可能已经链接好，否则取预加载好的条目；还没有准备好时由 preloading 唤醒
+    auto next = demuxItem->next();
+    if (next == nullptr) {
+        std::lock_guard<std::mutex> lck(playlistMtx);
+        next.swap(preloaded);
     }
-    return nullptr;
+    if (next == nullptr) return Stage::kIdle;
+    LOGI(LOGTAG, "demux %s", next->path.c_str());
+    demuxItem->setNext(next);
+    demuxItem = next;
+    demuxEof = videoEofSent = audioEofSent = false;
+    // 解码、转换阶段在排空上一项之后等待链接，预加载接着打开再下一项
+    videoDecoding->wake();
+    videoConverting->wake();
+    audioDecoding->wake();
+    preloading->wake();
+    return Stage::kProgress;
 }
 
-AVStream * Player::getAudioStream() {
-    for (int i = 0; i < pFormatCtx->nb_streams; ++i) {
-        if (pFormatCtx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
-            audioStreamId = i;
-            return pFormatCtx->streams[i];
-        }
+void Player::skipToNextKeyframe(const PlaybackSession *s, const AVPacket *pkt) {
+    // 根据关键帧索引直接跳到下一个需要显示的关键帧，中间的数据不再读取。
+    // 没有索引的格式（如 TS）退化为顺序读取并丢弃非关键帧
+    AVStream *st = s->formatCtx->streams[s->videoStreamId];
+    if (st->nb_index_entries == 0 || pkt->pts == AV_NOPTS_VALUE) return;
+    double step = m_speed * TRICK_FRAME_INTERVAL;
+    int64_t target = pkt->pts + static_cast<int64_t>(step / av_q2d(s->videoTimeBase));
+    int idx = av_index_search_timestamp(st, target, 0);
+    if (idx < 0) return;
+    int64_t next = st->index_entries[idx].timestamp;
+    if (next <= pkt->pts) return;
+    // 当前关键帧照常送出，下一次读取从目标关键帧开始
+    int ret = avformat_seek_file(s->formatCtx, s->videoStreamId, next, next, INT64_MAX, 0);
+    if (ret < 0) {
+        LOGW(LOGTAG, "trick play seek to %ld failed", next);
     }
-    return nullptr;
 }
 
-bool Player::openVideoDecoder() {
+int64_t Player::decodeVideoPacket() {
     char errBuf[BUFF_SIZE]{};
-    auto vs = getVideoStream();
-    if (vs == nullptr) return false;
+    auto s = videoItem.get();
+    if (s == nullptr) return Stage::kIdle;
+    auto pVideoCodecCtx_ = s->videoCodecCtx;
 
-    auto pCodecParameters = vs->codecpar;
-    pVideoCodec = avcodec_find_decoder(pCodecParameters->codec_id);
-    if (pVideoCodec == nullptr) {
-        // 没有找到解码器
-        LOGE(LOGTAG, "没有找到视频解码器");
-        return false;
+    if (pendingVideoFrame != nullptr) {
+        if (!videoFrameQ.tryPush(pendingVideoFrame)) return Stage::kIdle;
+        pendingVideoFrame = nullptr;
+        videoConverting->wake();
+        return Stage::kProgress;
     }
 
-    pVideoCodecCtx = avcodec_alloc_context3(pVideoCodec);
-    if (pVideoCodecCtx == nullptr) {
-        return false;
+    if (!s->primedVideo.empty()) {
+        // 预加载时已经解出的帧，切换后马上就有画面可以转换
+        pendingVideoFrame = s->primedVideo.front();
+        s->primedVideo.pop_front();
+        return Stage::kProgress;
     }
 
-    int ret = avcodec_parameters_to_context(pVideoCodecCtx, pCodecParameters);
-    if (ret < 0) {
-        av_strerror(ret, errBuf, sizeof(errBuf) - 1);
-        LOGE(LOGTAG, "使用流的参数来填充上下文失败, ffmpeg avcodec_parameters_to_context error: %s", errBuf);
-        avformat_free_context(pFormatCtx);
-        avcodec_free_context(&pVideoCodecCtx);
-        return false;
+    if (loopVideoFrames) return replayLoopVideo(s);
+
+    AVFrame *frame = av_frame_alloc();
+    int ret = avcodec_receive_frame(pVideoCodecCtx_, frame);
+    if (ret == 0) {
+        stats.decodedVideoFrames++;
+        if (looping && !loopVideoFrame(s, frame)) {
+            av_frame_free(&frame);
+            return Stage::kProgress;
+        }
+        if (dropVideoBefore != AV_NOPTS_VALUE && frame->pts != AV_NOPTS_VALUE &&
+            frame->pts < dropVideoBefore) {
+            av_frame_free(&frame);
+            return Stage::kProgress;
+        }
+        LOGD(LOGTAG, "添加一个 video frame 到 videoFrameQ: pts=%ld, width=%d, height=%d",
+             frame->pts, frame->width, frame->height);
+        pendingVideoFrame = frame;
+        return Stage::kProgress;
+    }
+    av_frame_free(&frame);
+    if (ret == AVERROR_EOF) {
+        // 这一项已经排空，在帧队列中放一个空帧作为分界：转换阶段据此冲出滤镜中缓存的帧，
+        // 解复用阶段链接下一项之后两个阶段再各自切换过去
+        if (!videoEndQueued) {
+            if (!videoFrameQ.tryPush(nullptr)) return Stage::kIdle;
+            videoEndQueued = true;
+            videoConverting->wake();
+        }
+        auto next = s->next();
+        if (next == nullptr) return Stage::kIdle;
+        next->videoCodecCtx->skip_frame = trickPlay ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+        videoItem = next;
+        videoEndQueued = false;
+        dropVideoBefore = AV_NOPTS_VALUE;
+        return Stage::kProgress;
+    }
+    if (ret != AVERROR(EAGAIN)) {
+        av_strerror(ret, errBuf, sizeof(errBuf)-1);
+        LOGE(LOGTAG, "ffmpeg avcodec_receive_frame error: %s", errBuf);
+        return Stage::kIdle;
     }
 
-    ret = avcodec_open2(pVideoCodecCtx, pVideoCodec, nullptr);
+    // 解码器需要更多输入
+    AVPacket *pkt = nullptr;
+    if (!videoPacketQ.tryPop(pkt)) return Stage::kIdle;
+    demuxing->wake();
+    if (pkt != nullptr) {
+        LOGD(LOGTAG, "从 videoPacketQ 获取到一个 raw package: dts=%ld, pts=%ld, duration=%ld",
+             pkt->dts, pkt->pts, pkt->duration);
+    }
+    // pkt 为空表示文件已读完，解码器进入排空模式
+    ret = avcodec_send_packet(pVideoCodecCtx_, pkt);
+    av_packet_free(&pkt);
     if (ret < 0) {
-        av_strerror(ret, errBuf, sizeof(errBuf) - 1);
-        LOGE(LOGTAG, "打开视频解码器失败, ffmpeg avcodec_open2 error: %s", errBuf);
-        avformat_free_context(pFormatCtx);
-        avcodec_free_context(&pVideoCodecCtx);
-        return false;
+        av_strerror(ret, errBuf, sizeof(errBuf)-1);
+        LOGE(LOGTAG, "ffmpeg avcodec_send_packet error: %s", errBuf);
     }
-
-    LOGD(LOGTAG, "Video Codec: resolution %dx%d, bit rate: %ld",
-         pCodecParameters->width, pCodecParameters->height,
-         pCodecParameters->bit_rate);
-
-    videoRender.setBuffers(pCodecParameters->width, pCodecParameters->height);
-
-    return true;
+    return Stage::kProgress;
 }
 
-bool Player::openAudioDecoder() {
+int64_t Player::decodeAudioPacket() {
     char errBuf[BUFF_SIZE]{};
-    auto as = getAudioStream();
-    if (as == nullptr) return false;
+    auto s = audioItem.get();
+    if (s == nullptr) return Stage::kIdle;
+    auto pAudioCodecCtx_ = s->audioCodecCtx;
 
-    auto pCodecParameters = as->codecpar;
-    pAudioCodec = avcodec_find_decoder(pCodecParameters->codec_id);
-    if (pAudioCodec == nullptr) {
-        LOGE(LOGTAG, "没有找到音频解码器");
-        return false;
-    }
+    // 设备断开（拔出耳机、切换蓝牙等）或切换独占模式后重新打开输出，新流的采样率和格式可能不同
+    if (audioRender.needsReopen() && !reopenAudioOutput()) return AUDIO_REOPEN_RETRY_US;
 
-    pAudioCodecCtx = avcodec_alloc_context3(pAudioCodec);
-    if (pAudioCodecCtx == nullptr) {
-        return false;
+    // 按欠载次数调整设备缓冲区，同时刷新音频时钟用到的输出延迟
+    int64_t now = av_gettime_relative();
+    if (now - lastTuneTime >= AUDIO_TUNE_INTERVAL_US) {
+        audioRender.tune(now);
+        lastTuneTime = now;
     }
 
-    int ret = avcodec_parameters_to_context(pAudioCodecCtx, pCodecParameters);
+    // 输出没有空间时稍后再试。环形缓冲区由实时回调消费，回调里不能调度任务，所以这里轮询
+    if (!flushPendingPcm()) return AUDIO_POLL_US;
+
+    if (loopAudioFrames) return replayLoopAudio(s);
+
+    AVFrame *frame = av_frame_alloc();
+    int ret = avcodec_receive_frame(pAudioCodecCtx_, frame);
+    if (ret == AVERROR(EAGAIN) || (ret == 0 && trickPlay)) {
+        // 快速浏览时不输出音频，解出的帧直接丢弃
+        av_frame_free(&frame);
+        if (ret == 0) return Stage::kProgress;
+        AVPacket *pkt = nullptr;
+        if (!audioPacketQ.tryPop(pkt)) return Stage::kIdle;
+        demuxing->wake();
+        if (pkt != nullptr) {
+            LOGD(LOGTAG, "从 audioPacketQ 获取到一个 raw package: dts=%ld, pts=%ld, duration=%ld",
+                 pkt->dts, pkt->pts, pkt->duration);
+        }
+        ret = avcodec_send_packet(pAudioCodecCtx_, pkt);
+        av_packet_free(&pkt);
+        if (ret < 0) {
+            av_strerror(ret, errBuf, sizeof(errBuf)-1);
+            LOGE(LOGTAG, "ffmpeg avcodec_send_packet error: %s", errBuf);
+        }
+        return Stage::kProgress;
+    }
+    if (ret == AVERROR_EOF) {
+        av_frame_free(&frame);
+        // 这一项解码完了：保留的最后几帧裁掉结尾的填充后送出
+        if (!heldAudio.empty()) {
+            int back = audioEndTrimmed ? 0 : s->trailingPadding;
+            for (auto it = heldAudio.rbegin(); it != heldAudio.rend() && back > 0; ++it) {
+                int n = std::min(back, (*it)->nb_samples);
+                (*it)->nb_samples -= n;
+                back -= n;
+                stats.trimmedAudioSamples += n;
+            }
+            for (auto &f : heldAudio) {
+                if (f->nb_samples > 0) playAudioFrame(s, f);
+                av_frame_free(&f);
+            }
+            heldAudio.clear();
+            heldAudioSamples = 0;
+            return Stage::kProgress;
+        }
+        // 解复用阶段链接下一项之后切换过去。重采样、变速和限幅器的状态保留，前后两项的样本
+        // 直接衔接；音频时钟在新条目的数据写入环形缓冲区后才属于新条目
+        auto next = s->next();
+        // 播放列表到头，或者下一项的时间基不同、滤镜需要重建时，先冲出滤镜中缓存的帧
+        // （loudnorm 会缓存几秒），其余情况滤镜的状态在两项之间延续
+        bool rebuild = next != nullptr && av_cmp_q(next->audioTimeBase, s->audioTimeBase) != 0;
+        if (!audioFilterFlushed && (next == nullptr || rebuild)) {
+            audioFilterFlushed = true;
+            if (audioFilter.enabled() && audioFilter.flush()) {
+                frame = av_frame_alloc();
+                while (audioFilter.receive(frame)) {
+                    outputAudio(s, frame);
+                    av_frame_unref(frame);
+                }
+                av_frame_free(&frame);
+                return Stage::kProgress;
+            }
+        }
+        if (next == nullptr) return Stage::kIdle;
+        LOGI(LOGTAG, "audio %s", next->path.c_str());
+        if (rebuild) audioFilter.reset();
+        audioItem = next;
+        audioFilterFlushed = false;
+        audioAtStart = true;
+        audioSkipLeft = 0;
+        audioSideTrimmed = audioEndTrimmed = false;
+        dropAudioBefore = -1.0;
+        switchSilenceBase = stats.audioSilenceFrames.load();
+        // 新曲目重新估计响度，延迟线中上一曲目的结尾照常输出
+        loudness.restart();
+        metadataGainDb = next->loudnessGainDb;
+        metadataGainSource = next->loudnessGainSource;
+        loudnessDirty = true;
+        return Stage::kProgress;
+    }
     if (ret < 0) {
-        av_strerror(ret, errBuf, sizeof(errBuf) - 1);
-        LOGE(LOGTAG, "使用流的参数来填充上下文失败, ffmpeg avcodec_parameters_to_context error: %s",
-             errBuf);
-        avformat_free_context(pFormatCtx);
-        avcodec_free_context(&pAudioCodecCtx);
-        return false;
+        av_frame_free(&frame);
+        av_strerror(ret, errBuf, sizeof(errBuf)-1);
+        LOGE(LOGTAG, "ffmpeg avcodec_receive_frame error: %s", errBuf);
+        return Stage::kIdle;
     }
 
-    ret = avcodec_open2(pAudioCodecCtx, pAudioCodec, nullptr);
+    stats.decodedAudioFrames++;
+    LOGD(LOGTAG, "audio frame format: %d", frame->format);
+    stats.trimmedAudioSamples += trimAudio(s, frame);
+    if (looping && frame->nb_samples > 0 && !loopAudioFrame(s, frame)) {
+        av_frame_free(&frame);
+        return Stage::kProgress;
+    }
+    if (frame->nb_samples <= 0 ||
+        (frame->pts != AV_NOPTS_VALUE && frame->pts * av_q2d(s->audioTimeBase) < dropAudioBefore)) {
+        av_frame_free(&frame);
+        return Stage::kProgress;
+    }
+
+    if (s->trailingPadding > 0) {
+        // 解码结束时才知道哪几帧是最后的，保留至少 trailing_padding 个样本
+        heldAudio.push_back(frame);
+        heldAudioSamples += frame->nb_samples;
+        while (heldAudioSamples - heldAudio.front()->nb_samples >= s->trailingPadding) {
+            AVFrame *f = heldAudio.front();
+            heldAudio.pop_front();
+            heldAudioSamples -= f->nb_samples;
+            playAudioFrame(s, f);
+            av_frame_free(&f);
+        }
+    } else {
+        playAudioFrame(s, frame);
+        av_frame_free(&frame);
+    }
+
+    flushPendingPcm();
+    return Stage::kProgress;
+}
+
+// 去掉帧开头的 n 个样本，pts 相应后移
+static bool skipSamples(AVFrame *frame, int n, AVRational timeBase) {
+    if (n <= 0) return true;
+    if (av_frame_make_writable(frame) < 0) return false;
+    av_samples_copy(frame->extended_data, frame->extended_data, 0, n,
+                    frame->nb_samples - n, frame->channels,
+                    static_cast<AVSampleFormat>(frame->format));
+    frame->nb_samples -= n;
+    if (frame->pts != AV_NOPTS_VALUE && frame->sample_rate > 0) {
+        frame->pts += av_rescale_q(n, AVRational{1, frame->sample_rate}, timeBase);
+    }
+    return true;
+}
+
+int Player::trimAudio(const PlaybackSession *s, AVFrame *frame) {
+    // 解码器设置了 AV_CODEC_FLAG2_SKIP_MANUAL，开头要跳过的样本和结尾的填充以附加数据给出，
+    // 要跳过的样本可能多于这一帧，余下的在后面的帧中继续跳过
+    int back = 0;
+    AVFrameSideData *sd = av_frame_get_side_data(frame, AV_FRAME_DATA_SKIP_SAMPLES);
+    if (sd != nullptr && sd->size >= 10) {
+        uint32_t skip = AV_RL32(sd->data);
+        uint32_t discard = AV_RL32(sd->data + 4);
+        if (skip > 0) audioSideTrimmed = true;
+        if (discard > 0) audioEndTrimmed = true;
+        audioSkipLeft += skip;
+        back = static_cast<int>(std::min<uint32_t>(discard, INT32_MAX));
+    }
+    if (frame->flags & AV_FRAME_FLAG_DISCARD) {
+        audioSideTrimmed = true;
+        int n = frame->nb_samples;
+        audioSkipLeft = std::max<int64_t>(0, audioSkipLeft - n);
+        frame->nb_samples = 0;
+        return n;
+    }
+    // 没有附加数据时按容器给出的编码器延迟裁剪，只在从开头播放时需要
+    if (audioAtStart && !audioSideTrimmed) audioSkipLeft += s->initialPadding;
+    audioAtStart = false;
+
+    int front = static_cast<int>(std::min<int64_t>(audioSkipLeft, frame->nb_samples));
+    audioSkipLeft -= front;
+    back = std::min(back, frame->nb_samples - front);
+    if (!skipSamples(frame, front, s->audioTimeBase)) return 0;
+    frame->nb_samples -= back;
+    return front + back;
+}
+
+void Player::playAudioFrame(const PlaybackSession *s, AVFrame *frame) {
+    if (audioFilter.enabled() && audioFilter.send(frame, s->audioTimeBase)) {
+        // 滤镜（如 loudnorm）可能缓存若干帧后才输出，也可能一次输出多帧
+        while (audioFilter.receive(frame)) {
+            outputAudio(s, frame);
+            av_frame_unref(frame);
+        }
+    } else {
+        outputAudio(s, frame);
+    }
+}
+
+int Player::loopPassOf(int64_t pts, AVRational timeBase, int64_t &raw) const {
+    double period = loopPeriod;
+    if (period <= 0) {
+        raw = pts;
+        return 0;
+    }
+    // 每一遍的时间戳落在 [loopOrigin + pass * period, loopOrigin + (pass + 1) * period) 内，
+    // 加上一点余量抵消偏移取整的误差
+    double t = pts * av_q2d(timeBase) - loopOrigin + 0.001;
+    int pass = std::max(0, static_cast<int>(std::floor(t / period)));
+    raw = pts - loopOffset(pass, period, timeBase);
+    return pass;
+}
+
+bool Player::startLoopFrames(LoopStream stream, int pass) {
+    // 保存的那一遍已经解码完，之后的帧都从缓存取，解码器不再使用
+    loopCache.finishFrames(stream);
+    if (!loopCache.framesReady(stream)) return false;
+    bool video = stream == LoopStream::Video;
+    LOGI(LOGTAG, "loop replays %zu decoded %s frames from pass %d", loopCache.frameCount(stream),
+         video ? "video" : "audio", pass);
+    if (video) {
+        loopVideoPass = pass;
+        loopVideoCursor = 0;
+        loopVideoFrames = true;
+    } else {
+        loopAudioPass = pass;
+        loopAudioCursor = 0;
+        loopAudioFrames = true;
+    }
+    return true;
+}
+
+bool Player::loopVideoFrame(const PlaybackSession *s, AVFrame *frame) {
+    if (frame->pts == AV_NOPTS_VALUE) return true;
+    int64_t raw;
+    int pass = loopPassOf(frame->pts, s->videoTimeBase, raw);
+    if (loopFramePass >= 0 && pass > loopFramePass && startLoopFrames(LoopStream::Video, pass)) return false;
+    double t = raw * av_q2d(s->videoTimeBase);
+    if (t < loopStart || t >= loopEnd) return false;
+    frame->pts = raw;
+    if (pass == loopFramePass) loopCache.addFrame(LoopStream::Video, frame);
+    frame->pts = raw + loopOffset(pass, loopEnd - loopStart, s->videoTimeBase);
+    return true;
+}
+
+bool Player::loopAudioFrame(const PlaybackSession *s, AVFrame *frame) {
+    if (frame->pts == AV_NOPTS_VALUE || frame->sample_rate <= 0) return true;
+    int64_t raw;
+    int pass = loopPassOf(frame->pts, s->audioTimeBase, raw);
+    if (loopFramePass >= 0 && pass > loopFramePass && startLoopFrames(LoopStream::Audio, pass)) return false;
+    // 按样本裁到 [A, B)，前后两遍的样本直接衔接
+    double t = raw * av_q2d(s->audioTimeBase);
+    int n = frame->nb_samples;
+    int front = static_cast<int>(std::ceil((loopStart - t) * frame->sample_rate - 1e-6));
+    int keep = static_cast<int>(std::floor((loopEnd - t) * frame->sample_rate + 1e-6));
+    front = std::min(std::max(front, 0), n);
+    keep = std::min(std::max(keep, 0), n);
+    if (front >= keep) return false;
+    frame->nb_samples = keep;
+    frame->pts = raw;
+    if (!skipSamples(frame, front, s->audioTimeBase)) return false;
+    if (pass == loopFramePass) loopCache.addFrame(LoopStream::Audio, frame);
+    frame->pts += loopOffset(pass, loopEnd - loopStart, s->audioTimeBase);
+    return true;
+}
+
+int64_t Player::replayLoopVideo(const PlaybackSession *s) {
+    // 解复用阶段已经不再送这一路的 packet，队列中剩下的直接丢掉
+    AVPacket *pkt = nullptr;
+    while (videoPacketQ.tryPop(pkt)) av_packet_free(&pkt);
+    AVFrame *frame = av_frame_clone(loopCache.frame(LoopStream::Video, loopVideoCursor));
+    if (frame != nullptr) {
+        frame->pts += loopOffset(loopVideoPass, loopEnd - loopStart, s->videoTimeBase);
+        pendingVideoFrame = frame;
+        stats.loopReplayedFrames++;
+    }
+    if (++loopVideoCursor == loopCache.frameCount(LoopStream::Video)) {
+        loopVideoCursor = 0;
+        loopVideoPass++;
+        stats.loopFramePasses++;
+    }
+    return Stage::kProgress;
+}
+
+int64_t Player::replayLoopAudio(const PlaybackSession *s) {
+    AVPacket *pkt = nullptr;
+    while (audioPacketQ.tryPop(pkt)) av_packet_free(&pkt);
+    // 为裁掉结尾填充保留的上一遍的最后几帧先送出
+    for (auto &f : heldAudio) {
+        playAudioFrame(s, f);
+        av_frame_free(&f);
+    }
+    heldAudio.clear();
+    heldAudioSamples = 0;
+    AVFrame *frame = av_frame_clone(loopCache.frame(LoopStream::Audio, loopAudioCursor));
+    if (frame != nullptr) {
+        frame->pts += loopOffset(loopAudioPass, loopEnd - loopStart, s->audioTimeBase);
+        playAudioFrame(s, frame);
+        av_frame_free(&frame);
+        stats.loopReplayedFrames++;
+    }
+    if (++loopAudioCursor == loopCache.frameCount(LoopStream::Audio)) {
+        loopAudioCursor = 0;
+        loopAudioPass++;
+    }
+    flushPendingPcm();
+    return Stage::kProgress;
+}
+
+bool Player::flushPendingPcm() {
+    if (pendingPcm.empty()) return true;
+    if (!audioRing.write(pendingPcm.data(), pendingPcm.size())) return false;
+    pendingPcm.clear();
+    audioRingEnd = pendingPcmEnd;
+    audioRingSerial = pendingPcmSerial;
+    return true;
+}
+
+bool Player::reopenAudioOutput() {
+    int64_t t0 = av_gettime_relative();
+    if (audioRender.reopen() < 0) return false;
+    LOGI(LOGTAG, "audio output reopened in %.1f ms: %d Hz, %d channels",
+         (av_gettime_relative() - t0) / 1000.0, audioRender.sampleRate(), audioRender.channelCount());
+    // 环形缓冲区中是按旧设备的格式写入的数据，丢掉；重采样在下一帧按新设备重建
+    pendingPcm.clear();
+    audioRing.clear();
+    swr_free(&swrCtx);
+    pendingPcmEnd = NAN;
+    audioRingEnd = NAN;
+    // 新流由 audioControl 确认开始后才取消静音
+    audioControl->wake();
+    return true;
+}
+
+void Player::applyLoudnessSettings() {
+    bool enabled = loudnessEnabled;
+    float target = loudnessTarget;
+    // 重新开启时延迟线和滤波器里是关闭前的数据
+    if (enabled && !loudnessActive) loudness.clear();
+    loudnessActive = enabled;
+    loudness.setTarget(target);
+    if (!std::isnan(metadataGainDb)) {
+        loudness.setTrackGain(metadataGainDb + target - REPLAYGAIN_REFERENCE_LUFS);
+    }
+}
+
+double Player::audioClock(const PlaybackSession *item) const {
+    // 环形缓冲区空了（欠载或音频已结束）时时钟不再前进，不能用来同步画面
+    if (item == nullptr || audioRingSerial != item->serial) return NAN;
+    size_t queued = audioRing.readable();
+    int bytesPerSec = audioBytesPerSec;
+    double end = audioRingEnd;
+    if (queued == 0 || bytesPerSec <= 0 || std::isnan(end)) return NAN;
+    int64_t latencyUs = audioRender.latencyUs();
+    double pending = static_cast<double>(queued) / bytesPerSec + (latencyUs > 0 ? latencyUs / 1e6 : 0.0);
+    // 缓冲区中的数据经过变速，按速度换算成媒体时间
+    return end - pending * m_speed;
+}
+
+// FFmpeg 默认顺序为 FL FR FC LFE 加左右环绕的 5.1 / 7.1，可以用 stereoDownmixMatrix 的矩阵
+static bool isSurroundLayout(uint64_t layout) {
+    return layout == AV_CH_LAYOUT_5POINT1 || layout == AV_CH_LAYOUT_5POINT1_BACK ||
+           layout == AV_CH_LAYOUT_7POINT1;
+}
+
+void Player::outputAudio(const PlaybackSession *s, const AVFrame *frame) {
+    // 重采样上下文在第一帧时按帧的格式创建，之后复用，保持重采样器内部状态连续；
+    // 只有输入格式变化（如切换了音频滤镜）或输出设备变化时才重建。
+    // 重采样输出 float 交给变速处理，设备接受 float 时直接写入环形缓冲区，否则转换成 S16
+    uint64_t inChannelLayout = frame->channel_layout;
+    if (inChannelLayout == 0) {
+        inChannelLayout = av_get_default_channel_layout(frame->channels);
+    }
+    if (swrCtx == nullptr || frame->format != swrInFormat || frame->sample_rate != swrInRate ||
+        inChannelLayout != swrInLayout) {
+        swr_free(&swrCtx);
+        AVSampleFormat outSampleFmt = AV_SAMPLE_FMT_FLT;
+        // 输出采样率和声道数跟随设备，一次重采样到位，系统混音器不需要再重采样。
+        // 输出流没有打开时按码流的采样率
+        int outSampleRate = audioRender.sampleRate();
+        int outChannels = audioRender.channelCount();
+        if (outSampleRate <= 0) outSampleRate = s->audioCodecCtx->sample_rate;
+        if (outChannels <= 0) outChannels = AUDIO_CHANNELS;
+        uint64_t outChannelLayout = av_get_default_channel_layout(outChannels);
+        // 5.1 / 7.1 输出到立体声时 swresample 保留原声道，重采样之后再由 audioDsp 下混
+        downmixChannels = 0;
+        if (outChannels == 2 && isSurroundLayout(inChannelLayout)) {
+            outChannelLayout = inChannelLayout;
+            downmixChannels = av_get_channel_layout_nb_channels(inChannelLayout);
+            downmixDirty = true;
+        }
+        swrOutChannels = av_get_channel_layout_nb_channels(outChannelLayout);
+        swrCtx = swr_alloc_set_opts(nullptr, outChannelLayout, outSampleFmt, outSampleRate,
+                                    inChannelLayout, static_cast<AVSampleFormat>(frame->format),
+                                    frame->sample_rate, 0, nullptr);
+        swr_init(swrCtx);
+        swrInFormat = frame->format;
+        swrInRate = frame->sample_rate;
+        swrInLayout = inChannelLayout;
+        audioOutFloat = audioRender.format() == AAUDIO_FORMAT_PCM_FLOAT;
+        LOGI(LOGTAG, "resample %d Hz fmt %d -> %d Hz %s, %d channels, downmix from %d", frame->sample_rate,
+             frame->format, outSampleRate, audioOutFloat ? "float" : "s16", outChannels, downmixChannels.load());
+        if (audioOutRate != outSampleRate || audioOutChannels != outChannels) {
+            audioOutRate = outSampleRate;
+            audioOutChannels = outChannels;
+            tempo.configure(outSampleRate, outChannels);
+            // 重新打开文件（stop() 清零了 audioOutRate）或设备参数变化时重新开始估计响度
+            loudness.configure(outSampleRate, outChannels);
+            loudnessDirty = true;
+        }
+        audioBytesPerSec = outSampleRate * outChannels *
+                           static_cast<int>(audioOutFloat ? sizeof(float) : sizeof(int16_t));
+    }
+    if (downmixChannels > 0 && downmixDirty.exchange(false)) {
+        stereoDownmixMatrix(downmixChannels, downmixCenter, downmixSurround, downmixLfe, downmixMatrix);
+    }
+    if (loudnessDirty.exchange(false)) applyLoudnessSettings();
+
+    int64_t t0 = av_gettime_relative();
+    int outSamples = swr_get_out_samples(swrCtx, frame->nb_samples);
+    resampled.resize(static_cast<size_t>(outSamples) * swrOutChannels);
+    auto outBuf = reinterpret_cast<uint8_t *>(resampled.data());
+    int ret = swr_convert(swrCtx, &outBuf, outSamples,
+        (const uint8_t* *)frame->data, frame->nb_samples);
+    stats.resampleUs += av_gettime_relative() - t0;
+    if (ret <= 0) return;
+
+    float *pcmIn = resampled.data();
+    if (downmixChannels > 0) {
+        t0 = av_gettime_relative();
+        mixed.resize(static_cast<size_t>(ret) * 2);
+        audioDsp.downmixStereo(resampled.data(), downmixChannels, downmixMatrix, mixed.data(), ret);
+        stats.downmixUs += av_gettime_relative() - t0;
+        stats.downmixFrames += ret;
+        pcmIn = mixed.data();
+    }
+
+    // 响度归一化在变速之前，估计的响度与播放速度无关
+    if (loudnessActive) {
+        t0 = av_gettime_relative();
+        loudness.process(pcmIn, ret);
+        stats.loudnessUs += av_gettime_relative() - t0;
+        stats.loudnessFrames += ret;
+    }
+
+    // 变速不变调，速度变化时在处理器内部平滑过渡
+    t0 = av_gettime_relative();
+    tempo.setTempo(m_speed);
+    stretched.clear();
+    size_t frames = tempo.process(pcmIn, ret, stretched);
+    stats.tempoProcessUs += av_gettime_relative() - t0;
+    stats.tempoOutputFrames += frames;
+    // 变速处理器和限幅器的前视延迟中还留着没输出的输入，输出只到这一帧结束前的位置
+    if (frame->pts != AV_NOPTS_VALUE && frame->sample_rate > 0) {
+        size_t delayed = tempo.bufferedFrames() + (loudnessActive ? loudness.latencyFrames() : 0);
+        pendingPcmEnd = frame->pts * av_q2d(s->audioTimeBase) +
+                        static_cast<double>(frame->nb_samples) / frame->sample_rate -
+                        static_cast<double>(delayed) / audioOutRate;
+        pendingPcmSerial = s->serial;
+    }
+
+    // 下混矩阵按行归一化、变速的交叉淡化是凸组合、音量在回调中由 GainControl 处理，都不会超出满幅；
+    // 只有 float 解码输出（或重采样滤波的过冲）可能超出 [-1, 1]。响度归一化的限幅器已经把峰值压在
+    // 满幅以下，不需要再检查；否则先求峰值，整段超出满幅时才软削波，满幅以内的样本保持原样
+    size_t samples = frames * audioOutChannels;
+    if (!loudnessActive) {
+        t0 = av_gettime_relative();
+        if (audioDsp.peak(stretched.data(), samples) > 1.0f) {
+            stats.softClippedSamples += audioDsp.softClip(stretched.data(), samples);
+        }
+        stats.softClipUs += av_gettime_relative() - t0;
+        stats.softClipSamples += samples;
+    }
+
+    size_t offset = pendingPcm.size();
+    if (audioOutFloat) {
+        pendingPcm.resize(offset + samples * sizeof(float));
+        memcpy(pendingPcm.data() + offset, stretched.data(), samples * sizeof(float));
+        return;
+    }
+    pendingPcm.resize(offset + samples * sizeof(int16_t));
+    t0 = av_gettime_relative();
+    audioDsp.floatToS16(stretched.data(), reinterpret_cast<int16_t *>(pendingPcm.data() + offset), samples);
+    stats.s16Us += av_gettime_relative() - t0;
+    stats.s16Samples += samples;
+}
+
+int64_t Player::convertVideo() {
+    if (convertItem == nullptr) return Stage::kIdle;
+
+    if (pendingImage != nullptr) {
+        if (!readyQ.tryPush(pendingImage)) return Stage::kIdle;
+        pendingImage = nullptr;
+        videoRendering->wake();
+        return Stage::kProgress;
+    }
+
+    AVFrame *frame = nullptr;
+    bool filtered = false;
+    if (!nextVideoFrame(convertItem.get(), frame, filtered)) return Stage::kIdle;
+    if (frame == nullptr) return Stage::kProgress;
+    auto s = convertItem.get();
+
+    // 滤镜（crop、transpose 等）可能改变画面尺寸，输出尺寸跟随滤镜的输出。
+    // 解码器使用 lowres 时帧尺寸是缩小后的，换算回原尺寸
+    int w = filtered ? frame->width << decoderLowres : codedWidth;
+    int h = filtered ? frame->height << decoderLowres : codedHeight;
+    AVRational sar = frame->sample_aspect_ratio.num > 0 ? frame->sample_aspect_ratio : streamSar;
+    if (w != videoWidth || h != videoHeight || av_cmp_q(sar, videoSar) != 0) {
+        videoWidth = w;
+        videoHeight = h;
+        videoSar = sar;
+        configureOutput();
+    }
+    refreshOutput();
+    // 转换结果直接写进单步缓存，显示阶段与缓存共享同一块内存，之后单步回退时不需要重新解码
+    auto image = frameRing.insert(frame->pts);
+    if (image == nullptr) {
+        av_frame_free(&frame);
+        return Stage::kProgress;
+    }
+    convertFrame(frame, image.get());
+    // 快速浏览时相邻的两帧之间有被跳过的帧，不能用于单步
+    if (!trickPlay) frameRing.link(lastConvertedPts, frame->pts);
+
+    // 转换耗时超过帧间隔一半时降低缩放质量，降到四分之一以下再恢复。
+    // 快速浏览时帧之间隔着被跳过的帧，按 pts 差值计算间隔
+    double duration = frame->pkt_duration * av_q2d(s->videoTimeBase);
+    if (lastConvertedPts != AV_NOPTS_VALUE && frame->pts != AV_NOPTS_VALUE &&
+        frame->pts > lastConvertedPts) {
+        duration = (frame->pts - lastConvertedPts) * av_q2d(s->videoTimeBase);
+    }
+    auto interval = static_cast<int64_t>(duration * 1000000 / m_speed);
+    if (!fastScale && interval > 0 && convertCostUs > interval / 2) {
+        fastScale = true;
+    } else if (fastScale && convertCostUs < interval / 4) {
+        fastScale = false;
+    }
+
+    lastConvertedPts = frame->pts;
+    pendingImage = new ReadyImage{image, frame->pts, frame->pkt_duration,
+                                  outWidth, outHeight, outFormat,
+                                  convertSwitched ? convertItem : nullptr};
+    convertSwitched = false;
+    av_frame_free(&frame);
+    return Stage::kProgress;
+}
+
+void Player::switchConvertItem() {
+    auto next = convertItem->next();
+    if (next == nullptr) return;
+    LOGI(LOGTAG, "convert %s", next->path.c_str());
+    convertItem = next;
+    applyVideoParams(*next);
+    // 滤镜中缓存的上一项的帧丢弃，单步缓存中的画面与新条目的 pts 不能混在一起
+    videoFilter.reset();
+    frameRing.clear();
+    lastConvertedPts = AV_NOPTS_VALUE;
+    convertSwitched = true;
+}
+
+void Player::applyVideoParams(const PlaybackSession &item) {
+    displayRotation = item.rotation;
+    streamSar = videoSar = item.sar;
+    decoderLowres = item.lowres;
+    hdrPeakNits = item.hdrPeakNits;
+    preferredFormat = item.preferredFormat;
+    codedWidth = videoWidth = item.codedWidth;
+    codedHeight = videoHeight = item.codedHeight;
+    configureOutput();
+}
+
+bool Player::nextVideoFrame(const PlaybackSession *s, AVFrame *&frame, bool &filtered) {
+    filtered = false;
+    if (videoFilter.enabled()) {
+        // 先取滤镜已有的输出（如 yadif=1 一帧输入产生两帧输出）
+        frame = av_frame_alloc();
+        if (videoFilter.receive(frame)) {
+            filtered = true;
+            return true;
+        }
+        av_frame_free(&frame);
+    }
+    if (convertEnded) {
+        // 滤镜冲出的帧已经取完，等解复用阶段链接了下一项再切换
+        if (convertItem->next() == nullptr) return false;
+        convertEnded = false;
+        switchConvertItem();
+        return true;
+    }
+    if (!videoFrameQ.tryPop(frame)) return false;
+    videoDecoding->wake();
+    if (frame == nullptr) {
+        // 这一项的帧已经全部取出。滤镜（如 yadif）中还缓存着最后几帧，送入空帧让它们输出
+        convertEnded = true;
+        if (videoFilter.enabled()) videoFilter.flush();
+        return true;
+    }
+    LOGD(LOGTAG, "从 videoFrameQ 获取到一个 frame: pts=%ld, width: %d, height: %d",
+         frame->pts, frame->width, frame->height);
+    if (videoFilter.enabled() && videoFilter.send(frame, s->videoTimeBase)) {
+        // 数据引用已经交给滤镜，输出在下一轮取
+        av_frame_free(&frame);
+    }
+    return true;
+}
+
+int64_t Player::renderVideo() {
+    auto s = std::atomic_load(&session);
+    if (s == nullptr) return Stage::kIdle;
+    float speed = m_speed;
+
+    ReadyImage *image = heldImage;
+    heldImage = nullptr;
+    if (image == nullptr) {
+        if (!readyQ.tryPop(image)) return Stage::kIdle;
+        videoConverting->wake();
+        stats.presentedImages++;
+        stats.readyAheadSum += readyQ.size();
+    }
+    if (image->item != nullptr && image->item != s) {
+        // 播放列表下一项的第一帧，等上一项的音频播放完再切换。暂停时与 readyQ 一样不再显示
+        int64_t wait = paused ? 0 : itemSwitchDelay(s.get(), image);
+        if (paused || wait > 0) {
+            heldImage = image;
+            if (paused) heldSince = 0;
+            return paused ? Stage::kIdle : wait;
+        }
+        switchItem(image->item);
+        s = image->item;
+    }
+
+    AVRational timebase = s->videoTimeBase;
+    double pts = image->pts * static_cast<double>(timebase.num) / timebase.den; // in seconds
+    double position = looping ? loopPosition(pts) : pts;
+
+    // 画面已经在 videoConverting 中转换好，这里只锁定窗口、复制、提交
+    int64_t t0 = av_gettime_relative();
+    showImage(image->data.get(), image->width, image->height, image->format);
+    lastPresentTime = av_gettime_relative();
+    stats.presentUs += lastPresentTime - t0;
+    shownPts = image->pts;
+    currPosition = position;
+    stats.renderedVideoFrames++;
+
+    // 根据每一帧的 duration 延时后再渲染下一帧
+    double duration = image->duration * av_q2d(timebase);
+    if (trickPlay && image->pts != AV_NOPTS_VALUE) {
+        // 快速浏览时相邻两帧之间隔着若干被跳过的帧，按 pts 差值计算间隔
+        int64_t now = av_gettime_relative();
+        if (trickStartPts == AV_NOPTS_VALUE) {
+            trickStartPts = image->pts;
+            trickStartTime = now;
+        } else if (now > trickStartTime) {
+            stats.trickEffectiveSpeed = (image->pts - trickStartPts) * av_q2d(timebase) * 1000000 /
+                                        (now - trickStartTime);
+        }
+        if (lastRenderPts != AV_NOPTS_VALUE && image->pts > lastRenderPts) {
+            duration = (image->pts - lastRenderPts) * av_q2d(timebase);
+        }
+        lastRenderPts = image->pts;
+    }
+    auto delay = static_cast<int64_t>(duration * 1000000 / speed);
+    // 有音频时以音频时钟为准：下一帧在音频播放到这一帧结束时显示。等待时间限制在两帧以内，
+    // 画面落后时立即显示下一帧
+    double clock = trickPlay ? NAN : audioClock(s.get());
+    if (!std::isnan(clock) && image->pts != AV_NOPTS_VALUE) {
+        double diff = pts - clock;
+        stats.avSyncDiff = diff;
+        if (std::fabs(diff) < AV_SYNC_MAX_DIFF) {
+            double wait = (diff + duration) / speed;
+            wait = std::min(std::max(wait, 0.0), 2 * duration / speed);
+            delay = static_cast<int64_t>(wait * 1000000);
+            stats.audioClockedFrames++;
+        }
+    }
+    lastPresentUs = delay;
+    delete image;
+    return delay > 0 ? delay : Stage::kProgress;
+}
+
+int64_t Player::itemSwitchDelay(const PlaybackSession *shown, const ReadyImage *image) {
+    int64_t now = av_gettime_relative();
+    if (heldSince == 0) heldSince = now;
+    // 音频阶段出错或者暂停太久时不再等待
+    if (now - heldSince > static_cast<int64_t>(AV_SYNC_MAX_DIFF * 1000000)) {
+        heldSince = 0;
+        return 0;
+    }
+    int64_t wait = 0;
+    if (!trickPlay && !std::isnan(audioClock(shown))) {
+        // 环形缓冲区中最新的数据还是上一项的
+        wait = ITEM_SWITCH_POLL_US;
+    } else if (!trickPlay && image->pts != AV_NOPTS_VALUE) {
+        // 新条目的音频已经写入，但前面还有上一项的结尾没有播放
+        double clock = audioClock(image->item.get());
+        double diff = image->pts * av_q2d(image->item->videoTimeBase) - clock;
+        if (!std::isnan(clock) && diff > 0 && diff < AV_SYNC_MAX_DIFF) {
+            wait = std::min<int64_t>(static_cast<int64_t>(diff * 1000000 / m_speed), ITEM_SWITCH_POLL_US);
+        }
+    }
+    if (wait == 0) heldSince = 0;
+    return wait;
+}
+
+double Player::loopPosition(double t) {
+    double span = loopEnd - loopStart;
+    if (span <= 0 || t < loopStart) return t;
+    int pass = static_cast<int>(std::floor((t - loopStart) / span));
+    if (pass > loopShownPass) {
+        // 回到 A 的第一帧比上一遍最后一帧的预定结束时刻晚了多少
+        if (lastPresentTime > 0) {
+            int64_t gap = av_gettime_relative() - lastPresentTime - lastPresentUs;
+            stats.loopGapUs = gap;
+            int64_t peak = stats.loopGapMaxUs;
+            if (gap > peak) stats.loopGapMaxUs = gap;
+        }
+        stats.loopPasses++;
+        loopShownPass = pass;
+    }
+    return t - pass * span;
+}
+
+void Player::switchItem(const std::shared_ptr<PlaybackSession> &item) {
+    // 第一帧比上一项最后一帧的预定结束时刻晚了多少
+    int64_t now = av_gettime_relative();
+    if (lastPresentTime > 0) {
+        int64_t gap = now - lastPresentTime - lastPresentUs;
+        stats.switchGapUs = gap;
+        int64_t peak = stats.switchGapMaxUs;
+        if (gap > peak) stats.switchGapMaxUs = gap;
+    }
+    stats.switchSilenceFrames += stats.audioSilenceFrames - switchSilenceBase;
+    stats.playlistSwitches++;
+    LOGI(LOGTAG, "switch to %s", item->path.c_str());
+    // 上一项不再使用，交给 preloading 关闭文件和解码器
+    auto old = std::atomic_load(&session);
+    std::atomic_store(&session, item);
+    shownItem++;
+    trickStartPts = lastRenderPts = AV_NOPTS_VALUE;
+    {
+        std::lock_guard<std::mutex> lck(playlistMtx);
+        retired.push_back(std::move(old));
+    }
+    preloading->wake();
+}
+
+bool Player::showImage(const uint8_t *data, int width, int height, RenderFormat format) {
+    // 窗口已经退回 RGBA，之前按 YV12 转换的画面无法显示，等转换阶段改用 RGBA
+    if (format == RenderFormat::YV12 && videoRender.fallbacks() > 0) return false;
+    if (!videoRender.matches(width, height, format)) {
+        videoRender.setBuffers(width, height, format);
+        if (!videoRender.matches(width, height, format)) return false;
+    }
+    videoRender.setDataSpace(format == RenderFormat::YV12 ? outDataSpace.load() : ADATASPACE_UNKNOWN);
+    if (videoRender.render(data) != 0) return false;
+    stats.renderedBytes += videoRender.frameBytes();
+    return true;
+}
+
+void Player::presentFrame(const AVFrame *frame) {
+    refreshOutput();
+    // 倒放和单步直接在当前线程转换并显示，同样写进单步缓存
+    auto image = frameRing.insert(frame->pts);
+    if (image == nullptr) {
+        // 放不进缓存（预算小于一帧或分配失败）时仍然显示，之后单步到这一帧需要重新解码
+        stats.stepCacheFailures++;
+        LOGW(LOGTAG, "step cache insert failed, pts %lld", static_cast<long long>(frame->pts));
+        size_t bytes = ANWRender::frameBytes(outWidth, outHeight, outFormat);
+        std::unique_ptr<uint8_t[]> buf(new (std::nothrow) uint8_t[bytes]);
+        if (buf == nullptr) return;
+        convertFrame(frame, buf.get());
+        showImage(buf.get(), outWidth, outHeight, outFormat);
+        shownPts = frame->pts;
+        return;
+    }
+    convertFrame(frame, image.get());
+    showImage(image.get(), outWidth, outHeight, outFormat);
+    shownPts = frame->pts;
+}
+
+// 常见的 YUV 4:2:0 格式可以不经过 swscale，直接转换或复制，其他格式返回 false
+static bool chromaLayoutOf(int format, ChromaLayout &layout) {
+    switch (format) {
+        case AV_PIX_FMT_YUV420P:
+        case AV_PIX_FMT_YUVJ420P:
+            layout = ChromaLayout::Planar;
+            return true;
+        case AV_PIX_FMT_NV12:
+            layout = ChromaLayout::NV12;
+            return true;
+        case AV_PIX_FMT_NV21:
+            layout = ChromaLayout::NV21;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool toYuvImage(const AVFrame *frame, YuvImage &img) {
+    img = YuvImage{frame->data[0], frame->data[1], frame->data[2],
+                   frame->linesize[0], frame->linesize[1], frame->width, frame->height,
+                   ChromaLayout::Planar};
+    return chromaLayoutOf(frame->format, img.layout);
+}
+
+static void scaleWithSws(SwsContext *&swsCtx, int flags, const AVFrame *frame,
+                         int dstWidth, int dstHeight, AVPixelFormat dstFmt,
+                         uint8_t *const dstData[4], const int dstLineSize[4]) {
+    // 参数不变时 sws_getCachedContext 直接返回原来的上下文
+    swsCtx = sws_getCachedContext(swsCtx,
+    frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+    dstWidth, dstHeight, dstFmt,
+    flags, nullptr, nullptr, nullptr);
+    if (swsCtx == nullptr) return;
+    sws_scale(swsCtx, frame->data, frame->linesize, 0, frame->height,
+        dstData, dstLineSize);
+}
+
+// 10 位 4:2:0 格式（HEVC/AV1 的 HDR10、HLG 以及 10 位 SDR）转换前先映射到 8 位
+static bool toYuv10Image(const AVFrame *frame, Yuv10Image &img) {
+    bool p010 = frame->format == AV_PIX_FMT_P010LE;
+    if (!p010 && frame->format != AV_PIX_FMT_YUV420P10LE) return false;
+    img = Yuv10Image{reinterpret_cast<const uint16_t *>(frame->data[0]),
+                     reinterpret_cast<const uint16_t *>(frame->data[1]),
+                     p010 ? nullptr : reinterpret_cast<const uint16_t *>(frame->data[2]),
+                     frame->linesize[0] / 2, frame->linesize[1] / 2, frame->width, frame->height,
+                     p010 ? 6 : 0, p010};
+    return true;
+}
+
+static bool isTenBit(int format) {
+    return format == AV_PIX_FMT_P010LE || format == AV_PIX_FMT_YUV420P10LE;
+}
+
+// 内容峰值亮度：优先用 MaxCLL，没有时用母版显示器的最大亮度，都没有返回 0
+static double peakNitsOf(const AVContentLightMetadata *light,
+                         const AVMasteringDisplayMetadata *mastering) {
+    double peak = light != nullptr ? light->MaxCLL : 0;
+    if (peak <= 0 && mastering != nullptr && mastering->has_luminance) {
+        peak = av_q2d(mastering->max_luminance);
+    }
+    return peak;
+}
+
+static Yuv8Planes planesAt(const Yuv8Planes &p, int row) {
+    return Yuv8Planes{p.y + static_cast<ptrdiff_t>(row) * p.yStride,
+                      p.u + static_cast<ptrdiff_t>(row / 2) * p.uvStride,
+                      p.v + static_cast<ptrdiff_t>(row / 2) * p.uvStride,
+                      p.yStride, p.uvStride};
+}
+
+int Player::sliceCount(int width, int height) {
+    int slices = convertSlices;
+    if (slices == 0) {
+        slices = std::min<int>(WorkerPool::shared()->threadCount(), width * height / SLICE_MIN_PIXELS);
+        slices = std::min(std::max(slices, 1), MAX_CONVERT_SLICES);
+    }
+    return slices;
+}
+
+void Player::configureToneMap(const AVFrame *frame) {
+    HdrTransfer transfer = HdrTransfer::SDR;
+    if (frame->color_trc == AVCOL_TRC_SMPTE2084) {
+        transfer = HdrTransfer::PQ;
+    } else if (frame->color_trc == AVCOL_TRC_ARIB_STD_B67) {
+        transfer = HdrTransfer::HLG;
+    }
+    // 亮度元数据一般只附在关键帧上，没有时沿用之前的值
+    auto light = av_frame_get_side_data(frame, AV_FRAME_DATA_CONTENT_LIGHT_LEVEL);
+    auto mastering = av_frame_get_side_data(frame, AV_FRAME_DATA_MASTERING_DISPLAY_METADATA);
+    double peak = peakNitsOf(
+            light ? reinterpret_cast<const AVContentLightMetadata *>(light->data) : nullptr,
+            mastering ? reinterpret_cast<const AVMasteringDisplayMetadata *>(mastering->data) : nullptr);
+    if (peak > 0) hdrPeakNits = peak;
+    if (toneMapper.configure(transfer, hdrPeakNits, frame->color_range == AVCOL_RANGE_JPEG)) {
+        LOGI(LOGTAG, "tone map transfer %d, peak %.0f nits", static_cast<int>(transfer),
+             toneMapper.peakNits());
+        stats.toneMapPeakNits = toneMapper.peakNits();
+    }
+}
+
+const AVFrame * Player::toneMapToFrame(const AVFrame *frame, const Yuv10Image &src) {
+    if (toneFrame == nullptr || toneFrame->width != frame->width ||
+        toneFrame->height != frame->height) {
+        av_frame_free(&toneFrame);
+        toneFrame = av_frame_alloc();
+        toneFrame->format = AV_PIX_FMT_YUV420P;
+        toneFrame->width = frame->width;
+        toneFrame->height = frame->height;
+        if (av_frame_get_buffer(toneFrame, 0) < 0) {
+            av_frame_free(&toneFrame);
+            return nullptr;
+        }
+    }
+    toneFrame->colorspace = frame->colorspace;
+    toneFrame->color_range = AVCOL_RANGE_MPEG;
+    Yuv8Planes planes{toneFrame->data[0], toneFrame->data[1], toneFrame->data[2],
+                      toneFrame->linesize[0], toneFrame->linesize[1]};
+    int slices = sliceCount(src.width, src.height);
+    int band = ((src.height + slices - 1) / slices + 1) & ~1;
+    WorkerPool::shared()->parallelFor(slices, [&](int i) {
+        if (i * band >= src.height) return;
+        toneMapper.convertRows(src, planesAt(planes, i * band), i * band, (i + 1) * band);
+    }, CoreClass::Big);
+    return toneFrame;
+}
+
+void Player::toneMapToRgba(const Yuv10Image &src, uint8_t *out, int rowBegin, int rowEnd,
+                           int slice, bool toBt709) {
+    int w = src.width;
+    int cw = (w + 1) / 2;
+    uint8_t *scratch = toneScratch.data() + static_cast<size_t>(slice) * (2 * w + 2 * cw);
+    Yuv8Planes rows{scratch, scratch + 2 * w, scratch + 2 * w + cw, w, cw};
+    YuvImage pair{scratch, scratch + 2 * w, scratch + 2 * w + cw, w, cw, w, 2, ChromaLayout::Planar};
+    rowEnd = std::min(rowEnd, src.height);
+    for (int row = rowBegin; row < rowEnd; row += 2) {
+        // 映射结果还在缓存里就转换成 RGBA，不需要整帧的中间缓冲区
+        pair.height = std::min(2, rowEnd - row);
+        toneMapper.convertRows(src, rows, row, row + pair.height);
+        uint8_t *rgba = out + static_cast<size_t>(row) * w * 4;
+        yuvConverter.convertRows(pair, rgba, w * 4, 0, pair.height);
+        if (toBt709) toneMapper.toBt709(rgba, w * pair.height);
+    }
+}
+
+const AVFrame * Player::scaleToFrame(const AVFrame *frame, int width, int height, int flags) {
+    if (scaledFrame == nullptr || scaledFrame->width != width || scaledFrame->height != height) {
+        av_frame_free(&scaledFrame);
+        scaledFrame = av_frame_alloc();
+        scaledFrame->format = AV_PIX_FMT_YUV420P;
+        scaledFrame->width = width;
+        scaledFrame->height = height;
+        if (av_frame_get_buffer(scaledFrame, 0) < 0) {
+            av_frame_free(&scaledFrame);
+            return nullptr;
+        }
+    }
+    scaleWithSws(scaleCtx, flags, frame, width, height, AV_PIX_FMT_YUV420P,
+                 scaledFrame->data, scaledFrame->linesize);
+    // swscale 把 YUVJ420P 转成 limited range，其他格式保持原来的范围
+    scaledFrame->colorspace = frame->colorspace;
+    scaledFrame->color_range = frame->format == AV_PIX_FMT_YUVJ420P ? AVCOL_RANGE_MPEG :
+                               frame->color_range;
+    return scaledFrame;
+}
+
+void Player::convertFrame(const AVFrame *frame, uint8_t *out) {
+    int w = outWidth;
+    int h = outHeight;
+    // 输出尺寸是旋转后的，帧与旋转前的尺寸比较
+    Rotation rotation = displayRotation;
+    bool rotated = rotation != Rotation::None;
+    bool transposed = rotation == Rotation::Cw90 || rotation == Rotation::Cw270;
+    int srcW = transposed ? h : w;
+    int srcH = transposed ? w : h;
+    int64_t t0 = av_gettime_relative();
+    // 没有标注色彩空间时按分辨率推断，高清内容一般是 BT.709。按原始帧判断，不受中间缩放影响
+    YuvMatrix matrix = YuvMatrix::BT601;
+    if (frame->colorspace == AVCOL_SPC_BT2020_NCL || frame->colorspace == AVCOL_SPC_BT2020_CL) {
+        matrix = YuvMatrix::BT2020;
+    } else if (frame->colorspace == AVCOL_SPC_BT709 ||
+               (frame->colorspace == AVCOL_SPC_UNSPECIFIED && frame->height >= 720)) {
+        matrix = YuvMatrix::BT709;
+    }
+    // BT.2020 原色的内容：RGBA 输出在线性光下换算成 BT.709，YV12 输出由窗口的 dataspace 标明
+    bool wideGamut = frame->color_primaries == AVCOL_PRI_BT2020;
+    int flags = fastScale ? SWS_FAST_BILINEAR : SWS_BICUBIC;
+    // 10 位内容先映射到 8 位。尺寸相同时映射结果直接写进输出缓冲区（YV12）或者每两行交给
+    // RGBA 转换；需要缩放或旋转时先映射成 8 位 YUV420P，再和其他格式一样处理
+    Yuv10Image hdr{};
+    bool toneMapped = toYuv10Image(frame, hdr);
+    bool tenBit = toneMapped;
+    if (tenBit) {
+        configureToneMap(frame);
+        if (frame->width != srcW || frame->height != srcH || rotated) {
+            frame = toneMapToFrame(frame, hdr);
+            if (frame == nullptr) return;
+            tenBit = false;
+        }
+    }
+    // 解码尺寸与输出尺寸不同（Surface 较小，或倒放缓存中的帧被缩小过，或像素不是方形）时
+    // 交给 swscale，转换跟不上时用快速双线性代替双三次
+    YuvImage img{};
+    bool direct = frame->width == srcW && frame->height == srcH && (tenBit || toYuvImage(frame, img));
+    if (!direct && fastScale) stats.fastScaleFrames++;
+    if (!direct && rotated) {
+        // swscale 不能旋转：先缩放成旋转前尺寸的 YUV420P，旋转留给下面的转换一起做，
+        // 比缩放成 RGBA 后再单独旋转少一遍整帧 RGBA 的读写
+        frame = scaleToFrame(frame, srcW, srcH, flags);
+        if (frame == nullptr) return;
+        direct = toYuvImage(frame, img);
+        stats.rotateScaledFrames++;
+    }
+    // 大尺寸画面按输出的行分片，在调用线程和工作线程上并行处理，直接写入目标缓冲区
+    auto pool = WorkerPool::shared();
+    int slices = sliceCount(w, h);
+    int band = ((h + slices - 1) / slices + 1) & ~1;
+    int64_t t1 = av_gettime_relative();
+
+    outDataSpace = outFormat == RenderFormat::YV12 && wideGamut ? YV12_BT2020_DATASPACE : ADATASPACE_UNKNOWN;
+    if (outFormat == RenderFormat::YV12) {
+        // 窗口直接显示 YUV，只需要按 YV12 排列平面
+        Yv12Layout layout = yv12PackedLayout(w, h);
+        if (tenBit) {
+            Yuv8Planes planes{out, out + layout.cbOffset, out + layout.crOffset,
+                              layout.yStride, layout.cStride};
+            pool->parallelFor(slices, [&](int i) {
+                if (i * band >= h) return;
+                toneMapper.convertRows(hdr, planesAt(planes, i * band), i * band, (i + 1) * band);
+            }, CoreClass::Big);
+        } else if (direct && rotated) {
+            pool->parallelFor(slices, [&](int i) {
+                if (i * band >= h) return;
+                rotateToYv12(img, out, layout, rotation, i * band, (i + 1) * band);
+            }, CoreClass::Big);
+            stats.yuvDirectFrames++;
+        } else if (direct) {
+            copyToYv12(img, out, layout);
+            stats.yuvDirectFrames++;
+        } else {
+            uint8_t *dstData[4] = {out, out + layout.cbOffset, out + layout.crOffset, nullptr};
+            int dstLineSize[4] = {layout.yStride, layout.cStride, layout.cStride, 0};
+            scaleWithSws(scaleCtx, flags, frame, w, h, AV_PIX_FMT_YUV420P, dstData, dstLineSize);
+            stats.swsConvertedFrames++;
+        }
+    } else if (direct) {
+        // 色调映射的输出总是 limited range
+        bool fullRange = !tenBit && (frame->color_range == AVCOL_RANGE_JPEG ||
+                                     frame->format == AV_PIX_FMT_YUVJ420P);
+        yuvConverter.setColor(matrix, fullRange);
+        if (tenBit) toneScratch.resize(static_cast<size_t>(slices) * (2 * w + 2 * ((w + 1) / 2)));
+        pool->parallelFor(slices, [&](int i) {
+            if (tenBit) {
+                toneMapToRgba(hdr, out, i * band, (i + 1) * band, i, wideGamut);
+            } else {
+                // 旋转在转换的同时完成，不经过整帧的中间缓冲区
+                yuvConverter.convertRotated(img, out, w * 4, rotation, i * band, (i + 1) * band);
+                if (wideGamut && i * band < h) {
+                    int rows = std::min(band, h - i * band);
+                    toneMapper.toBt709(out + static_cast<size_t>(i) * band * w * 4, w * rows);
+                }
+            }
+        }, CoreClass::Big);
+        lastSlices = slices;
+        stats.slicedPixels[slices] += static_cast<uint64_t>(w) * h;
+        stats.slicedUs[slices] += av_gettime_relative() - t0;
+        stats.simdConvertedFrames++;
+    } else {
+        // SRC_PIX_FMT 转 RGBA
+        uint8_t *dstData[4] = {out, nullptr, nullptr, nullptr};
+        int dstLineSize[4] = {w * 4, 0, 0, 0};
+        scaleWithSws(scaleCtx, flags, frame, w, h, AV_PIX_FMT_RGBA, dstData, dstLineSize);
+        if (wideGamut) {
+            pool->parallelFor(slices, [&](int i) {
+                if (i * band >= h) return;
+                int rows = std::min(band, h - i * band);
+                toneMapper.toBt709(out + static_cast<size_t>(i) * band * w * 4, w * rows);
+            }, CoreClass::Big);
+        }
+        stats.swsConvertedFrames++;
+    }
+    if (wideGamut && outFormat == RenderFormat::RGBA) stats.gamutMappedFrames++;
+    if (direct && !tenBit) {
+        // 只计同尺寸转换本身，不含之前的缩放和映射
+        uint64_t us = av_gettime_relative() - t1;
+        if (rotated) {
+            stats.rotatedFrames++;
+            stats.rotatedPixels += static_cast<uint64_t>(w) * h;
+            stats.rotatedUs += us;
+        } else {
+            stats.uprightPixels += static_cast<uint64_t>(w) * h;
+            stats.uprightUs += us;
+        }
+    }
+    int64_t cost = av_gettime_relative() - t0;
+    convertCostUs = (convertCostUs * 7 + cost) / 8;
+    stats.sourcePixels += static_cast<uint64_t>(frame->width) * frame->height;
+    stats.convertedPixels += static_cast<uint64_t>(w) * h;
+    stats.convertUs += cost;
+    if (toneMapped) {
+        stats.toneMappedFrames++;
+        stats.toneMapPixels += static_cast<uint64_t>(w) * h;
+        stats.toneMapUs += cost;
+    }
+}
+
+int64_t Player::decodeReverseGop() {
+    char errBuf[BUFF_SIZE]{};
+    auto s = std::atomic_load(&session);
+    if (s == nullptr || !reversePlay) return Stage::kIdle;
+    if (!gopRequested.load(std::memory_order_acquire)) return Stage::kIdle;
+    auto pVideoCodecCtx_ = s->videoCodecCtx;
+
+    if (!gopSeeked) {
+        // 跳到 gopEnd 之前最近的关键帧，从那里解码到 gopEnd 为止就是一个完整的 GOP
+        prefetchGop->clear();
+        prefetchGop->setBudget(reverseBudget / 2);
+        gopDecodeStart = av_gettime_relative();
+        gopSeeked = true;
+        int ret = avformat_seek_file(s->formatCtx, s->videoStreamId,
+                                     INT64_MIN, gopEnd - 1, gopEnd - 1, 0);
+        avcodec_flush_buffers(pVideoCodecCtx_);
+        if (ret < 0) {
+            // 已经没有更早的关键帧
+            finishReverseGop();
+        }
+        return Stage::kProgress;
+    }
+
+    AVFrame *frame = av_frame_alloc();
+    int ret = avcodec_receive_frame(pVideoCodecCtx_, frame);
+    if (ret == 0) {
+        int64_t pts = frame->best_effort_timestamp;
+        if (pts == AV_NOPTS_VALUE) pts = frame->pts;
+        // 解码器按显示顺序输出，遇到下一个 GOP 的帧说明这个 GOP 已经完整
+        if (pts != AV_NOPTS_VALUE && pts >= gopEnd) {
+            av_frame_free(&frame);
+            finishReverseGop();
+            return Stage::kProgress;
+        }
+        stats.decodedVideoFrames++;
+        frame->pts = pts;
+        if (prefetchGop->startPts == AV_NOPTS_VALUE) prefetchGop->startPts = pts;
+        prefetchGop->add(frame);
+        return Stage::kProgress;
+    }
+    av_frame_free(&frame);
+    if (ret != AVERROR(EAGAIN)) {
+        if (ret != AVERROR_EOF) {
+            av_strerror(ret, errBuf, sizeof(errBuf)-1);
+            LOGE(LOGTAG, "ffmpeg avcodec_receive_frame error: %s", errBuf);
+        }
+        finishReverseGop();
+        return Stage::kProgress;
+    }
+
+    AVPacket *pkt = av_packet_alloc();
+    ret = av_read_frame(s->formatCtx, pkt);
+    if (ret < 0) {
+        // 读到文件末尾，排空解码器
+        av_packet_free(&pkt);
+    } else if (pkt->stream_index != s->videoStreamId) {
+        av_packet_free(&pkt);
+        return Stage::kProgress;
+    }
+    ret = avcodec_send_packet(pVideoCodecCtx_, pkt);
+    av_packet_free(&pkt);
+    if (ret < 0 && ret != AVERROR_EOF) {
+        av_strerror(ret, errBuf, sizeof(errBuf)-1);
+        LOGE(LOGTAG, "ffmpeg avcodec_send_packet error: %s", errBuf);
+    }
+    return Stage::kProgress;
+}
+
+void Player::finishReverseGop() {
+    stats.reverseGops++;
+    stats.reverseGopDecodeUs += av_gettime_relative() - gopDecodeStart;
+    stats.reverseDownscaledFrames += prefetchGop->downscaledFrames;
+    stats.reverseDroppedFrames += prefetchGop->droppedFrames;
+    // 起点不早于 gopEnd 说明没有更早的 GOP 了
+    if (prefetchGop->startPts == AV_NOPTS_VALUE || prefetchGop->startPts >= gopEnd) {
+        prefetchGop->clear();
+        reverseEof = true;
+    }
+    gopSeeked = false;
+    gopRequested.store(false, std::memory_order_relaxed);
+    gopReady.store(true, std::memory_order_release);
+    reverseRendering->wake();
+}
+
+int64_t Player::renderReverse() {
+    auto s = std::atomic_load(&session);
+    if (s == nullptr || !reversePlay || paused) return Stage::kIdle;
+
+    if (shownGop->empty()) {
+        if (!gopReady.load(std::memory_order_acquire)) {
+            // 下一个 GOP 还没解码好，等 gopDecoding 完成后唤醒
+            if (!reverseWaiting && lastReversePts != AV_NOPTS_VALUE) stats.reverseStalls++;
+            reverseWaiting = true;
+            return Stage::kIdle;
+        }
+        reverseWaiting = false;
+        if (reverseEof) return Stage::kIdle; // 已经倒放到开头，停在第一帧
+        std::swap(shownGop, prefetchGop);
+        // 马上开始解码更早的 GOP，与显示当前 GOP 并行
+        gopEnd = shownGop->startPts;
+        gopReady.store(false, std::memory_order_relaxed);
+        gopRequested.store(true, std::memory_order_release);
+        gopDecoding->wake();
+        if (shownGop->empty()) return Stage::kProgress;
+    }
+
+    AVFrame *frame = shownGop->popLast();
+    int64_t laterPts = shownPts;
+    presentFrame(frame);
+    // 倒放时先显示的是后一帧；GOP 中有因预算丢掉的帧时不能确认相邻
+    if (shownGop->droppedFrames == 0) frameRing.link(frame->pts, laterPts);
+    AVRational timebase = s->videoTimeBase;
+    currPosition = frame->pts * av_q2d(timebase);
+    stats.renderedVideoFrames++;
+
+    // 按显示间隔延时，间隔未知时用相邻两帧的 pts 差
+    double duration = frame->pkt_duration * av_q2d(timebase);
+    if (duration <= 0 && lastReversePts != AV_NOPTS_VALUE && lastReversePts > frame->pts) {
+        duration = (lastReversePts - frame->pts) * av_q2d(timebase);
+    }
+    lastReversePts = frame->pts;
+    auto delay = static_cast<int64_t>(duration * 1000000 / m_speed);
+    av_frame_free(&frame);
+    return delay > 0 ? delay : Stage::kProgress;
+}
+
+int Player::stepForward() {
+    return requestStep(true);
+}
+
+int Player::stepBackward() {
+    return requestStep(false);
+}
+
+int Player::requestStep(bool forward) {
+    if (!isOpen) return -1;
+    pause();
+    postCommand({PlayerCommand::Step, forward, av_gettime_relative(), 0, 0, 0});
+    return 0;
+}
+
+void Player::postCommand(const PlayerCommand &cmd) {
+    {
+        std::lock_guard<std::mutex> lck(commandMtx);
+        if (cmd.type == PlayerCommand::Seek && !commands.empty() && commands.back().type == PlayerCommand::Seek) {
+            // 拖动进度条时连续的跳转只执行最后一次，延时从最早的请求算起。切换模式的重新
+            // 跳转（位置为 NAN）不覆盖排在前面的目标位置，只改为跳到前一个关键帧
+            PlayerCommand &last = commands.back();
+            if (!std::isnan(cmd.position)) last.position = cmd.position;
+            last.flags = cmd.flags;
+            stats.seeksCoalesced++;
+        } else {
+            commands.push_back(cmd);
+        }
+    }
+    controlling->wake();
+}
+
+int64_t Player::runCommand() {
+    PlayerCommand cmd{};
+    {
+        std::lock_guard<std::mutex> lck(commandMtx);
+        if (commands.empty()) return Stage::kIdle;
+        cmd = commands.front();
+        commands.pop_front();
+    }
+    switch (cmd.type) {
+        case PlayerCommand::Step: {
+            bool hit = false;
+            if (!step(cmd.forward, hit)) break;
+            // 耗时从请求时算起，包括排在前面的请求
+            int64_t cost = av_gettime_relative() - cmd.postTime;
+            if (hit) {
+                stats.stepHits++;
+                stats.stepHitUs += cost;
+            } else {
+                stats.stepMisses++;
+                stats.stepMissUs += cost;
+            }
+            break;
+        }
+        case PlayerCommand::Seek:
+            if (runSeek(cmd)) {
+                PlayerStats::addCall(stats.seeksDone, stats.seekDoneUs, stats.seekDoneMaxUs,
+                                     av_gettime_relative() - cmd.postTime);
+            } else {
+                stats.seekFailures++;
+            }
+            break;
+        case PlayerCommand::SetLoop:
+            if (!runSetLoop(cmd.position, cmd.end)) LOGW(LOGTAG, "set loop failed");
+            break;
+        case PlayerCommand::ClearLoop:
+            runClearLoop();
+            break;
+        case PlayerCommand::ClearPlaylist:
+            runClearPlaylist();
+            break;
+    }
+    return Stage::kProgress;
+}
+
+bool Player::step(bool forward, bool &hit) {
+    lock_guard lck(mtx);
+    auto s = std::atomic_load(&session);
+    // 请求之后已经 resume 或 stop 的不再执行
+    if (!isOpen || s == nullptr || !paused) return false;
+    // 停掉流水线，之后由当前阶段直接使用解码器，resume 时再从当前画面重新同步
+    if (!stepping) {
+        // 先设置 stepping 再确认仍然暂停，与 resume() 的顺序相反：resume() 没有看到 stepping 时
+        // 这里一定看到已经恢复播放，不会停下流水线后没有人重新启动
+        stepping = true;
+        if (!paused) {
+            stepping = false;
+            return false;
+        }
+        stopStages();
+        // 循环时画面的 pts 是排成连续的显示时间，单步按文件中的时间从当前位置重新解码
+        if (looping) {
+            shownPts = AV_NOPTS_VALUE;
+            frameRing.clear();
+        }
+    }
+    if (shownPts == AV_NOPTS_VALUE) {
+        // 跳转后还没有显示过画面，以跳转位置作为当前帧
+        shownPts = llround(currPosition / av_q2d(s->videoTimeBase));
+    }
+
+    int64_t pts = AV_NOPTS_VALUE;
+    const uint8_t *rgba = forward ? frameRing.after(shownPts, pts) : frameRing.before(shownPts, pts);
+    hit = rgba != nullptr;
+    if (hit) {
+        showImage(rgba, outWidth, outHeight, outFormat);
+        shownPts = pts;
+    } else if (!decodeStep(s.get(), forward)) {
+        stats.stepFailures++;
+        LOGW(LOGTAG, "step %s from pts %lld failed", forward ? "forward" : "backward",
+             static_cast<long long>(shownPts));
+        return false;
+    }
+    currPosition = shownPts * av_q2d(s->videoTimeBase);
+    return true;
+}
+
+bool Player::decodeStep(const PlaybackSession *s, bool forward) {
+    auto pVideoCodecCtx_ = s->videoCodecCtx;
+    int64_t cur = shownPts;
+    int64_t prevPts = AV_NOPTS_VALUE;
+    if (forward && stepDecoderPts == cur) {
+        // 解码器上一次单步停在当前帧之后，继续解码即可
+        prevPts = cur;
+    } else {
+        // 向前单步从当前帧所在的关键帧开始解码，向后单步从前一帧所在的关键帧开始
+        int64_t target = forward ? cur : cur - 1;
+        int ret = avformat_seek_file(s->formatCtx, s->videoStreamId, INT64_MIN, target, target, 0);
+        if (ret < 0) return false;
+        avcodec_flush_buffers(pVideoCodecCtx_);
+    }
+    stepDecoderPts = AV_NOPTS_VALUE;
+
+    // 向后单步时保留当前帧之前最近的若干帧，解码结束后一起放进画面缓存
+    std::deque<AVFrame *> tail;
+    bool done = false;
+    AVFrame *frame = av_frame_alloc();
+    AVPacket *pkt = av_packet_alloc();
+    while (!done) {
+        int ret = avcodec_receive_frame(pVideoCodecCtx_, frame);
+        if (ret == AVERROR(EAGAIN)) {
+            ret = av_read_frame(s->formatCtx, pkt);
+            if (ret < 0) {
+                avcodec_send_packet(pVideoCodecCtx_, nullptr);
+            } else if (pkt->stream_index == s->videoStreamId) {
+                avcodec_send_packet(pVideoCodecCtx_, pkt);
+            }
+            av_packet_unref(pkt);
+            continue;
+        }
+        if (ret < 0) break;
+
+        stats.decodedVideoFrames++;
+        int64_t pts = frame->best_effort_timestamp;
+        if (pts == AV_NOPTS_VALUE) pts = frame->pts;
+        frame->pts = pts;
+        if (forward) {
+            if (pts != AV_NOPTS_VALUE && pts > cur) {
+                presentFrame(frame);
+                frameRing.link(prevPts, pts);
+                stepDecoderPts = pts;
+                done = true;
+            }
+            prevPts = pts;
+        } else if (pts != AV_NOPTS_VALUE && pts >= cur) {
+            break;
+        } else {
+            tail.push_back(av_frame_clone(frame));
+            if (tail.size() > frameRing.capacity()) {
+                av_frame_free(&tail.front());
+                tail.pop_front();
+            }
+        }
+        av_frame_unref(frame);
+    }
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    if (forward) return done;
+
+    // 按显示顺序放进缓存并记录相邻关系，继续后退时可以直接命中
+    if (tail.empty()) return false;
+    prevPts = AV_NOPTS_VALUE;
+    for (auto &f : tail) {
+        auto image = frameRing.insert(f->pts);
+        if (image != nullptr) convertFrame(f, image.get());
+        frameRing.link(prevPts, f->pts);
+        prevPts = f->pts;
+        av_frame_free(&f);
+    }
+    frameRing.link(prevPts, cur);
+    const uint8_t *rgba = frameRing.find(prevPts);
+    if (rgba == nullptr) return false;
+    showImage(rgba, outWidth, outHeight, outFormat);
+    shownPts = prevPts;
+    return true;
+}
+
+double Player::getDuration() {
+    // 播放列表切换后是新条目的时长
+    auto s = std::atomic_load(&session);
+    if (s == nullptr) return 0.0;
+    return static_cast<double>(s->formatCtx->duration) / AV_TIME_BASE;
+}
+
+double Player::getPosition() const {
+    return currPosition;
+}
+
+// 统计项按 "名称=值" 每行一项输出
+static void appendStat(std::string &out, const char *name, uint64_t value) {
+    char line[BUFF_SIZE];
+    snprintf(line, sizeof(line), "%s=%llu\n", name, (unsigned long long) value);
+    out += line;
+}
+
+static void appendStat(std::string &out, const char *name, double value) {
+    char line[BUFF_SIZE];
+    snprintf(line, sizeof(line), "%s=%.3f\n", name, value);
+    out += line;
+}
+
+static void appendStat(std::string &out, const char *name, const char *value) {
+    out += name;
+    out += "=";
+    out += value;
+    out += "\n";
+}
+
+std::string Player::dumpStats() {
+    std::string out;
+    double elapsed = openTime ? (av_gettime() - openTime) / 1000000.0 : 0.0;
+    uint64_t rendered = stats.renderedVideoFrames;
+
+    // 整个进程自打开以来的 CPU 占用（100% 表示占满一个核）和上下文切换频率
+    struct rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    auto cpuSeconds = [](const struct rusage &u) {
+        return u.ru_utime.tv_sec + u.ru_stime.tv_sec +
+               (u.ru_utime.tv_usec + u.ru_stime.tv_usec) / 1000000.0;
+    };
+    double cpu = cpuSeconds(usage) - cpuSeconds(openUsage);
+    long ctxSwitches = (usage.ru_nvcsw - openUsage.ru_nvcsw) + (usage.ru_nivcsw - openUsage.ru_nivcsw);
+
+    double audioSeconds = audioOutRate > 0 ?
+            static_cast<double>(stats.tempoOutputFrames) / audioOutRate : 0.0;
+
+    auto pool = WorkerPool::shared();
+    appendStat(out, "playerLockAcquired", mtx.acquisitions());
+    appendStat(out, "playerLockContended", mtx.contentions());
+    appendStat(out, "poolThreads", static_cast<uint64_t>(pool->threadCount()));
+    appendStat(out, "poolSteals", pool->stealCount());
+    appendStat(out, "poolParks", pool->parkCount());
+    appendStat(out, "cpuPercent", elapsed > 0 ? cpu * 100 / elapsed : 0.0);
+    appendStat(out, "ctxSwitchesPerSec", elapsed > 0 ? ctxSwitches / elapsed : 0.0);
+    appendStat(out, "demuxedPackets", stats.demuxedPackets.load());
+    appendStat(out, "decodedVideoFrames", stats.decodedVideoFrames.load());
+    appendStat(out, "renderedVideoFrames", rendered);
+    appendStat(out, "decodedAudioFrames", stats.decodedAudioFrames.load());
+    appendStat(out, "tempoCpuMsPerAudioSec",
+               audioSeconds > 0 ? stats.tempoProcessUs / 1000.0 / audioSeconds : 0.0);
+    // 码流与设备的采样率相同时不需要重采样，比较 44.1k 和 48k 片源的重采样开销和延迟
+    auto shown = std::atomic_load(&session);
+    appendStat(out, "audioSourceRate", static_cast<uint64_t>(shown ? shown->audioCodecCtx->sample_rate : 0));
+    appendStat(out, "audioDeviceRate", static_cast<uint64_t>(audioRender.sampleRate()));
+    appendStat(out, "audioDeviceChannels", static_cast<uint64_t>(audioRender.channelCount()));
+    appendStat(out, "audioDeviceFormat",
+               audioRender.format() == AAUDIO_FORMAT_PCM_FLOAT ? "float" : "s16");
+    appendStat(out, "audioReopens", static_cast<uint64_t>(audioRender.reopens()));
+    appendStat(out, "resampleCpuMsPerAudioSec",
+               audioSeconds > 0 ? stats.resampleUs / 1000.0 / audioSeconds : 0.0);
+    // AudioDsp 各运算的吞吐量（百万样本/秒，下混按输入样本计）
+    uint64_t mixedFrames = stats.downmixFrames, clipSamples = stats.softClipSamples;
+    uint64_t s16Samples = stats.s16Samples;
+    appendStat(out, "audioDspLevel", YuvConverter::levelName(audioDsp.level()));
+    appendStat(out, "volume", static_cast<double>(outputGain.target()));
+    int mixChannels = isOpen ? downmixChannels.load() : 0;
+    appendStat(out, "downmixChannels", static_cast<uint64_t>(mixChannels));
+    appendStat(out, "downmixFrames", mixedFrames);
+    appendStat(out, "downmixMsamplesPerSec",
+               stats.downmixUs ? mixedFrames * mixChannels / static_cast<double>(stats.downmixUs) : 0.0);
+    appendStat(out, "softClipMsamplesPerSec",
+               stats.softClipUs ? clipSamples / static_cast<double>(stats.softClipUs) : 0.0);
+    appendStat(out, "softClippedSamples", stats.softClippedSamples.load());
+    appendStat(out, "s16ConvertMsamplesPerSec",
+               stats.s16Us ? s16Samples / static_cast<double>(stats.s16Us) : 0.0);
+    // 响度归一化：元数据或实时估计的响度、当前增益、限幅器的衰减，以及占音频时长的 CPU 比例
+    uint64_t loudFrames = stats.loudnessFrames, loudProcessed = loudness.processedFrames();
+    appendStat(out, "loudnessEnabled", static_cast<uint64_t>(loudnessEnabled.load()));
+    appendStat(out, "loudnessSource", loudness.usingMetadata() ? metadataGainSource.load() : "measured");
+    appendStat(out, "loudnessTargetLufs", static_cast<double>(loudnessTarget.load()));
+    appendStat(out, "momentaryLufs", static_cast<double>(loudness.momentaryLufs()));
+    appendStat(out, "shortTermLufs", static_cast<double>(loudness.shortTermLufs()));
+    appendStat(out, "integratedLufs", static_cast<double>(loudness.integratedLufs()));
+    appendStat(out, "loudnessGainDb", static_cast<double>(loudness.gainDb()));
+    appendStat(out, "limiterReductionDb", static_cast<double>(loudness.limiterReductionDb()));
+    appendStat(out, "truePeakCheckedPercent",
+               loudProcessed ? loudness.truePeakFrames() * 100.0 / loudProcessed : 0.0);
+    appendStat(out, "loudnessCpuPercent",
+               loudFrames && audioOutRate > 0
+               ? stats.loudnessUs / 1e6 / (static_cast<double>(loudFrames) / audioOutRate) * 100 : 0.0);
+    // 端到端延迟：环形缓冲区中等待的数据加上设备中还没播放的数据
+    int64_t deviceLatencyUs = audioRender.latencyUs();
+    double queuedMs = 0;
+    if (audioOutRate > 0) {
+        size_t frameBytes = audioOutChannels * (audioOutFloat ? sizeof(float) : sizeof(int16_t));
+        queuedMs = audioRing.readable() / frameBytes * 1000.0 / audioOutRate;
+    }
+    appendStat(out, "audioQueuedMs", queuedMs);
+    appendStat(out, "audioDeviceLatencyMs", deviceLatencyUs >= 0 ? deviceLatencyUs / 1000.0 : 0.0);
+    appendStat(out, "audioLatencyMs", queuedMs + (deviceLatencyUs >= 0 ? deviceLatencyUs / 1000.0 : 0.0));
+    appendStat(out, "audioExclusiveRequested", static_cast<uint64_t>(audioRender.exclusiveRequested()));
+    appendStat(out, "audioSharingMode",
+               audioRender.sharingMode() == AAUDIO_SHARING_MODE_EXCLUSIVE ? "exclusive" : "shared");
+    appendStat(out, "audioLowLatency",
+               static_cast<uint64_t>(audioRender.performanceMode() == AAUDIO_PERFORMANCE_MODE_LOW_LATENCY));
+    appendStat(out, "audioExclusiveFallbacks", static_cast<uint64_t>(audioRender.fallbacks()));
+    appendStat(out, "audioSilenceFrames", stats.audioSilenceFrames.load());
+    // 音频状态切换在后台完成，Java 调用只记录请求
+    int transitions = audioRender.transitions();
+    appendStat(out, "audioTransitions", static_cast<uint64_t>(transitions));
+    appendStat(out, "audioTransitionMs",
+               transitions ? audioRender.transitionTotalUs() / 1000.0 / transitions : 0.0);
+    appendStat(out, "audioTransitionMaxMs", audioRender.transitionPeakUs() / 1000.0);
+    appendStat(out, "audioStartFailures", static_cast<uint64_t>(audioRender.startFailures()));
+    appendStat(out, "audioStartGiveUps", static_cast<uint64_t>(audioRender.startGiveUps()));
+    uint64_t seeks = stats.seekCalls, pauses = stats.pauseCalls;
+    appendStat(out, "seekCalls", seeks);
+    appendStat(out, "seekCallMs", seeks ? stats.seekCallUs / 1000.0 / seeks : 0.0);
+    appendStat(out, "seekCallMaxMs", stats.seekCallMaxUs / 1000.0);
+    // 跳转从请求到流水线重新开始的耗时，在 controlling 阶段测量
+    uint64_t seeksDone = stats.seeksDone;
+    appendStat(out, "seeksDone", seeksDone);
+    appendStat(out, "seekDoneMs", seeksDone ? stats.seekDoneUs / 1000.0 / seeksDone : 0.0);
+    appendStat(out, "seekDoneMaxMs", stats.seekDoneMaxUs / 1000.0);
+    appendStat(out, "seeksCoalesced", stats.seeksCoalesced.load());
+    appendStat(out, "seekFailures", stats.seekFailures.load());
+    appendStat(out, "pauseCalls", pauses);
+    appendStat(out, "pauseCallMs", pauses ? stats.pauseCallUs / 1000.0 / pauses : 0.0);
+    appendStat(out, "pauseCallMaxMs", stats.pauseCallMaxUs / 1000.0);
+    // 播放列表：预加载的耗时（打开 + 预热），切换时第一帧晚了多少、音频欠载了多少
+    uint64_t preloads = stats.preloadedItems;
+    appendStat(out, "playlistIndex", static_cast<uint64_t>(shownItem.load()));
+    appendStat(out, "playlistSwitches", stats.playlistSwitches.load());
+    appendStat(out, "preloadedItems", preloads);
+    appendStat(out, "preloadFailures", stats.preloadFailures.load());
+    appendStat(out, "preloadMs", preloads ? stats.preloadUs / 1000.0 / preloads : 0.0);
+    appendStat(out, "preloadMaxMs", stats.preloadMaxUs / 1000.0);
+    appendStat(out, "primedFrames", stats.primedFrames.load());
+    appendStat(out, "itemSwitchGapMs", stats.switchGapUs / 1000.0);
+    appendStat(out, "itemSwitchGapMaxMs", stats.switchGapMaxUs / 1000.0);
+    appendStat(out, "switchSilenceFrames", stats.switchSilenceFrames.load());
+    appendStat(out, "trimmedAudioSamples", stats.trimmedAudioSamples.load());
+    // 解码器复用：新打开和复用的平均耗时，两者之差乘以复用次数就是节省的打开时间
+    uint64_t opens = stats.decoderOpens, reuses = stats.decoderReuses;
+    double openMs = opens ? stats.decoderOpenUs / 1000.0 / opens : 0.0;
+    double reuseMs = reuses ? stats.decoderReuseUs / 1000.0 / reuses : 0.0;
+    appendStat(out, "decoderOpens", opens);
+    appendStat(out, "decoderReuses", reuses);
+    appendStat(out, "decoderOpenMs", openMs);
+    appendStat(out, "decoderReuseMs", reuseMs);
+    appendStat(out, "decoderReuseSavedMs", opens ? reuses * (openMs - reuseMs) : 0.0);
+    appendStat(out, "decoderCacheMismatches", decoderCache->mismatches());
+    appendStat(out, "decoderCacheEvictions", decoderCache->evictions());
+    // A-B 循环：每一遍来自缓存的 packet、解码帧还是重新读文件，以及回到 A 时画面的延迟
+    appendStat(out, "loopActive", static_cast<uint64_t>(looping.load()));
+    appendStat(out, "loopCacheMB", loopCache.bytes() / 1048576.0);
+    appendStat(out, "loopPasses", stats.loopPasses.load());
+    appendStat(out, "loopPacketPasses", stats.loopPacketPasses.load());
+    appendStat(out, "loopSeekPasses", stats.loopSeekPasses.load());
+    appendStat(out, "loopFramePasses", stats.loopFramePasses.load());
+    appendStat(out, "loopVideoFrameReplay", static_cast<uint64_t>(loopVideoFrames.load()));
+    appendStat(out, "loopAudioFrameReplay", static_cast<uint64_t>(loopAudioFrames.load()));
+    appendStat(out, "loopReplayedPackets", stats.loopReplayedPackets.load());
+    appendStat(out, "loopReplayedMB", stats.loopReplayedBytes / 1048576.0);
+    appendStat(out, "loopReplayedFrames", stats.loopReplayedFrames.load());
+    appendStat(out, "loopGapMs", stats.loopGapUs / 1000.0);
+    appendStat(out, "loopGapMaxMs", stats.loopGapMaxUs / 1000.0);
+    // 设备缓冲区从一个 burst 开始，欠载时加大，稳定一段时间后缩小
+    appendStat(out, "audioBurstFrames", static_cast<uint64_t>(audioRender.burstFrames()));
+    appendStat(out, "audioBufferFrames", static_cast<uint64_t>(audioRender.bufferFrames()));
+    appendStat(out, "audioXRuns", static_cast<uint64_t>(audioRender.xruns()));
+    appendStat(out, "audioBufferGrows", static_cast<uint64_t>(audioRender.bufferGrows()));
+    appendStat(out, "audioBufferShrinks", static_cast<uint64_t>(audioRender.bufferShrinks()));
+    appendStat(out, "audioClockedFrames", stats.audioClockedFrames.load());
+    appendStat(out, "avSyncDiffMs", stats.avSyncDiff * 1000.0);
+    appendStat(out, "renderFps", elapsed > 0 ? rendered / elapsed : 0.0);
+    appendStat(out, "trickPlay", static_cast<uint64_t>(trickPlay.load()));
+    appendStat(out, "trickDroppedPackets", stats.trickDroppedPackets.load());
+    appendStat(out, "trickEffectiveSpeed", stats.trickEffectiveSpeed.load());
+    uint64_t gops = stats.reverseGops;
+    appendStat(out, "reversePlay", static_cast<uint64_t>(reversePlay.load()));
+    appendStat(out, "reverseGops", gops);
+    appendStat(out, "reverseGopDecodeMs", gops ? stats.reverseGopDecodeUs / 1000.0 / gops : 0.0);
+    appendStat(out, "reverseDownscaledFrames", stats.reverseDownscaledFrames.load());
+    appendStat(out, "reverseDroppedFrames", stats.reverseDroppedFrames.load());
+    appendStat(out, "reverseStalls", stats.reverseStalls.load());
+    uint64_t hits = stats.stepHits, misses = stats.stepMisses;
+    appendStat(out, "stepHits", hits);
+    appendStat(out, "stepHitMs", hits ? stats.stepHitUs / 1000.0 / hits : 0.0);
+    appendStat(out, "stepMisses", misses);
+    appendStat(out, "stepMissMs", misses ? stats.stepMissUs / 1000.0 / misses : 0.0);
+    appendStat(out, "stepFailures", stats.stepFailures.load());
+    appendStat(out, "stepCacheFailures", stats.stepCacheFailures.load());
+    uint64_t convertUs = stats.convertUs;
+    appendStat(out, "yuvKernel", YuvConverter::levelName(yuvConverter.level()));
+    appendStat(out, "convertMpixPerSec",
+               convertUs ? static_cast<double>(stats.convertedPixels) / convertUs : 0.0);
+    appendStat(out, "simdConvertedFrames", stats.simdConvertedFrames.load());
+    appendStat(out, "swsConvertedFrames", stats.swsConvertedFrames.load());
+    appendStat(out, "renderFormat", videoRender.format() == RenderFormat::YV12 ? "yv12" : "rgba");
+    appendStat(out, "renderFallbacks", static_cast<uint64_t>(videoRender.fallbacks()));
+    appendStat(out, "yuvDirectFrames", stats.yuvDirectFrames.load());
+    appendStat(out, "outputWidth", static_cast<uint64_t>(outWidth.load()));
+    appendStat(out, "outputHeight", static_cast<uint64_t>(outHeight.load()));
+    appendStat(out, "decoderLowres", static_cast<uint64_t>(decoderLowres.load()));
+    appendStat(out, "sourcePixelsPerSec", elapsed > 0 ? stats.sourcePixels / elapsed : 0.0);
+    appendStat(out, "convertedPixelsPerSec", elapsed > 0 ? stats.convertedPixels / elapsed : 0.0);
+    appendStat(out, "fastScaleFrames", stats.fastScaleFrames.load());
+    appendStat(out, "convertSlices", static_cast<uint64_t>(lastSlices.load()));
+    for (int i = 1; i <= MAX_CONVERT_SLICES; ++i) {
+        uint64_t us = stats.slicedUs[i];
+        if (us == 0) continue;
+        char name[32];
+        snprintf(name, sizeof(name), "convertMpixPerSec@%d", i);
+        appendStat(out, name, static_cast<double>(stats.slicedPixels[i]) / us);
+    }
+    uint64_t presented = stats.presentedImages;
+    appendStat(out, "framesReadyAhead", static_cast<uint64_t>(readyQ.size()));
+    appendStat(out, "framesReadyAheadAvg",
+               presented ? static_cast<double>(stats.readyAheadSum) / presented : 0.0);
+    appendStat(out, "presentMs", presented ? stats.presentUs / 1000.0 / presented : 0.0);
+    uint64_t toneMapUs = stats.toneMapUs;
+    static const char *transferNames[] = {"sdr", "pq", "hlg"};
+    appendStat(out, "toneMappedFrames", stats.toneMappedFrames.load());
+    appendStat(out, "toneMapTransfer", transferNames[static_cast<int>(toneMapper.transfer())]);
+    appendStat(out, "toneMapPeakNits", stats.toneMapPeakNits.load());
+    appendStat(out, "toneMapMpixPerSec",
+               toneMapUs ? static_cast<double>(stats.toneMapPixels) / toneMapUs : 0.0);
+    appendStat(out, "gamutMappedFrames", stats.gamutMappedFrames.load());
+    appendStat(out, "outputDataSpace", static_cast<uint64_t>(static_cast<uint32_t>(outDataSpace.load())));
+    // 旋转与不旋转的同尺寸转换吞吐量，两者之比就是旋转的额外开销
+    uint64_t uprightUs = stats.uprightUs, rotatedUs = stats.rotatedUs;
+    appendStat(out, "displayRotation", static_cast<uint64_t>(displayRotation) * 90);
+    appendStat(out, "sampleAspectRatio", videoSar.num > 0 ? av_q2d(videoSar) : 1.0);
+    appendStat(out, "rotatedFrames", stats.rotatedFrames.load());
+    appendStat(out, "rotateScaledFrames", stats.rotateScaledFrames.load());
+    appendStat(out, "uprightMpixPerSec",
+               uprightUs ? static_cast<double>(stats.uprightPixels) / uprightUs : 0.0);
+    appendStat(out, "rotatedMpixPerSec",
+               rotatedUs ? static_cast<double>(stats.rotatedPixels) / rotatedUs : 0.0);
+    // 每个滤镜每帧的平均耗时
+    auto appendFilterStats = [&out](const char *prefix, const FilterGraph &graph) {
+        appendStat(out, (std::string(prefix) + "Rebuilds").c_str(),
+                   static_cast<uint64_t>(graph.rebuilds()));
+        appendStat(out, (std::string(prefix) + "Errors").c_str(),
+                   static_cast<uint64_t>(graph.errors()));
+        auto timings = graph.timings();
+        for (size_t i = 0; i < timings.size(); ++i) {
+            char name[64];
+            snprintf(name, sizeof(name), "%s.%zu.%sMs", prefix, i, timings[i].name.c_str());
+            appendStat(out, name, timings[i].frames ? timings[i].us / 1000.0 / timings[i].frames : 0.0);
+        }
+    };
+    appendFilterStats("videoFilter", videoFilter);
+    appendFilterStats("audioFilter", audioFilter);
+    appendStat(out, "renderMBPerSec", elapsed > 0 ? stats.renderedBytes / 1048576.0 / elapsed : 0.0);
+    return out;
+}
+
+// 每种类型使用第一个流
+static AVStream *firstStream(const AVFormatContext *ctx, AVMediaType type, int &index) {
+    for (unsigned i = 0; i < ctx->nb_streams; ++i) {
+        if (ctx->streams[i]->codecpar->codec_type == type) {
+            index = static_cast<int>(i);
+            return ctx->streams[i];
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<PlaybackSession> Player::openItem(const std::string &path) {
+    int64_t t0 = av_gettime_relative();
+    auto item = std::make_shared<PlaybackSession>();
+    item->path = path;
+    item->decoders = decoderCache;
+    item->serial = ++itemSerial;
+    // 打开封装格式
+    int ret = avformat_open_input(&item->formatCtx, path.c_str(), nullptr, nullptr);
+    char errBuf[BUFF_SIZE]{};
     if (ret < 0) {
         av_strerror(ret, errBuf, sizeof(errBuf) - 1);
-        LOGE(LOGTAG, "打开音频解码器失败, ffmpeg avcodec_open2 error: %s", errBuf);
-        avformat_free_context(pFormatCtx);
-        avcodec_free_context(&pAudioCodecCtx);
+        LOGE(LOGTAG, "打开 %s 失败, ffmpeg avformat_open_input error: %s", path.c_str(), errBuf);
+        return nullptr;
+    }
+
+    LOGD(LOGTAG, "打开 %s 成功", path.c_str());
+    ret = avformat_find_stream_info(item->formatCtx, nullptr);
+    if (ret < 0) {
+        av_strerror(ret, errBuf, sizeof(errBuf) - 1);
+        LOGE(LOGTAG, "获取流信息失败, ffmpeg avformat_find_stream_info error: %s", errBuf);
+        return nullptr;
+    }
+
+    LOGD(LOGTAG, "Format %s, duration %ld us", item->formatCtx->iformat->long_name,
+         item->formatCtx->duration);
+
+    // 打开失败时已经分配的上下文随 item 一起释放
+    if (!openVideoDecoder(*item)) return nullptr;
+    if (!openAudioDecoder(*item)) return nullptr;
+    item->videoTimeBase = item->formatCtx->streams[item->videoStreamId]->time_base;
+    item->audioTimeBase = item->formatCtx->streams[item->audioStreamId]->time_base;
+    item->openUs = av_gettime_relative() - t0;
+    return item;
+}
+
+bool Player::openVideoDecoder(PlaybackSession &item) {
+    auto vs = firstStream(item.formatCtx, AVMEDIA_TYPE_VIDEO, item.videoStreamId);
+    if (vs == nullptr) return false;
+
+    auto pCodecParameters = vs->codecpar;
+    AVCodec *codec = avcodec_find_decoder(pCodecParameters->codec_id);
+    if (codec == nullptr) {
+        // 没有找到解码器
+        LOGE(LOGTAG, "没有找到视频解码器");
         return false;
     }
 
-    LOGD(LOGTAG, "Audio Codec: %d channels, sample rate: %d", pCodecParameters->channels,
-         pCodecParameters->sample_rate);
+    // 手机竖拍的视频带有显示矩阵，变形（非方形像素）的视频带有像素宽高比，
+    // 两者都在转换时一并处理，输出尺寸是旋转、拉伸后的显示尺寸
+    item.rotation = rotationOf(vs);
+    item.sar = av_guess_sample_aspect_ratio(item.formatCtx, vs, nullptr);
+    LOGI(LOGTAG, "display rotation %d, sample aspect ratio %d:%d",
+         static_cast<int>(item.rotation) * 90, item.sar.num, item.sar.den);
 
+    // 输出尺寸不超过原尺寸的 1/2、1/4 时让支持的解码器直接输出低分辨率（lowres）。
+    // 比较的是旋转前的尺寸
+    // 这里在 preloading 线程执行，Surface 尺寸可能同时被 UI 线程修改，只读一次
+    int surfaceW = surfaceWidth;
+    int surfaceH = surfaceHeight;
+    int displayW, displayH, fitW, fitH;
+    displaySize(pCodecParameters->width, pCodecParameters->height, item.sar, item.rotation,
+                displayW, displayH);
+    fitSize(displayW, displayH, surfaceW, surfaceH, fitW, fitH);
+    if (item.rotation == Rotation::Cw90 || item.rotation == Rotation::Cw270) {
+        std::swap(fitW, fitH);
+    }
+    int lowres = 0;
+    while (lowres < std::min<int>(codec->max_lowres, MAX_LOWRES) &&
+           (pCodecParameters->width >> (lowres + 1)) >= fitW &&
+           (pCodecParameters->height >> (lowres + 1)) >= fitH) {
+        lowres++;
+    }
+    item.lowres = lowres;
+
+    item.videoKey = DecoderCache::keyOf(pCodecParameters, lowres, 0);
+    item.videoCodecCtx = openDecoder(pCodecParameters, codec, item.videoKey);
+    if (item.videoCodecCtx == nullptr) return false;
+
+    LOGD(LOGTAG, "Video Codec: resolution %dx%d, bit rate: %ld",
+         pCodecParameters->width, pCodecParameters->height,
+         pCodecParameters->bit_rate);
+
+    // 解码输出是 YUV 4:2:0（10 位的映射到 8 位之后）时优先让窗口直接显示 YV12
+    ChromaLayout layout;
+    bool yuv = chromaLayoutOf(pCodecParameters->format, layout) || isTenBit(pCodecParameters->format);
+    // 容器（如 MKV）中的 HDR 亮度元数据放在流的附加数据里，帧上不一定有
+    item.hdrPeakNits = peakNitsOf(
+            reinterpret_cast<const AVContentLightMetadata *>(
+                    av_stream_get_side_data(vs, AV_PKT_DATA_CONTENT_LIGHT_LEVEL, nullptr)),
+            reinterpret_cast<const AVMasteringDisplayMetadata *>(
+                    av_stream_get_side_data(vs, AV_PKT_DATA_MASTERING_DISPLAY_METADATA, nullptr)));
+    if (item.hdrPeakNits <= 0) item.hdrPeakNits = DEFAULT_HDR_PEAK_NITS;
+    item.preferredFormat = yuv ? RenderFormat::YV12 : RenderFormat::RGBA;
+    item.codedWidth = pCodecParameters->width;
+    item.codedHeight = pCodecParameters->height;
     return true;
+}
+
+// 封装层把 REPLAYGAIN_* 标签（MP3、FLAC、Vorbis 等）解析成流的附加数据，增益以 1/100000 dB
+// 为单位，INT32_MIN 表示没有。Opus 的 R128_TRACK_GAIN 只是普通标签，Q7.8 格式、相对 -23 LUFS。
+// 增益换算到 REPLAYGAIN_REFERENCE_LUFS，没有元数据时 gainDb 为 NAN，返回增益的来源
+static const char *loudnessGainOf(const AVStream *as, const AVDictionary *formatMeta, float &gainDb) {
+    gainDb = NAN;
+    auto rg = reinterpret_cast<const AVReplayGain *>(
+            av_stream_get_side_data(as, AV_PKT_DATA_REPLAYGAIN, nullptr));
+    if (rg != nullptr) {
+        if (rg->track_gain != INT32_MIN) {
+            gainDb = rg->track_gain / 100000.0f;
+            return "replaygain-track";
+        }
+        if (rg->album_gain != INT32_MIN) {
+            gainDb = rg->album_gain / 100000.0f;
+            return "replaygain-album";
+        }
+    }
+    for (const AVDictionary *meta : {static_cast<const AVDictionary *>(as->metadata), formatMeta}) {
+        AVDictionaryEntry *tag = av_dict_get(meta, "R128_TRACK_GAIN", nullptr, 0);
+        if (tag == nullptr) continue;
+        char *end = nullptr;
+        long q78 = strtol(tag->value, &end, 10);
+        if (end == tag->value) continue;
+        gainDb = q78 / 256.0f + REPLAYGAIN_REFERENCE_LUFS - R128_REFERENCE_LUFS;
+        return "r128";
+    }
+    return "none";
+}
+
+bool Player::openAudioDecoder(PlaybackSession &item) {
+    auto as = firstStream(item.formatCtx, AVMEDIA_TYPE_AUDIO, item.audioStreamId);
+    if (as == nullptr) return false;
+
+    auto pCodecParameters = as->codecpar;
+    AVCodec *codec = avcodec_find_decoder(pCodecParameters->codec_id);
+    if (codec == nullptr) {
+        LOGE(LOGTAG, "没有找到音频解码器");
+        return false;
+    }
+
+    // 开头的编码器延迟和结尾的填充由音频阶段裁剪，播放列表的前后两项才能逐样本衔接
+    item.audioKey = DecoderCache::keyOf(pCodecParameters, 0, AV_CODEC_FLAG2_SKIP_MANUAL);
+    item.audioCodecCtx = openDecoder(pCodecParameters, codec, item.audioKey);
+    if (item.audioCodecCtx == nullptr) return false;
+
+    LOGD(LOGTAG, "Audio Codec: %d channels, sample rate: %d, padding %d + %d",
+         pCodecParameters->channels, pCodecParameters->sample_rate,
+         pCodecParameters->initial_padding, pCodecParameters->trailing_padding);
+    item.initialPadding = std::max(pCodecParameters->initial_padding, 0);
+    item.trailingPadding = std::max(pCodecParameters->trailing_padding, 0);
+
+    item.loudnessGainSource = loudnessGainOf(as, item.formatCtx->metadata, item.loudnessGainDb);
+    if (!std::isnan(item.loudnessGainDb)) {
+        LOGI(LOGTAG, "loudness metadata %s: %.2f dB", item.loudnessGainSource, item.loudnessGainDb);
+    }
+
+    return true;
+}
+
+AVCodecContext *Player::openDecoder(const AVCodecParameters *par, const AVCodec *codec,
+                                    const DecoderKey &key) {
+    char errBuf[BUFF_SIZE]{};
+    int64_t t0 = av_gettime_relative();
+    // 缓存中的解码器已经清空过缓冲，打开时的参数和选项都与 key 相同
+    AVCodecContext *ctx = decoderCache->acquire(key);
+    if (ctx != nullptr) {
+        stats.decoderReuses++;
+        stats.decoderReuseUs += av_gettime_relative() - t0;
+        LOGD(LOGTAG, "reuse %s decoder", codec->name);
+        return ctx;
+    }
+
+    ctx = avcodec_alloc_context3(codec);
+    if (ctx == nullptr) {
+        return nullptr;
+    }
+
+    int ret = avcodec_parameters_to_context(ctx, par);
+    if (ret < 0) {
+        av_strerror(ret, errBuf, sizeof(errBuf) - 1);
+        LOGE(LOGTAG, "使用流的参数来填充上下文失败, ffmpeg avcodec_parameters_to_context error: %s", errBuf);
+        avcodec_free_context(&ctx);
+        return nullptr;
+    }
+    ctx->lowres = key.lowres;
+    ctx->flags2 |= key.flags2;
+
+    ret = avcodec_open2(ctx, codec, nullptr);
+    if (ret < 0) {
+        av_strerror(ret, errBuf, sizeof(errBuf) - 1);
+        LOGE(LOGTAG, "打开%s解码器失败, ffmpeg avcodec_open2 error: %s",
+             par->codec_type == AVMEDIA_TYPE_VIDEO ? "视频" : "音频", errBuf);
+        avcodec_free_context(&ctx);
+        return nullptr;
+    }
+    stats.decoderOpens++;
+    stats.decoderOpenUs += av_gettime_relative() - t0;
+    return ctx;
+}
+
+void Player::primeItem(PlaybackSession &item) {
+    // 只解出第一个视频帧：切换时马上有画面，解码器（包括它的线程）也已经开始工作
+    int64_t t0 = av_gettime_relative();
+    AVPacket *pkt = av_packet_alloc();
+    AVFrame *frame = av_frame_alloc();
+    for (int i = 0; i < PRELOAD_MAX_PACKETS && item.primedVideo.empty(); ++i) {
+        if (av_read_frame(item.formatCtx, pkt) < 0) break;
+        if (pkt->stream_index == item.audioStreamId) {
+            item.primedAudio.push_back(pkt);
+            pkt = av_packet_alloc();
+            continue;
+        }
+        if (pkt->stream_index == item.videoStreamId &&
+            avcodec_send_packet(item.videoCodecCtx, pkt) == 0) {
+            while (avcodec_receive_frame(item.videoCodecCtx, frame) == 0) {
+                item.primedVideo.push_back(frame);
+                frame = av_frame_alloc();
+            }
+        }
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+    av_frame_free(&frame);
+    item.primeUs = av_gettime_relative() - t0;
+}
+
+int64_t Player::preloadNext() {
+    // 切换后不再使用的条目在这里释放，关闭文件和解码器线程不占用流水线阶段的时间
+    std::vector<std::shared_ptr<PlaybackSession>> dead;
+    std::string path;
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lck(playlistMtx);
+        dead.swap(retired);
+        if (preloaded != nullptr || playlist.empty()) return Stage::kIdle;
+        path = playlist.front();
+        playlist.pop_front();
+        generation = playlistGeneration;
+    }
+    dead.clear();
+
+    auto item = openItem(path);
+    if (item != nullptr) primeItem(*item);
+    {
+        std::lock_guard<std::mutex> lck(playlistMtx);
+        // 打开期间 stop 或者清空了列表
+        if (generation != playlistGeneration) return Stage::kProgress;
+        if (item == nullptr) {
+            stats.preloadFailures++;
+            LOGW(LOGTAG, "skip %s", path.c_str());
+            return Stage::kProgress;
+        }
+        preloaded = item;
+    }
+    PlayerStats::addCall(stats.preloadedItems, stats.preloadUs, stats.preloadMaxUs,
+                         item->openUs + item->primeUs);
+    stats.primedFrames += item->primedVideo.size();
+    LOGI(LOGTAG, "preloaded %s: open %.1f ms, prime %.1f ms, %zu frames, %zu audio packets",
+         path.c_str(), item->openUs / 1000.0, item->primeUs / 1000.0, item->primedVideo.size(),
+         item->primedAudio.size());
+    // 解复用阶段可能已经读完当前项在等待
+    demuxing->wake();
+    return Stage::kProgress;
 }
\ No newline at end of file
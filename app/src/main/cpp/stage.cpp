@@ -0,0 +1,83 @@
+#include "stage.h"
+
+std::shared_ptr<Stage> Stage::create(WorkerPool *pool, Step step, ThreadRole role) {
+    return std::shared_ptr<Stage>(new Stage(pool, std::move(step), role));
+}
+
+Stage::Stage(WorkerPool *pool, Step step, ThreadRole role):
+pool(pool), step(std::move(step)), role(role), state(pack(STOPPED, 0)), stoppers(0) {}
+
+void Stage::start() {
+    uint64_t v = state.load();
+    while (stateOf(v) == STOPPED && !state.compare_exchange_weak(v, pack(IDLE, ticketOf(v)))) {}
+    wake();
+}
+
+void Stage::wake() {
+    uint64_t v = state.load();
+    while (true) {
+        int s = stateOf(v);
+        uint64_t ticket = ticketOf(v);
+        if (s == IDLE) {
+            if (state.compare_exchange_weak(v, pack(SCHEDULED, ticket + 1))) {
+                schedule(ticket + 1, 0);
+                return;
+            }
+        } else if (s == RUNNING) {
+            // 正在执行，让它结束后再跑一轮
+            if (state.compare_exchange_weak(v, pack(RERUN, ticket))) return;
+        } else {
+            return;
+        }
+    }
+}
+
+void Stage::stop() {
+    std::unique_lock<std::mutex> lck(mtx);
+    // 先登记再检查状态，与 run() 中先改状态再检查等待者相对应，不会漏掉通知
+    stoppers++;
+    uint64_t v = state.load();
+    while (stateOf(v) != STOPPED) {
+        if (stateOf(v) == RUNNING || stateOf(v) == RERUN) {
+            idle.wait(lck);
+            v = state.load();
+            continue;
+        }
+        // 已经投递但还没执行的任务在 run() 中会发现序号对不上而直接返回
+        state.compare_exchange_weak(v, pack(STOPPED, ticketOf(v)));
+    }
+    stoppers--;
+}
+
+void Stage::notifyStopper() {
+    if (stoppers.load() == 0) return;
+    std::lock_guard<std::mutex> lck(mtx);
+    idle.notify_all();
+}
+
+void Stage::schedule(uint64_t ticket, int64_t delayUs) {
+    auto self = shared_from_this();
+    pool->postDelayed([self, ticket] { self->run(ticket); }, delayUs,
+                      ThreadPolicy::preferredClass(role));
+}
+
+void Stage::run(uint64_t ticket) {
+    uint64_t expected = pack(SCHEDULED, ticket);
+    if (!state.compare_exchange_strong(expected, pack(RUNNING, ticket))) return;
+    ThreadPolicy::enterRole(role);
+
+    int64_t ret = kProgress;
+    for (int i = 0; i < kBatch && ret == kProgress; ++i) {
+        ret = step();
+    }
+
+    expected = pack(RUNNING, ticket);
+    if (ret == kIdle && state.compare_exchange_strong(expected, pack(IDLE, ticket))) {
+        notifyStopper();
+        return;
+    }
+    // 还有工作（批次用完、需要延时或执行期间被唤醒），换一个序号重新投递
+    state.store(pack(SCHEDULED, ticket + 1));
+    notifyStopper();
+    schedule(ticket + 1, ret == kIdle ? 0 : ret);
+}
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <cmath>
+#include "tempo_processor.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#define SEQUENCE_MS 40
+#define SEEK_WINDOW_MS 15
+#define OVERLAP_MS 8
+#define COARSE_STEP 4           // 粗搜索步长（帧），之后在最佳位置附近逐帧细搜
+#define TEMPO_RAMP_STEP 0.05f   // 每段最多改变的速度
+#define MIN_TEMPO 0.25f
+#define MAX_TEMPO 4.0f
+
+// 计算 a·b 和 b·b，是 WSOLA 中最耗时的部分
+static void correlate(const float *a, const float *b, size_t n, float &corr, float &energy) {
+    size_t i = 0;
+    float c = 0.0f, e = 0.0f;
+#if defined(__ARM_NEON)
+    float32x4_t vc = vdupq_n_f32(0.0f);
+    float32x4_t ve = vdupq_n_f32(0.0f);
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t va = vld1q_f32(a + i);
+        float32x4_t vb = vld1q_f32(b + i);
+        vc = vmlaq_f32(vc, va, vb);
+        ve = vmlaq_f32(ve, vb, vb);
+    }
+    float32x2_t sc = vadd_f32(vget_low_f32(vc), vget_high_f32(vc));
+    float32x2_t se = vadd_f32(vget_low_f32(ve), vget_high_f32(ve));
+    c = vget_lane_f32(vpadd_f32(sc, sc), 0);
+    e = vget_lane_f32(vpadd_f32(se, se), 0);
+#elif defined(__SSE__)
+    __m128 vc = _mm_setzero_ps();
+    __m128 ve = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) {
+        __m128 va = _mm_loadu_ps(a + i);
+        __m128 vb = _mm_loadu_ps(b + i);
+        vc = _mm_add_ps(vc, _mm_mul_ps(va, vb));
+        ve = _mm_add_ps(ve, _mm_mul_ps(vb, vb));
+    }
+    float tc[4], te[4];
+    _mm_storeu_ps(tc, vc);
+    _mm_storeu_ps(te, ve);
+    c = tc[0] + tc[1] + tc[2] + tc[3];
+    e = te[0] + te[1] + te[2] + te[3];
+#endif
+    for (; i < n; ++i) {
+        c += a[i] * b[i];
+        e += b[i] * b[i];
+    }
+    corr = c;
+    energy = e;
+}
+
+TempoProcessor::TempoProcessor():
+channels(2), sequence(0), seekWindow(0), overlap(0), target(1.0f), current(1.0f),
+skipFract(0.0), lastOffset(0), lastWasUnity(true), midValid(false), inputStart(0) {
+    configure(44100, 2);
+}
+
+void TempoProcessor::configure(int sampleRate, int channelCnt) {
+    channels = channelCnt;
+    sequence = static_cast<size_t>(sampleRate) * SEQUENCE_MS / 1000;
+    seekWindow = static_cast<size_t>(sampleRate) * SEEK_WINDOW_MS / 1000;
+    overlap = static_cast<size_t>(sampleRate) * OVERLAP_MS / 1000;
+    clear();
+}
+
+void TempoProcessor::setTempo(float tempo) {
+    target = std::min(std::max(tempo, MIN_TEMPO), MAX_TEMPO);
+}
+
+void TempoProcessor::clear() {
+    input.clear();
+    inputStart = 0;
+    mid.clear();
+    midValid = false;
+    skipFract = 0.0;
+    lastOffset = 0;
+    lastWasUnity = true;
+    current = target;
+}
+
+size_t TempoProcessor::seekBestOffset(const float *base) const {
+    size_t n = overlap * channels;
+    float bestScore = -1e30f;
+    size_t best = 0;
+    auto score = [&](size_t off) {
+        float corr, energy;
+        correlate(mid.data(), base + off * channels, n, corr, energy);
+        float s = corr / std::sqrt(energy + 1e-9f);
+        if (s > bestScore) {
+            bestScore = s;
+            best = off;
+        }
+    };
+    for (size_t off = 0; off < seekWindow; off += COARSE_STEP) {
+        score(off);
+    }
+    size_t lo = best >= COARSE_STEP ? best - COARSE_STEP + 1 : 0;
+    size_t hi = std::min(seekWindow - 1, best + COARSE_STEP - 1);
+    for (size_t off = lo; off <= hi; ++off) {
+        score(off);
+    }
+    return best;
+}
+
+void TempoProcessor::compact() {
+    if (inputStart >= input.size()) {
+        input.clear();
+        inputStart = 0;
+    } else if (inputStart > input.size() / 2) {
+        input.erase(input.begin(), input.begin() + static_cast<long>(inputStart));
+        inputStart = 0;
+    }
+}
+
+size_t TempoProcessor::process(const float *in, size_t frames, std::vector<float> &out) {
+    input.insert(input.end(), in, in + frames * channels);
+    size_t produced = 0;
+    size_t step = sequence - overlap;
+
+    while (true) {
+        size_t avail = (input.size() - inputStart) / channels;
+        const float *base = input.data() + inputStart;
+        if (!midValid) {
+            // 第一段：把开头当作上一段的尾部，偏移 0 处与它完全吻合
+            if (avail < overlap) break;
+            mid.assign(base, base + overlap * channels);
+            midValid = true;
+            lastOffset = 0;
+            lastWasUnity = true;
+            continue;
+        }
+
+        // 输入要够一次搜索加一段，也要够这一段之后跳过的长度
+        auto maxSkip = static_cast<size_t>(std::max(current, target) * step) + 1;
+        if (avail < std::max(seekWindow + sequence, maxSkip)) break;
+
+        if (std::fabs(target - current) <= TEMPO_RAMP_STEP) {
+            current = target;
+        } else {
+            current += target > current ? TEMPO_RAMP_STEP : -TEMPO_RAMP_STEP;
+        }
+        bool unity = current == 1.0f;
+        size_t offset = unity && lastWasUnity ? lastOffset : seekBestOffset(base);
+
+        size_t outPos = out.size();
+        out.resize(outPos + step * channels);
+        float *dst = out.data() + outPos;
+        const float *seg = base + offset * channels;
+        for (size_t i = 0; i < overlap; ++i) {
+            float w = static_cast<float>(i) / overlap;
+            for (int c = 0; c < channels; ++c) {
+                size_t k = i * channels + c;
+                dst[k] = mid[k] * (1.0f - w) + seg[k] * w;
+            }
+        }
+        std::copy(seg + overlap * channels, seg + step * channels, dst + overlap * channels);
+        mid.assign(seg + step * channels, seg + sequence * channels);
+        produced += step;
+
+        double skip = current * step + skipFract;
+        auto skipInt = static_cast<size_t>(skip);
+        skipFract = skip - skipInt;
+        inputStart += skipInt * channels;
+        lastOffset = offset;
+        lastWasUnity = unity;
+    }
+
+    compact();
+    return produced;
+}
+
+size_t TempoProcessor::bufferedFrames() const {
+    return (input.size() - inputStart) / channels;
+}
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cstdio>
+#include <cerrno>
+#include <map>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "thread_policy.h"
+#include "log.h"
+
+#define LOG_TAG "ThreadPolicy"
+#define AUDIO_NICE (-16)    // 与 Android 的 ANDROID_PRIORITY_AUDIO 一致
+
+// 当前工作线程的基础名字、当前角色和原始 nice 值
+static thread_local char tlsBaseName[8] = "tp";
+static thread_local ThreadRole tlsRole = ThreadRole::General;
+static thread_local int tlsBaseNice = 0;
+
+static long readLong(const std::string &path) {
+    FILE *fp = fopen(path.c_str(), "r");
+    if (fp == nullptr) return -1;
+    long v = -1;
+    if (fscanf(fp, "%ld", &v) != 1) v = -1;
+    fclose(fp);
+    return v;
+}
+
+CpuTopology CpuTopology::detect(const std::string &root) {
+    CpuTopology topo;
+    std::map<long, std::vector<int>> byFreq;
+    DIR *dir = opendir(root.c_str());
+    if (dir != nullptr) {
+        while (dirent *ent = readdir(dir)) {
+            int cpu;
+            char tail;
+            // 只要 cpuN 目录，跳过 cpufreq、cpuidle 等
+            if (sscanf(ent->d_name, "cpu%d%c", &cpu, &tail) != 1) continue;
+            long freq = readLong(root + "/" + ent->d_name + "/cpufreq/cpuinfo_max_freq");
+            byFreq[freq].push_back(cpu);
+        }
+        closedir(dir);
+    }
+    for (auto &kv : byFreq) {
+        std::sort(kv.second.begin(), kv.second.end());
+        topo.m_clusters.push_back({kv.first, kv.second});
+    }
+    return topo;
+}
+
+const std::vector<CpuCluster> & CpuTopology::clusters() const {
+    return m_clusters;
+}
+
+bool CpuTopology::isHeterogeneous() const {
+    // 读不到频率的核心归为 -1 一组，此时不做区分
+    return m_clusters.size() > 1 && m_clusters.front().maxFreqKHz > 0;
+}
+
+std::vector<int> CpuTopology::cpus(CoreClass cls) const {
+    std::vector<int> ret;
+    for (size_t i = 0; i < m_clusters.size(); ++i) {
+        bool little = i == 0;
+        if (cls == CoreClass::Any || !isHeterogeneous() ||
+            (cls == CoreClass::Little) == little) {
+            ret.insert(ret.end(), m_clusters[i].cpus.begin(), m_clusters[i].cpus.end());
+        }
+    }
+    return ret;
+}
+
+ThreadPolicy * ThreadPolicy::shared() {
+    static ThreadPolicy policy;
+    return &policy;
+}
+
+ThreadPolicy::ThreadPolicy(): m_topology(CpuTopology::detect()) {
+    for (auto &c : m_topology.clusters()) {
+        LOGI(LOG_TAG, "cpu cluster: max freq %ld kHz, %zu cores", c.maxFreqKHz, c.cpus.size());
+    }
+}
+
+const CpuTopology & ThreadPolicy::topology() const {
+    return m_topology;
+}
+
+std::vector<CoreClass> ThreadPolicy::workerClasses(size_t n) const {
+    if (!m_topology.isHeterogeneous() || n < 2) {
+        return std::vector<CoreClass>(n, CoreClass::Any);
+    }
+    // 至少留一个小核线程给解复用，其余按大核个数分给大核
+    size_t big = std::min(m_topology.cpus(CoreClass::Big).size(), n - 1);
+    std::vector<CoreClass> ret(n, CoreClass::Little);
+    std::fill(ret.begin(), ret.begin() + big, CoreClass::Big);
+    return ret;
+}
+
+void ThreadPolicy::bindWorker(CoreClass cls, size_t index) const {
+    const char *prefix = cls == CoreClass::Big ? "b" : cls == CoreClass::Little ? "l" : "";
+    snprintf(tlsBaseName, sizeof(tlsBaseName), "tp-%s%zu", prefix, index);
+    pthread_setname_np(pthread_self(), tlsBaseName);
+    errno = 0;
+    int nice = getpriority(PRIO_PROCESS, gettid());
+    tlsBaseNice = errno == 0 ? nice : 0;
+
+    if (cls == CoreClass::Any) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : m_topology.cpus(cls)) {
+        CPU_SET(cpu, &set);
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        LOGW(LOG_TAG, "sched_setaffinity for %s failed: %d", tlsBaseName, errno);
+    }
+}
+
+CoreClass ThreadPolicy::preferredClass(ThreadRole role) {
+    switch (role) {
+        case ThreadRole::Demux:
+            return CoreClass::Little;
+        case ThreadRole::VideoDecode:
+        case ThreadRole::VideoRender:
+        case ThreadRole::AudioDecode:
+        case ThreadRole::VideoConvert:
+            return CoreClass::Big;
+        default:
+            return CoreClass::Any;
+    }
+}
+
+void ThreadPolicy::enterRole(ThreadRole role) {
+    if (role == tlsRole) return;
+    static const char *suffix[] = {"", ":dmx", ":vdec", ":vrnd", ":adec", ":vcvt"};
+    char name[16];
+    snprintf(name, sizeof(name), "%s%s", tlsBaseName, suffix[static_cast<int>(role)]);
+    pthread_setname_np(pthread_self(), name);
+
+    // 音频阶段饿死会直接导致回调取不到数据，运行时提高优先级，离开时恢复
+    if (role == ThreadRole::AudioDecode) {
+        if (setpriority(PRIO_PROCESS, gettid(), AUDIO_NICE) != 0) {
+            LOGW(LOG_TAG, "setpriority for audio failed: %d", errno);
+        }
+    } else if (tlsRole == ThreadRole::AudioDecode) {
+        setpriority(PRIO_PROCESS, gettid(), tlsBaseNice);
+    }
+    tlsRole = role;
+}
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "tone_map.h"
+
+#define MAX_CHROMA_GAIN 2.0         // 色度最多放大的倍数，避免暗部噪声被放大
+#define CHROMA_RATIO_BIAS 0.02      // 计算亮度之比时加上的偏置，暗部增益平滑过渡到 1
+
+// SMPTE ST 2084 常数
+static const double kPqM1 = 2610.0 / 16384;
+static const double kPqM2 = 2523.0 / 4096 * 128;
+static const double kPqC1 = 3424.0 / 4096;
+static const double kPqC2 = 2413.0 / 4096 * 32;
+static const double kPqC3 = 2392.0 / 4096 * 32;
+
+// ARIB STD-B67 常数
+static const double kHlgA = 0.17883277;
+static const double kHlgB = 0.28466892;
+static const double kHlgC = 0.55991073;
+
+// PQ 码值（0 ~ 1）-> 绝对亮度（nits）
+static double pqToNits(double e) {
+    double p = std::pow(e, 1.0 / kPqM2);
+    return 10000.0 * std::pow(std::max(p - kPqC1, 0.0) / (kPqC2 - kPqC3 * p), 1.0 / kPqM1);
+}
+
+static double nitsToPq(double nits) {
+    double y = std::pow(std::max(nits, 0.0) / 10000.0, kPqM1);
+    return std::pow((kPqC1 + kPqC2 * y) / (1 + kPqC3 * y), kPqM2);
+}
+
+// HLG 码值 -> 场景线性光，再经 BT.2100 的 OOTF（系统 gamma 随峰值亮度变化）得到显示亮度
+static double hlgToNits(double e, double peak) {
+    double scene = e <= 0.5 ? e * e / 3 : (std::exp((e - kHlgC) / kHlgA) + kHlgB) / 12;
+    double gamma = 1.2 + 0.42 * std::log10(peak / 1000.0);
+    return peak * std::pow(scene, gamma);
+}
+
+// BT.2390 EETF：在 PQ 域把 [0, peak] 压缩到 [0, SDR_WHITE_NITS]，膝点以下保持不变
+static double eetf(double nits, double peak) {
+    if (peak <= SDR_WHITE_NITS) return std::min(nits, SDR_WHITE_NITS);
+    double maxIn = nitsToPq(peak);
+    double e1 = std::min(nitsToPq(nits) / maxIn, 1.0);
+    double maxLum = nitsToPq(SDR_WHITE_NITS) / maxIn;
+    double ks = std::max(1.5 * maxLum - 0.5, 0.0);
+    double e2 = e1;
+    if (e1 > ks) {
+        // Hermite 样条，从膝点平滑过渡到 maxLum
+        double t = (e1 - ks) / (1 - ks);
+        double t2 = t * t;
+        double t3 = t2 * t;
+        e2 = (2 * t3 - 3 * t2 + 1) * ks + (t3 - 2 * t2 + t) * (1 - ks) + (-2 * t3 + 3 * t2) * maxLum;
+    }
+    return pqToNits(e2 * maxIn);
+}
+
+// BT.2020 -> BT.709 的线性 RGB 转换矩阵（ITU-R BT.2087）
+static const float kBt2020To709[3][3] = {
+        {1.6605f, -0.5876f, -0.0728f},
+        {-0.1246f, 1.1329f, -0.0083f},
+        {-0.0182f, -0.1006f, 1.1187f},
+};
+
+static inline int32_t floatToBits(float f) {
+    int32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+static inline float bitsToFloat(int32_t bits) {
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// 重新编码查找表按 float 位模式的指数和尾数高 log2(GAMUT_ENCODE_STEPS) 位索引
+static const int kEncodeShift = 23 - 8;                                  // GAMUT_ENCODE_STEPS = 2^8
+static const int32_t kEncodeMinBits = (127 - GAMUT_ENCODE_OCTAVES) << 23;  // 2^-20
+static const int32_t kEncodeOneBits = 127 << 23;                          // 1.0
+
+ToneMapper::ToneMapper(): curve(HdrTransfer::SDR), peak(0), full(false), built(false),
+lumaLut{}, chromaGain{} {
+    // 映射输出按 BT.1886（gamma 2.4）编码，色域转换按同一条曲线解码和重新编码
+    for (int code = 0; code < 256; ++code) {
+        linearLut[code] = static_cast<float>(std::pow(code / 255.0, 2.4));
+    }
+    for (int i = 0; i < GAMUT_ENCODE_OCTAVES * GAMUT_ENCODE_STEPS; ++i) {
+        // 取每一级的中点；第一级还包含 0 和更暗的值，编码为 0
+        float linear = bitsToFloat(kEncodeMinBits + (i << kEncodeShift) + (1 << (kEncodeShift - 1)));
+        encodeLut[i] = i == 0 ? 0 : static_cast<uint8_t>(std::lround(255 * std::pow(linear, 1 / 2.4)));
+    }
+    encodeLut[GAMUT_ENCODE_OCTAVES * GAMUT_ENCODE_STEPS] = 255;
+}
+
+bool ToneMapper::configure(HdrTransfer transfer, double peakNits, bool fullRange) {
+    peakNits = std::min(std::max(peakNits, SDR_WHITE_NITS), 10000.0);
+    if (built && transfer == curve && peakNits == peak && fullRange == full) return false;
+    curve = transfer;
+    peak = peakNits;
+    full = fullRange;
+    built = true;
+
+    double chromaScale = fullRange ? 224.0 / 1023 : 224.0 / 896;
+    for (int code = 0; code < 1024; ++code) {
+        double in = fullRange ? code / 1023.0 : (code - 64) / 876.0;
+        in = std::min(std::max(in, 0.0), 1.0);
+        double out = in;
+        if (transfer != HdrTransfer::SDR) {
+            double nits = transfer == HdrTransfer::PQ ? pqToNits(in) : hlgToNits(in, peak);
+            double sdr = std::min(eetf(nits, peak) / SDR_WHITE_NITS, 1.0);
+            out = std::pow(sdr, 1 / 2.4);
+        }
+        lumaLut[code] = static_cast<uint8_t>(std::lround(16 + 219 * out));
+        double ratio = std::min((out + CHROMA_RATIO_BIAS) / (in + CHROMA_RATIO_BIAS), MAX_CHROMA_GAIN);
+        chromaGain[code] = static_cast<int16_t>(std::lround(ratio * chromaScale * 4096));
+    }
+    return true;
+}
+
+HdrTransfer ToneMapper::transfer() const {
+    return curve;
+}
+
+double ToneMapper::peakNits() const {
+    return peak;
+}
+
+uint8_t ToneMapper::mapLuma(int code) const {
+    return lumaLut[code & 1023];
+}
+
+void ToneMapper::toBt709(uint8_t *rgba, int pixels) const {
+    const auto &m = kBt2020To709;
+    // 负数的位模式按有符号整数比较小于 kEncodeMinBits，大于 1 的大于 kEncodeOneBits，都被截断
+    auto encode = [this](float linear) {
+        int32_t bits = std::min(std::max(floatToBits(linear), kEncodeMinBits), kEncodeOneBits);
+        return encodeLut[(bits - kEncodeMinBits) >> kEncodeShift];
+    };
+    for (int i = 0; i < pixels; ++i, rgba += 4) {
+        float r = linearLut[rgba[0]];
+        float g = linearLut[rgba[1]];
+        float b = linearLut[rgba[2]];
+        rgba[0] = encode(m[0][0] * r + m[0][1] * g + m[0][2] * b);
+        rgba[1] = encode(m[1][0] * r + m[1][1] * g + m[1][2] * b);
+        rgba[2] = encode(m[2][0] * r + m[2][1] * g + m[2][2] * b);
+    }
+}
+
+static inline uint8_t chromaOut(int c, int gain) {
+    int v = 128 + (((c - 512) * gain + 2048) >> 12);
+    return static_cast<uint8_t>(std::min(std::max(v, 16), 240));
+}
+
+void ToneMapper::convertRows(const Yuv10Image &src, const Yuv8Planes &dst,
+                             int rowBegin, int rowEnd) const {
+    rowEnd = std::min(rowEnd, src.height);
+    int shift = src.shift;
+    int chromaWidth = (src.width + 1) / 2;
+    int step = src.interleaved ? 2 : 1;
+    for (int row = rowBegin; row < rowEnd; ++row) {
+        const uint16_t *ys = src.y + static_cast<ptrdiff_t>(row) * src.yStride;
+        uint8_t *yd = dst.y + static_cast<ptrdiff_t>(row - rowBegin) * dst.yStride;
+        for (int x = 0; x < src.width; ++x) {
+            yd[x] = lumaLut[(ys[x] >> shift) & 1023];
+        }
+        if (row & 1) continue;
+
+        // 色度按每个 2x2 块左上角的亮度查增益
+        const uint16_t *us = src.u + static_cast<ptrdiff_t>(row / 2) * src.uvStride;
+        const uint16_t *vs = src.interleaved ? us + 1 :
+                             src.v + static_cast<ptrdiff_t>(row / 2) * src.uvStride;
+        uint8_t *ud = dst.u + static_cast<ptrdiff_t>((row - rowBegin) / 2) * dst.uvStride;
+        uint8_t *vd = dst.v + static_cast<ptrdiff_t>((row - rowBegin) / 2) * dst.uvStride;
+        for (int i = 0; i < chromaWidth; ++i) {
+            int gain = chromaGain[(ys[2 * i] >> shift) & 1023];
+            ud[i] = chromaOut((us[i * step] >> shift) & 1023, gain);
+            vd[i] = chromaOut((vs[i * step] >> shift) & 1023, gain);
+        }
+    }
+}
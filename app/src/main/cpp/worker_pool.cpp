@@ -0,0 +1,224 @@
+#include <algorithm>
+#include "worker_pool.h"
+
+// 当前线程所属的线程池及其在池中的下标，非工作线程为 nullptr
+static thread_local WorkerPool *tlsPool = nullptr;
+static thread_local size_t tlsIndex = 0;
+
+WorkerPool * WorkerPool::shared() {
+    static WorkerPool pool(std::min(std::max(std::thread::hardware_concurrency(), 2u), 8u));
+    return &pool;
+}
+
+WorkerPool::WorkerPool(size_t nThreads):
+nextWorker(0), pending(0), sleepers(0), steals(0), parks(0),
+earliestDue(INT64_MAX), timerSeq(0), closed(false) {
+    auto classes = ThreadPolicy::shared()->workerClasses(nThreads);
+    for (size_t i = 0; i < nThreads; ++i) {
+        workers.emplace_back(new Worker);
+        workers[i]->cls = classes[i];
+        lanes[static_cast<int>(CoreClass::Any)].push_back(i);
+        if (classes[i] != CoreClass::Any) {
+            lanes[static_cast<int>(classes[i])].push_back(i);
+        }
+    }
+    // 所有队列创建好之后再启动线程，窃取时会遍历全部队列
+    for (size_t i = 0; i < nThreads; ++i) {
+        workers[i]->thread = std::thread([this, i] {
+            ThreadPolicy::shared()->bindWorker(workers[i]->cls, i);
+            workerLoop(i);
+        });
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        lock_guard lck(sleepMtx);
+        closed = true;
+    }
+    sleepCv.notify_all();
+    for (auto &w : workers) {
+        w->thread.join();
+    }
+}
+
+bool WorkerPool::accepts(size_t index, CoreClass cls) const {
+    return cls == CoreClass::Any || workers[index]->cls == CoreClass::Any ||
+           workers[index]->cls == cls;
+}
+
+const std::vector<size_t> &WorkerPool::laneOf(CoreClass cls) const {
+    return lanes[static_cast<int>(cls)].empty() ?
+           lanes[static_cast<int>(CoreClass::Any)] : lanes[static_cast<int>(cls)];
+}
+
+void WorkerPool::post(Task task, CoreClass cls) {
+    // 当前工作线程适合执行时放进自己的队列，否则轮流放进偏好分组的队列
+    auto &lane = laneOf(cls);
+    size_t i = tlsPool == this && accepts(tlsIndex, cls) ?
+               tlsIndex : lane[nextWorker++ % lane.size()];
+    push(i, std::move(task));
+}
+
+void WorkerPool::push(size_t index, Task task) {
+    {
+        lock_guard lck(workers[index]->mtx);
+        workers[index]->deq.push_back(std::move(task));
+    }
+    pending++;
+    if (sleepers.load() > 0) {
+        lock_guard lck(sleepMtx);
+        sleepCv.notify_one();
+    }
+}
+
+void WorkerPool::postDelayed(Task task, int64_t delayUs, CoreClass cls) {
+    if (delayUs <= 0) {
+        post(std::move(task), cls);
+        return;
+    }
+    auto due = clock::now() + std::chrono::microseconds(delayUs);
+    {
+        lock_guard lck(timerMtx);
+        timers.push({due, timerSeq++, cls, std::move(task)});
+        earliestDue = timers.top().due.time_since_epoch().count();
+    }
+    // 新的定时任务可能比休眠线程正在等待的更早到期，唤醒一个线程重新计算等待时间
+    if (sleepers.load() > 0) {
+        lock_guard lck(sleepMtx);
+        sleepCv.notify_one();
+    }
+}
+
+void WorkerPool::parallelFor(int count, const std::function<void(int)> &fn, CoreClass cls) {
+    if (count <= 1) {
+        if (count == 1) fn(0);
+        return;
+    }
+    // 分片状态由 shared_ptr 持有：调用返回后才开始运行的辅助任务领不到分片，也不会访问 fn
+    struct Job {
+        std::atomic<int> next{0};
+        std::atomic<int> done{0};
+        int count = 0;
+        const std::function<void(int)> *fn = nullptr;
+        std::mutex mtx;
+        std::condition_variable cv;
+    };
+    auto job = std::make_shared<Job>();
+    job->count = count;
+    job->fn = &fn;
+    auto run = [](Job &j) {
+        int i;
+        while ((i = j.next.fetch_add(1)) < j.count) {
+            (*j.fn)(i);
+            if (j.done.fetch_add(1) + 1 == j.count) {
+                lock_guard lck(j.mtx);
+                j.cv.notify_all();
+            }
+        }
+    };
+    // 辅助任务分别放进其他工作线程的队列：在池内调用时如果放进自己的队列，只能等别的线程
+    // 来窃取，空闲线程要先被唤醒再逐个窃取，分片实际上串行执行。调用线程自己也领取分片，
+    // 不需要为它投递，辅助任务也不超过其他线程的个数
+    auto &lane = laneOf(cls);
+    bool inLane = tlsPool == this &&
+                  std::find(lane.begin(), lane.end(), tlsIndex) != lane.end();
+    size_t helpers = std::min(static_cast<size_t>(count - 1), lane.size() - (inLane ? 1 : 0));
+    size_t start = nextWorker.fetch_add(helpers);
+    for (size_t k = 0, posted = 0; posted < helpers; ++k) {
+        size_t i = lane[(start + k) % lane.size()];
+        if (inLane && i == tlsIndex) continue;
+        push(i, [job, run] { run(*job); });
+        posted++;
+    }
+    run(*job);
+    unique_lock lck(job->mtx);
+    job->cv.wait(lck, [&] { return job->done.load() == job->count; });
+}
+
+size_t WorkerPool::threadCount() const {
+    return workers.size();
+}
+
+uint64_t WorkerPool::stealCount() const {
+    return steals;
+}
+
+uint64_t WorkerPool::parkCount() const {
+    return parks;
+}
+
+bool WorkerPool::popLocal(size_t index, Task &task) {
+    auto &w = *workers[index];
+    lock_guard lck(w.mtx);
+    if (w.deq.empty()) return false;
+    task = std::move(w.deq.back());
+    w.deq.pop_back();
+    pending--;
+    return true;
+}
+
+bool WorkerPool::steal(size_t index, Task &task) {
+    // 第一轮只从同组线程窃取，第二轮才跨组
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t k = 1; k < workers.size(); ++k) {
+            auto &w = *workers[(index + k) % workers.size()];
+            if ((w.cls == workers[index]->cls) != (pass == 0)) continue;
+            lock_guard lck(w.mtx);
+            if (w.deq.empty()) continue;
+            task = std::move(w.deq.front());
+            w.deq.pop_front();
+            pending--;
+            steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WorkerPool::popDueTimer(size_t index, Task &task) {
+    // 先用原子变量判断，避免每次循环都去抢定时器的锁
+    if (clock::now().time_since_epoch().count() < earliestDue.load()) return false;
+    CoreClass cls;
+    {
+        lock_guard lck(timerMtx);
+        if (timers.empty() || timers.top().due > clock::now()) return false;
+        cls = timers.top().cls;
+        task = std::move(const_cast<TimedTask &>(timers.top()).task);
+        timers.pop();
+        earliestDue = timers.empty() ? INT64_MAX : timers.top().due.time_since_epoch().count();
+    }
+    if (accepts(index, cls)) return true;
+    // 到期的任务偏好另一类核心，转交给对应分组
+    post(std::move(task), cls);
+    return false;
+}
+
+void WorkerPool::workerLoop(size_t index) {
+    tlsPool = this;
+    tlsIndex = index;
+    while (true) {
+        Task task;
+        if (popDueTimer(index, task) || popLocal(index, task) || steal(index, task)) {
+            task();
+            continue;
+        }
+
+        unique_lock lck(sleepMtx);
+        if (closed) break;
+        // 先登记休眠再检查任务，与 post() 中先加任务再检查休眠线程数相对应，不会漏掉唤醒
+        sleepers++;
+        int64_t due = earliestDue.load();
+        if (pending.load() > 0 || clock::now().time_since_epoch().count() >= due) {
+            sleepers--;
+            continue;
+        }
+        parks++;
+        if (due == INT64_MAX) {
+            sleepCv.wait(lck);
+        } else {
+            sleepCv.wait_until(lck, clock::time_point(clock::duration(due)));
+        }
+        sleepers--;
+    }
+}
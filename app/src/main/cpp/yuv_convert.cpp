@@ -0,0 +1,543 @@
+#include <algorithm>
+#include <cstring>
+#include "yuv_convert.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define YUV_X86 1
+#endif
+
+#define ROTATE_TILE_W 32     // 旋转转换时每块的源图像列数，不小于 SIMD 一次处理的像素数
+#define ROTATE_TILE_H 64     // 每块的源图像行数，即每个目标行一次连续写出的像素数
+
+// 定点公式（系数放大 64 倍）：
+//   y = (Y - yOffset) * yMul，u = U - 128，v = V - 128
+//   R = (y + rv * v + 32) >> 6
+//   G = (y - gu * u - gv * v + 32) >> 6
+//   B = (y + bu * u + 32) >> 6
+// 每一步加减都按 int16 饱和，结果截断到 0 ~ 255
+static const YuvConverter::Coeffs kCoeffs[3][2] = {
+    // BT.601：limited range、full range
+    {{16, 75, 102, 25, 52, 129}, {0, 64, 90, 22, 46, 113}},
+    // BT.709
+    {{16, 75, 115, 14, 34, 135}, {0, 64, 101, 12, 30, 119}},
+    // BT.2020
+    {{16, 75, 107, 12, 42, 137}, {0, 64, 94, 11, 37, 120}},
+};
+
+static inline int sat16(int x) {
+    return std::min(std::max(x, -32768), 32767);
+}
+
+static inline uint8_t toPixel(int t) {
+    t = sat16(t + 32) >> 6;
+    return static_cast<uint8_t>(std::min(std::max(t, 0), 255));
+}
+
+// 从第 begin 个像素（偶数）开始逐像素转换，也用于 SIMD 版本处理行尾。
+// mirror 时第 x 个像素写到第 width-1-x 个位置，即左右翻转
+static void rowScalarFrom(const uint8_t *y, const uint8_t *u, const uint8_t *v, int uvStep,
+                          uint8_t *dst, int begin, int width, bool mirror,
+                          const YuvConverter::Coeffs &c) {
+    for (int x = begin; x < width; ++x) {
+        int k = (x >> 1) * uvStep;
+        int yy = (y[x] - c.yOffset) * c.yMul;
+        int uu = u[k] - 128;
+        int vv = v[k] - 128;
+        uint8_t *p = dst + (mirror ? width - 1 - x : x) * 4;
+        p[0] = toPixel(sat16(yy + c.rv * vv));
+        p[1] = toPixel(sat16(sat16(yy - c.gu * uu) - c.gv * vv));
+        p[2] = toPixel(sat16(yy + c.bu * uu));
+        p[3] = 255;
+    }
+}
+
+static void rowScalar(const uint8_t *y, const uint8_t *u, const uint8_t *v, int uvStep,
+                      uint8_t *dst, int width, bool mirror, const YuvConverter::Coeffs &c) {
+    rowScalarFrom(y, u, v, uvStep, dst, 0, width, mirror, c);
+}
+
+#if defined(__ARM_NEON)
+static inline uint8x8_t packNeon(int16x8_t t) {
+    return vqmovun_s16(vshrq_n_s16(vqaddq_s16(t, vdupq_n_s16(32)), 6));
+}
+
+// 16 个字节倒序
+static inline uint8x16_t reverseNeon(uint8x16_t t) {
+    t = vrev64q_u8(t);
+    return vextq_u8(t, t, 8);
+}
+
+// 每次处理 16 个像素（8 组色度）
+static void rowNeon(const uint8_t *y, const uint8_t *u, const uint8_t *v, int uvStep,
+                    uint8_t *dst, int width, bool mirror, const YuvConverter::Coeffs &c) {
+    int x = 0;
+    const uint8_t *uv = std::min(u, v);
+    bool vFirst = v < u;
+    int16x8_t yOff = vdupq_n_s16(c.yOffset);
+    uint8x8_t bias = vdup_n_u8(128);
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t yv = vld1q_u8(y + x);
+        uint8x8_t ub, vb;
+        if (uvStep == 1) {
+            ub = vld1_u8(u + x / 2);
+            vb = vld1_u8(v + x / 2);
+        } else {
+            uint8x8x2_t p = vld2_u8(uv + x);
+            ub = vFirst ? p.val[1] : p.val[0];
+            vb = vFirst ? p.val[0] : p.val[1];
+        }
+        int16x8_t uu = vreinterpretq_s16_u16(vsubl_u8(ub, bias));
+        int16x8_t vv = vreinterpretq_s16_u16(vsubl_u8(vb, bias));
+        // 每个色度样本对应两个像素
+        int16x8x2_t rc = vzipq_s16(vmulq_n_s16(vv, c.rv), vmulq_n_s16(vv, c.rv));
+        int16x8x2_t gu = vzipq_s16(vmulq_n_s16(uu, c.gu), vmulq_n_s16(uu, c.gu));
+        int16x8x2_t gv = vzipq_s16(vmulq_n_s16(vv, c.gv), vmulq_n_s16(vv, c.gv));
+        int16x8x2_t bc = vzipq_s16(vmulq_n_s16(uu, c.bu), vmulq_n_s16(uu, c.bu));
+        uint8x8_t r[2], g[2], b[2];
+        for (int h = 0; h < 2; ++h) {
+            uint8x8_t yh = h == 0 ? vget_low_u8(yv) : vget_high_u8(yv);
+            int16x8_t yy = vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(yh)), yOff), c.yMul);
+            r[h] = packNeon(vqaddq_s16(yy, rc.val[h]));
+            g[h] = packNeon(vqsubq_s16(vqsubq_s16(yy, gu.val[h]), gv.val[h]));
+            b[h] = packNeon(vqaddq_s16(yy, bc.val[h]));
+        }
+        uint8x16x4_t out;
+        out.val[0] = vcombine_u8(r[0], r[1]);
+        out.val[1] = vcombine_u8(g[0], g[1]);
+        out.val[2] = vcombine_u8(b[0], b[1]);
+        out.val[3] = vdupq_n_u8(255);
+        if (mirror) {
+            // 翻转时倒序写到行尾对称的位置，不需要额外的一遍
+            for (int k = 0; k < 3; ++k) out.val[k] = reverseNeon(out.val[k]);
+            vst4q_u8(dst + (width - x - 16) * 4, out);
+        } else {
+            vst4q_u8(dst + x * 4, out);
+        }
+    }
+    rowScalarFrom(y, u, v, uvStep, dst, x, width, mirror, c);
+}
+#endif
+
+#if defined(YUV_X86)
+// 16 个像素的 R/G/B/A 交错写出
+__attribute__((target("sse4.1")))
+static inline void storeRgba(uint8_t *dst, __m128i r, __m128i g, __m128i b) {
+    __m128i a = _mm_set1_epi8(static_cast<char>(0xFF));
+    __m128i rgLo = _mm_unpacklo_epi8(r, g);
+    __m128i rgHi = _mm_unpackhi_epi8(r, g);
+    __m128i baLo = _mm_unpacklo_epi8(b, a);
+    __m128i baHi = _mm_unpackhi_epi8(b, a);
+    auto out = reinterpret_cast<__m128i *>(dst);
+    _mm_storeu_si128(out, _mm_unpacklo_epi16(rgLo, baLo));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(rgLo, baLo));
+    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(rgHi, baHi));
+    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(rgHi, baHi));
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i shiftSse(__m128i t) {
+    return _mm_srai_epi16(_mm_adds_epi16(t, _mm_set1_epi16(32)), 6);
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i reverseSse(__m128i t) {
+    return _mm_shuffle_epi8(t, _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+}
+
+// 每次处理 16 个像素（8 组色度）
+__attribute__((target("sse4.1")))
+static void rowSse41(const uint8_t *y, const uint8_t *u, const uint8_t *v, int uvStep,
+                     uint8_t *dst, int width, bool mirror, const YuvConverter::Coeffs &c) {
+    int x = 0;
+    const uint8_t *uv = std::min(u, v);
+    bool vFirst = v < u;
+    __m128i yOff = _mm_set1_epi16(c.yOffset);
+    __m128i yMul = _mm_set1_epi16(c.yMul);
+    __m128i bias = _mm_set1_epi16(128);
+    __m128i lowByte = _mm_set1_epi16(0x00FF);
+    for (; x + 16 <= width; x += 16) {
+        __m128i yv = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x));
+        __m128i ub, vb;
+        if (uvStep == 1) {
+            ub = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + x / 2)));
+            vb = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + x / 2)));
+        } else {
+            __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(uv + x));
+            __m128i even = _mm_and_si128(p, lowByte);
+            __m128i odd = _mm_srli_epi16(p, 8);
+            ub = vFirst ? odd : even;
+            vb = vFirst ? even : odd;
+        }
+        __m128i uu = _mm_sub_epi16(ub, bias);
+        __m128i vv = _mm_sub_epi16(vb, bias);
+        __m128i rc = _mm_mullo_epi16(vv, _mm_set1_epi16(c.rv));
+        __m128i guc = _mm_mullo_epi16(uu, _mm_set1_epi16(c.gu));
+        __m128i gvc = _mm_mullo_epi16(vv, _mm_set1_epi16(c.gv));
+        __m128i bc = _mm_mullo_epi16(uu, _mm_set1_epi16(c.bu));
+
+        __m128i y0 = _mm_mullo_epi16(_mm_sub_epi16(_mm_cvtepu8_epi16(yv), yOff), yMul);
+        __m128i y1 = _mm_mullo_epi16(_mm_sub_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(yv, 8)), yOff), yMul);
+        // 每个色度样本对应两个像素
+        __m128i rc0 = _mm_unpacklo_epi16(rc, rc), rc1 = _mm_unpackhi_epi16(rc, rc);
+        __m128i gu0 = _mm_unpacklo_epi16(guc, guc), gu1 = _mm_unpackhi_epi16(guc, guc);
+        __m128i gv0 = _mm_unpacklo_epi16(gvc, gvc), gv1 = _mm_unpackhi_epi16(gvc, gvc);
+        __m128i bc0 = _mm_unpacklo_epi16(bc, bc), bc1 = _mm_unpackhi_epi16(bc, bc);
+
+        __m128i r = _mm_packus_epi16(shiftSse(_mm_adds_epi16(y0, rc0)),
+                                     shiftSse(_mm_adds_epi16(y1, rc1)));
+        __m128i g = _mm_packus_epi16(shiftSse(_mm_subs_epi16(_mm_subs_epi16(y0, gu0), gv0)),
+                                     shiftSse(_mm_subs_epi16(_mm_subs_epi16(y1, gu1), gv1)));
+        __m128i b = _mm_packus_epi16(shiftSse(_mm_adds_epi16(y0, bc0)),
+                                     shiftSse(_mm_adds_epi16(y1, bc1)));
+        if (mirror) {
+            storeRgba(dst + (width - x - 16) * 4, reverseSse(r), reverseSse(g), reverseSse(b));
+        } else {
+            storeRgba(dst + x * 4, r, g, b);
+        }
+    }
+    rowScalarFrom(y, u, v, uvStep, dst, x, width, mirror, c);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i shiftAvx2(__m256i t) {
+    return _mm256_srai_epi16(_mm256_adds_epi16(t, _mm256_set1_epi16(32)), 6);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i spread(__m256i t) {
+    return _mm256_permute4x64_epi64(t, 0xD8);
+}
+
+// 两组 16 个 int16 打包成 32 个有序的 uint8
+__attribute__((target("avx2")))
+static inline __m256i packAvx2(__m256i lo, __m256i hi) {
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(shiftAvx2(lo), shiftAvx2(hi)), 0xD8);
+}
+
+// 32 个字节倒序：先在每个 128 位通道内倒序，再交换两个通道
+__attribute__((target("avx2")))
+static inline __m256i reverseAvx2(__m256i t) {
+    const __m256i mask = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                          15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    return _mm256_permute4x64_epi64(_mm256_shuffle_epi8(t, mask), 0x4E);
+}
+
+// 每次处理 32 个像素（16 组色度）
+__attribute__((target("avx2")))
+static void rowAvx2(const uint8_t *y, const uint8_t *u, const uint8_t *v, int uvStep,
+                    uint8_t *dst, int width, bool mirror, const YuvConverter::Coeffs &c) {
+    int x = 0;
+    const uint8_t *uv = std::min(u, v);
+    bool vFirst = v < u;
+    __m256i yOff = _mm256_set1_epi16(c.yOffset);
+    __m256i yMul = _mm256_set1_epi16(c.yMul);
+    __m256i bias = _mm256_set1_epi16(128);
+    __m256i lowByte = _mm256_set1_epi16(0x00FF);
+    __m256i alpha = _mm256_set1_epi8(static_cast<char>(0xFF));
+    for (; x + 32 <= width; x += 32) {
+        __m256i ub, vb;
+        if (uvStep == 1) {
+            ub = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(u + x / 2)));
+            vb = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(v + x / 2)));
+        } else {
+            __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(uv + x));
+            __m256i even = _mm256_and_si256(p, lowByte);
+            __m256i odd = _mm256_srli_epi16(p, 8);
+            ub = vFirst ? odd : even;
+            vb = vFirst ? even : odd;
+        }
+        __m256i uu = _mm256_sub_epi16(ub, bias);
+        __m256i vv = _mm256_sub_epi16(vb, bias);
+        // 调整 64 位块的顺序，使 unpacklo/unpackhi 得到像素 0-15 和 16-31 的色度
+        __m256i rc = spread(_mm256_mullo_epi16(vv, _mm256_set1_epi16(c.rv)));
+        __m256i guc = spread(_mm256_mullo_epi16(uu, _mm256_set1_epi16(c.gu)));
+        __m256i gvc = spread(_mm256_mullo_epi16(vv, _mm256_set1_epi16(c.gv)));
+        __m256i bc = spread(_mm256_mullo_epi16(uu, _mm256_set1_epi16(c.bu)));
+
+        __m256i y0 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x)));
+        __m256i y1 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x + 16)));
+        y0 = _mm256_mullo_epi16(_mm256_sub_epi16(y0, yOff), yMul);
+        y1 = _mm256_mullo_epi16(_mm256_sub_epi16(y1, yOff), yMul);
+
+        __m256i r = packAvx2(_mm256_adds_epi16(y0, _mm256_unpacklo_epi16(rc, rc)),
+                             _mm256_adds_epi16(y1, _mm256_unpackhi_epi16(rc, rc)));
+        __m256i g = packAvx2(
+            _mm256_subs_epi16(_mm256_subs_epi16(y0, _mm256_unpacklo_epi16(guc, guc)),
+                              _mm256_unpacklo_epi16(gvc, gvc)),
+            _mm256_subs_epi16(_mm256_subs_epi16(y1, _mm256_unpackhi_epi16(guc, guc)),
+                              _mm256_unpackhi_epi16(gvc, gvc)));
+        __m256i b = packAvx2(_mm256_adds_epi16(y0, _mm256_unpacklo_epi16(bc, bc)),
+                             _mm256_adds_epi16(y1, _mm256_unpackhi_epi16(bc, bc)));
+        if (mirror) {
+            r = reverseAvx2(r);
+            g = reverseAvx2(g);
+            b = reverseAvx2(b);
+        }
+
+        // 按 128 位通道交错，再把两个通道的结果按像素顺序写出
+        __m256i rgLo = _mm256_unpacklo_epi8(r, g);
+        __m256i rgHi = _mm256_unpackhi_epi8(r, g);
+        __m256i baLo = _mm256_unpacklo_epi8(b, alpha);
+        __m256i baHi = _mm256_unpackhi_epi8(b, alpha);
+        __m256i p0 = _mm256_unpacklo_epi16(rgLo, baLo);
+        __m256i p1 = _mm256_unpackhi_epi16(rgLo, baLo);
+        __m256i p2 = _mm256_unpacklo_epi16(rgHi, baHi);
+        __m256i p3 = _mm256_unpackhi_epi16(rgHi, baHi);
+        auto out = reinterpret_cast<__m256i *>(dst + (mirror ? width - x - 32 : x) * 4);
+        _mm256_storeu_si256(out, _mm256_permute2x128_si256(p0, p1, 0x20));
+        _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(p2, p3, 0x20));
+        _mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(p0, p1, 0x31));
+        _mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+    }
+    rowScalarFrom(y, u, v, uvStep, dst, x, width, mirror, c);
+}
+#endif
+
+SimdLevel YuvConverter::detect() {
+#if defined(__ARM_NEON)
+    return SimdLevel::Neon;
+#elif defined(YUV_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::Avx2;
+    if (__builtin_cpu_supports("sse4.1")) return SimdLevel::Sse41;
+    return SimdLevel::Scalar;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const char * YuvConverter::levelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Neon: return "neon";
+        case SimdLevel::Sse41: return "sse4.1";
+        case SimdLevel::Avx2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+YuvConverter::YuvConverter(SimdLevel level): simd(SimdLevel::Scalar), row(rowScalar),
+coeffs(kCoeffs[0][0]) {
+    // 请求的级别在当前编译目标上不可用时退回标量实现
+#if defined(__ARM_NEON)
+    if (level == SimdLevel::Neon) {
+        simd = level;
+        row = rowNeon;
+    }
+#elif defined(YUV_X86)
+    if (level == SimdLevel::Avx2) {
+        simd = level;
+        row = rowAvx2;
+    } else if (level == SimdLevel::Sse41) {
+        simd = level;
+        row = rowSse41;
+    }
+#else
+    (void) level;
+#endif
+}
+
+void YuvConverter::setColor(YuvMatrix matrix, bool fullRange) {
+    coeffs = kCoeffs[static_cast<int>(matrix)][fullRange ? 1 : 0];
+}
+
+SimdLevel YuvConverter::level() const {
+    return simd;
+}
+
+void YuvConverter::convert(const YuvImage &src, uint8_t *dst, int dstStride) const {
+    convertRows(src, dst, dstStride, 0, src.height);
+}
+
+void YuvConverter::convertSpan(const YuvImage &src, int r, int x, int width, bool mirror,
+                               uint8_t *out) const {
+    const uint8_t *y = src.y + static_cast<ptrdiff_t>(r) * src.yStride + x;
+    const uint8_t *c = src.u + static_cast<ptrdiff_t>(r / 2) * src.uvStride;
+    switch (src.layout) {
+        case ChromaLayout::Planar:
+            row(y, c + x / 2, src.v + static_cast<ptrdiff_t>(r / 2) * src.uvStride + x / 2, 1,
+                out, width, mirror, coeffs);
+            break;
+        case ChromaLayout::NV12:
+            row(y, c + x, c + x + 1, 2, out, width, mirror, coeffs);
+            break;
+        case ChromaLayout::NV21:
+            row(y, c + x + 1, c + x, 2, out, width, mirror, coeffs);
+            break;
+    }
+}
+
+void YuvConverter::convertRows(const YuvImage &src, uint8_t *dst, int dstStride,
+                               int rowBegin, int rowEnd) const {
+    for (int r = rowBegin; r < std::min(rowEnd, src.height); ++r) {
+        convertSpan(src, r, 0, src.width, false, dst + static_cast<ptrdiff_t>(r) * dstStride);
+    }
+}
+
+void YuvConverter::convertRotated(const YuvImage &src, uint8_t *dst, int dstStride,
+                                  Rotation rotation, int rowBegin, int rowEnd) const {
+    if (rotation == Rotation::None) {
+        convertRows(src, dst, dstStride, rowBegin, rowEnd);
+        return;
+    }
+    int w = src.width;
+    int h = src.height;
+    auto dstRow = [dst, dstStride](int r) {
+        return reinterpret_cast<uint32_t *>(dst + static_cast<ptrdiff_t>(r) * dstStride);
+    };
+    if (rotation == Rotation::Cw180) {
+        // 目标第 r 行是源图像第 h-1-r 行的左右翻转，由行转换直接倒序写出
+        for (int r = rowBegin; r < std::min(rowEnd, h); ++r) {
+            convertSpan(src, h - 1 - r, 0, w, true, reinterpret_cast<uint8_t *>(dstRow(r)));
+        }
+        return;
+    }
+
+    // 一块源图像转换后的 RGBA，8 KB，转置时始终在 L1 缓存中
+    uint32_t tile[ROTATE_TILE_H * ROTATE_TILE_W];
+    // 90° 和 270° 时目标的一行是源图像的一列。每次转换 ROTATE_TILE_W 列 x ROTATE_TILE_H 行，
+    // 每个目标行连续写出 ROTATE_TILE_H 个像素（256 字节），写入的缓存行大多是完整的
+    rowEnd = std::min(rowEnd, w);
+    bool cw90 = rotation == Rotation::Cw90;
+    int colBegin = cw90 ? rowBegin : w - rowEnd;
+    int colEnd = cw90 ? rowEnd : w - rowBegin;
+    // 色度按两列共用，块的起点取偶数列，多转换的一列不写出
+    for (int x0 = colBegin & ~1; x0 < colEnd; x0 += ROTATE_TILE_W) {
+        int x1 = std::min(x0 + ROTATE_TILE_W, colEnd);
+        for (int y0 = 0; y0 < h; y0 += ROTATE_TILE_H) {
+            int rows = std::min(ROTATE_TILE_H, h - y0);
+            for (int i = 0; i < rows; ++i) {
+                convertSpan(src, y0 + i, x0, x1 - x0, false,
+                            reinterpret_cast<uint8_t *>(tile + i * ROTATE_TILE_W));
+            }
+            for (int x = std::max(x0, colBegin); x < x1; ++x) {
+                const uint32_t *col = tile + (x - x0);
+                if (cw90) {
+                    // 源像素 (x, y) 落在目标第 x 行第 h-1-y 列
+                    uint32_t *out = dstRow(x) + (h - 1 - y0);
+                    for (int i = 0; i < rows; ++i) out[-i] = col[i * ROTATE_TILE_W];
+                } else {
+                    // 源像素 (x, y) 落在目标第 w-1-x 行第 y 列
+                    uint32_t *out = dstRow(w - 1 - x) + y0;
+                    for (int i = 0; i < rows; ++i) out[i] = col[i * ROTATE_TILE_W];
+                }
+            }
+        }
+    }
+}
+
+static inline int align16(int x) {
+    return (x + 15) & ~15;
+}
+
+Yv12Layout yv12WindowLayout(int yStride, int height) {
+    Yv12Layout l{};
+    l.yStride = yStride;
+    l.cStride = align16(yStride / 2);
+    l.crOffset = static_cast<size_t>(yStride) * height;
+    l.cbOffset = l.crOffset + static_cast<size_t>(l.cStride) * (height / 2);
+    l.size = l.cbOffset + static_cast<size_t>(l.cStride) * (height / 2);
+    return l;
+}
+
+Yv12Layout yv12PackedLayout(int width, int height) {
+    Yv12Layout l{};
+    l.yStride = width;
+    l.cStride = width / 2;
+    l.crOffset = static_cast<size_t>(width) * height;
+    l.cbOffset = l.crOffset + static_cast<size_t>(l.cStride) * (height / 2);
+    l.size = l.cbOffset + static_cast<size_t>(l.cStride) * (height / 2);
+    return l;
+}
+
+void copyToYv12(const YuvImage &src, uint8_t *dst, const Yv12Layout &layout) {
+    for (int r = 0; r < src.height; ++r) {
+        memcpy(dst + static_cast<size_t>(r) * layout.yStride,
+               src.y + static_cast<ptrdiff_t>(r) * src.yStride, src.width);
+    }
+    int cw = src.width / 2;
+    uint8_t *cr = dst + layout.crOffset;
+    uint8_t *cb = dst + layout.cbOffset;
+    for (int r = 0; r < src.height / 2; ++r) {
+        const uint8_t *c = src.u + static_cast<ptrdiff_t>(r) * src.uvStride;
+        uint8_t *crRow = cr + static_cast<size_t>(r) * layout.cStride;
+        uint8_t *cbRow = cb + static_cast<size_t>(r) * layout.cStride;
+        if (src.layout == ChromaLayout::Planar) {
+            memcpy(cbRow, c, cw);
+            memcpy(crRow, src.v + static_cast<ptrdiff_t>(r) * src.uvStride, cw);
+            continue;
+        }
+        const uint8_t *uSrc = src.layout == ChromaLayout::NV12 ? c : c + 1;
+        const uint8_t *vSrc = src.layout == ChromaLayout::NV12 ? c + 1 : c;
+        for (int x = 0; x < cw; ++x) {
+            cbRow[x] = uSrc[2 * x];
+            crRow[x] = vSrc[2 * x];
+        }
+    }
+}
+
+// 旋转一个 8 位平面。src 的样本间隔为 step（交错的色度为 2），w、h 是源平面的尺寸，
+// 只写目标的 [rowBegin, rowEnd) 行，dst 指向目标的第 0 行
+static void rotatePlane(const uint8_t *src, int srcStride, int step, int w, int h,
+                        uint8_t *dst, int dstStride, Rotation rotation, int rowBegin, int rowEnd) {
+    if (rotation == Rotation::None || rotation == Rotation::Cw180) {
+        bool flip = rotation == Rotation::Cw180;
+        for (int r = rowBegin; r < std::min(rowEnd, h); ++r) {
+            const uint8_t *s = src + static_cast<ptrdiff_t>(flip ? h - 1 - r : r) * srcStride;
+            uint8_t *d = dst + static_cast<ptrdiff_t>(r) * dstStride;
+            if (!flip && step == 1) {
+                memcpy(d, s, w);
+            } else if (flip) {
+                for (int x = 0; x < w; ++x) d[w - 1 - x] = s[x * step];
+            } else {
+                for (int x = 0; x < w; ++x) d[x] = s[x * step];
+            }
+        }
+        return;
+    }
+    // 按 16x16 的块转置，一块的读写都落在少数几个缓存行内
+    rowEnd = std::min(rowEnd, w);
+    bool cw90 = rotation == Rotation::Cw90;
+    for (int r0 = rowBegin; r0 < rowEnd; r0 += 16) {
+        int r1 = std::min(r0 + 16, rowEnd);
+        for (int c0 = 0; c0 < h; c0 += 16) {
+            int c1 = std::min(c0 + 16, h);
+            for (int r = r0; r < r1; ++r) {
+                // 目标 (c, r)：顺时针 90° 取源图像 (r, h-1-c)，270° 取 (w-1-r, c)
+                const uint8_t *s = src + static_cast<ptrdiff_t>(cw90 ? r : w - 1 - r) * step;
+                uint8_t *d = dst + static_cast<ptrdiff_t>(r) * dstStride;
+                for (int c = c0; c < c1; ++c) {
+                    d[c] = s[static_cast<ptrdiff_t>(cw90 ? h - 1 - c : c) * srcStride];
+                }
+            }
+        }
+    }
+}
+
+void rotateToYv12(const YuvImage &src, uint8_t *dst, const Yv12Layout &layout, Rotation rotation,
+                  int rowBegin, int rowEnd) {
+    rotatePlane(src.y, src.yStride, 1, src.width, src.height, dst, layout.yStride,
+                rotation, rowBegin, rowEnd);
+    const uint8_t *u = src.u;
+    const uint8_t *v = src.v;
+    int step = 1;
+    if (src.layout != ChromaLayout::Planar) {
+        step = 2;
+        u = src.layout == ChromaLayout::NV12 ? src.u : src.u + 1;
+        v = src.layout == ChromaLayout::NV12 ? src.u + 1 : src.u;
+    }
+    int cw = src.width / 2;
+    int ch = src.height / 2;
+    rotatePlane(u, src.uvStride, step, cw, ch, dst + layout.cbOffset, layout.cStride,
+                rotation, rowBegin / 2, (rowEnd + 1) / 2);
+    rotatePlane(v, src.uvStride, step, cw, ch, dst + layout.crOffset, layout.cStride,
+                rotation, rowBegin / 2, (rowEnd + 1) / 2);
+}
+
+YuvImage yv12Image(const uint8_t *packed, int width, int height) {
+    Yv12Layout l = yv12PackedLayout(width, height);
+    return YuvImage{packed, packed + l.cbOffset, packed + l.crOffset,
+                    l.yStride, l.cStride, width, height, ChromaLayout::Planar};
+}
@@ -26,6 +26,7 @@ public class MainActivity extends AppCompatActivity {
     private Player player;
     private Handler mHandler;
     private SeekBar mSeekBar;
+    private Thread mProgressThread;
 
     @Override
     protected void onCreate(Bundle savedInstanceState) {
@@ -62,7 +63,7 @@ public class MainActivity extends AppCompatActivity {
 
             @Override
             public void surfaceChanged(@NonNull SurfaceHolder holder, int format, int width, int height) {
-
+                player.setSurfaceSize(width, height);
             }
 
             @Override
@@ -71,15 +72,16 @@ public class MainActivity extends AppCompatActivity {
             }
         });
 
-        Thread progressThread = new Thread(() -> {
+        // onDestroy 中断并等待这个线程退出之后才释放 player
+        mProgressThread = new Thread(() -> {
             int progress;
-            while (true) {
+            while (!Thread.currentThread().isInterrupted()) {
                 progress = (int) Math.round(player.getProgress() * 100);
                 setSeekBar(progress);
                 try {
                     Thread.sleep(500);
                 } catch (InterruptedException e) {
-                    throw new RuntimeException(e);
+                    return;
                 }
             }
         });
@@ -90,8 +92,8 @@ public class MainActivity extends AppCompatActivity {
                 case None:
                 case End:
                     player.start();
-                    if (!progressThread.isAlive())
-                        progressThread.start();
+                    if (!mProgressThread.isAlive())
+                        mProgressThread.start();
                     play.setText(R.string.pause);
                     break;
                 case Playing:
@@ -123,10 +125,18 @@ public class MainActivity extends AppCompatActivity {
                     speed.setText("3x");
                     break;
                 case "3x":
+                    player.setSpeed(8);
+                    speed.setText("8x");
+                    break;
+                case "8x":
                     player.setSpeed(0.5f);
                     speed.setText("0.5x");
                     break;
                 case "0.5x":
+                    player.setSpeed(-1);
+                    speed.setText("-1x");
+                    break;
+                case "-1x":
                     player.setSpeed(1);
                     speed.setText("1x");
                     break;
@@ -156,6 +166,20 @@ public class MainActivity extends AppCompatActivity {
         });
     }
 
+    @Override
+    protected void onDestroy() {
+        super.onDestroy();
+        mProgressThread.interrupt();
+        try {
+            mProgressThread.join();
+        } catch (InterruptedException e) {
+            Thread.currentThread().interrupt();
+        }
+        mHandler.removeCallbacksAndMessages(null);
+        player.stop();
+        player.release();
+    }
+
     private void setSeekBar(int progress) {
         Bundle bundle = new Bundle();
         bundle.putInt("progress", progress);
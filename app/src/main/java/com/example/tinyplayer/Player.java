@@ -16,6 +16,11 @@ public class Player {
     private PlayerState mState = PlayerState.None;
     private String fileUri;
     private double duration;
+    private int itemIndex;
+
+    public Player() {
+        nativeSetup();
+    }
 
     public void setDataSource(String uri) {
         fileUri = uri;
@@ -25,10 +30,112 @@ public class Player {
         mSurface = surface;
     }
 
+    /**
+     * Surface 尺寸变化时调用，画面按 Surface 尺寸缩放后再显示
+     */
+    public void setSurfaceSize(int width, int height) {
+        nativeSetSurfaceSize(width, height);
+    }
+
+    /**
+     * 颜色转换使用的分片（线程）数，0 表示自动选择，用于比较不同线程数下的转换速度
+     */
+    public void setConvertSlices(int slices) {
+        nativeSetConvertSlices(slices);
+    }
+
+    /**
+     * 视频滤镜链（libavfilter 语法，如 "yadif" 或 "crop=1280:720"），空字符串关闭
+     */
+    public void setVideoFilter(String desc) {
+        nativeSetVideoFilter(desc);
+    }
+
+    /**
+     * 音频滤镜链（如 "loudnorm"），空字符串关闭
+     */
+    public void setAudioFilter(String desc) {
+        nativeSetAudioFilter(desc);
+    }
+
+    /**
+     * 请求独占（MMAP）音频输出，延迟最低，适合拖动进度时试听等交互场景；设备不支持或
+     * 已被占用时自动使用共享模式，实际模式见 getStats() 中的 audioSharingMode
+     */
+    public void setExclusiveAudio(boolean exclusive) {
+        nativeSetExclusiveAudio(exclusive);
+    }
+
+    /**
+     * 音量，1 为原始音量，最大 4（超出范围的部分软削波），平滑过渡到新值
+     */
+    public void setVolume(float volume) {
+        nativeSetVolume(volume);
+    }
+
+    /**
+     * 5.1 / 7.1 下混到立体声时中置、环绕、低音声道的系数，默认 0.7071、0.7071、0
+     */
+    public void setDownmixLevels(float center, float surround, float lfe) {
+        nativeSetDownmixLevels(center, surround, lfe);
+    }
+
+    /**
+     * 响度归一化到 targetLufs（如 -18），优先使用 ReplayGain / R128 元数据，没有时边播放边估计，
+     * 并用真峰值限幅器防止削波。默认关闭，当前响度和增益见 getStats()
+     */
+    public void setLoudnessNormalization(boolean enabled, float targetLufs) {
+        nativeSetLoudnessNormalization(enabled, targetLufs);
+    }
+
+    /**
+     * 加入播放列表，当前文件播放完后无缝接着播放。下一项在后台提前打开，stop() 时清空
+     */
+    public void enqueue(String uri) {
+        nativeEnqueue(uri);
+    }
+
+    /**
+     * 清空还没有开始播放的列表项
+     */
+    public void clearQueue() {
+        nativeClearQueue();
+    }
+
+    /**
+     * 正在播放的是第几项，setDataSource 的文件为 0，之后按 enqueue 的顺序递增
+     */
+    public int getItemIndex() {
+        return nativeGetItemIndex();
+    }
+
+    /**
+     * A-B 循环播放 [start, end)，与 seek 一样按时长的比例。片段在 setLoopCacheBudget 的预算内时
+     * 第一遍之后从内存重放，不再读文件和跳转。seek 到区间外、快速浏览或倒放时自动取消，成功返回 0
+     */
+    public int setLoop(double start, double end) {
+        return nativeSetLoop(start, end);
+    }
+
+    /**
+     * 取消循环，从当前位置继续往后播放
+     */
+    public void clearLoop() {
+        nativeClearLoop();
+    }
+
+    /**
+     * 循环片段缓存 packet 和解码帧可使用的最大内存（字节），下一次 setLoop 生效
+     */
+    public void setLoopCacheBudget(long bytes) {
+        nativeSetLoopCacheBudget(bytes);
+    }
+
     public void start() {
         nativePlay(fileUri, mSurface);
         mState = PlayerState.Playing;
         duration = nativeGetDuration();
+        itemIndex = 0;
     }
 
     public void pause(boolean p) {
@@ -45,11 +152,40 @@ public class Player {
         mState = PlayerState.End;
     }
 
-    public void seek(double position) {
-        nativeSeek(position);
+    /**
+     * 跳转到时长的 position 比例处（0 ~ 1）。请求放进后台执行后立即返回，不等待跳转完成：
+     * 返回 0 只表示请求已经接受，没有打开文件时返回 -1。之后执行失败的次数见 getStats() 中的 seekFailures
+     */
+    public int seek(double position) {
+        return nativeSeek(position);
+    }
+
+    /**
+     * 暂停并显示下一帧。解码在后台进行，调用不等待画面显示，已经打开时返回 0
+     */
+    public int stepForward() {
+        mState = PlayerState.Paused;
+        return nativeStepForward();
+    }
+
+    /**
+     * 暂停并显示上一帧，与 stepForward 一样在后台执行
+     */
+    public int stepBackward() {
+        mState = PlayerState.Paused;
+        return nativeStepBackward();
     }
 
     public double getProgress() {
+        // 切换到播放列表的下一项后按新文件的时长计算
+        int index = nativeGetItemIndex();
+        if (index != itemIndex) {
+            itemIndex = index;
+            duration = nativeGetDuration();
+        }
+        if (duration <= 0) {
+            return 0;
+        }
         return nativeGetPosition() / duration;
     }
 
@@ -57,15 +193,60 @@ public class Player {
         return mState;
     }
 
-    public void setSpeed(float speed) {
-        nativeSetSpeed(speed);
+    /**
+     * 设置播放速度，正数为 (0, 32]，负数表示倒放（-4 ~ -0.25），超出范围时返回 -1，成功返回 0
+     */
+    public int setSpeed(float speed) {
+        return nativeSetSpeed(speed);
+    }
+
+    /**
+     * 倒放时缓存解码帧可使用的最大内存（字节），必须大于 0，成功返回 0
+     */
+    public int setReverseCacheBudget(long bytes) {
+        return nativeSetReverseCacheBudget(bytes);
+    }
+
+    public String getStats() {
+        return nativeGetStats();
+    }
+
+    /**
+     * 释放 native 播放器，可以重复调用。之后其他方法什么也不做，getProgress() 返回 0
+     */
+    public synchronized void release() {
+        if (nativeContext == 0) {
+            return;
+        }
+        nativeRelease();
+        mState = PlayerState.None;
     }
 
+    private native void nativeSetup();
+    private native void nativeRelease();
     private native int nativePlay(String file, Surface surface);
     private native void nativePause(boolean p);
     private native int nativeSeek(double position);
     private native void nativeStop();
     private native int nativeSetSpeed(float speed);
+    private native void nativeSetSurfaceSize(int width, int height);
+    private native void nativeSetConvertSlices(int slices);
+    private native void nativeSetVideoFilter(String desc);
+    private native void nativeSetAudioFilter(String desc);
+    private native void nativeSetExclusiveAudio(boolean exclusive);
+    private native void nativeSetVolume(float volume);
+    private native void nativeSetDownmixLevels(float center, float surround, float lfe);
+    private native void nativeSetLoudnessNormalization(boolean enabled, float targetLufs);
+    private native void nativeEnqueue(String file);
+    private native void nativeClearQueue();
+    private native int nativeGetItemIndex();
+    private native int nativeSetLoop(double start, double end);
+    private native void nativeClearLoop();
+    private native void nativeSetLoopCacheBudget(long bytes);
+    private native int nativeStepForward();
+    private native int nativeStepBackward();
     private native double nativeGetPosition();
     private native double nativeGetDuration();
+    private native int nativeSetReverseCacheBudget(long bytes);
+    private native String nativeGetStats();
 }
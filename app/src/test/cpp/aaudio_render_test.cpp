@@ -0,0 +1,315 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include "unit_test.h"
+#include "fake_aaudio.h"
+#include "aaudio_render.h"
+#include "buffer_tuner.h"
+
+namespace {
+
+// 回调输出固定的样本，每 slowEvery 次回调耗时 slowUs，模拟调度抖动造成的欠载
+struct Client {
+    AAudioRender render;
+    std::atomic<int> calls{0};
+    std::atomic<int> slowEvery{0};
+    std::atomic<int> slowUs{0};
+
+    Client() {
+        render.configure(AAUDIO_UNSPECIFIED, 2, AAUDIO_FORMAT_PCM_FLOAT);
+        render.setCallback(callback, this);
+    }
+
+    static int callback(AAudioStream *, void *userData, void *audioData, int32_t numFrames) {
+        auto self = static_cast<Client *>(userData);
+        int n = ++self->calls;
+        memset(audioData, 0, static_cast<size_t>(numFrames) * self->render.frameBytes());
+        int every = self->slowEvery;
+        if (every > 0 && n % every == 0) std::this_thread::sleep_for(std::chrono::microseconds(self->slowUs));
+        return 0;
+    }
+};
+
+// 与 Player 的 audioControl 阶段一样反复调用 control() 直到到达目标状态
+bool settle(AAudioRender &render) {
+    for (int i = 0; i < 1000; ++i) {
+        int64_t delay = render.control();
+        if (delay == 0) return true;
+        std::this_thread::sleep_for(std::chrono::microseconds(delay));
+    }
+    return false;
+}
+
+void sleepMs(int ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+int64_t nowUs() {
+    return fakeAudioNowNs() / 1000;
+}
+
+void resetDevice() {
+    fakeAudioDevice = FakeAudioDevice();
+}
+
+}
+
+TEST(AudioBufferTuner, GrowsOnXRunsAndShrinksAfterStablePeriod) {
+    AudioBufferTuner tuner;
+    EXPECT_EQ(tuner.reset(192, 192 * 4), 192 * AUDIO_MIN_BUFFER_BURSTS);
+    EXPECT_EQ(tuner.update(0, 0), 0);           // 第一次调用只记录基准
+    EXPECT_EQ(tuner.update(2, 1000), 384);
+    EXPECT_EQ(tuner.update(3, 2000), 576);
+    EXPECT_EQ(tuner.update(3, 2000 + AUDIO_STABLE_PERIOD_US - 1), 0);
+    EXPECT_EQ(tuner.update(3, 2000 + AUDIO_STABLE_PERIOD_US), 384);
+    EXPECT_EQ(tuner.grows(), 2);
+    EXPECT_EQ(tuner.shrinks(), 1);
+}
+
+TEST(AudioBufferTuner, StopsAtCapacityAndMinimum) {
+    AudioBufferTuner tuner;
+    tuner.reset(100, 250);
+    tuner.update(0, 0);
+    EXPECT_EQ(tuner.update(1, 1), 200);
+    EXPECT_EQ(tuner.update(2, 2), 0);           // 再加一个 burst 超出容量
+    EXPECT_EQ(tuner.bufferFrames(), 200);
+    EXPECT_EQ(tuner.update(2, 2 + AUDIO_STABLE_PERIOD_US), 100);
+    EXPECT_EQ(tuner.update(2, 2 + 3LL * AUDIO_STABLE_PERIOD_US), 0);
+    EXPECT_EQ(tuner.bufferFrames(), 100);
+}
+
+TEST(AudioBufferTuner, BacksOffAfterShrinkThenXRun) {
+    AudioBufferTuner tuner;
+    tuner.reset(100, 1000);
+    tuner.update(0, 0);
+    tuner.update(1, 0);                         // 200
+    int64_t t = AUDIO_STABLE_PERIOD_US;
+    EXPECT_EQ(tuner.update(1, t), 100);
+    // 缩小后的稳定期内又欠载：加大，之后的稳定期加倍
+    EXPECT_EQ(tuner.update(2, t + 10), 200);
+    EXPECT_EQ(tuner.update(2, t + 10 + AUDIO_STABLE_PERIOD_US), 0);
+    EXPECT_EQ(tuner.update(2, t + 10 + 2LL * AUDIO_STABLE_PERIOD_US), 100);
+}
+
+TEST(AAudioRender, OpensAtDeviceNativeRateAndFormat) {
+    resetDevice();
+    fakeAudioDevice.sampleRate = 44100;
+    fakeAudioDevice.floatSupported = false;
+    Client client;
+    ASSERT_EQ(client.render.open(), 0);
+    EXPECT_EQ(client.render.sampleRate(), 44100);
+    EXPECT_EQ(client.render.channelCount(), 2);
+    EXPECT_EQ(client.render.format(), AAUDIO_FORMAT_PCM_I16);
+    EXPECT_FALSE(client.render.floatOutput());
+    EXPECT_EQ(client.render.frameBytes(), 2 * sizeof(int16_t));
+    EXPECT_EQ(client.render.performanceMode(), AAUDIO_PERFORMANCE_MODE_LOW_LATENCY);
+}
+
+TEST(AAudioRender, ExclusiveFallsBackToShared) {
+    resetDevice();
+    fakeAudioDevice.exclusiveSupported = false;
+    Client client;
+    client.render.setExclusive(true);
+    ASSERT_EQ(client.render.open(), 0);
+    EXPECT_EQ(client.render.sharingMode(), AAUDIO_SHARING_MODE_SHARED);
+    EXPECT_EQ(client.render.fallbacks(), 1);
+}
+
+TEST(AAudioRender, StartsAtOneBurstAndPlaysFromCallbacks) {
+    resetDevice();
+    Client client;
+    ASSERT_EQ(client.render.open(), 0);
+    AAudioStream *stream = fakeAudioStream();
+    ASSERT_TRUE(stream != nullptr);
+    EXPECT_EQ(client.render.burstFrames(), 192);
+    EXPECT_EQ(client.render.bufferFrames(), 192 * AUDIO_MIN_BUFFER_BURSTS);
+    EXPECT_EQ(AAudioStream_getBufferSizeInFrames(stream), 192 * AUDIO_MIN_BUFFER_BURSTS);
+
+    client.render.requestFlush();
+    client.render.play(true);
+    EXPECT_TRUE(client.render.muted());
+    ASSERT_TRUE(settle(client.render));
+    EXPECT_FALSE(client.render.muted());
+    EXPECT_EQ(AAudioStream_getState(stream), AAUDIO_STREAM_STATE_STARTED);
+    EXPECT_GE(client.render.transitions(), 1);
+
+    sleepMs(100);
+    // 4ms 一个 burst，100ms 内设备读走约 25 个 burst，回调在每次读走之后补上
+    int64_t read = AAudioStream_getFramesRead(stream);
+    EXPECT_GE(read, 192 * 10);
+    EXPECT_GE(client.calls.load(), 10);
+    EXPECT_LE(AAudioStream_getFramesWritten(stream) - read, 192 * AUDIO_MIN_BUFFER_BURSTS);
+
+    client.render.play(false);
+    ASSERT_TRUE(settle(client.render));
+    EXPECT_EQ(AAudioStream_getState(stream), AAUDIO_STREAM_STATE_PAUSED);
+    int calls = client.calls;
+    sleepMs(30);
+    EXPECT_EQ(client.calls.load(), calls);
+}
+
+TEST(AAudioRender, MeasuresLatencyFromTimestamps) {
+    resetDevice();
+    Client client;
+    ASSERT_EQ(client.render.open(), 0);
+    client.render.play(true);
+    ASSERT_TRUE(settle(client.render));
+    AAudioStream *stream = fakeAudioStream();
+    sleepMs(60);
+    client.render.tune(nowUs());
+    int64_t latency = client.render.latencyUs();
+    // 设备缓冲区（一个 burst）加上设备的播放延迟，另外允许一个 burst 的调度误差
+    int32_t rate = client.render.sampleRate();
+    int64_t bound = (static_cast<int64_t>(client.render.bufferFrames()) + stream->presentation + stream->burst) *
+                    1000000 / rate;
+    EXPECT_GT(latency, 0) << "latency " << latency;
+    EXPECT_LE(latency, bound) << "latency " << latency << " bound " << bound;
+}
+
+TEST(AAudioRender, GrowsBufferOnXRunsAndShrinksWhenStable) {
+    resetDevice();
+    fakeAudioDevice.capacityBursts = 8;
+    Client client;
+    ASSERT_EQ(client.render.open(), 0);
+    client.render.play(true);
+    ASSERT_TRUE(settle(client.render));
+    AAudioStream *stream = fakeAudioStream();
+    int32_t burst = client.render.burstFrames();
+
+    // 每 10 次回调有一次耽误 3 个 burst 周期，缓冲区只有一个 burst 时必然欠载
+    client.slowUs = 12000;
+    client.slowEvery = 10;
+    for (int i = 0; i < 40 && client.render.bufferFrames() < 4 * burst; ++i) {
+        sleepMs(50);
+        client.render.tune(nowUs());
+    }
+    EXPECT_GT(client.render.xruns(), 0);
+    EXPECT_LE(client.render.xruns(), stream->xruns.load());
+    EXPECT_GE(client.render.bufferGrows(), 1);
+    EXPECT_GT(client.render.bufferFrames(), burst);
+    EXPECT_EQ(stream->bufferSize, client.render.bufferFrames());
+
+    // 不再耽误，稳定期过后每次缩小一个 burst。tune() 使用调用方给的时间，这里直接跳过稳定期
+    client.slowEvery = 0;
+    sleepMs(20);
+    int32_t grown = client.render.bufferFrames();
+    int64_t t = nowUs();
+    client.render.tune(t);
+    client.render.tune(t + AUDIO_STABLE_PERIOD_US);
+    EXPECT_EQ(client.render.bufferFrames(), grown - burst);
+    EXPECT_EQ(client.render.bufferShrinks(), 1);
+}
+
+TEST(AAudioRender, PausedStreamDoesNotCountTowardsStability) {
+    resetDevice();
+    Client client;
+    ASSERT_EQ(client.render.open(), 0);
+    AAudioStream *stream = fakeAudioStream();
+    // 没有播放时 tune() 不读欠载次数，也不调整缓冲区
+    int calls = stream->bufferSizeCalls;
+    client.render.tune(0);
+    client.render.tune(10LL * AUDIO_STABLE_PERIOD_US);
+    EXPECT_EQ(stream->bufferSizeCalls.load(), calls);
+    EXPECT_EQ(client.render.bufferShrinks(), 0);
+}
+
+TEST(AAudioRender, FlushPausesFlushesAndRestarts) {
+    resetDevice();
+    Client client;
+    ASSERT_EQ(client.render.open(), 0);
+    client.render.play(true);
+    ASSERT_TRUE(settle(client.render));
+    AAudioStream *stream = fakeAudioStream();
+    sleepMs(20);
+
+    client.render.requestFlush();
+    EXPECT_TRUE(client.render.muted());
+    ASSERT_TRUE(settle(client.render));
+    EXPECT_FALSE(client.render.muted());
+    EXPECT_EQ(AAudioStream_getState(stream), AAUDIO_STREAM_STATE_STARTED);
+    EXPECT_EQ(client.render.transitions(), 2);
+    EXPECT_GE(stream->startRequests.load(), 2);
+}
+
+TEST(AAudioRender, ReopensAfterDisconnect) {
+    resetDevice();
+    Client client;
+    ASSERT_EQ(client.render.open(), 0);
+    client.render.play(true);
+    ASSERT_TRUE(settle(client.render));
+    AAudioStream *old = fakeAudioStream();
+
+    // 换到另一个原生采样率的设备
+    fakeAudioDevice.sampleRate = 44100;
+    fakeAudioDisconnect(old);
+    for (int i = 0; i < 100 && !client.render.needsReopen(); ++i) sleepMs(1);
+    ASSERT_TRUE(client.render.needsReopen());
+    ASSERT_EQ(client.render.reopen(), 0);
+    EXPECT_FALSE(client.render.needsReopen());
+    EXPECT_EQ(client.render.reopens(), 1);
+    EXPECT_EQ(client.render.sampleRate(), 44100);
+    ASSERT_TRUE(settle(client.render));
+    AAudioStream *stream = fakeAudioStream();
+    sleepMs(20);
+    EXPECT_EQ(AAudioStream_getState(stream), AAUDIO_STREAM_STATE_STARTED);
+    EXPECT_GT(AAudioStream_getFramesRead(stream), 0);
+}
+
+TEST(AAudioRender, GivesUpOnPersistentStartFailureAndReopens) {
+    resetDevice();
+    fakeAudioDevice.startFailures = -1;
+    Client client;
+    ASSERT_EQ(client.render.open(), 0);
+    client.render.play(true);
+    // 连续失败有上限，不会每 2ms 一直重试下去
+    int steps = 0;
+    while (client.render.control() > 0 && steps < 1000) steps++;
+    EXPECT_EQ(steps, AUDIO_START_MAX_RETRIES - 1);
+    EXPECT_EQ(client.render.startFailures(), AUDIO_START_MAX_RETRIES);
+    EXPECT_EQ(client.render.startGiveUps(), 1);
+    EXPECT_TRUE(client.render.needsReopen());
+
+    // 仍然失败时 reopen() 报错，并保留重新打开的请求
+    EXPECT_LT(client.render.reopen(), 0);
+    EXPECT_TRUE(client.render.needsReopen());
+    EXPECT_EQ(client.render.startFailures(), AUDIO_START_MAX_RETRIES + 1);
+
+    fakeAudioDevice.startFailures = 0;
+    ASSERT_EQ(client.render.reopen(), 0);
+    EXPECT_FALSE(client.render.needsReopen());
+    ASSERT_TRUE(settle(client.render));
+    EXPECT_FALSE(client.render.muted());
+    EXPECT_EQ(AAudioStream_getState(fakeAudioStream()), AAUDIO_STREAM_STATE_STARTED);
+}
+
+TEST(AAudioRender, RetriesTransientStartFailure) {
+    resetDevice();
+    fakeAudioDevice.startFailures = 2;
+    Client client;
+    ASSERT_EQ(client.render.open(), 0);
+    client.render.play(true);
+    ASSERT_TRUE(settle(client.render));
+    EXPECT_EQ(client.render.startFailures(), 2);
+    EXPECT_EQ(client.render.startGiveUps(), 0);
+    EXPECT_FALSE(client.render.needsReopen());
+    EXPECT_EQ(AAudioStream_getState(fakeAudioStream()), AAUDIO_STREAM_STATE_STARTED);
+}
+
+// close() 返回之后回调不再执行，control() 也不会重新打开流
+TEST(AAudioRender, CloseStopsCallbacksSynchronously) {
+    resetDevice();
+    Client client;
+    ASSERT_EQ(client.render.open(), 0);
+    client.render.play(true);
+    ASSERT_TRUE(settle(client.render));
+    sleepMs(20);
+    EXPECT_GT(client.calls.load(), 0);
+    client.render.close();
+    EXPECT_EQ(fakeAudioStream(), nullptr);
+    int calls = client.calls;
+    sleepMs(20);
+    EXPECT_EQ(client.calls.load(), calls);
+    EXPECT_EQ(client.render.control(), 0);
+    EXPECT_EQ(fakeAudioStream(), nullptr);
+}
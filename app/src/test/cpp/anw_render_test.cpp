@@ -0,0 +1,202 @@
+#include <vector>
+#include "unit_test.h"
+#include "fake_window.h"
+#include "anw_render.h"
+#include "yuv_convert.h"
+
+namespace {
+
+// 紧凑 YV12 测试数据：Y、Cr、Cb 三个平面用不同的取值范围，错位时容易发现
+std::vector<uint8_t> packedYv12(int w, int h) {
+    Yv12Layout l = yv12PackedLayout(w, h);
+    std::vector<uint8_t> data(l.size);
+    for (int r = 0; r < h; ++r) {
+        for (int x = 0; x < w; ++x) data[r * w + x] = static_cast<uint8_t>((r * 7 + x) % 100);
+    }
+    for (int r = 0; r < h / 2; ++r) {
+        for (int x = 0; x < w / 2; ++x) {
+            data[l.crOffset + r * l.cStride + x] = static_cast<uint8_t>(100 + (r + x) % 50);
+            data[l.cbOffset + r * l.cStride + x] = static_cast<uint8_t>(160 + (r * 3 + x) % 50);
+        }
+    }
+    return data;
+}
+
+int align16(int x) {
+    return (x + 15) & ~15;
+}
+
+// 按 HAL_PIXEL_FORMAT_YV12 的规定独立计算布局，逐字节检查窗口缓冲区：
+// 可见部分与源数据一致，行尾的填充没有被写过
+void checkYv12(const ANativeWindow &win, const std::vector<uint8_t> &src, int w, int h) {
+    int yStride = win.stride;
+    int cStride = align16(yStride / 2);
+    size_t crOffset = static_cast<size_t>(yStride) * h;
+    size_t cbOffset = crOffset + static_cast<size_t>(cStride) * (h / 2);
+    ASSERT_EQ(win.posted.size(), cbOffset + static_cast<size_t>(cStride) * (h / 2));
+    Yv12Layout packed = yv12PackedLayout(w, h);
+    int wrong = 0;
+    int padding = 0;
+    for (int r = 0; r < h; ++r) {
+        for (int x = 0; x < yStride; ++x) {
+            uint8_t v = win.posted[r * yStride + x];
+            if (x < w && v != src[r * w + x]) wrong++;
+            if (x >= w && v != FAKE_WINDOW_POISON) padding++;
+        }
+    }
+    for (int r = 0; r < h / 2; ++r) {
+        for (int x = 0; x < cStride; ++x) {
+            uint8_t cr = win.posted[crOffset + r * cStride + x];
+            uint8_t cb = win.posted[cbOffset + r * cStride + x];
+            if (x < w / 2) {
+                if (cr != src[packed.crOffset + r * packed.cStride + x]) wrong++;
+                if (cb != src[packed.cbOffset + r * packed.cStride + x]) wrong++;
+            } else if (cr != FAKE_WINDOW_POISON || cb != FAKE_WINDOW_POISON) {
+                padding++;
+            }
+        }
+    }
+    EXPECT_EQ(wrong, 0);
+    EXPECT_EQ(padding, 0);
+}
+
+}  // namespace
+
+// 行距按 16 和 64 像素对齐、色度行距需要再对齐（stride / 2 不是 16 的倍数）的几种尺寸
+TEST(AnwRender, Yv12PlaneLayoutAndStride) {
+    const int sizes[][2] = {{100, 20}, {96, 10}, {176, 144}, {34, 6}};
+    for (int align : {16, 64}) {
+        for (auto &size : sizes) {
+            int w = size[0];
+            int h = size[1];
+            ANativeWindow win;
+            win.strideAlign = align;
+            ANWRender render;
+            render.init(&win);
+            ASSERT_EQ(render.setBuffers(w, h, RenderFormat::YV12), 0);
+            ASSERT_TRUE(render.format() == RenderFormat::YV12);
+            auto src = packedYv12(w, h);
+            ASSERT_EQ(render.render(src.data()), 0);
+            ASSERT_EQ(win.postCount, 1);
+            checkYv12(win, src, w, h);
+            render.init(nullptr);
+        }
+    }
+}
+
+TEST(AnwRender, RgbaRespectsStride) {
+    ANativeWindow win;
+    win.strideAlign = 64;
+    ANWRender render;
+    render.init(&win);
+    const int w = 70, h = 5;
+    ASSERT_EQ(render.setBuffers(w, h, RenderFormat::RGBA), 0);
+    std::vector<uint8_t> src(w * h * 4);
+    for (size_t i = 0; i < src.size(); ++i) src[i] = static_cast<uint8_t>(i * 31);
+    ASSERT_EQ(render.render(src.data()), 0);
+    int wrong = 0;
+    for (int r = 0; r < h; ++r) {
+        for (int x = 0; x < win.stride * 4; ++x) {
+            uint8_t v = win.posted[r * win.stride * 4 + x];
+            if (x < w * 4 ? v != src[r * w * 4 + x] : v != FAKE_WINDOW_POISON) wrong++;
+        }
+    }
+    EXPECT_EQ(wrong, 0);
+    render.init(nullptr);
+}
+
+// 窗口不接受 YV12 的几何设置时直接退回 RGBA
+TEST(AnwRender, FallbackWhenGeometryRejected) {
+    ANativeWindow win;
+    win.accepted.erase(FAKE_WINDOW_YV12);
+    ANWRender render;
+    render.init(&win);
+    EXPECT_EQ(render.setBuffers(64, 32, RenderFormat::YV12), 0);
+    EXPECT_TRUE(render.format() == RenderFormat::RGBA);
+    EXPECT_EQ(render.fallbacks(), 1);
+    EXPECT_EQ(win.format, WINDOW_FORMAT_RGBA_8888);
+    render.init(nullptr);
+}
+
+// 接受 YV12 的几何设置、锁定时却给出 RGBA 缓冲区：这一帧转换成 RGBA 写入后再提交，
+// 不能提交未写入的缓冲区，之后改用 RGBA
+TEST(AnwRender, FallbackWhenLockedBufferIsNotYv12) {
+    ANativeWindow win;
+    win.lockFormat = WINDOW_FORMAT_RGBA_8888;
+    ANWRender render;
+    render.init(&win);
+    const int w = 64, h = 16;
+    ASSERT_EQ(render.setBuffers(w, h, RenderFormat::YV12), 0);
+    auto src = packedYv12(w, h);
+    EXPECT_EQ(render.render(src.data()), 0);
+    ASSERT_EQ(win.postCount, 1);
+    EXPECT_EQ(render.fallbacks(), 1);
+    EXPECT_TRUE(render.format() == RenderFormat::RGBA);
+
+    std::vector<uint8_t> expected(w * h * 4);
+    YuvConverter conv;
+    conv.convert(yv12Image(src.data(), w, h), expected.data(), w * 4);
+    int wrong = 0;
+    for (int r = 0; r < h; ++r) {
+        for (int x = 0; x < w * 4; ++x) {
+            if (win.posted[r * win.stride * 4 + x] != expected[r * w * 4 + x]) wrong++;
+        }
+    }
+    EXPECT_EQ(wrong, 0);
+    render.init(nullptr);
+}
+
+// 锁定失败时没有缓冲区可以提交，返回失败并退回 RGBA
+TEST(AnwRender, FallbackWhenLockFails) {
+    ANativeWindow win;
+    ANWRender render;
+    render.init(&win);
+    ASSERT_EQ(render.setBuffers(32, 8, RenderFormat::YV12), 0);
+    win.failLock = true;
+    auto src = packedYv12(32, 8);
+    EXPECT_NE(render.render(src.data()), 0);
+    EXPECT_EQ(win.postCount, 0);
+    EXPECT_EQ(render.fallbacks(), 1);
+    EXPECT_TRUE(render.format() == RenderFormat::RGBA);
+    render.init(nullptr);
+}
+
+// 是否支持 YV12 按窗口记录，换了窗口后重新尝试
+TEST(AnwRender, FallbackCountResetsForNewWindow) {
+    ANativeWindow rejecting;
+    rejecting.accepted.erase(FAKE_WINDOW_YV12);
+    ANativeWindow accepting;
+    ANWRender render;
+    render.init(&rejecting);
+    render.setBuffers(32, 8, RenderFormat::YV12);
+    EXPECT_EQ(render.fallbacks(), 1);
+    render.init(&rejecting);
+    EXPECT_EQ(render.fallbacks(), 1);
+    render.init(&accepting);
+    EXPECT_EQ(render.fallbacks(), 0);
+    EXPECT_EQ(render.setBuffers(32, 8, RenderFormat::YV12), 0);
+    EXPECT_TRUE(render.format() == RenderFormat::YV12);
+    render.init(nullptr);
+}
+
+// dataspace 只在变化时设置给窗口，换了窗口后重新设置
+TEST(AnwRender, DataSpaceSetOnlyOnChange) {
+    ANativeWindow first;
+    ANativeWindow second;
+    ANWRender render;
+    render.init(&first);
+    render.setDataSpace(ADATASPACE_UNKNOWN);
+    EXPECT_EQ(first.dataSpaceCalls, 0);
+    int32_t bt2020 = ADATASPACE_STANDARD_BT2020 | ADATASPACE_TRANSFER_SMPTE_170M | ADATASPACE_RANGE_LIMITED;
+    render.setDataSpace(bt2020);
+    render.setDataSpace(bt2020);
+    EXPECT_EQ(first.dataSpaceCalls, 1);
+    EXPECT_EQ(first.dataSpace, bt2020);
+    render.init(&second);
+    render.setDataSpace(bt2020);
+    EXPECT_EQ(second.dataSpaceCalls, 1);
+    EXPECT_EQ(second.dataSpace, bt2020);
+    render.setDataSpace(ADATASPACE_UNKNOWN);
+    EXPECT_EQ(second.dataSpace, ADATASPACE_UNKNOWN);
+    render.init(nullptr);
+}
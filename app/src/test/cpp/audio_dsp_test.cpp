@@ -0,0 +1,56 @@
+#include <cmath>
+#include <random>
+#include <vector>
+#include "audio_dsp.h"
+#include "unit_test.h"
+
+namespace {
+
+std::vector<SimdLevel> availableLevels() {
+    std::vector<SimdLevel> levels{SimdLevel::Scalar};
+    SimdLevel best = YuvConverter::detect();
+    if (best == SimdLevel::Neon) levels.push_back(SimdLevel::Neon);
+    if (best == SimdLevel::Sse41 || best == SimdLevel::Avx2) levels.push_back(SimdLevel::Sse41);
+    if (best == SimdLevel::Avx2) levels.push_back(SimdLevel::Avx2);
+    return levels;
+}
+
+}  // namespace
+
+// 各级别的峰值一致，长度不是向量宽度整数倍时尾部也参与比较
+TEST(AudioDsp, PeakMatchesScalarAtEveryLength) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> dist(-0.8f, 0.8f);
+    for (SimdLevel level : availableLevels()) {
+        AudioDsp dsp(level);
+        for (size_t n : {0u, 1u, 3u, 7u, 8u, 15u, 17u, 1023u}) {
+            std::vector<float> buf(n);
+            for (auto &s : buf) s = dist(rng);
+            float expected = 0;
+            for (float s : buf) expected = std::max(expected, std::fabs(s));
+            EXPECT_EQ(dsp.peak(buf.data(), n), expected) << YuvConverter::levelName(level) << " n=" << n;
+            if (n == 0) continue;
+            // 负的峰值放在最后一个样本
+            buf[n - 1] = -1.25f;
+            EXPECT_EQ(dsp.peak(buf.data(), n), 1.25f) << YuvConverter::levelName(level) << " n=" << n;
+        }
+    }
+}
+
+// 超出满幅的一段软削波之后不超过 1，膝点以下的样本不变
+TEST(AudioDsp, SoftClipBoundsHotBlock) {
+    for (SimdLevel level : availableLevels()) {
+        AudioDsp dsp(level);
+        std::vector<float> buf(1001);
+        for (size_t i = 0; i < buf.size(); ++i) buf[i] = 1.5f * std::sin(0.05f * i);
+        std::vector<float> orig = buf;
+        ASSERT_GT(dsp.peak(buf.data(), buf.size()), 1.0f);
+        EXPECT_GT(dsp.softClip(buf.data(), buf.size()), 0u);
+        EXPECT_LE(dsp.peak(buf.data(), buf.size()), 1.0f) << YuvConverter::levelName(level);
+        for (size_t i = 0; i < buf.size(); ++i) {
+            if (std::fabs(orig[i]) < AUDIO_SOFT_CLIP_KNEE) {
+                EXPECT_EQ(buf[i], orig[i]);
+            }
+        }
+    }
+}
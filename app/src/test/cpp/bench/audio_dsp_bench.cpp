@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "audio_dsp.h"
+
+// 各 SIMD 级别的 AudioDsp 运算吞吐量（百万样本/秒，下混按输入样本计，与 Player::dumpStats()
+// 中的 downmixMsamplesPerSec 等一致），单线程，每种情况取最好的一轮。
+// 每次处理 1 秒 48kHz 的交错 PCM，原地运算在计时之外先从源数据复制一份。
+//   softClip quiet / hot —— 峰值 0.5 / 1.5 的信号，前者只做比较，后者大部分样本被压缩；
+//   peak+clip quiet     —— Player::outputAudio() 现在的做法：先求峰值，不超出满幅就不软削波。
+// NEON 实现只在 ARM 目标上编译，开发机上只能测标量、SSE4.1 和 AVX2。
+// 用法：audio_dsp_bench [--quick]
+
+using Clock = std::chrono::steady_clock;
+
+#define RATE 48000
+
+template <typename Prepare, typename Fn>
+static double bestMsamplesPerSec(size_t samples, int iterations, Prepare &&prepare, Fn &&fn) {
+    double best = 0;
+    for (int round = 0; round < 3; ++round) {
+        double sec = 0;
+        for (int i = 0; i < iterations; ++i) {
+            prepare();
+            auto begin = Clock::now();
+            fn();
+            sec += std::chrono::duration<double>(Clock::now() - begin).count();
+        }
+        best = std::max(best, static_cast<double>(samples) * iterations / sec / 1e6);
+    }
+    return best;
+}
+
+static void fillSine(std::vector<float> &buf, int channels, float amplitude) {
+    size_t frames = buf.size() / channels;
+    for (size_t i = 0; i < frames; ++i) {
+        for (int c = 0; c < channels; ++c) {
+            buf[i * channels + c] = amplitude * static_cast<float>(sin(2 * M_PI * (440.0 + 110 * c) * i / RATE));
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+    int iterations = quick ? 2 : 200;
+    std::vector<SimdLevel> levels{SimdLevel::Scalar};
+    SimdLevel best = YuvConverter::detect();
+    if (best == SimdLevel::Neon) levels.push_back(SimdLevel::Neon);
+    if (best == SimdLevel::Sse41 || best == SimdLevel::Avx2) levels.push_back(SimdLevel::Sse41);
+    if (best == SimdLevel::Avx2) levels.push_back(SimdLevel::Avx2);
+
+    size_t stereo = RATE * 2;
+    std::vector<float> quiet(stereo), hot(stereo), work(stereo);
+    fillSine(quiet, 2, 0.5f);
+    fillSine(hot, 2, 1.5f);
+    std::vector<int16_t> s16(stereo);
+    std::vector<float> surround6(RATE * 6), surround8(RATE * 8);
+    fillSine(surround6, 6, 0.5f);
+    fillSine(surround8, 8, 0.5f);
+    float matrix6[2 * MAX_DOWNMIX_CHANNELS], matrix8[2 * MAX_DOWNMIX_CHANNELS];
+    stereoDownmixMatrix(6, 1.0f, 1.0f, 0.0f, matrix6);
+    stereoDownmixMatrix(8, 1.0f, 1.0f, 0.0f, matrix8);
+
+    printf("%-18s", "kernel");
+    for (SimdLevel level : levels) printf(" %10s", YuvConverter::levelName(level));
+    printf("   (Msamples/s)\n");
+
+    auto none = [] {};
+    auto copyQuiet = [&] { memcpy(work.data(), quiet.data(), stereo * sizeof(float)); };
+    auto copyHot = [&] { memcpy(work.data(), hot.data(), stereo * sizeof(float)); };
+    volatile float sink = 0;
+    const char *names[] = {"floatToS16", "s16ToFloat", "gainRamp", "downmix 5.1", "downmix 7.1",
+                           "peak", "softClip quiet", "softClip hot", "peak+clip quiet"};
+    for (const char *name : names) {
+        printf("%-18s", name);
+        for (SimdLevel level : levels) {
+            AudioDsp dsp(level);
+            double rate = 0;
+            if (strcmp(name, "floatToS16") == 0) {
+                rate = bestMsamplesPerSec(stereo, iterations, none, [&] {
+                    dsp.floatToS16(quiet.data(), s16.data(), stereo);
+                });
+            } else if (strcmp(name, "s16ToFloat") == 0) {
+                rate = bestMsamplesPerSec(stereo, iterations, none, [&] {
+                    dsp.s16ToFloat(s16.data(), work.data(), stereo);
+                });
+            } else if (strcmp(name, "gainRamp") == 0) {
+                rate = bestMsamplesPerSec(stereo, iterations, copyQuiet, [&] {
+                    dsp.gainRamp(work.data(), stereo, 0.5f, 0.8f);
+                });
+            } else if (strcmp(name, "downmix 5.1") == 0) {
+                rate = bestMsamplesPerSec(surround6.size(), iterations, none, [&] {
+                    dsp.downmixStereo(surround6.data(), 6, matrix6, work.data(), RATE);
+                });
+            } else if (strcmp(name, "downmix 7.1") == 0) {
+                rate = bestMsamplesPerSec(surround8.size(), iterations, none, [&] {
+                    dsp.downmixStereo(surround8.data(), 8, matrix8, work.data(), RATE);
+                });
+            } else if (strcmp(name, "peak") == 0) {
+                rate = bestMsamplesPerSec(stereo, iterations, none, [&] {
+                    sink = dsp.peak(quiet.data(), stereo);
+                });
+            } else if (strcmp(name, "softClip quiet") == 0) {
+                rate = bestMsamplesPerSec(stereo, iterations, copyQuiet, [&] {
+                    dsp.softClip(work.data(), stereo);
+                });
+            } else if (strcmp(name, "softClip hot") == 0) {
+                rate = bestMsamplesPerSec(stereo, iterations, copyHot, [&] {
+                    dsp.softClip(work.data(), stereo);
+                });
+            } else {
+                rate = bestMsamplesPerSec(stereo, iterations, copyQuiet, [&] {
+                    if (dsp.peak(work.data(), stereo) > 1.0f) dsp.softClip(work.data(), stereo);
+                });
+            }
+            printf(" %10.1f", rate);
+        }
+        printf("\n");
+    }
+    (void) sink;
+    return 0;
+}
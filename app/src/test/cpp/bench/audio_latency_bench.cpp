@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "aaudio_render.h"
+#include "audio_dsp.h"
+#include "fake_aaudio.h"
+#include "ring_buffer.hpp"
+
+#ifdef HAVE_SWRESAMPLE
+extern "C" {
+#include "libswresample/swresample.h"
+#include "libavutil/channel_layout.h"
+}
+#endif
+
+// 44.1kHz / 48kHz 片源经过输出路径的端到端延迟和 CPU 开销。
+//
+// 输出路径与 Player 相同：解码阶段把设备采样率的 float PCM 写入 64KB 的环形缓冲区，
+// 满了等 5ms 再试；AAudio 回调从环形缓冲区读出并应用音量；每 100ms 调用一次
+// AAudioRender::tune() 调整设备缓冲区并测量输出延迟。设备是 fake_aaudio 模拟的回调驱动
+// 设备（原生采样率 44.1kHz 或 48kHz，burst 为 4ms），按真实时间运行。
+// 端到端延迟 = 环形缓冲区中的数据时长 + AAudioRender::latencyUs()（已写入设备还没播放的
+// 部分），与 Player::audioClock() 的算法一致，即写入环形缓冲区的样本多久之后被播放出来。
+//
+// 重采样只在输入与设备采样率不同时发生（每个片源只做一次，系统混音器不再重采样），
+// 开发机装有 libswresample 时另外测量每秒音频的重采样耗时。
+//
+// 设备上的对应数据来自 Player::dumpStats()：播放 44.1kHz 和 48kHz 的文件各一分钟后读取
+// audioDeviceRate、resampleCpuMsPerAudioSec、audioLatencyMs、audioBufferFrames、audioXRuns，
+// 在 simpleperf 中对 AAudio 回调线程采样得到回调的 CPU 占用。
+// 用法：audio_latency_bench [--quick]
+
+#define RING_BYTES 65536            // 与 AUDIO_RING_SIZE 相同
+#define PRODUCE_FRAMES 1024         // 解码阶段每次写入的帧数
+#define PRODUCER_POLL_US 5000       // 与 AUDIO_POLL_US 相同
+#define TUNE_INTERVAL_US 100000     // 与 AUDIO_TUNE_INTERVAL_US 相同
+#define CHANNELS 2
+
+using Clock = std::chrono::steady_clock;
+
+struct Output {
+    RingBuffer ring{RING_BYTES};
+    AudioDsp dsp;
+    GainControl gain;
+    AAudioRender render;
+};
+
+static int renderCallback(AAudioStream *, void *userData, void *audioData, int32_t numFrames) {
+    auto out = static_cast<Output *>(userData);
+    auto buf = static_cast<uint8_t *>(audioData);
+    size_t len = static_cast<size_t>(numFrames) * out->render.frameBytes();
+    if (out->render.muted()) {
+        memset(buf, 0, len);
+        return 0;
+    }
+    size_t n = out->ring.read(buf, len);
+    if (n < len) memset(buf + n, 0, len - n);
+    out->gain.process(out->dsp, reinterpret_cast<float *>(buf), len / sizeof(float));
+    return 0;
+}
+
+struct Result {
+    int32_t burst;
+    int32_t buffer;
+    int32_t xruns;
+    double callbackUsPerSec;    // 回调每秒音频的耗时
+    double callbackMaxUs;
+    double deviceMs;            // 设备部分的平均延迟
+    double totalMs;             // 端到端平均延迟
+    double totalMaxMs;
+};
+
+static Result runOutput(int deviceRate, double seconds) {
+    fakeAudioDevice.sampleRate = deviceRate;
+    // 4ms 的 burst，与常见手机的低延迟通路相近
+    fakeAudioDevice.framesPerBurst = deviceRate / 250;
+    fakeAudioDevice.presentationFrames = fakeAudioDevice.framesPerBurst;
+
+    Output out;
+    out.gain.setTarget(0.8f);
+    out.render.configure(AAUDIO_UNSPECIFIED, CHANNELS, AAUDIO_FORMAT_PCM_FLOAT);
+    out.render.setCallback(renderCallback, &out);
+    out.render.open();
+    out.render.play(true);
+    while (int64_t delay = out.render.control()) std::this_thread::sleep_for(std::chrono::microseconds(delay));
+
+    std::atomic<bool> running{true};
+    std::thread producer([&] {
+        std::vector<float> pcm(PRODUCE_FRAMES * CHANNELS);
+        int64_t pos = 0;
+        auto bytes = reinterpret_cast<const uint8_t *>(pcm.data());
+        while (running) {
+            for (int i = 0; i < PRODUCE_FRAMES; ++i, ++pos) {
+                float s = 0.5f * static_cast<float>(sin(2 * M_PI * 440.0 * pos / deviceRate));
+                pcm[i * CHANNELS] = pcm[i * CHANNELS + 1] = s;
+            }
+            while (running && !out.ring.write(bytes, pcm.size() * sizeof(float))) {
+                std::this_thread::sleep_for(std::chrono::microseconds(PRODUCER_POLL_US));
+            }
+        }
+    });
+
+    double bytesPerSec = static_cast<double>(deviceRate) * CHANNELS * sizeof(float);
+    double deviceSum = 0;
+    double totalSum = 0;
+    double totalMax = 0;
+    int samples = 0;
+    auto end = Clock::now() + std::chrono::duration<double>(seconds);
+    while (Clock::now() < end) {
+        std::this_thread::sleep_for(std::chrono::microseconds(TUNE_INTERVAL_US));
+        out.render.tune(fakeAudioNowNs() / 1000);
+        int64_t device = out.render.latencyUs();
+        if (device < 0) continue;
+        double total = out.ring.readable() / bytesPerSec * 1000 + device / 1000.0;
+        deviceSum += device / 1000.0;
+        totalSum += total;
+        totalMax = std::max(totalMax, total);
+        samples++;
+    }
+    running = false;
+    producer.join();
+
+    AAudioStream *stream = fakeAudioStream();
+    Result r{};
+    r.burst = out.render.burstFrames();
+    r.buffer = out.render.bufferFrames();
+    r.xruns = out.render.xruns();
+    double audioSec = static_cast<double>(AAudioStream_getFramesRead(stream)) / deviceRate;
+    r.callbackUsPerSec = audioSec > 0 ? stream->callbackNs / 1000.0 / audioSec : 0;
+    r.callbackMaxUs = stream->callbackMaxNs / 1000.0;
+    r.deviceMs = samples ? deviceSum / samples : -1;
+    r.totalMs = samples ? totalSum / samples : -1;
+    r.totalMaxMs = totalMax;
+    return r;
+}
+
+#ifdef HAVE_SWRESAMPLE
+// 每秒输入音频的重采样耗时（毫秒），输入 S16 立体声，输出 float
+static double resampleMsPerSec(int srcRate, int dstRate, double seconds) {
+    SwrContext *swr = swr_alloc_set_opts(nullptr, AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_FLT, dstRate,
+                                         AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_S16, srcRate, 0, nullptr);
+    swr_init(swr);
+    std::vector<int16_t> in(PRODUCE_FRAMES * CHANNELS);
+    for (int i = 0; i < PRODUCE_FRAMES; ++i) {
+        in[i * CHANNELS] = in[i * CHANNELS + 1] = static_cast<int16_t>(8000 * sin(2 * M_PI * 440.0 * i / srcRate));
+    }
+    std::vector<float> out(static_cast<size_t>(swr_get_out_samples(swr, PRODUCE_FRAMES)) * CHANNELS);
+    int chunks = std::max(1, static_cast<int>(seconds * srcRate / PRODUCE_FRAMES));
+    auto begin = Clock::now();
+    for (int i = 0; i < chunks; ++i) {
+        auto src = reinterpret_cast<const uint8_t *>(in.data());
+        auto dst = reinterpret_cast<uint8_t *>(out.data());
+        swr_convert(swr, &dst, static_cast<int>(out.size() / CHANNELS), &src, PRODUCE_FRAMES);
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    swr_free(&swr);
+    return ms / (static_cast<double>(chunks) * PRODUCE_FRAMES / srcRate);
+}
+#endif
+
+int main(int argc, char **argv) {
+    bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+    double seconds = quick ? 0.5 : 10.0;
+    const int rates[] = {44100, 48000};
+
+    printf("%-8s %6s %7s %6s %12s %10s %10s %10s %10s\n", "device", "burst", "buffer", "xruns",
+           "cbUs/audioS", "cbMaxUs", "deviceMs", "e2eMs", "e2eMaxMs");
+    for (int rate : rates) {
+        Result r = runOutput(rate, seconds);
+        printf("%-8d %6d %7d %6d %12.1f %10.1f %10.2f %10.2f %10.2f\n", rate, r.burst, r.buffer, r.xruns,
+               r.callbackUsPerSec, r.callbackMaxUs, r.deviceMs, r.totalMs, r.totalMaxMs);
+    }
+
+    printf("\n%-8s %-8s %16s\n", "source", "device", "resampleMs/audioS");
+    for (int src : rates) {
+        for (int dst : rates) {
+#ifdef HAVE_SWRESAMPLE
+            printf("%-8d %-8d %16.3f\n", src, dst, resampleMsPerSec(src, dst, quick ? 0.5 : 30.0));
+#else
+            printf("%-8d %-8d %16s\n", src, dst, "n/a (no libswresample)");
+#endif
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "decoder_cache.h"
+#include "fake_avcodec.h"
+
+// 播放列表连续打开 100 个片段时每个片段打开音视频解码器的耗时，有无 DecoderCache 两种情况。
+//
+// 打开的过程与 Player::openDecoder() 相同：先按 DecoderKey 从缓存取，取不到时
+// avcodec_alloc_context3 + avcodec_parameters_to_context + avcodec_open2。与 Player 一样，
+// 预加载打开第 i 项时第 i - 1 项还在播放，第 i - 2 项的解码器在这之前放回缓存（或释放）。
+// libavcodec 由 fake_avcodec 替代，打开、清空缓冲、释放按下面的耗时忙等。这些耗时是假设的
+// 量级，不是测量值：设备上对应的数据是 dumpStats() 中的 decoderOpenMs（新打开）和
+// decoderReuseMs（复用），换成设备上的值即可得到那台设备上的结果；复用的次数、因参数不同
+// 没能复用的次数只取决于片段的参数，与耗时无关。
+//
+// 片段来自几种来源，按固定的种子打乱顺序：同一台手机拍的 H.264 High + AAC（占大多数）、
+// 另一台手机的 H.264 Main、avc3 封装的 H.264、HEVC、带 PCM 音轨的录屏。
+// 用法：decoder_open_bench [--quick]
+
+using Clock = std::chrono::steady_clock;
+
+#define H264_OPEN_US 12000
+#define HEVC_OPEN_US 20000
+#define AUDIO_OPEN_US 1000
+#define FLUSH_US 200
+#define FREE_US 3000
+
+struct Source {
+    const char *name;
+    int count;                  // 100 个片段中的个数
+    AVCodecID video;
+    uint32_t tag;
+    int profile;
+    int width;
+    int height;
+    AVCodecID audio;
+    int blockAlign;
+    int frameSize;
+    uint8_t extradata[8];
+};
+
+static const Source kSources[] = {
+        {"phone-a h264 high", 60, AV_CODEC_ID_H264, MKTAG('a', 'v', 'c', '1'), FF_PROFILE_H264_HIGH, 1920, 1080,
+         AV_CODEC_ID_AAC, 0, 1024, {1, 100, 0, 40}},
+        {"phone-b h264 main", 15, AV_CODEC_ID_H264, MKTAG('a', 'v', 'c', '1'), FF_PROFILE_H264_MAIN, 1920, 1080,
+         AV_CODEC_ID_AAC, 0, 1024, {1, 77, 0, 40}},
+        {"h264 avc3", 5, AV_CODEC_ID_H264, MKTAG('a', 'v', 'c', '3'), FF_PROFILE_H264_HIGH, 1920, 1080,
+         AV_CODEC_ID_AAC, 0, 1024, {1, 100, 0, 40}},
+        {"hevc", 15, AV_CODEC_ID_HEVC, MKTAG('h', 'v', 'c', '1'), FF_PROFILE_HEVC_MAIN, 3840, 2160,
+         AV_CODEC_ID_AAC, 0, 1024, {1, 1, 96, 0}},
+        {"screen pcm", 5, AV_CODEC_ID_H264, MKTAG('a', 'v', 'c', '1'), FF_PROFILE_H264_HIGH, 1920, 1080,
+         AV_CODEC_ID_PCM_S16LE, 4, 0, {1, 100, 0, 40}},
+};
+
+struct Clip {
+    AVCodecParameters video{};
+    AVCodecParameters audio{};
+    AVCodec videoCodec{};
+    AVCodec audioCodec{};
+    DecoderKey videoKey;
+    DecoderKey audioKey;
+    AVCodecContext *videoCtx = nullptr;
+    AVCodecContext *audioCtx = nullptr;
+};
+
+static void makeClip(const Source &src, Clip &clip) {
+    AVCodecParameters &v = clip.video;
+    v.codec_type = AVMEDIA_TYPE_VIDEO;
+    v.codec_id = src.video;
+    v.codec_tag = src.tag;
+    v.profile = src.profile;
+    v.format = AV_PIX_FMT_YUV420P;
+    v.width = src.width;
+    v.height = src.height;
+    v.extradata = const_cast<uint8_t *>(src.extradata);
+    v.extradata_size = sizeof(src.extradata);
+    AVCodecParameters &a = clip.audio;
+    a.codec_type = AVMEDIA_TYPE_AUDIO;
+    a.codec_id = src.audio;
+    a.format = src.audio == AV_CODEC_ID_AAC ? AV_SAMPLE_FMT_FLTP : AV_SAMPLE_FMT_S16;
+    a.sample_rate = 48000;
+    a.channels = 2;
+    a.channel_layout = AV_CH_LAYOUT_STEREO;
+    a.block_align = src.blockAlign;
+    a.frame_size = src.frameSize;
+    clip.videoCodec.type = AVMEDIA_TYPE_VIDEO;
+    clip.videoCodec.id = src.video;
+    clip.audioCodec.type = AVMEDIA_TYPE_AUDIO;
+    clip.audioCodec.id = src.audio;
+    clip.videoKey = DecoderCache::keyOf(&v, 0, 0);
+    clip.audioKey = DecoderCache::keyOf(&a, 0, 0);
+}
+
+// 与 Player::openDecoder() 相同的步骤
+static AVCodecContext *openDecoder(DecoderCache *cache, const AVCodecParameters *par, const AVCodec *codec,
+                                   const DecoderKey &key) {
+    AVCodecContext *ctx = cache != nullptr ? cache->acquire(key) : nullptr;
+    if (ctx != nullptr) return ctx;
+    ctx = avcodec_alloc_context3(codec);
+    avcodec_parameters_to_context(ctx, par);
+    ctx->lowres = key.lowres;
+    ctx->flags2 |= key.flags2;
+    avcodec_open2(ctx, codec, nullptr);
+    return ctx;
+}
+
+static void releaseClip(DecoderCache *cache, Clip &clip) {
+    if (cache != nullptr) {
+        cache->release(clip.videoKey, clip.videoCtx);
+        cache->release(clip.audioKey, clip.audioCtx);
+        clip.videoCtx = clip.audioCtx = nullptr;
+        return;
+    }
+    avcodec_free_context(&clip.videoCtx);
+    avcodec_free_context(&clip.audioCtx);
+}
+
+static void run(bool useCache, int clipCount) {
+    fakeCodec.reset();
+    fakeCodec.audioOpenUs = AUDIO_OPEN_US;
+    fakeCodec.flushUs = FLUSH_US;
+    fakeCodec.freeUs = FREE_US;
+
+    std::vector<const Source *> order;
+    for (const Source &src : kSources) {
+        for (int i = 0; i < src.count; ++i) order.push_back(&src);
+    }
+    std::mt19937 rng(2024);
+    std::shuffle(order.begin(), order.end(), rng);
+    order.resize(std::min<size_t>(order.size(), clipCount));
+
+    DecoderCache cache;
+    DecoderCache *c = useCache ? &cache : nullptr;
+    std::vector<Clip> clips(order.size());
+    std::vector<double> openMs;
+    double releaseMs = 0;
+    for (size_t i = 0; i < clips.size(); ++i) {
+        makeClip(*order[i], clips[i]);
+        fakeCodec.videoOpenUs = order[i]->video == AV_CODEC_ID_HEVC ? HEVC_OPEN_US : H264_OPEN_US;
+        // 切换到第 i - 1 项之后，第 i - 2 项交给 preloading 释放，再打开第 i 项
+        if (i >= 2) {
+            auto t0 = Clock::now();
+            releaseClip(c, clips[i - 2]);
+            releaseMs += std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        }
+        auto t0 = Clock::now();
+        clips[i].videoCtx = openDecoder(c, &clips[i].video, &clips[i].videoCodec, clips[i].videoKey);
+        clips[i].audioCtx = openDecoder(c, &clips[i].audio, &clips[i].audioCodec, clips[i].audioKey);
+        openMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+    }
+    for (size_t i = clips.size() >= 2 ? clips.size() - 2 : 0; i < clips.size(); ++i) releaseClip(c, clips[i]);
+    cache.clear();
+
+    std::vector<double> sorted = openMs;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for (double ms : openMs) sum += ms;
+    size_t n = sorted.size();
+    printf("%-8s %6zu %6d %7llu %9llu %8.2f %8.2f %8.2f %8.2f %10.2f\n", useCache ? "cache" : "no-cache", n,
+           fakeCodec.opens.load(), static_cast<unsigned long long>(cache.hits()),
+           static_cast<unsigned long long>(cache.mismatches()), sum / n, sorted[n / 2],
+           sorted[std::min(n - 1, n * 95 / 100)], sorted.back(), releaseMs / n);
+}
+
+int main(int argc, char **argv) {
+    bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+    int clips = quick ? 10 : 100;
+    printf("assumed costs: h264 open %.1fms, hevc open %.1fms, audio open %.1fms, flush %.1fms, free %.1fms\n",
+           H264_OPEN_US / 1000.0, HEVC_OPEN_US / 1000.0, AUDIO_OPEN_US / 1000.0, FLUSH_US / 1000.0,
+           FREE_US / 1000.0);
+    printf("%-8s %6s %6s %7s %9s %8s %8s %8s %8s %10s\n", "mode", "clips", "opens", "reuses", "mismatch",
+           "meanMs", "p50Ms", "p95Ms", "maxMs", "releaseMs");
+    run(false, clips);
+    run(true, clips);
+    return 0;
+}
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include "fake_avcodec.h"
+#include "loop_cache.h"
+#include "queue.hpp"
+
+extern "C" {
+#include "libavutil/imgutils.h"
+}
+
+// A-B 循环回到 A 时画面的间隔（dumpStats() 中的 loopGapMs / loopGapMaxMs），以及片段缓存的预算
+// 决定每一遍走哪条路：
+//   seek    —— packet 放不下预算，每一遍跳回 A 之前的关键帧重新读文件、解码；
+//   packets —— 第一遍保存的 packet 从内存重放，省掉跳转和读文件，A 之前的帧照样要解码；
+//   frames  —— 不超过 LOOP_FRAME_MAX_SECONDS、估计放得下预算的片段保存解码帧，之后直接重放。
+//
+// 与 Player 相同的部分：LoopCache（预算、整类丢弃）、是否保存解码帧的估计、每一遍从 A - LOOP_PREROLL
+// 之前的关键帧读起、dts 到达 B 时结束一遍、按第一遍读到的时间范围加 LOOP_PERIOD_MARGIN 得到每一遍的
+// 时间戳偏移，以及显示阶段按 loopPosition() 的方法计算间隔：新一遍的第一帧比上一遍最后一帧的预定
+// 结束时刻晚了多少。解码阶段到显示之间最多提前 videoFrameQ + readyQ 共 7 帧。
+// 另外检查每一遍后移的时间戳都能按 loopPassOf() 的方法还原成原来的时间戳。
+//
+// 片源是 1080p 30fps、GOP 2 秒的 H.264（关键帧 200KB，其他帧 25KB），时间基 1/90000。
+// 跳转、读 packet、解码一帧的耗时是假设的量级（中档手机软件解码 1080p），用忙等模拟，不是测量值；
+// 设备上的间隔直接看 dumpStats() 的 loopGapMs。走哪条路只取决于片段和预算，与耗时无关。
+// 用法：loop_bench [--quick]
+
+using Clock = std::chrono::steady_clock;
+
+#define FPS 30
+#define GOP_FRAMES 60
+#define KEY_BYTES 200000
+#define FRAME_BYTES 25000
+#define WIDTH 1920
+#define HEIGHT 1080
+#define TIME_BASE 90000
+#define SEEK_US 5000
+#define READ_US 100                     // 读一个 packet
+#define DECODE_US 8000                  // 解码一帧
+#define REPLAY_US 50                    // 从缓存取一帧（引用计数加一）
+#define FRAMES_AHEAD 7                  // videoFrameQ(5) + READY_QUEUE_SIZE(2)
+#define LOOP_FRAME_MAX_SECONDS 2.0      // 与 player.h 相同
+#define LOOP_PREROLL 0.1
+#define LOOP_PERIOD_MARGIN 0.01
+
+struct Case {
+    const char *name;
+    double start;
+    double end;
+    size_t budgetMB;
+};
+
+struct Shown {
+    int64_t pts;                        // 后移之后的时间戳
+    int pass;
+    bool end;
+};
+
+struct Result {
+    const char *path;
+    double cacheMB;
+    int passes;
+    double gapMs;                       // 第二遍起回到 A 的平均间隔
+    double gapMaxMs;
+    int ptsErrors;
+};
+
+static void spin(int us) {
+    auto end = Clock::now() + std::chrono::microseconds(us);
+    while (Clock::now() < end) {}
+}
+
+static int64_t loopOffset(int pass, double seconds) {
+    return llround(pass * seconds * TIME_BASE);
+}
+
+// 与 Player::loopPassOf() 相同
+static int loopPassOf(int64_t pts, double origin, double period, int64_t &raw) {
+    double t = static_cast<double>(pts) / TIME_BASE - origin + 0.001;
+    int pass = std::max(0, static_cast<int>(std::floor(t / period)));
+    raw = pts - loopOffset(pass, period);
+    return pass;
+}
+
+static Result runCase(const Case &c, int passes) {
+    fakeCodec.reset();
+    size_t budget = c.budgetMB * 1024 * 1024;
+    LoopCache cache(budget);
+    double span = c.end - c.start;
+    int64_t frameDur = TIME_BASE / FPS;
+    // 与 Player::setLoop() 中 decodedBytes() 的估计相同（不计音频）
+    double frameSize = av_image_get_buffer_size(AV_PIX_FMT_YUV420P, WIDTH, HEIGHT, 1);
+    double bitRate = (KEY_BYTES + (GOP_FRAMES - 1.0) * FRAME_BYTES) * 8 * FPS / GOP_FRAMES;
+    double estimate = frameSize * std::ceil(span * FPS + 1) + (span + LOOP_PREROLL) * bitRate / 8;
+    bool frameCapture = span <= LOOP_FRAME_MAX_SECONDS && estimate <= budget;
+    int firstFrame = static_cast<int>(std::ceil(c.start * FPS));
+    int keyFrame = static_cast<int>(std::floor((c.start - LOOP_PREROLL) * FPS)) / GOP_FRAMES * GOP_FRAMES;
+
+    Queue<Shown> shown(FRAMES_AHEAD);
+    Result r{};
+    r.passes = passes;
+    std::thread producer([&] {
+        bool capturing = true;
+        double period = 0;
+        bool framesReady = false;
+        for (int pass = 0; pass < passes; ++pass) {
+            if (framesReady) {
+                for (size_t i = 0; i < cache.frameCount(LoopStream::Video); ++i) {
+                    spin(REPLAY_US);
+                    shown.push({cache.frame(LoopStream::Video, i)->pts + loopOffset(pass, span), pass, false});
+                }
+                continue;
+            }
+            bool replay = cache.packetsReady();
+            if (!replay) spin(SEEK_US);
+            for (int f = keyFrame;; ++f) {
+                // dts 到达 B，这一遍结束
+                if (static_cast<double>(f) / FPS >= c.end) break;
+                AVPacket pkt{};
+                pkt.pts = pkt.dts = f * frameDur;
+                pkt.size = f % GOP_FRAMES == 0 ? KEY_BYTES : FRAME_BYTES;
+                if (!replay) {
+                    spin(READ_US);
+                    if (capturing && !cache.addPacket(&pkt)) capturing = false;
+                }
+                spin(DECODE_US);
+                if (f < firstFrame) continue;
+                AVFrame frame{};
+                frame.format = AV_PIX_FMT_YUV420P;
+                frame.width = WIDTH;
+                frame.height = HEIGHT;
+                frame.pts = pkt.pts;
+                if (frameCapture && pass == 0) cache.addFrame(LoopStream::Video, &frame);
+                // packet 的时间戳后移，解码输出的帧按 loopPassOf() 还原
+                int64_t shifted = frame.pts + loopOffset(pass, period);
+                int64_t raw;
+                int decodedPass = loopPassOf(shifted, static_cast<double>(keyFrame) / FPS, period > 0 ? period : 1e9,
+                                             raw);
+                if (raw != frame.pts || decodedPass != pass) r.ptsErrors++;
+                shown.push({raw + loopOffset(pass, span), pass, false});
+            }
+            if (period <= 0) period = (c.end - static_cast<double>(keyFrame) / FPS) + LOOP_PERIOD_MARGIN;
+            if (capturing) {
+                cache.finishPackets();
+                capturing = false;
+            }
+            if (frameCapture && pass == 0) {
+                cache.finishFrames(LoopStream::Video);
+                framesReady = cache.framesReady(LoopStream::Video);
+            }
+        }
+        shown.push({0, passes, true});
+    });
+
+    // 显示：片段按 A 开始连续排列，第 pass 遍的帧在 pass * span + (t - A) 显示，晚到的帧立即显示
+    Clock::time_point origin;
+    Clock::time_point lastPresent;
+    bool started = false;
+    int shownPass = 0;
+    double gapSum = 0;
+    int gaps = 0;
+    Shown s{};
+    while (shown.pop(s) && !s.end) {
+        double t = static_cast<double>(s.pts) / TIME_BASE - c.start;
+        if (!started) {
+            origin = Clock::now() - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(t));
+            started = true;
+        }
+        auto due = origin + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(t));
+        std::this_thread::sleep_until(due);
+        auto now = Clock::now();
+        if (s.pass > shownPass) {
+            double gap = std::chrono::duration<double, std::milli>(now - lastPresent).count() - 1000.0 / FPS;
+            gapSum += gap;
+            gaps++;
+            r.gapMaxMs = std::max(r.gapMaxMs, gap);
+            shownPass = s.pass;
+        }
+        lastPresent = now;
+        // 晚到的帧之后按新的时刻继续排
+        if (now > due + std::chrono::milliseconds(2)) origin += now - due;
+    }
+    producer.join();
+    r.gapMs = gaps ? gapSum / gaps : 0;
+    r.cacheMB = cache.bytes() / 1048576.0;
+    r.path = cache.framesReady(LoopStream::Video) ? "frames" : cache.packetsReady() ? "packets" : "seek";
+    cache.clear();
+    return r;
+}
+
+int main(int argc, char **argv) {
+    bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+    // A 在 GOP 的后部，每一遍要先解码 A 之前五十多帧
+    const Case cases[] = {
+            {"1s late-gop", 11.8, 12.8, 4},
+            {"1s late-gop", 11.8, 12.8, 32},
+            {"1s late-gop", 11.8, 12.8, 128},
+            {"1s early-gop", 10.2, 11.2, 32},
+            {"8s", 20.5, 28.5, 4},
+            {"8s", 20.5, 28.5, 32},
+    };
+    printf("assumed costs: seek %.1fms, read %.1fms/packet, decode %.1fms/frame, %d frames ahead\n",
+           SEEK_US / 1000.0, READ_US / 1000.0, DECODE_US / 1000.0, FRAMES_AHEAD);
+    printf("%-13s %8s %-8s %8s %7s %9s %9s %9s\n", "segment", "budgetMB", "path", "cacheMB", "passes",
+           "gapMs", "gapMaxMs", "ptsErrors");
+    for (const Case &c : cases) {
+        bool shortCase = c.end - c.start <= 1.0;
+        if (quick && (!shortCase || c.budgetMB == 32)) continue;
+        int passes = quick ? 2 : shortCase ? 6 : 3;
+        Result r = runCase(c, passes);
+        printf("%-13s %8zu %-8s %8.2f %7d %9.1f %9.1f %9d\n", c.name, c.budgetMB, r.path, r.cacheMB, r.passes,
+               r.gapMs, r.gapMaxMs, r.ptsErrors);
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "loudness.h"
+
+// 响度归一化占一个核心的 CPU 比例（每秒音频的处理耗时），48kHz 立体声，每次处理 1024 帧，
+// 与 Player::outputAudio() 相同，对应 dumpStats() 中的 loudnessCpuPercent 和 truePeakCheckedPercent：
+//   estimate sine  —— -20dBFS 1kHz 正弦，没有元数据，实时估计响度（最常见的情况）；
+//   metadata quiet —— 元数据增益 -6dB，信号远低于上限，不做过采样峰值估计；
+//   metadata loud  —— 元数据增益 +12dB 的满幅噪声，每一帧都做过采样峰值估计（最坏情况）。
+// 这是开发机（x86）上的数据，ARM 设备上以 dumpStats() 的 loudnessCpuPercent 为准；
+// 估计和限幅都是标量代码（只有增益斜坡用 AudioDsp），两者的比例应该接近。
+// 用法：loudness_bench [--quick]
+
+using Clock = std::chrono::steady_clock;
+
+#define RATE 48000
+#define CHANNELS 2
+#define CHUNK_FRAMES 1024
+
+struct Case {
+    const char *name;
+    bool metadata;
+    float gainDb;
+    bool noise;
+    float amplitude;
+};
+
+int main(int argc, char **argv) {
+    bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+    double seconds = quick ? 1.0 : 30.0;
+    const Case cases[] = {
+            {"estimate sine", false, 0.0f, false, 0.1f},
+            {"metadata quiet", true, -6.0f, false, 0.1f},
+            {"metadata loud", true, 12.0f, true, 1.0f},
+    };
+
+    printf("%-16s %8s %10s %10s %12s %8s\n", "case", "cpu%", "gainDb", "integLufs", "limiterDb", "tp%");
+    for (const Case &c : cases) {
+        LoudnessNormalizer loudness;
+        loudness.configure(RATE, CHANNELS);
+        if (c.metadata) loudness.setTrackGain(c.gainDb);
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        std::vector<float> buf(CHUNK_FRAMES * CHANNELS);
+        size_t chunks = static_cast<size_t>(seconds * RATE / CHUNK_FRAMES);
+        int64_t pos = 0;
+        double sec = 0;
+        for (size_t i = 0; i < chunks; ++i) {
+            for (int f = 0; f < CHUNK_FRAMES; ++f, ++pos) {
+                float s = c.noise ? dist(rng) : static_cast<float>(sin(2 * M_PI * 1000.0 * pos / RATE));
+                buf[f * CHANNELS] = buf[f * CHANNELS + 1] = c.amplitude * s;
+            }
+            auto begin = Clock::now();
+            loudness.process(buf.data(), CHUNK_FRAMES);
+            sec += std::chrono::duration<double>(Clock::now() - begin).count();
+        }
+        double audioSec = static_cast<double>(chunks) * CHUNK_FRAMES / RATE;
+        double processed = static_cast<double>(loudness.processedFrames());
+        printf("%-16s %8.3f %10.2f %10.2f %12.2f %8.1f\n", c.name, sec / audioSec * 100, loudness.gainDb(),
+               loudness.integratedLufs(), loudness.limiterReductionDb(),
+               processed > 0 ? loudness.truePeakFrames() / processed * 100 : 0.0);
+    }
+    return 0;
+}
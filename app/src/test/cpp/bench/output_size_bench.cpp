@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "anw_render.h"
+#include "fake_window.h"
+#include "yuv_convert.h"
+
+#ifdef HAVE_SWSCALE
+extern "C" {
+#include "libswscale/swscale.h"
+}
+#endif
+
+// 4K 片源显示在不同尺寸的窗口中时，转换阶段和显示阶段每秒能处理多少帧、多少像素。
+// “全尺寸”是按视频尺寸输出的旧行为；按窗口尺寸输出时，窗口不大于片源的 1/2、1/4 就用
+// lowres 解码，解码器直接给出缩小的平面，这里用对应尺寸的平面模拟。其余尺寸需要 swscale
+// 先缩放，只在开发机装有 libswscale 时测量。
+// 用法：output_size_bench [--quick]
+
+using Clock = std::chrono::steady_clock;
+
+struct Case {
+    const char *name;
+    int width;          // 输出（窗口缓冲区）尺寸
+    int height;
+    int lowres;         // 解码输出相对片源缩小的倍数（2 的幂）
+};
+
+struct Planes {
+    std::vector<uint8_t> y;
+    std::vector<uint8_t> u;
+    std::vector<uint8_t> v;
+    int width;
+    int height;
+
+    Planes(int w, int h): y(static_cast<size_t>(w) * h, 120),
+                          u(static_cast<size_t>(w / 2) * (h / 2), 100),
+                          v(static_cast<size_t>(w / 2) * (h / 2), 150), width(w), height(h) {}
+
+    YuvImage image() {
+        return YuvImage{y.data(), u.data(), v.data(), width, width / 2, width, height,
+                        ChromaLayout::Planar};
+    }
+};
+
+// 每秒能处理多少帧（转换并提交一次为一帧），取三轮中最好的一轮
+template <typename Fn>
+static double bestFps(int frames, Fn &&fn) {
+    double best = 0;
+    for (int round = 0; round < 3; ++round) {
+        auto begin = Clock::now();
+        for (int i = 0; i < frames; ++i) fn();
+        double sec = std::chrono::duration<double>(Clock::now() - begin).count();
+        best = std::max(best, frames / sec);
+    }
+    return best;
+}
+
+static void report(const char *name, int w, int h, int srcW, int srcH, double fps) {
+    printf("%-12s %4dx%-5d %8.1f %12.1f %12.1f\n", name, w, h, fps,
+           fps * w * h / 1e6, fps * srcW * srcH / 1e6);
+}
+
+int main(int argc, char **argv) {
+    bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+    const int srcW = 3840;
+    const int srcH = 2160;
+    const Case cases[] = {
+            {"full", srcW, srcH, 1},
+            {"lowres=1", srcW / 2, srcH / 2, 2},
+            {"lowres=2", srcW / 4, srcH / 4, 4},
+    };
+    YuvConverter conv;
+    conv.setColor(YuvMatrix::BT709, false);
+
+    printf("source %dx%d, simd %s\n", srcW, srcH, YuvConverter::levelName(conv.level()));
+    printf("%-12s %-10s %8s %12s %12s\n", "output", "size", "fps", "outMpx/s", "srcMpx/s");
+    for (const Case &c : cases) {
+        Planes planes(srcW / c.lowres, srcH / c.lowres);
+        YuvImage img = planes.image();
+        std::vector<uint8_t> rgba(static_cast<size_t>(c.width) * c.height * 4);
+        ANativeWindow window;
+        ANWRender render;
+        render.init(&window);
+        render.setBuffers(c.width, c.height, RenderFormat::RGBA);
+        int frames = quick ? 1 : std::max(2, 400000000 / (c.width * c.height));
+        double fps = bestFps(frames, [&] {
+            conv.convert(img, rgba.data(), c.width * 4);
+            render.render(rgba.data());
+        });
+        report(c.name, c.width, c.height, srcW, srcH, fps);
+    }
+
+#ifdef HAVE_SWSCALE
+    // 窗口尺寸不是片源的 1/2^n 时，从 lowres 输出缩放到窗口尺寸再转换，负载高时用快速双线性
+    const int outW = 1280;
+    const int outH = 720;
+    Planes planes(srcW / 2, srcH / 2);
+    std::vector<uint8_t> rgba(static_cast<size_t>(outW) * outH * 4);
+    for (int flags : {SWS_BICUBIC, SWS_FAST_BILINEAR}) {
+        SwsContext *sws = sws_getContext(planes.width, planes.height, AV_PIX_FMT_YUV420P,
+                                         outW, outH, AV_PIX_FMT_RGBA, flags, nullptr, nullptr, nullptr);
+        const uint8_t *src[3] = {planes.y.data(), planes.u.data(), planes.v.data()};
+        int srcStride[3] = {planes.width, planes.width / 2, planes.width / 2};
+        uint8_t *dst[1] = {rgba.data()};
+        int dstStride[1] = {outW * 4};
+        ANativeWindow window;
+        ANWRender render;
+        render.init(&window);
+        render.setBuffers(outW, outH, RenderFormat::RGBA);
+        int frames = quick ? 1 : 200;
+        double fps = bestFps(frames, [&] {
+            sws_scale(sws, src, srcStride, 0, planes.height, dst, dstStride);
+            render.render(rgba.data());
+        });
+        sws_freeContext(sws);
+        report(flags == SWS_BICUBIC ? "sws-bicubic" : "sws-fastbil", outW, outH, srcW, srcH, fps);
+    }
+#endif
+    return 0;
+}
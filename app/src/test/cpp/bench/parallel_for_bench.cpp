@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <thread>
+#include <vector>
+#include "worker_pool.h"
+#include "yuv_convert.h"
+
+// 按行分片的 YUV -> RGBA 转换用 1 ~ N 个分片时的吞吐量（百万像素/秒）和相对 1 个分片的加速比。
+// 分别从池外的线程和池内的任务中调用 parallelFor，后者是转换阶段实际的调用方式。
+// 线程池大小与 WorkerPool::shared() 相同，单核机器上加速比接近 1 是正常的。
+// 用法：parallel_for_bench [--quick]
+
+using Clock = std::chrono::steady_clock;
+
+template <typename Fn>
+static double bestMpxPerSec(int pixels, int iterations, Fn &&fn) {
+    double best = 0;
+    for (int round = 0; round < 3; ++round) {
+        auto begin = Clock::now();
+        for (int i = 0; i < iterations; ++i) fn();
+        double sec = std::chrono::duration<double>(Clock::now() - begin).count();
+        best = std::max(best, static_cast<double>(pixels) * iterations / sec / 1e6);
+    }
+    return best;
+}
+
+int main(int argc, char **argv) {
+    bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+    int threads = static_cast<int>(std::min(std::max(std::thread::hardware_concurrency(), 2u), 8u));
+    WorkerPool pool(threads);
+    const int w = 3840;
+    const int h = 2160;
+    std::vector<uint8_t> y(static_cast<size_t>(w) * h, 120);
+    std::vector<uint8_t> u(static_cast<size_t>(w / 2) * (h / 2), 100);
+    std::vector<uint8_t> v(static_cast<size_t>(w / 2) * (h / 2), 150);
+    std::vector<uint8_t> rgba(static_cast<size_t>(w) * h * 4);
+    YuvImage img{y.data(), u.data(), v.data(), w, w / 2, w, h, ChromaLayout::Planar};
+    YuvConverter conv;
+    conv.setColor(YuvMatrix::BT709, false);
+    int iterations = quick ? 1 : 30;
+
+    auto convert = [&](int slices) {
+        // 与转换阶段相同，每片的行数取偶数，最后一片可能较短或为空
+        int band = ((h + slices - 1) / slices + 1) & ~1;
+        pool.parallelFor(slices, [&](int i) {
+            if (i * band >= h) return;
+            conv.convertRows(img, rgba.data(), w * 4, i * band, std::min((i + 1) * band, h));
+        }, CoreClass::Big);
+    };
+
+    printf("%dx%d, simd %s, pool %d threads, %u cpus\n", w, h,
+           YuvConverter::levelName(conv.level()), threads, std::thread::hardware_concurrency());
+    printf("%-8s %6s %10s %8s\n", "caller", "slices", "Mpx/s", "speedup");
+    for (bool inPool : {false, true}) {
+        double base = 0;
+        for (int slices = 1; slices <= threads; ++slices) {
+            double mpx = bestMpxPerSec(w * h, iterations, [&] {
+                if (!inPool) {
+                    convert(slices);
+                    return;
+                }
+                std::promise<void> done;
+                pool.post([&] {
+                    convert(slices);
+                    done.set_value();
+                });
+                done.get_future().wait();
+            });
+            if (slices == 1) base = mpx;
+            printf("%-8s %6d %10.1f %8.2f\n", inPool ? "pool" : "outside", slices, mpx,
+                   base > 0 ? mpx / base : 0.0);
+        }
+    }
+    printf("steals %llu, parks %llu\n", static_cast<unsigned long long>(pool.stealCount()),
+           static_cast<unsigned long long>(pool.parkCount()));
+    return 0;
+}
@@ -0,0 +1,236 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include "queue.hpp"
+#include "stage.h"
+#include "worker_pool.h"
+
+// 比较两种流水线的调度模型：
+//   threads —— 原来的做法，每个播放器 4 个专用线程（解复用、解码、转换、渲染），在阻塞队列上等待；
+//   stages  —— 现在的做法，各阶段是共享线程池上的 Stage，输入为空或输出已满时返回 kIdle。
+// 每个阶段的工作用忙等模拟（解码最重），渲染按 30fps 的节奏或不限速。
+// 输出吞吐量（帧/秒）、CPU 占用（CPU 时间 / 墙上时间，100% 为一个核）、每秒上下文切换次数和线程数。
+// 用法：pipeline_bench [--quick]
+
+using Clock = std::chrono::steady_clock;
+
+struct Costs {
+    int demuxUs = 100;
+    int decodeUs = 3000;
+    int convertUs = 800;
+    int renderUs = 200;
+};
+
+static const Costs kCosts;
+#define QUEUE_SIZE 8
+#define FRAME_US 33333
+
+static void spin(int us) {
+    auto end = Clock::now() + std::chrono::microseconds(us);
+    while (Clock::now() < end) {}
+}
+
+static int threadCount() {
+    FILE *fp = fopen("/proc/self/status", "r");
+    if (fp == nullptr) return -1;
+    char line[256];
+    int n = -1;
+    while (fgets(line, sizeof(line), fp) != nullptr) {
+        if (sscanf(line, "Threads: %d", &n) == 1) break;
+    }
+    fclose(fp);
+    return n;
+}
+
+// 一次运行期间进程的资源使用
+class Meter {
+public:
+    Meter() {
+        getrusage(RUSAGE_SELF, &start);
+        begin = Clock::now();
+    }
+
+    void report(const char *model, int players, bool paced, int frames, int threads) const {
+        rusage end{};
+        getrusage(RUSAGE_SELF, &end);
+        double wall = std::chrono::duration<double>(Clock::now() - begin).count();
+        auto sec = [](const timeval &tv) { return tv.tv_sec + tv.tv_usec / 1e6; };
+        double cpu = sec(end.ru_utime) - sec(start.ru_utime) + sec(end.ru_stime) - sec(start.ru_stime);
+        long cs = (end.ru_nvcsw - start.ru_nvcsw) + (end.ru_nivcsw - start.ru_nivcsw);
+        printf("%-8s %7d %-6s %10.1f %8.0f%% %10.0f %8d\n", model, players, paced ? "30fps" : "max",
+               frames / wall, cpu / wall * 100, cs / wall, threads);
+    }
+
+private:
+    rusage start{};
+    Clock::time_point begin;
+};
+
+// 原来的模型：每个阶段一个线程，用阻塞的 push/pop 传递帧序号，-1 表示结束
+class ThreadPlayer {
+public:
+    ThreadPlayer(int frames, bool paced): frames(frames), paced(paced),
+    q1(QUEUE_SIZE), q2(QUEUE_SIZE), q3(QUEUE_SIZE) {}
+
+    void start() {
+        threads.emplace_back([this] {
+            for (int i = 0; i < frames; ++i) {
+                spin(kCosts.demuxUs);
+                q1.push(i);
+            }
+            q1.push(-1);
+        });
+        threads.emplace_back([this] { relay(q1, q2, kCosts.decodeUs); });
+        threads.emplace_back([this] { relay(q2, q3, kCosts.convertUs); });
+        threads.emplace_back([this] {
+            auto begin = Clock::now();
+            int v;
+            while (q3.pop(v) && v >= 0) {
+                if (paced) std::this_thread::sleep_until(begin + std::chrono::microseconds(FRAME_US) * v);
+                spin(kCosts.renderUs);
+            }
+        });
+    }
+
+    void join() {
+        for (auto &t : threads) t.join();
+    }
+
+private:
+    static void relay(Queue<int> &in, Queue<int> &out, int cost) {
+        int v;
+        while (in.pop(v)) {
+            if (v >= 0) spin(cost);
+            out.push(v);
+            if (v < 0) break;
+        }
+    }
+
+    int frames;
+    bool paced;
+    Queue<int> q1, q2, q3;
+    std::vector<std::thread> threads;
+};
+
+// 现在的模型：四个 Stage，单步函数不阻塞，队列状态变化时唤醒上下游
+class StagePlayer {
+public:
+    StagePlayer(WorkerPool *pool, int frames, bool paced): frames(frames), paced(paced),
+    q1(QUEUE_SIZE), q2(QUEUE_SIZE), q3(QUEUE_SIZE) {
+        demux = Stage::create(pool, [this] {
+            if (demuxed == this->frames) return Stage::kIdle;
+            if (q1.full()) return Stage::kIdle;
+            spin(kCosts.demuxUs);
+            q1.tryPush(demuxed++);
+            decode->wake();
+            return Stage::kProgress;
+        }, ThreadRole::Demux);
+        decode = Stage::create(pool, [this] { return relay(q1, q2, kCosts.decodeUs, demux, convert); },
+                               ThreadRole::VideoDecode);
+        convert = Stage::create(pool, [this] { return relay(q2, q3, kCosts.convertUs, decode, render); },
+                                ThreadRole::VideoConvert);
+        render = Stage::create(pool, [this] {
+            int v;
+            if (pendingFrame < 0) {
+                if (!q3.tryPop(v)) return Stage::kIdle;
+                pendingFrame = v;
+                convert->wake();
+            }
+            if (this->paced) {
+                auto due = begin + std::chrono::microseconds(FRAME_US) * pendingFrame;
+                auto now = Clock::now();
+                if (due > now) {
+                    return static_cast<int64_t>(
+                        std::chrono::duration_cast<std::chrono::microseconds>(due - now).count());
+                }
+            }
+            spin(kCosts.renderUs);
+            pendingFrame = -1;
+            if (++rendered == this->frames) {
+                std::lock_guard<std::mutex> lck(mtx);
+                finished = true;
+                cv.notify_all();
+            }
+            return Stage::kProgress;
+        }, ThreadRole::VideoRender);
+    }
+
+    void start() {
+        begin = Clock::now();
+        for (auto &s : {demux, decode, convert, render}) s->start();
+    }
+
+    void join() {
+        std::unique_lock<std::mutex> lck(mtx);
+        cv.wait(lck, [this] { return finished; });
+        lck.unlock();
+        for (auto &s : {demux, decode, convert, render}) s->stop();
+    }
+
+private:
+    static int64_t relay(Queue<int> &in, Queue<int> &out, int cost,
+                         const std::shared_ptr<Stage> &up, const std::shared_ptr<Stage> &down) {
+        if (out.full()) return Stage::kIdle;
+        int v;
+        if (!in.tryPop(v)) return Stage::kIdle;
+        up->wake();
+        spin(cost);
+        out.tryPush(v);
+        down->wake();
+        return Stage::kProgress;
+    }
+
+    int frames;
+    bool paced;
+    int demuxed = 0;
+    int rendered = 0;
+    int pendingFrame = -1;
+    Clock::time_point begin;
+    Queue<int> q1, q2, q3;
+    std::shared_ptr<Stage> demux, decode, convert, render;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool finished = false;
+};
+
+template <typename P, typename Make>
+static void runModel(const char *model, int players, bool paced, int frames, Make &&make) {
+    std::vector<std::unique_ptr<P>> list;
+    for (int i = 0; i < players; ++i) list.push_back(make());
+    Meter meter;
+    for (auto &p : list) p->start();
+    // 运行中途取线程数
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    int threads = threadCount();
+    for (auto &p : list) p->join();
+    meter.report(model, players, paced, frames * players, threads);
+}
+
+int main(int argc, char **argv) {
+    bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+    WorkerPool *pool = WorkerPool::shared();
+    printf("cpus %u, pool threads %zu\n", std::thread::hardware_concurrency(), pool->threadCount());
+    printf("%-8s %7s %-6s %10s %9s %10s %8s\n", "model", "players", "pace", "frames/s", "cpu",
+           "csw/s", "threads");
+    for (bool paced : {true, false}) {
+        for (int players : {1, 4, 8}) {
+            if (quick && players > 1) break;
+            // 限速时每个播放器播放 3 秒，不限速时每个播放器的帧数使总工作量相近
+            int frames = paced ? (quick ? 10 : 90) : (quick ? 10 : 240 / players);
+            runModel<ThreadPlayer>("threads", players, paced, frames, [&] {
+                return std::unique_ptr<ThreadPlayer>(new ThreadPlayer(frames, paced));
+            });
+            runModel<StagePlayer>("stages", players, paced, frames, [&] {
+                return std::unique_ptr<StagePlayer>(new StagePlayer(pool, frames, paced));
+            });
+        }
+    }
+    return 0;
+}
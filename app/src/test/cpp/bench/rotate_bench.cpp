@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "yuv_convert.h"
+
+// 旋转显示的额外开销：同尺寸转换时不旋转、顺时针 90/180/270 度的吞吐量（百万像素/秒）
+// 以及相对不旋转的比例，单线程。
+//   rgba      —— YuvConverter::convertRotated，旋转在转换的同时完成；
+//   rgba2pass —— 对照：先转换成整帧 RGBA，再单独转置一遍（逐像素 32 位复制）；
+//   yv12      —— rotateToYv12 / copyToYv12，窗口直接显示 YUV 时只旋转平面。
+// 用法：rotate_bench [--quick]
+
+using Clock = std::chrono::steady_clock;
+
+template <typename Fn>
+static double bestMpxPerSec(int pixels, int iterations, Fn &&fn) {
+    double best = 0;
+    for (int round = 0; round < 3; ++round) {
+        auto begin = Clock::now();
+        for (int i = 0; i < iterations; ++i) fn();
+        double sec = std::chrono::duration<double>(Clock::now() - begin).count();
+        best = std::max(best, static_cast<double>(pixels) * iterations / sec / 1e6);
+    }
+    return best;
+}
+
+// 整帧 RGBA 顺时针旋转，src 为 w x h，dst 为旋转后的尺寸
+static void rotateRgba(const uint32_t *src, int w, int h, uint32_t *dst, Rotation rotation) {
+    for (int r = 0; r < h; ++r) {
+        const uint32_t *row = src + static_cast<size_t>(r) * w;
+        for (int x = 0; x < w; ++x) {
+            switch (rotation) {
+                case Rotation::Cw90:
+                    dst[static_cast<size_t>(x) * h + (h - 1 - r)] = row[x];
+                    break;
+                case Rotation::Cw180:
+                    dst[static_cast<size_t>(h - 1 - r) * w + (w - 1 - x)] = row[x];
+                    break;
+                case Rotation::Cw270:
+                    dst[static_cast<size_t>(w - 1 - x) * h + r] = row[x];
+                    break;
+                default:
+                    dst[static_cast<size_t>(r) * w + x] = row[x];
+                    break;
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+    const int w = 1920;
+    const int h = 1080;
+    std::vector<uint8_t> y(static_cast<size_t>(w) * h);
+    std::vector<uint8_t> u(static_cast<size_t>(w / 2) * (h / 2));
+    std::vector<uint8_t> v(u.size());
+    for (size_t i = 0; i < y.size(); ++i) y[i] = static_cast<uint8_t>(16 + i % 220);
+    for (size_t i = 0; i < u.size(); ++i) {
+        u[i] = static_cast<uint8_t>(64 + i % 128);
+        v[i] = static_cast<uint8_t>(192 - i % 128);
+    }
+    YuvImage img{y.data(), u.data(), v.data(), w, w / 2, w, h, ChromaLayout::Planar};
+    YuvConverter conv;
+    conv.setColor(YuvMatrix::BT709, false);
+    std::vector<uint8_t> rgba(static_cast<size_t>(w) * h * 4);
+    std::vector<uint8_t> upright(rgba.size());
+    std::vector<uint8_t> yv12(yv12PackedLayout(w, h).size);
+    int iterations = quick ? 1 : 60;
+
+    const Rotation rotations[] = {Rotation::None, Rotation::Cw90, Rotation::Cw180, Rotation::Cw270};
+    const char *names[] = {"0", "90", "180", "270"};
+    printf("%dx%d yuv420p, simd %s\n", w, h, YuvConverter::levelName(conv.level()));
+    printf("%-10s %8s %10s %8s\n", "path", "rotation", "Mpx/s", "ratio");
+    double base[3] = {};
+    for (int k = 0; k < 4; ++k) {
+        Rotation rotation = rotations[k];
+        bool transposed = rotation == Rotation::Cw90 || rotation == Rotation::Cw270;
+        int outW = transposed ? h : w;
+        int outH = transposed ? w : h;
+        double mpx[3];
+        mpx[0] = bestMpxPerSec(w * h, iterations, [&] {
+            conv.convertRotated(img, rgba.data(), outW * 4, rotation, 0, outH);
+        });
+        mpx[1] = bestMpxPerSec(w * h, iterations, [&] {
+            conv.convert(img, upright.data(), w * 4);
+            if (rotation != Rotation::None) {
+                rotateRgba(reinterpret_cast<const uint32_t *>(upright.data()), w, h,
+                           reinterpret_cast<uint32_t *>(rgba.data()), rotation);
+            }
+        });
+        Yv12Layout layout = yv12PackedLayout(outW, outH);
+        mpx[2] = bestMpxPerSec(w * h, iterations, [&] {
+            if (rotation == Rotation::None) {
+                copyToYv12(img, yv12.data(), layout);
+            } else {
+                rotateToYv12(img, yv12.data(), layout, rotation, 0, outH);
+            }
+        });
+        const char *paths[] = {"rgba", "rgba2pass", "yv12"};
+        for (int p = 0; p < 3; ++p) {
+            if (k == 0) base[p] = mpx[p];
+            printf("%-10s %8s %10.1f %8.2f\n", paths[p], names[k], mpx[p], mpx[p] / base[p]);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "stage.h"
+#include "worker_pool.h"
+
+// 跳转请求在调用线程（UI 线程）上的耗时，以及从请求到流水线重新开始的耗时：
+//   sync   —— 最早的做法，调用线程持锁停止各阶段、跳转、重新启动。停止要等正在执行的单步结束，
+//             视频解码的一步可能就是一帧的解码时间；
+//   locked —— 请求交给 controlling 阶段执行，但调用线程仍然持 mtx 读取时长，controlling 阶段
+//             持 mtx 跳转时要等它跳转完；
+//   async  —— 现在的 Player::seek()：不加锁，从原子地发布的条目读取时长后把请求放进命令队列，
+//             队尾已经有跳转时合并成一次。
+// 流水线各阶段用忙等模拟，按播放的节奏执行（视频解码一帧 8ms）。跳转本身（av_seek_frame、刷新解码器、
+// 清空队列）用 2ms 的忙等模拟。"spaced" 每 50ms 跳转一次，"drag" 模拟拖动进度条，每 4ms 一次。
+// 用法：seek_call_bench [--quick]
+
+using Clock = std::chrono::steady_clock;
+
+#define SEEK_WORK_US 2000
+
+// 每个阶段一步的耗时和节奏：30fps 的视频，1024 帧一包的 48kHz 音频
+struct StepCost {
+    int costUs;
+    int periodUs;
+    ThreadRole role;
+};
+
+static const StepCost kSteps[] = {
+        {100, 10000, ThreadRole::Demux},
+        {8000, 33333, ThreadRole::VideoDecode},
+        {1500, 33333, ThreadRole::VideoConvert},
+        {300, 33333, ThreadRole::VideoRender},
+        {300, 21333, ThreadRole::AudioDecode},
+};
+
+static void spin(int us) {
+    auto end = Clock::now() + std::chrono::microseconds(us);
+    while (Clock::now() < end) {}
+}
+
+static int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count();
+}
+
+struct Stats {
+    int64_t callUs = 0;
+    int64_t callMaxUs = 0;
+    int64_t doneUs = 0;
+    int64_t doneMaxUs = 0;
+    int calls = 0;
+    int done = 0;
+
+    void call(int64_t us) {
+        calls++;
+        callUs += us;
+        callMaxUs = std::max(callMaxUs, us);
+    }
+
+    void finish(int64_t us) {
+        done++;
+        doneUs += us;
+        doneMaxUs = std::max(doneMaxUs, us);
+    }
+};
+
+// 与 PlaybackSession 一样打开后不变，由 shared_ptr 保持
+struct FakeSession {
+    int64_t duration = 600 * 1000000LL;
+};
+
+class FakePlayer {
+public:
+    explicit FakePlayer(WorkerPool *pool) {
+        for (const StepCost &c : kSteps) {
+            stages.push_back(Stage::create(pool, [c] {
+                spin(c.costUs);
+                return static_cast<int64_t>(c.periodUs - c.costUs);
+            }, c.role));
+        }
+        controlling = Stage::create(pool, [this] { return runCommand(); }, ThreadRole::General);
+        controlling->start();
+        for (auto &s : stages) s->start();
+        std::atomic_store(&session, std::make_shared<FakeSession>());
+        isOpen = true;
+    }
+
+    ~FakePlayer() {
+        controlling->stop();
+        for (auto &s : stages) s->stop();
+    }
+
+    void seekSync() {
+        int64_t t0 = nowUs();
+        std::lock_guard<std::mutex> lck(mtx);
+        seekTo();
+        int64_t cost = nowUs() - t0;
+        stats.call(cost);
+        stats.finish(cost);
+    }
+
+    // 修改之前的 Player::seek()
+    void seekLocked(double fraction) {
+        int64_t t0 = nowUs();
+        double position;
+        {
+            std::lock_guard<std::mutex> lck(mtx);
+            auto s = std::atomic_load(&session);
+            if (!isOpen || s == nullptr) return;
+            position = fraction * static_cast<double>(s->duration) / 1000000;
+        }
+        post(t0, position);
+    }
+
+    // 与 Player::seek() 相同
+    void seekAsync(double fraction) {
+        int64_t t0 = nowUs();
+        auto s = std::atomic_load(&session);
+        if (!isOpen || s == nullptr) return;
+        double position = fraction * static_cast<double>(s->duration) / 1000000;
+        post(t0, position);
+    }
+
+    // 等待排队的跳转执行完
+    void drain() {
+        for (;;) {
+            {
+                std::lock_guard<std::mutex> lck(commandMtx);
+                if (commands.empty() && !running) return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    Stats stats;
+
+private:
+    void post(int64_t t0, double position) {
+        {
+            std::lock_guard<std::mutex> lck(commandMtx);
+            if (commands.empty()) {
+                commands.push_back({t0, position});
+            } else {
+                commands.back().position = position;
+            }
+        }
+        controlling->wake();
+        stats.call(nowUs() - t0);
+    }
+
+    void seekTo() {
+        for (auto &s : stages) s->stop();
+        spin(SEEK_WORK_US);
+        for (auto &s : stages) s->start();
+    }
+
+    int64_t runCommand() {
+        int64_t postTime;
+        {
+            std::lock_guard<std::mutex> lck(commandMtx);
+            if (commands.empty()) return Stage::kIdle;
+            postTime = commands.front().postTime;
+            commands.pop_front();
+            running = true;
+        }
+        {
+            std::lock_guard<std::mutex> lck(mtx);
+            seekTo();
+        }
+        stats.finish(nowUs() - postTime);
+        std::lock_guard<std::mutex> lck(commandMtx);
+        running = false;
+        return Stage::kProgress;
+    }
+
+    std::vector<std::shared_ptr<Stage>> stages;
+    std::shared_ptr<Stage> controlling;
+    std::mutex mtx;
+    std::mutex commandMtx;
+    struct Command {
+        int64_t postTime;
+        double position;
+    };
+    std::deque<Command> commands;
+    bool running = false;
+    std::shared_ptr<FakeSession> session;
+    std::atomic<bool> isOpen{false};
+};
+
+enum class Mode { Sync, Locked, Async };
+
+static const char *modeName(Mode mode) {
+    switch (mode) {
+        case Mode::Sync: return "sync";
+        case Mode::Locked: return "locked";
+        default: return "async";
+    }
+}
+
+static void run(const char *name, Mode mode, int seeks, int intervalUs) {
+    FakePlayer player(WorkerPool::shared());
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    for (int i = 0; i < seeks; ++i) {
+        double fraction = static_cast<double>(i) / seeks;
+        if (mode == Mode::Async) {
+            player.seekAsync(fraction);
+        } else if (mode == Mode::Locked) {
+            player.seekLocked(fraction);
+        } else {
+            player.seekSync();
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(intervalUs));
+    }
+    player.drain();
+    const Stats &s = player.stats;
+    printf("%-8s %-6s %6d %10.3f %10.3f %8d %10.2f %10.2f\n", name, modeName(mode), s.calls,
+           s.callUs / 1000.0 / std::max(s.calls, 1), s.callMaxUs / 1000.0, s.done,
+           s.doneUs / 1000.0 / std::max(s.done, 1), s.doneMaxUs / 1000.0);
+}
+
+int main(int argc, char **argv) {
+    bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+    int seeks = quick ? 5 : 200;
+    printf("%-8s %-6s %6s %10s %10s %8s %10s %10s\n", "pattern", "mode", "calls", "callMs", "callMaxMs",
+           "seeks", "doneMs", "doneMaxMs");
+    for (Mode mode : {Mode::Sync, Mode::Locked, Mode::Async}) run("spaced", mode, seeks, 50000);
+    for (Mode mode : {Mode::Sync, Mode::Locked, Mode::Async}) run("drag", mode, seeks, 4000);
+    return 0;
+}
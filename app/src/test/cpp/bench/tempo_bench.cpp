@@ -0,0 +1,69 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <vector>
+#include "tempo_processor.h"
+
+// WSOLA 变速的 CPU 开销：每处理 1 秒输入音频花费的 CPU 毫秒数（单线程），以及相当于实时的倍数。
+// 输入是几个正弦波叠加噪声的立体声 float PCM，每次送 1024 帧，与解码阶段每帧的大小相近。
+// 用法：tempo_bench [--quick]
+
+#define CHUNK_FRAMES 1024
+
+static double threadCpuSeconds() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static std::vector<float> makeSignal(int rate, int channels, double seconds) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+    size_t frames = static_cast<size_t>(rate * seconds);
+    std::vector<float> pcm(frames * channels);
+    for (size_t i = 0; i < frames; ++i) {
+        double t = static_cast<double>(i) / rate;
+        float s = static_cast<float>(0.3 * sin(2 * M_PI * 220 * t) + 0.2 * sin(2 * M_PI * 330 * t) +
+                                     0.1 * sin(2 * M_PI * 1250 * t));
+        for (int c = 0; c < channels; ++c) pcm[i * channels + c] = s + noise(rng);
+    }
+    return pcm;
+}
+
+int main(int argc, char **argv) {
+    bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+    const int rates[] = {44100, 48000};
+    const float tempos[] = {0.5f, 0.75f, 1.0f, 1.25f, 1.5f, 2.0f, 3.0f};
+    const int channels = 2;
+    double seconds = quick ? 0.5 : 20.0;
+
+    printf("%-6s %-6s %14s %12s %10s\n", "rate", "tempo", "cpu ms / s", "x realtime", "out/in");
+    for (int rate : rates) {
+        std::vector<float> pcm = makeSignal(rate, channels, seconds);
+        size_t frames = pcm.size() / channels;
+        for (float tempo : tempos) {
+            TempoProcessor proc;
+            proc.configure(rate, channels);
+            proc.setTempo(tempo);
+            std::vector<float> out;
+            // 先处理 1 秒，让速度从 1 逼近到目标值，计时的部分都以目标速度运行
+            std::vector<float> warm = makeSignal(rate, channels, 1.0);
+            proc.process(warm.data(), warm.size() / channels, out);
+            out.clear();
+
+            size_t produced = 0;
+            double begin = threadCpuSeconds();
+            for (size_t pos = 0; pos < frames; pos += CHUNK_FRAMES) {
+                size_t n = std::min<size_t>(CHUNK_FRAMES, frames - pos);
+                produced += proc.process(pcm.data() + pos * channels, n, out);
+                out.clear();
+            }
+            double cpu = threadCpuSeconds() - begin;
+            printf("%-6d %-6.2f %14.2f %12.0f %10.3f\n", rate, tempo, cpu * 1000 / seconds,
+                   seconds / cpu, static_cast<double>(produced) / frames);
+        }
+    }
+    return 0;
+}
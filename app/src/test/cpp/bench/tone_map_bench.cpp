@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "tone_map.h"
+#include "yuv_convert.h"
+
+// 4K 10 位 PQ 内容单线程的映射吞吐量（百万像素/秒、帧/秒）：
+//   yv12       —— 映射成 8 位 YUV420P，以 YV12 显示，色域由窗口的 dataspace 标明；
+//   rgba       —— 每两行映射后立即按 BT.2020 矩阵转换成 RGBA（与转换阶段相同）；
+//   rgba+709   —— 另外在线性光下换算成 BT.709 原色。
+// yuv420p10 与 P010 各测一遍。用法：tone_map_bench [--quick]
+
+using Clock = std::chrono::steady_clock;
+
+template <typename Fn>
+static double bestMpxPerSec(int pixels, int iterations, Fn &&fn) {
+    double best = 0;
+    for (int round = 0; round < 3; ++round) {
+        auto begin = Clock::now();
+        for (int i = 0; i < iterations; ++i) fn();
+        double sec = std::chrono::duration<double>(Clock::now() - begin).count();
+        best = std::max(best, static_cast<double>(pixels) * iterations / sec / 1e6);
+    }
+    return best;
+}
+
+int main(int argc, char **argv) {
+    bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+    const int w = 3840;
+    const int h = 2160;
+    const int cw = w / 2;
+    // 亮度覆盖整个码值范围，色度在中性值附近变化
+    std::vector<uint16_t> y(static_cast<size_t>(w) * h);
+    std::vector<uint16_t> planar(static_cast<size_t>(cw) * h);        // U 平面之后是 V 平面
+    std::vector<uint16_t> interleaved(static_cast<size_t>(w) * h / 2);
+    for (size_t i = 0; i < y.size(); ++i) y[i] = static_cast<uint16_t>(64 + i % 877);
+    for (size_t i = 0; i < planar.size(); ++i) planar[i] = static_cast<uint16_t>(448 + i % 128);
+    for (size_t i = 0; i < interleaved.size(); ++i) interleaved[i] = static_cast<uint16_t>(448 + i % 128);
+    std::vector<uint16_t> yP010(y.size());
+    std::vector<uint16_t> uvP010(interleaved.size());
+    for (size_t i = 0; i < y.size(); ++i) yP010[i] = static_cast<uint16_t>(y[i] << 6);
+    for (size_t i = 0; i < interleaved.size(); ++i) uvP010[i] = static_cast<uint16_t>(interleaved[i] << 6);
+
+    const Yuv10Image images[] = {
+            {y.data(), planar.data(), planar.data() + static_cast<size_t>(cw) * (h / 2), w, cw, w, h, 0, false},
+            {yP010.data(), uvP010.data(), nullptr, w, w, w, h, 6, true},
+    };
+    const char *names[] = {"yuv420p10", "p010"};
+
+    ToneMapper mapper;
+    mapper.configure(HdrTransfer::PQ, DEFAULT_HDR_PEAK_NITS, false);
+    YuvConverter conv;
+    conv.setColor(YuvMatrix::BT2020, false);
+    std::vector<uint8_t> yuv(static_cast<size_t>(w) * h * 3 / 2);
+    std::vector<uint8_t> rgba(static_cast<size_t>(w) * h * 4);
+    std::vector<uint8_t> scratch(2 * w + 2 * cw);
+    int iterations = quick ? 1 : 10;
+
+    printf("%dx%d PQ, simd %s\n", w, h, YuvConverter::levelName(conv.level()));
+    printf("%-10s %-10s %10s %8s\n", "input", "output", "Mpx/s", "fps");
+    for (int k = 0; k < 2; ++k) {
+        const Yuv10Image &src = images[k];
+        Yuv8Planes planes{yuv.data(), yuv.data() + static_cast<size_t>(w) * h,
+                          yuv.data() + static_cast<size_t>(w) * h * 5 / 4, w, cw};
+        double mpx = bestMpxPerSec(w * h, iterations, [&] {
+            mapper.convertRows(src, planes, 0, h);
+        });
+        printf("%-10s %-10s %10.1f %8.1f\n", names[k], "yv12", mpx, mpx * 1e6 / (w * h));
+        for (bool gamut : {false, true}) {
+            Yuv8Planes rows{scratch.data(), scratch.data() + 2 * w, scratch.data() + 2 * w + cw, w, cw};
+            YuvImage pair{rows.y, rows.u, rows.v, w, cw, w, 2, ChromaLayout::Planar};
+            mpx = bestMpxPerSec(w * h, iterations, [&] {
+                for (int row = 0; row < h; row += 2) {
+                    uint8_t *out = rgba.data() + static_cast<size_t>(row) * w * 4;
+                    mapper.convertRows(src, rows, row, row + 2);
+                    conv.convertRows(pair, out, w * 4, 0, 2);
+                    if (gamut) mapper.toBt709(out, w * 2);
+                }
+            });
+            printf("%-10s %-10s %10.1f %8.1f\n", names[k], gamut ? "rgba+709" : "rgba", mpx,
+                   mpx * 1e6 / (w * h));
+        }
+    }
+    return 0;
+}
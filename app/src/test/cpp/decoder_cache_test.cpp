@@ -0,0 +1,109 @@
+#include <vector>
+#include "decoder_cache.h"
+#include "fake_avcodec.h"
+#include "unit_test.h"
+
+namespace {
+
+AVCodecParameters videoParams() {
+    AVCodecParameters par{};
+    par.codec_type = AVMEDIA_TYPE_VIDEO;
+    par.codec_id = AV_CODEC_ID_H264;
+    par.codec_tag = MKTAG('a', 'v', 'c', '1');
+    par.profile = FF_PROFILE_H264_HIGH;
+    par.format = AV_PIX_FMT_YUV420P;
+    par.width = 1920;
+    par.height = 1080;
+    par.bits_per_raw_sample = 8;
+    return par;
+}
+
+AVCodecParameters audioParams() {
+    AVCodecParameters par{};
+    par.codec_type = AVMEDIA_TYPE_AUDIO;
+    par.codec_id = AV_CODEC_ID_PCM_S16LE;
+    par.format = AV_SAMPLE_FMT_S16;
+    par.sample_rate = 48000;
+    par.channels = 2;
+    par.channel_layout = AV_CH_LAYOUT_STEREO;
+    par.bits_per_coded_sample = 16;
+    par.block_align = 4;
+    par.frame_size = 1024;
+    return par;
+}
+
+AVCodecContext *newContext() {
+    return avcodec_alloc_context3(nullptr);
+}
+
+}  // namespace
+
+TEST(DecoderCache, ReusesDecoderWithSameParameters) {
+    fakeCodec.reset();
+    {
+        DecoderCache cache;
+        AVCodecParameters par = videoParams();
+        DecoderKey key = DecoderCache::keyOf(&par, 0, 0);
+        AVCodecContext *ctx = newContext();
+        cache.release(key, ctx);
+        EXPECT_EQ(fakeCodec.flushes.load(), 1);
+        EXPECT_EQ(cache.acquire(DecoderCache::keyOf(&par, 0, 0)), ctx);
+        EXPECT_EQ(cache.hits(), 1u);
+        // 取走之后缓存中没有了
+        EXPECT_EQ(cache.acquire(key), nullptr);
+        EXPECT_EQ(cache.misses(), 1u);
+        avcodec_free_context(&ctx);
+    }
+    EXPECT_EQ(fakeCodec.live.load(), 0);
+}
+
+// 影响解码器初始化的参数不同时不能复用：codec tag、profile、位深、音频的块大小和帧长
+TEST(DecoderCache, KeyIncludesInitParameters) {
+    std::vector<void (*)(AVCodecParameters &)> videoChanges = {
+            [](AVCodecParameters &p) { p.codec_tag = MKTAG('a', 'v', 'c', '3'); },
+            [](AVCodecParameters &p) { p.profile = FF_PROFILE_H264_MAIN; },
+            [](AVCodecParameters &p) { p.bits_per_raw_sample = 10; },
+            [](AVCodecParameters &p) { p.bits_per_coded_sample = 24; },
+    };
+    std::vector<void (*)(AVCodecParameters &)> audioChanges = {
+            [](AVCodecParameters &p) { p.block_align = 8; },
+            [](AVCodecParameters &p) { p.frame_size = 960; },
+            [](AVCodecParameters &p) { p.bits_per_coded_sample = 24; },
+    };
+    fakeCodec.reset();
+    for (int audio = 0; audio < 2; ++audio) {
+        for (auto change : audio ? audioChanges : videoChanges) {
+            DecoderCache cache;
+            AVCodecParameters par = audio ? audioParams() : videoParams();
+            DecoderKey base = DecoderCache::keyOf(&par, 0, 0);
+            change(par);
+            DecoderKey changed = DecoderCache::keyOf(&par, 0, 0);
+            EXPECT_TRUE(base.sameStream(changed));
+            EXPECT_FALSE(base == changed);
+            cache.release(base, newContext());
+            EXPECT_EQ(cache.acquire(changed), nullptr);
+            EXPECT_EQ(cache.mismatches(), 1u);
+        }
+    }
+    EXPECT_EQ(fakeCodec.live.load(), 0);
+}
+
+TEST(DecoderCache, EvictsOldestWhenFull) {
+    fakeCodec.reset();
+    DecoderCache cache;
+    std::vector<DecoderKey> keys;
+    for (int i = 0; i <= DECODER_CACHE_SIZE; ++i) {
+        AVCodecParameters par = videoParams();
+        par.width = 640 + 16 * i;
+        keys.push_back(DecoderCache::keyOf(&par, 0, 0));
+        cache.release(keys.back(), newContext());
+    }
+    EXPECT_EQ(cache.evictions(), 1u);
+    EXPECT_EQ(fakeCodec.frees.load(), 1);
+    EXPECT_EQ(cache.acquire(keys.front()), nullptr);
+    AVCodecContext *ctx = cache.acquire(keys.back());
+    EXPECT_NE(ctx, nullptr);
+    avcodec_free_context(&ctx);
+    cache.clear();
+    EXPECT_EQ(fakeCodec.live.load(), 0);
+}
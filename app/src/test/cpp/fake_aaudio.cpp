@@ -0,0 +1,369 @@
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include "fake_aaudio.h"
+
+FakeAudioDevice fakeAudioDevice;
+
+static std::mutex openMtx;
+static AAudioStream *lastStream = nullptr;
+
+struct AAudioStreamBuilderStruct {
+    int32_t sampleRate = AAUDIO_UNSPECIFIED;
+    int32_t channelCount = AAUDIO_UNSPECIFIED;
+    aaudio_format_t format = AAUDIO_FORMAT_UNSPECIFIED;
+    aaudio_sharing_mode_t sharingMode = AAUDIO_SHARING_MODE_SHARED;
+    aaudio_performance_mode_t performanceMode = AAUDIO_PERFORMANCE_MODE_NONE;
+    AAudioStream_dataCallback dataCallback = nullptr;
+    void *dataUser = nullptr;
+    AAudioStream_errorCallback errorCallback = nullptr;
+    void *errorUser = nullptr;
+};
+
+int64_t fakeAudioNowNs() {
+    struct timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+AAudioStream *fakeAudioStream() {
+    std::lock_guard<std::mutex> lck(openMtx);
+    return lastStream;
+}
+
+static int64_t burstPeriodNs(const AAudioStream *s) {
+    return static_cast<int64_t>(s->burst) * 1000000000LL / s->sampleRate;
+}
+
+// 中间状态经过 transitionUs 后到达目标状态
+static void settleLocked(AAudioStream *s, int64_t now) {
+    if (now - s->stateSince < s->transitionUs * 1000) return;
+    switch (s->state) {
+        case AAUDIO_STREAM_STATE_STARTING:
+            s->state = AAUDIO_STREAM_STATE_STARTED;
+            s->startNs = now;
+            s->readBase = s->framesRead;
+            s->readNs = 0;
+            s->cond.notify_all();
+            break;
+        case AAUDIO_STREAM_STATE_PAUSING:
+            s->state = AAUDIO_STREAM_STATE_PAUSED;
+            break;
+        case AAUDIO_STREAM_STATE_FLUSHING:
+            // 丢弃还没有读走的数据
+            s->framesRead = s->framesWritten;
+            s->state = AAUDIO_STREAM_STATE_FLUSHED;
+            break;
+        case AAUDIO_STREAM_STATE_STOPPING:
+            s->state = AAUDIO_STREAM_STATE_STOPPED;
+            break;
+        default:
+            break;
+    }
+}
+
+static void enterLocked(AAudioStream *s, aaudio_stream_state_t state) {
+    s->state = state;
+    s->stateSince = fakeAudioNowNs();
+    settleLocked(s, s->stateSince);
+}
+
+static void deviceLoop(AAudioStream *s) {
+    std::unique_lock<std::mutex> lck(s->mtx);
+    while (!s->closing) {
+        if (s->pendingError != AAUDIO_OK) {
+            aaudio_result_t error = s->pendingError;
+            s->pendingError = AAUDIO_OK;
+            lck.unlock();
+            if (s->errorCallback) s->errorCallback(s, s->errorUser, error);
+            lck.lock();
+            continue;
+        }
+        int64_t now = fakeAudioNowNs();
+        settleLocked(s, now);
+        if (s->state != AAUDIO_STREAM_STATE_STARTED) {
+            s->cond.wait_for(lck, std::chrono::microseconds(500));
+            continue;
+        }
+        // 读走到现在为止应该播放的所有 burst，回调耽误了多个周期时一次补齐
+        int64_t period = burstPeriodNs(s);
+        int64_t ticks = (now - s->startNs) / period;
+        int64_t due = s->readBase + ticks * s->burst;
+        if (due > s->framesRead) {
+            int64_t need = due - s->framesRead;
+            int64_t queued = s->framesWritten - s->framesRead;
+            if (queued < need) {
+                s->xruns++;
+                s->silentFrames += need - queued;
+                s->framesWritten = due;
+            }
+            s->framesRead = due;
+            s->readNs = s->startNs + ticks * period;
+        }
+        // 缓冲区有一个 burst 的空间就调用回调
+        while (s->state == AAUDIO_STREAM_STATE_STARTED && !s->closing &&
+               s->framesWritten - s->framesRead + s->burst <= s->bufferSize) {
+            AAudioStream_dataCallback callback = s->dataCallback;
+            void *user = s->dataUser;
+            int32_t frames = s->burst;
+            lck.unlock();
+            int64_t t0 = fakeAudioNowNs();
+            aaudio_data_callback_result_t result = callback(s, user, s->scratch.data(), frames);
+            int64_t cost = fakeAudioNowNs() - t0;
+            lck.lock();
+            s->callbacks++;
+            s->callbackNs += cost;
+            if (cost > s->callbackMaxNs) s->callbackMaxNs = cost;
+            // 回调期间被刷新或暂停时这一段数据作废
+            if (s->state != AAUDIO_STREAM_STATE_STARTED) break;
+            s->framesWritten += frames;
+            if (result == AAUDIO_CALLBACK_RESULT_STOP) enterLocked(s, AAUDIO_STREAM_STATE_STOPPING);
+        }
+        if (s->state != AAUDIO_STREAM_STATE_STARTED) continue;
+        int64_t next = s->startNs + ((s->framesRead - s->readBase) / s->burst + 1) * period;
+        int64_t wait = next - fakeAudioNowNs();
+        if (wait > 0) s->cond.wait_for(lck, std::chrono::nanoseconds(wait));
+    }
+}
+
+void fakeAudioDisconnect(AAudioStream *stream) {
+    std::lock_guard<std::mutex> lck(stream->mtx);
+    stream->state = AAUDIO_STREAM_STATE_DISCONNECTED;
+    stream->pendingError = AAUDIO_ERROR_DISCONNECTED;
+    stream->cond.notify_all();
+}
+
+extern "C" {
+
+const char *AAudio_convertResultToText(aaudio_result_t returnCode) {
+    switch (returnCode) {
+        case AAUDIO_OK: return "AAUDIO_OK";
+        case AAUDIO_ERROR_DISCONNECTED: return "AAUDIO_ERROR_DISCONNECTED";
+        case AAUDIO_ERROR_ILLEGAL_ARGUMENT: return "AAUDIO_ERROR_ILLEGAL_ARGUMENT";
+        case AAUDIO_ERROR_INTERNAL: return "AAUDIO_ERROR_INTERNAL";
+        case AAUDIO_ERROR_INVALID_STATE: return "AAUDIO_ERROR_INVALID_STATE";
+        case AAUDIO_ERROR_TIMEOUT: return "AAUDIO_ERROR_TIMEOUT";
+        case AAUDIO_ERROR_UNAVAILABLE: return "AAUDIO_ERROR_UNAVAILABLE";
+        default: return "AAUDIO_ERROR_UNKNOWN";
+    }
+}
+
+aaudio_result_t AAudio_createStreamBuilder(AAudioStreamBuilder **builder) {
+    *builder = new AAudioStreamBuilder();
+    return AAUDIO_OK;
+}
+
+void AAudioStreamBuilder_setSampleRate(AAudioStreamBuilder *builder, int32_t sampleRate) {
+    builder->sampleRate = sampleRate;
+}
+
+void AAudioStreamBuilder_setChannelCount(AAudioStreamBuilder *builder, int32_t channelCount) {
+    builder->channelCount = channelCount;
+}
+
+void AAudioStreamBuilder_setFormat(AAudioStreamBuilder *builder, aaudio_format_t format) {
+    builder->format = format;
+}
+
+void AAudioStreamBuilder_setPerformanceMode(AAudioStreamBuilder *builder, aaudio_performance_mode_t mode) {
+    builder->performanceMode = mode;
+}
+
+void AAudioStreamBuilder_setSharingMode(AAudioStreamBuilder *builder, aaudio_sharing_mode_t sharingMode) {
+    builder->sharingMode = sharingMode;
+}
+
+void AAudioStreamBuilder_setDataCallback(AAudioStreamBuilder *builder, AAudioStream_dataCallback callback,
+                                         void *userData) {
+    builder->dataCallback = callback;
+    builder->dataUser = userData;
+}
+
+void AAudioStreamBuilder_setErrorCallback(AAudioStreamBuilder *builder, AAudioStream_errorCallback callback,
+                                          void *userData) {
+    builder->errorCallback = callback;
+    builder->errorUser = userData;
+}
+
+aaudio_result_t AAudioStreamBuilder_openStream(AAudioStreamBuilder *builder, AAudioStream **stream) {
+    // 只模拟回调驱动的流
+    if (builder->dataCallback == nullptr) return AAUDIO_ERROR_ILLEGAL_ARGUMENT;
+    const FakeAudioDevice &dev = fakeAudioDevice;
+    auto s = new AAudioStream();
+    s->sampleRate = builder->sampleRate != AAUDIO_UNSPECIFIED ? builder->sampleRate : dev.sampleRate;
+    s->channelCount = builder->channelCount != AAUDIO_UNSPECIFIED ? builder->channelCount : dev.channelCount;
+    bool wantFloat = builder->format != AAUDIO_FORMAT_PCM_I16;
+    s->format = wantFloat && dev.floatSupported ? AAUDIO_FORMAT_PCM_FLOAT : AAUDIO_FORMAT_PCM_I16;
+    s->sharingMode = builder->sharingMode == AAUDIO_SHARING_MODE_EXCLUSIVE && dev.exclusiveSupported ?
+                     AAUDIO_SHARING_MODE_EXCLUSIVE : AAUDIO_SHARING_MODE_SHARED;
+    s->performanceMode = builder->performanceMode;
+    s->burst = std::max(dev.framesPerBurst, 1);
+    s->capacity = s->burst * std::max(dev.capacityBursts, 1);
+    s->bufferSize = s->capacity;
+    s->presentation = dev.presentationFrames;
+    s->transitionUs = dev.transitionUs;
+    s->dataCallback = builder->dataCallback;
+    s->dataUser = builder->dataUser;
+    s->errorCallback = builder->errorCallback;
+    s->errorUser = builder->errorUser;
+    size_t sampleBytes = s->format == AAUDIO_FORMAT_PCM_FLOAT ? sizeof(float) : sizeof(int16_t);
+    s->scratch.resize(static_cast<size_t>(s->burst) * s->channelCount * sampleBytes);
+    s->device = std::thread(deviceLoop, s);
+    {
+        std::lock_guard<std::mutex> lck(openMtx);
+        lastStream = s;
+    }
+    *stream = s;
+    return AAUDIO_OK;
+}
+
+aaudio_result_t AAudioStreamBuilder_delete(AAudioStreamBuilder *builder) {
+    delete builder;
+    return AAUDIO_OK;
+}
+
+aaudio_result_t AAudioStream_close(AAudioStream *stream) {
+    {
+        std::lock_guard<std::mutex> lck(stream->mtx);
+        stream->closing = true;
+        stream->cond.notify_all();
+    }
+    stream->device.join();
+    {
+        std::lock_guard<std::mutex> lck(openMtx);
+        if (lastStream == stream) lastStream = nullptr;
+    }
+    delete stream;
+    return AAUDIO_OK;
+}
+
+aaudio_result_t AAudioStream_requestStart(AAudioStream *stream) {
+    std::lock_guard<std::mutex> lck(stream->mtx);
+    stream->startRequests++;
+    if (stream->state == AAUDIO_STREAM_STATE_DISCONNECTED) return AAUDIO_ERROR_DISCONNECTED;
+    FakeAudioDevice &dev = fakeAudioDevice;
+    if (dev.startFailures != 0) {
+        if (dev.startFailures > 0) dev.startFailures--;
+        return dev.startError;
+    }
+    if (stream->state == AAUDIO_STREAM_STATE_STARTING || stream->state == AAUDIO_STREAM_STATE_STARTED) {
+        return AAUDIO_OK;
+    }
+    enterLocked(stream, AAUDIO_STREAM_STATE_STARTING);
+    stream->cond.notify_all();
+    return AAUDIO_OK;
+}
+
+aaudio_result_t AAudioStream_requestPause(AAudioStream *stream) {
+    std::lock_guard<std::mutex> lck(stream->mtx);
+    switch (stream->state) {
+        case AAUDIO_STREAM_STATE_DISCONNECTED:
+            return AAUDIO_ERROR_DISCONNECTED;
+        case AAUDIO_STREAM_STATE_STARTING:
+        case AAUDIO_STREAM_STATE_STARTED:
+            enterLocked(stream, AAUDIO_STREAM_STATE_PAUSING);
+            return AAUDIO_OK;
+        default:
+            return AAUDIO_OK;
+    }
+}
+
+aaudio_result_t AAudioStream_requestFlush(AAudioStream *stream) {
+    std::lock_guard<std::mutex> lck(stream->mtx);
+    switch (stream->state) {
+        case AAUDIO_STREAM_STATE_DISCONNECTED:
+            return AAUDIO_ERROR_DISCONNECTED;
+        case AAUDIO_STREAM_STATE_OPEN:
+        case AAUDIO_STREAM_STATE_PAUSED:
+        case AAUDIO_STREAM_STATE_FLUSHED:
+        case AAUDIO_STREAM_STATE_STOPPED:
+            enterLocked(stream, AAUDIO_STREAM_STATE_FLUSHING);
+            return AAUDIO_OK;
+        default:
+            // 只能在暂停（或停止）时刷新
+            return AAUDIO_ERROR_INVALID_STATE;
+    }
+}
+
+aaudio_result_t AAudioStream_requestStop(AAudioStream *stream) {
+    std::lock_guard<std::mutex> lck(stream->mtx);
+    if (stream->state == AAUDIO_STREAM_STATE_DISCONNECTED) return AAUDIO_ERROR_DISCONNECTED;
+    enterLocked(stream, AAUDIO_STREAM_STATE_STOPPING);
+    return AAUDIO_OK;
+}
+
+aaudio_stream_state_t AAudioStream_getState(AAudioStream *stream) {
+    std::lock_guard<std::mutex> lck(stream->mtx);
+    settleLocked(stream, fakeAudioNowNs());
+    return stream->state;
+}
+
+aaudio_format_t AAudioStream_getFormat(AAudioStream *stream) {
+    return stream->format;
+}
+
+int32_t AAudioStream_getChannelCount(AAudioStream *stream) {
+    return stream->channelCount;
+}
+
+int32_t AAudioStream_getSampleRate(AAudioStream *stream) {
+    return stream->sampleRate;
+}
+
+aaudio_sharing_mode_t AAudioStream_getSharingMode(AAudioStream *stream) {
+    return stream->sharingMode;
+}
+
+aaudio_performance_mode_t AAudioStream_getPerformanceMode(AAudioStream *stream) {
+    return stream->performanceMode;
+}
+
+int32_t AAudioStream_getFramesPerBurst(AAudioStream *stream) {
+    return stream->burst;
+}
+
+int32_t AAudioStream_getBufferSizeInFrames(AAudioStream *stream) {
+    std::lock_guard<std::mutex> lck(stream->mtx);
+    return stream->bufferSize;
+}
+
+int32_t AAudioStream_getBufferCapacityInFrames(AAudioStream *stream) {
+    return stream->capacity;
+}
+
+aaudio_result_t AAudioStream_setBufferSizeInFrames(AAudioStream *stream, int32_t numFrames) {
+    std::lock_guard<std::mutex> lck(stream->mtx);
+    stream->bufferSizeCalls++;
+    if (stream->state == AAUDIO_STREAM_STATE_DISCONNECTED) return AAUDIO_ERROR_DISCONNECTED;
+    // 与真实设备一样截断到 [1, 容量]，返回实际的大小
+    stream->bufferSize = std::min(std::max(numFrames, 1), stream->capacity);
+    return stream->bufferSize;
+}
+
+int32_t AAudioStream_getXRunCount(AAudioStream *stream) {
+    return stream->xruns;
+}
+
+int64_t AAudioStream_getFramesWritten(AAudioStream *stream) {
+    std::lock_guard<std::mutex> lck(stream->mtx);
+    return stream->framesWritten;
+}
+
+int64_t AAudioStream_getFramesRead(AAudioStream *stream) {
+    std::lock_guard<std::mutex> lck(stream->mtx);
+    return stream->framesRead;
+}
+
+aaudio_result_t AAudioStream_getTimestamp(AAudioStream *stream, int32_t clockid, int64_t *framePosition,
+                                          int64_t *timeNanoseconds) {
+    std::lock_guard<std::mutex> lck(stream->mtx);
+    if (clockid != CLOCK_MONOTONIC) return AAUDIO_ERROR_ILLEGAL_ARGUMENT;
+    if (stream->state == AAUDIO_STREAM_STATE_DISCONNECTED) return AAUDIO_ERROR_DISCONNECTED;
+    // 还没有开始输出时没有时间戳
+    if (stream->state != AAUDIO_STREAM_STATE_STARTED || stream->readNs == 0) return AAUDIO_ERROR_INVALID_STATE;
+    *framePosition = std::max<int64_t>(stream->framesRead - stream->presentation, 0);
+    *timeNanoseconds = stream->readNs;
+    return AAUDIO_OK;
+}
+
+}
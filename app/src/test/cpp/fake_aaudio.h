@@ -0,0 +1,89 @@
+#ifndef TINY_PLAYER_FAKE_AAUDIO_H
+#define TINY_PLAYER_FAKE_AAUDIO_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <aaudio/AAudio.h>
+
+// 模拟设备的参数，在打开流时读取，只影响之后打开的流
+struct FakeAudioDevice {
+    int32_t sampleRate = 48000;         // 原生采样率，请求 AAUDIO_UNSPECIFIED 时给出
+    int32_t channelCount = 2;
+    bool floatSupported = true;         // 为 false 时请求 float 只能得到 S16
+    bool exclusiveSupported = true;
+    int32_t framesPerBurst = 192;
+    int32_t capacityBursts = 16;
+    int32_t presentationFrames = 192;   // 设备从读走数据到声音播放出来的延迟（帧）
+    int64_t transitionUs = 1000;        // STARTING、PAUSING 等中间状态持续的时间
+    int startFailures = 0;              // 接下来多少次 requestStart 失败，< 0 表示一直失败
+    aaudio_result_t startError = AAUDIO_ERROR_INTERNAL;
+};
+
+extern FakeAudioDevice fakeAudioDevice;
+
+// 模拟的回调驱动 AAudio 输出流。打开后由一个线程扮演设备：按采样率每个 burst 读走一个
+// burst 的数据，并在缓冲区（bufferSize 帧）有空间时调用数据回调填满。设备到时间要读
+// 数据而缓冲区不够时记一次欠载（XRun），与真实设备一样时间照常前进，缺的部分按静音播放。
+// 时间戳给出最近一次读取时已经播放出来的帧（读走的帧减去 presentationFrames）和时刻。
+//
+// 字段由 fake_aaudio.cpp 中的函数在 mtx 下修改，测试可以直接读取统计字段
+struct AAudioStreamStruct {
+    int32_t sampleRate = 0;
+    int32_t channelCount = 0;
+    aaudio_format_t format = AAUDIO_FORMAT_UNSPECIFIED;
+    aaudio_sharing_mode_t sharingMode = AAUDIO_SHARING_MODE_SHARED;
+    aaudio_performance_mode_t performanceMode = AAUDIO_PERFORMANCE_MODE_NONE;
+    int32_t burst = 0;
+    int32_t capacity = 0;
+    int32_t presentation = 0;
+    int64_t transitionUs = 0;
+    AAudioStream_dataCallback dataCallback = nullptr;
+    void *dataUser = nullptr;
+    AAudioStream_errorCallback errorCallback = nullptr;
+    void *errorUser = nullptr;
+
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::thread device;
+    bool closing = false;
+    aaudio_stream_state_t state = AAUDIO_STREAM_STATE_OPEN;
+    int64_t stateSince = 0;             // 进入中间状态的时刻（纳秒）
+    int64_t startNs = 0;                // 开始播放的时刻，设备按它计算每个 burst 的读取时间
+    int64_t readBase = 0;               // 开始播放时已经读走的帧
+    int32_t bufferSize = 0;
+    int64_t framesWritten = 0;
+    int64_t framesRead = 0;
+    int64_t readNs = 0;                 // 最近一次读取的时刻，0 表示还没有读过
+    aaudio_result_t pendingError = AAUDIO_OK;   // 等待设备线程通过错误回调报告的错误
+    std::vector<uint8_t> scratch;       // 一个 burst 的回调缓冲区
+
+    // 统计
+    std::atomic<int32_t> xruns{0};
+    std::atomic<int64_t> callbacks{0};
+    std::atomic<int64_t> callbackNs{0};     // 数据回调累计耗时
+    std::atomic<int64_t> callbackMaxNs{0};
+    std::atomic<int64_t> silentFrames{0};   // 欠载时按静音播放的帧
+    std::atomic<int> startRequests{0};
+    std::atomic<int> bufferSizeCalls{0};
+};
+
+/**
+ * @brief 单调时钟（纳秒），与 fake 设备和 AAudioRender 使用的 CLOCK_MONOTONIC 相同
+ */
+int64_t fakeAudioNowNs();
+
+/**
+ * @brief 最近一次打开、还没有关闭的流，没有时返回 nullptr
+ */
+AAudioStream *fakeAudioStream();
+
+/**
+ * @brief 模拟设备断开（拔出耳机）：流进入 DISCONNECTED 状态，并在设备线程上调用错误回调
+ */
+void fakeAudioDisconnect(AAudioStream *stream);
+
+#endif //TINY_PLAYER_FAKE_AAUDIO_H
@@ -0,0 +1,180 @@
+#include <chrono>
+#include "fake_avcodec.h"
+
+extern "C" {
+#include "libavutil/imgutils.h"
+#include "libavutil/samplefmt.h"
+#include "libswscale/swscale.h"
+}
+
+FakeCodecCosts fakeCodec;
+
+void FakeCodecCosts::reset() {
+    videoOpenUs = audioOpenUs = flushUs = freeUs = 0;
+    opens = flushes = frees = live = 0;
+    cloneFailAfter = -1;
+    liveRefs = 0;
+    allocFailAfter = -1;
+    scales = 0;
+}
+
+static bool cloneAllowed() {
+    if (fakeCodec.cloneFailAfter == 0) return false;
+    if (fakeCodec.cloneFailAfter > 0) fakeCodec.cloneFailAfter--;
+    return true;
+}
+
+static void spin(int us) {
+    if (us <= 0) return;
+    auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+    while (std::chrono::steady_clock::now() < end) {}
+}
+
+extern "C" {
+
+AVCodecContext *avcodec_alloc_context3(const AVCodec *codec) {
+    auto ctx = new AVCodecContext();
+    ctx->codec = codec;
+    if (codec != nullptr) {
+        ctx->codec_type = codec->type;
+        ctx->codec_id = codec->id;
+    }
+    fakeCodec.live++;
+    return ctx;
+}
+
+int avcodec_parameters_to_context(AVCodecContext *ctx, const AVCodecParameters *par) {
+    ctx->codec_type = par->codec_type;
+    ctx->codec_id = par->codec_id;
+    ctx->codec_tag = par->codec_tag;
+    ctx->profile = par->profile;
+    ctx->width = par->width;
+    ctx->height = par->height;
+    ctx->sample_rate = par->sample_rate;
+    ctx->channels = par->channels;
+    ctx->channel_layout = par->channel_layout;
+    return 0;
+}
+
+int avcodec_open2(AVCodecContext *ctx, const AVCodec *, AVDictionary **) {
+    spin(ctx->codec_type == AVMEDIA_TYPE_VIDEO ? fakeCodec.videoOpenUs : fakeCodec.audioOpenUs);
+    fakeCodec.opens++;
+    return 0;
+}
+
+void avcodec_flush_buffers(AVCodecContext *) {
+    spin(fakeCodec.flushUs);
+    fakeCodec.flushes++;
+}
+
+void avcodec_free_context(AVCodecContext **ctx) {
+    if (ctx == nullptr || *ctx == nullptr) return;
+    spin(fakeCodec.freeUs);
+    delete *ctx;
+    *ctx = nullptr;
+    fakeCodec.frees++;
+    fakeCodec.live--;
+}
+
+AVPacket *av_packet_clone(const AVPacket *src) {
+    if (!cloneAllowed()) return nullptr;
+    auto pkt = new AVPacket(*src);
+    pkt->buf = nullptr;
+    pkt->side_data = nullptr;
+    pkt->side_data_elems = 0;
+    fakeCodec.liveRefs++;
+    return pkt;
+}
+
+void av_packet_free(AVPacket **pkt) {
+    if (pkt == nullptr || *pkt == nullptr) return;
+    delete *pkt;
+    *pkt = nullptr;
+    fakeCodec.liveRefs--;
+}
+
+AVFrame *av_frame_clone(const AVFrame *src) {
+    if (!cloneAllowed()) return nullptr;
+    auto frame = new AVFrame();
+    frame->format = src->format;
+    frame->width = src->width;
+    frame->height = src->height;
+    frame->nb_samples = src->nb_samples;
+    frame->channels = src->channels;
+    frame->sample_rate = src->sample_rate;
+    frame->pts = src->pts;
+    frame->key_frame = src->key_frame;
+    fakeCodec.liveRefs++;
+    return frame;
+}
+
+AVFrame *av_frame_alloc() {
+    fakeCodec.liveRefs++;
+    return new AVFrame();
+}
+
+int av_frame_get_buffer(AVFrame *frame, int) {
+    if (fakeCodec.allocFailAfter == 0) return AVERROR(ENOMEM);
+    if (fakeCodec.allocFailAfter > 0) fakeCodec.allocFailAfter--;
+    return frame->width > 0 && frame->height > 0 ? 0 : AVERROR(EINVAL);
+}
+
+int av_frame_copy_props(AVFrame *dst, const AVFrame *src) {
+    dst->pts = src->pts;
+    dst->key_frame = src->key_frame;
+    return 0;
+}
+
+void av_frame_free(AVFrame **frame) {
+    if (frame == nullptr || *frame == nullptr) return;
+    delete *frame;
+    *frame = nullptr;
+    fakeCodec.liveRefs--;
+}
+
+int av_samples_get_buffer_size(int *linesize, int channels, int samples, enum AVSampleFormat fmt, int) {
+    int bytes;
+    switch (fmt) {
+        case AV_SAMPLE_FMT_U8: case AV_SAMPLE_FMT_U8P: bytes = 1; break;
+        case AV_SAMPLE_FMT_S16: case AV_SAMPLE_FMT_S16P: bytes = 2; break;
+        case AV_SAMPLE_FMT_S32: case AV_SAMPLE_FMT_S32P:
+        case AV_SAMPLE_FMT_FLT: case AV_SAMPLE_FMT_FLTP: bytes = 4; break;
+        case AV_SAMPLE_FMT_DBL: case AV_SAMPLE_FMT_DBLP: bytes = 8; break;
+        default: return -1;
+    }
+    if (channels <= 0 || samples <= 0) return -1;
+    if (linesize != nullptr) *linesize = bytes * samples;
+    return bytes * samples * channels;
+}
+
+int av_image_get_buffer_size(enum AVPixelFormat fmt, int width, int height, int) {
+    if (width <= 0 || height <= 0) return -1;
+    int cw = (width + 1) / 2;
+    int ch = (height + 1) / 2;
+    switch (fmt) {
+        case AV_PIX_FMT_YUV420P: case AV_PIX_FMT_NV12: case AV_PIX_FMT_NV21:
+            return width * height + 2 * cw * ch;
+        case AV_PIX_FMT_RGBA:
+            return width * height * 4;
+        default:
+            return -1;
+    }
+}
+
+// 没有状态，所有调用共用一个占位的上下文
+static char fakeSwsContext;
+
+SwsContext *sws_getCachedContext(SwsContext *, int, int, enum AVPixelFormat, int, int, enum AVPixelFormat,
+                                 int, SwsFilter *, SwsFilter *, const double *) {
+    return reinterpret_cast<SwsContext *>(&fakeSwsContext);
+}
+
+int sws_scale(SwsContext *, const uint8_t *const[], const int[], int, int srcSliceH, uint8_t *const[],
+              const int[]) {
+    fakeCodec.scales++;
+    return srcSliceH;
+}
+
+void sws_freeContext(SwsContext *) {}
+
+}
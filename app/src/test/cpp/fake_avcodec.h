@@ -0,0 +1,35 @@
+#ifndef TINY_PLAYER_FAKE_AVCODEC_H
+#define TINY_PLAYER_FAKE_AVCODEC_H
+
+#include <atomic>
+#include <cstdint>
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+}
+
+// 替代 libavcodec 中 DecoderCache 和 Player::openDecoder() 用到的几个函数：上下文用 new / delete
+// 分配，打开、清空缓冲、关闭按设定的耗时忙等，模拟设备上的开销，同时统计调用次数。
+// LoopCache 用到的 packet、帧的引用和大小计算也在这里：克隆只复制结构体中的字段，不分配数据，
+// 大小按 YUV 4:2:0 / RGBA 和交错、平面的样本格式计算（对齐为 1 时与 libavutil 相同）。
+// GopCache 缩小帧用到的 av_frame_get_buffer 和 swscale 只记录尺寸和次数，不分配、不处理像素
+struct FakeCodecCosts {
+    int videoOpenUs = 0;            // avcodec_open2 的耗时，视频解码器要创建帧线程
+    int audioOpenUs = 0;
+    int flushUs = 0;                // avcodec_flush_buffers
+    int freeUs = 0;                 // avcodec_free_context，等待帧线程退出
+    std::atomic<int> opens{0};
+    std::atomic<int> flushes{0};
+    std::atomic<int> frees{0};
+    std::atomic<int> live{0};       // 还没有释放的上下文
+    int cloneFailAfter = -1;        // 非负时再成功克隆这么多次之后克隆失败
+    std::atomic<int> liveRefs{0};   // 还没有释放的 packet、帧
+    int allocFailAfter = -1;        // 非负时再成功分配这么多次帧缓冲之后分配失败
+    std::atomic<int> scales{0};     // sws_scale 的调用次数
+
+    void reset();
+};
+
+extern FakeCodecCosts fakeCodec;
+
+#endif //TINY_PLAYER_FAKE_AVCODEC_H
@@ -0,0 +1,80 @@
+#include <cstring>
+#include "fake_window.h"
+
+static int32_t align(int32_t x, int32_t a) {
+    return (x + a - 1) / a * a;
+}
+
+size_t fakeBufferSize(int32_t format, int32_t stride, int32_t height) {
+    if (format == FAKE_WINDOW_YV12) {
+        size_t cStride = align(stride / 2, 16);
+        return static_cast<size_t>(stride) * height + cStride * (height / 2) * 2;
+    }
+    int bpp = format == WINDOW_FORMAT_RGB_565 ? 2 : 4;
+    return static_cast<size_t>(stride) * height * bpp;
+}
+
+extern "C" {
+
+void ANativeWindow_acquire(ANativeWindow *window) {
+    window->refs++;
+}
+
+void ANativeWindow_release(ANativeWindow *window) {
+    window->refs--;
+}
+
+int32_t ANativeWindow_getWidth(ANativeWindow *window) {
+    return window->width;
+}
+
+int32_t ANativeWindow_getHeight(ANativeWindow *window) {
+    return window->height;
+}
+
+int32_t ANativeWindow_getFormat(ANativeWindow *window) {
+    return window->format;
+}
+
+int32_t ANativeWindow_setBuffersGeometry(ANativeWindow *window, int32_t width, int32_t height,
+                                         int32_t format) {
+    if (window->accepted.count(format) == 0) return -22;    // -EINVAL
+    window->width = width;
+    window->height = height;
+    window->format = format;
+    return 0;
+}
+
+int32_t ANativeWindow_setBuffersDataSpace(ANativeWindow *window, int32_t dataSpace) {
+    window->dataSpace = dataSpace;
+    window->dataSpaceCalls++;
+    return 0;
+}
+
+int32_t ANativeWindow_lock(ANativeWindow *window, ANativeWindow_Buffer *outBuffer,
+                           ARect *inOutDirtyBounds) {
+    (void) inOutDirtyBounds;
+    if (window->failLock || window->locked) return -22;
+    int32_t format = window->lockFormat != 0 ? window->lockFormat : window->format;
+    window->stride = align(window->width, window->strideAlign);
+    window->buffer.assign(fakeBufferSize(format, window->stride, window->height), FAKE_WINDOW_POISON);
+    window->lockedFormat = format;
+    window->locked = true;
+    memset(outBuffer, 0, sizeof(*outBuffer));
+    outBuffer->width = window->width;
+    outBuffer->height = window->height;
+    outBuffer->stride = window->stride;
+    outBuffer->format = format;
+    outBuffer->bits = window->buffer.data();
+    return 0;
+}
+
+int32_t ANativeWindow_unlockAndPost(ANativeWindow *window) {
+    if (!window->locked) return -22;
+    window->locked = false;
+    window->posted = window->buffer;
+    window->postCount++;
+    return 0;
+}
+
+}
@@ -0,0 +1,40 @@
+#ifndef TINY_PLAYER_FAKE_WINDOW_H
+#define TINY_PLAYER_FAKE_WINDOW_H
+
+#include <cstdint>
+#include <set>
+#include <vector>
+#include <android/native_window.h>
+
+#define FAKE_WINDOW_YV12 0x32315659     // HAL_PIXEL_FORMAT_YV12
+#define FAKE_WINDOW_POISON 0xcd         // 锁定时缓冲区的初始内容，检查哪些字节被写过
+
+// 模拟的 ANativeWindow：可以配置接受哪些格式、行距的对齐方式，以及锁定时实际给出的格式，
+// 提交时保存缓冲区内容供测试检查。按 HAL 的规定分配 YV12 缓冲区：
+// Y 平面行距为 stride，色度平面行距为 ALIGN(stride / 2, 16)，Cr 平面在前
+struct ANativeWindow {
+    std::set<int32_t> accepted{WINDOW_FORMAT_RGBA_8888, WINDOW_FORMAT_RGBX_8888, FAKE_WINDOW_YV12};
+    int32_t strideAlign = 16;       // 以像素为单位
+    int32_t lockFormat = 0;         // 非 0 时锁定总是给出这种格式的缓冲区
+    bool failLock = false;
+
+    int32_t width = 0;
+    int32_t height = 0;
+    int32_t format = WINDOW_FORMAT_RGBA_8888;
+    int32_t stride = 0;
+    int32_t dataSpace = 0;
+    int dataSpaceCalls = 0;
+    int32_t lockedFormat = 0;
+    bool locked = false;
+    std::vector<uint8_t> buffer;
+    std::vector<uint8_t> posted;    // 最近一次提交的内容
+    int postCount = 0;
+    int refs = 1;
+};
+
+/**
+ * @brief format 格式、行距为 stride 像素时一帧缓冲区的字节数
+ */
+size_t fakeBufferSize(int32_t format, int32_t stride, int32_t height);
+
+#endif //TINY_PLAYER_FAKE_WINDOW_H
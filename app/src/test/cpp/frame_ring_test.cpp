@@ -0,0 +1,121 @@
+#include <cstring>
+#include "frame_ring.h"
+#include "unit_test.h"
+
+namespace {
+
+#define FRAME_BYTES 64
+#define NO_PTS INT64_MIN
+
+// 按显示顺序写入 pts 并与上一帧相连，每帧内容填成 pts 的低字节
+void show(FrameRing &ring, int64_t prev, int64_t pts) {
+    std::shared_ptr<uint8_t> buf = ring.insert(pts);
+    ASSERT_NE(buf.get(), nullptr);
+    memset(buf.get(), static_cast<int>(pts & 0xff), FRAME_BYTES);
+    ring.link(prev, pts);
+}
+
+}
+
+// 容量按预算计算，限制在 2 ~ 32 帧；每帧字节数不变时不清空
+TEST(FrameRing, CapacityFollowsBudget) {
+    FrameRing ring(FRAME_BYTES * 5);
+    EXPECT_EQ(ring.insert(0).get(), nullptr);
+    ring.configure(FRAME_BYTES);
+    EXPECT_EQ(ring.capacity(), 5u);
+    show(ring, NO_PTS, 0);
+    ring.configure(FRAME_BYTES);
+    EXPECT_NE(ring.find(0), nullptr);
+
+    ring.configure(FRAME_BYTES * 4);
+    EXPECT_EQ(ring.capacity(), 2u);
+    EXPECT_EQ(ring.find(0), nullptr);
+    ring.configure(1);
+    EXPECT_EQ(ring.capacity(), 32u);
+}
+
+// 只有 link 过的相邻两帧才能前后查找
+TEST(FrameRing, BeforeAndAfterFollowLinks) {
+    FrameRing ring(FRAME_BYTES * 8);
+    ring.configure(FRAME_BYTES);
+    show(ring, NO_PTS, 0);
+    show(ring, 0, 40);
+    show(ring, 40, 80);
+    // 120 之前的帧没有显示过（跳过了），与 80 不相连
+    show(ring, NO_PTS, 120);
+
+    int64_t found = -1;
+    const uint8_t *p = ring.before(80, found);
+    ASSERT_NE(p, nullptr);
+    EXPECT_EQ(found, 40);
+    EXPECT_EQ(p[0], 40);
+    p = ring.after(40, found);
+    ASSERT_NE(p, nullptr);
+    EXPECT_EQ(found, 80);
+    EXPECT_EQ(p[FRAME_BYTES - 1], 80);
+    EXPECT_EQ(ring.before(0, found), nullptr);
+    EXPECT_EQ(ring.before(120, found), nullptr);
+    EXPECT_EQ(ring.after(80, found), nullptr);
+    EXPECT_EQ(ring.after(NO_PTS, found), nullptr);
+    EXPECT_EQ(ring.before(200, found), nullptr);
+
+    // 补上 80 -> 120 的相邻关系
+    ring.link(80, 120);
+    EXPECT_NE(ring.after(80, found), nullptr);
+    EXPECT_EQ(found, 120);
+}
+
+// 满了以后覆盖最早写入的一项，被覆盖的帧和指向它的相邻关系一起失效
+TEST(FrameRing, EvictsOldest) {
+    FrameRing ring(FRAME_BYTES * 3);
+    ring.configure(FRAME_BYTES);
+    show(ring, NO_PTS, 0);
+    show(ring, 0, 1);
+    show(ring, 1, 2);
+    show(ring, 2, 3);
+    EXPECT_EQ(ring.find(0), nullptr);
+    int64_t found = -1;
+    EXPECT_EQ(ring.before(1, found), nullptr);
+    EXPECT_NE(ring.before(3, found), nullptr);
+    EXPECT_EQ(found, 2);
+
+    show(ring, 3, 4);
+    show(ring, 4, 5);
+    EXPECT_EQ(ring.find(1), nullptr);
+    EXPECT_EQ(ring.find(2), nullptr);
+    ASSERT_NE(ring.find(5), nullptr);
+    EXPECT_EQ(ring.find(5)[0], 5);
+    EXPECT_NE(ring.before(5, found), nullptr);
+    EXPECT_EQ(found, 4);
+
+    ring.clear();
+    EXPECT_EQ(ring.find(5), nullptr);
+}
+
+// 相同 pts 复用原来的缓冲区；缓冲区还被显示阶段持有时改为分配新的，持有的内容不被覆盖
+TEST(FrameRing, HeldBufferIsNotOverwritten) {
+    FrameRing ring(FRAME_BYTES * 2);
+    ring.configure(FRAME_BYTES);
+    std::shared_ptr<uint8_t> first = ring.insert(10);
+    ASSERT_NE(first.get(), nullptr);
+    uint8_t *raw = first.get();
+    memset(raw, 1, FRAME_BYTES);
+    first.reset();
+    EXPECT_EQ(ring.insert(10).get(), raw);
+
+    std::shared_ptr<uint8_t> held = ring.insert(10);
+    memset(held.get(), 7, FRAME_BYTES);
+    std::shared_ptr<uint8_t> again = ring.insert(10);
+    ASSERT_NE(again.get(), nullptr);
+    EXPECT_NE(again.get(), held.get());
+    memset(again.get(), 9, FRAME_BYTES);
+    EXPECT_EQ(held.get()[0], 7);
+
+    // 覆盖最早一项时也一样，clear() 之后持有的缓冲区仍然有效
+    show(ring, 10, 20);
+    std::shared_ptr<uint8_t> evicted = ring.insert(30);
+    ASSERT_NE(evicted.get(), nullptr);
+    EXPECT_NE(evicted.get(), again.get());
+    ring.clear();
+    EXPECT_EQ(held.get()[0], 7);
+}
@@ -0,0 +1,129 @@
+#include "fake_avcodec.h"
+#include "gop_cache.h"
+#include "unit_test.h"
+
+namespace {
+
+#define VIDEO_W 64
+#define VIDEO_H 32
+#define FULL_BYTES (VIDEO_W * VIDEO_H * 3 / 2)
+#define HALF_BYTES (FULL_BYTES / 4)
+#define QUARTER_BYTES (FULL_BYTES / 16)
+
+// 解码输出的一帧，由 GopCache 接管
+AVFrame *decoded(int64_t pts, int width = VIDEO_W, int height = VIDEO_H) {
+    AVFrame *frame = av_frame_alloc();
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = width;
+    frame->height = height;
+    frame->pts = pts;
+    return frame;
+}
+
+}
+
+// 预算内保存原尺寸，从末尾逐帧取出
+TEST(GopCache, PopsInReverseOrder) {
+    fakeCodec.reset();
+    {
+        GopCache cache(FULL_BYTES * 4);
+        for (int i = 0; i < 4; ++i) ASSERT_TRUE(cache.add(decoded(i)));
+        EXPECT_EQ(cache.bytes(), static_cast<size_t>(FULL_BYTES * 4));
+        EXPECT_EQ(cache.downscaledFrames, 0u);
+        EXPECT_EQ(fakeCodec.scales.load(), 0);
+        for (int i = 3; i >= 0; --i) {
+            AVFrame *frame = cache.popLast();
+            ASSERT_NE(frame, nullptr);
+            EXPECT_EQ(frame->pts, i);
+            EXPECT_EQ(frame->width, VIDEO_W);
+            EXPECT_EQ(cache.bytes(), static_cast<size_t>(FULL_BYTES * i));
+            av_frame_free(&frame);
+        }
+        EXPECT_TRUE(cache.empty());
+        EXPECT_EQ(cache.popLast(), nullptr);
+    }
+    EXPECT_EQ(fakeCodec.liveRefs.load(), 0);
+}
+
+// 超出预算时先缩小到 1/2，再到 1/4，仍然放不下的帧被丢弃并释放
+TEST(GopCache, DownscalesThenDrops) {
+    fakeCodec.reset();
+    {
+        GopCache cache(FULL_BYTES * 4 + HALF_BYTES + QUARTER_BYTES);
+        for (int i = 0; i < 4; ++i) ASSERT_TRUE(cache.add(decoded(i)));
+        ASSERT_TRUE(cache.add(decoded(4)));
+        ASSERT_TRUE(cache.add(decoded(5)));
+        EXPECT_FALSE(cache.add(decoded(6)));
+        EXPECT_EQ(cache.downscaledFrames, 2u);
+        EXPECT_EQ(cache.droppedFrames, 1u);
+        EXPECT_EQ(fakeCodec.scales.load(), 2);
+        EXPECT_EQ(cache.bytes(), static_cast<size_t>(FULL_BYTES * 4 + HALF_BYTES + QUARTER_BYTES));
+
+        AVFrame *frame = cache.popLast();
+        EXPECT_EQ(frame->pts, 5);
+        EXPECT_EQ(frame->width, VIDEO_W / 4);
+        EXPECT_EQ(frame->height, VIDEO_H / 4);
+        av_frame_free(&frame);
+        frame = cache.popLast();
+        EXPECT_EQ(frame->pts, 4);
+        EXPECT_EQ(frame->width, VIDEO_W / 2);
+        EXPECT_EQ(frame->height, VIDEO_H / 2);
+        av_frame_free(&frame);
+        EXPECT_EQ(cache.bytes(), static_cast<size_t>(FULL_BYTES * 4));
+    }
+    EXPECT_EQ(fakeCodec.liveRefs.load(), 0);
+}
+
+// 缩小之后即使取出帧腾出空间，同一个 GOP 内之后的帧仍然沿用缩小后的尺寸；clear() 之后恢复原尺寸
+TEST(GopCache, ScaleIsStickyUntilClear) {
+    fakeCodec.reset();
+    GopCache cache(FULL_BYTES * 2 + HALF_BYTES);
+    ASSERT_TRUE(cache.add(decoded(0)));
+    ASSERT_TRUE(cache.add(decoded(1)));
+    ASSERT_TRUE(cache.add(decoded(2)));
+    EXPECT_EQ(cache.downscaledFrames, 1u);
+    for (int i = 0; i < 3; ++i) {
+        AVFrame *frame = cache.popLast();
+        av_frame_free(&frame);
+    }
+    EXPECT_EQ(cache.bytes(), 0u);
+    ASSERT_TRUE(cache.add(decoded(3)));
+    AVFrame *frame = cache.popLast();
+    EXPECT_EQ(frame->width, VIDEO_W / 2);
+    av_frame_free(&frame);
+
+    cache.startPts = 100;
+    cache.clear();
+    EXPECT_EQ(cache.startPts, AV_NOPTS_VALUE);
+    EXPECT_EQ(cache.downscaledFrames, 0u);
+    EXPECT_EQ(cache.droppedFrames, 0u);
+    ASSERT_TRUE(cache.add(decoded(4)));
+    frame = cache.popLast();
+    EXPECT_EQ(frame->width, VIDEO_W);
+    av_frame_free(&frame);
+    EXPECT_EQ(fakeCodec.liveRefs.load(), 0);
+}
+
+// 缩小后尺寸为 0 或分配缩小帧失败时丢弃，不泄漏帧
+TEST(GopCache, DropsWhenDownscaleImpossible) {
+    fakeCodec.reset();
+    {
+        GopCache cache(FULL_BYTES);
+        ASSERT_TRUE(cache.add(decoded(0)));
+        EXPECT_FALSE(cache.add(decoded(1, 2, 2)));
+        EXPECT_EQ(cache.droppedFrames, 1u);
+
+        fakeCodec.allocFailAfter = 0;
+        EXPECT_FALSE(cache.add(decoded(2, 4, 4)));
+        EXPECT_EQ(cache.droppedFrames, 2u);
+        EXPECT_EQ(cache.downscaledFrames, 0u);
+        EXPECT_EQ(cache.bytes(), static_cast<size_t>(FULL_BYTES));
+
+        // 缩小后放得下的帧照常保存
+        fakeCodec.allocFailAfter = -1;
+        cache.setBudget(FULL_BYTES + HALF_BYTES);
+        EXPECT_TRUE(cache.add(decoded(3)));
+        EXPECT_EQ(cache.downscaledFrames, 1u);
+    }
+    EXPECT_EQ(fakeCodec.liveRefs.load(), 0);
+}
@@ -0,0 +1,170 @@
+#include "fake_avcodec.h"
+#include "loop_cache.h"
+#include "unit_test.h"
+
+extern "C" {
+#include "libavutil/frame.h"
+}
+
+namespace {
+
+#define VIDEO_W 64
+#define VIDEO_H 32
+#define VIDEO_FRAME_BYTES (VIDEO_W * VIDEO_H * 3 / 2)
+#define AUDIO_SAMPLES 1024
+#define AUDIO_FRAME_BYTES (AUDIO_SAMPLES * 2 * 4)     // 双声道 float
+
+AVPacket packetOf(int size, int64_t pts) {
+    AVPacket pkt{};
+    pkt.size = size;
+    pkt.pts = pkt.dts = pts;
+    return pkt;
+}
+
+AVFrame videoFrame(int64_t pts) {
+    AVFrame frame{};
+    frame.format = AV_PIX_FMT_YUV420P;
+    frame.width = VIDEO_W;
+    frame.height = VIDEO_H;
+    frame.pts = pts;
+    return frame;
+}
+
+AVFrame audioFrame(int64_t pts) {
+    AVFrame frame{};
+    frame.format = AV_SAMPLE_FMT_FLTP;
+    frame.nb_samples = AUDIO_SAMPLES;
+    frame.channels = 2;
+    frame.sample_rate = 48000;
+    frame.pts = pts;
+    return frame;
+}
+
+}  // namespace
+
+TEST(LoopCache, ReplaysPacketsWithinBudget) {
+    fakeCodec.reset();
+    {
+        LoopCache cache(10000);
+        for (int i = 0; i < 5; ++i) {
+            AVPacket pkt = packetOf(1000, i);
+            EXPECT_TRUE(cache.addPacket(&pkt));
+        }
+        EXPECT_FALSE(cache.packetsReady());
+        cache.finishPackets();
+        EXPECT_TRUE(cache.packetsReady());
+        EXPECT_EQ(cache.packetCount(), 5u);
+        EXPECT_EQ(cache.packetBytes(), 5000u);
+        EXPECT_EQ(cache.bytes(), 5000u);
+        EXPECT_EQ(cache.packet(3)->pts, 3);
+        // 完成之后不再加入
+        AVPacket pkt = packetOf(1000, 5);
+        EXPECT_FALSE(cache.addPacket(&pkt));
+    }
+    EXPECT_EQ(fakeCodec.liveRefs.load(), 0);
+}
+
+// 超出预算时整类丢弃，占用退回，之后这一类不再保存，直到 clear
+TEST(LoopCache, DropsPacketsOverBudget) {
+    fakeCodec.reset();
+    LoopCache cache(2500);
+    AVPacket pkt = packetOf(1000, 0);
+    EXPECT_TRUE(cache.addPacket(&pkt));
+    EXPECT_TRUE(cache.addPacket(&pkt));
+    EXPECT_FALSE(cache.addPacket(&pkt));
+    EXPECT_TRUE(cache.packetsFailed());
+    EXPECT_EQ(cache.packetCount(), 0u);
+    EXPECT_EQ(cache.bytes(), 0u);
+    EXPECT_EQ(fakeCodec.liveRefs.load(), 0);
+    cache.finishPackets();
+    EXPECT_FALSE(cache.packetsReady());
+    pkt.size = 10;
+    EXPECT_FALSE(cache.addPacket(&pkt));
+
+    cache.clear();
+    EXPECT_FALSE(cache.packetsFailed());
+    EXPECT_TRUE(cache.addPacket(&pkt));
+    cache.clear();
+    EXPECT_EQ(fakeCodec.liveRefs.load(), 0);
+}
+
+// packet 和两路帧共用预算：视频帧放不下时只丢视频帧，已经保存的 packet 和音频帧不受影响
+TEST(LoopCache, SharesBudgetBetweenPacketsAndFrames) {
+    fakeCodec.reset();
+    size_t budget = 4000 + 3 * AUDIO_FRAME_BYTES + 2 * VIDEO_FRAME_BYTES + VIDEO_FRAME_BYTES / 2;
+    LoopCache cache(budget);
+    AVPacket pkt = packetOf(1000, 0);
+    for (int i = 0; i < 4; ++i) EXPECT_TRUE(cache.addPacket(&pkt));
+    cache.finishPackets();
+    for (int i = 0; i < 3; ++i) {
+        AVFrame frame = audioFrame(i * AUDIO_SAMPLES);
+        EXPECT_TRUE(cache.addFrame(LoopStream::Audio, &frame));
+    }
+    cache.finishFrames(LoopStream::Audio);
+    EXPECT_TRUE(cache.framesReady(LoopStream::Audio));
+
+    AVFrame frame = videoFrame(0);
+    EXPECT_TRUE(cache.addFrame(LoopStream::Video, &frame));
+    EXPECT_TRUE(cache.addFrame(LoopStream::Video, &frame));
+    EXPECT_EQ(cache.bytes(), 4000u + 3 * AUDIO_FRAME_BYTES + 2 * VIDEO_FRAME_BYTES);
+    EXPECT_FALSE(cache.addFrame(LoopStream::Video, &frame));
+    EXPECT_TRUE(cache.framesFailed(LoopStream::Video));
+    EXPECT_EQ(cache.frameCount(LoopStream::Video), 0u);
+    cache.finishFrames(LoopStream::Video);
+    EXPECT_FALSE(cache.framesReady(LoopStream::Video));
+
+    EXPECT_TRUE(cache.packetsReady());
+    EXPECT_EQ(cache.frameCount(LoopStream::Audio), 3u);
+    EXPECT_EQ(cache.bytes(), 4000u + 3 * AUDIO_FRAME_BYTES);
+    cache.clear();
+    EXPECT_EQ(cache.bytes(), 0u);
+    EXPECT_EQ(fakeCodec.liveRefs.load(), 0);
+}
+
+// 被打断的一遍保存到一半的数据丢掉，已经完成的保留
+TEST(LoopCache, DiscardPartialKeepsFinishedData) {
+    fakeCodec.reset();
+    LoopCache cache(1 << 20);
+    AVPacket pkt = packetOf(500, 0);
+    cache.addPacket(&pkt);
+    cache.finishPackets();
+    AVFrame video = videoFrame(0);
+    cache.addFrame(LoopStream::Video, &video);
+    AVFrame audio = audioFrame(0);
+    cache.addFrame(LoopStream::Audio, &audio);
+    cache.finishFrames(LoopStream::Audio);
+
+    cache.discardPartial();
+    EXPECT_TRUE(cache.packetsReady());
+    EXPECT_EQ(cache.packetCount(), 1u);
+    EXPECT_EQ(cache.frameCount(LoopStream::Video), 0u);
+    EXPECT_FALSE(cache.framesFailed(LoopStream::Video));
+    EXPECT_TRUE(cache.framesReady(LoopStream::Audio));
+    EXPECT_EQ(cache.bytes(), 500u + AUDIO_FRAME_BYTES);
+    // 重新保存视频帧
+    EXPECT_TRUE(cache.addFrame(LoopStream::Video, &video));
+    cache.finishFrames(LoopStream::Video);
+    EXPECT_TRUE(cache.framesReady(LoopStream::Video));
+    cache.clear();
+    EXPECT_EQ(fakeCodec.liveRefs.load(), 0);
+}
+
+// 克隆失败与超出预算一样处理，占用不会泄漏
+TEST(LoopCache, CloneFailureReleasesReservation) {
+    fakeCodec.reset();
+    LoopCache cache(1 << 20);
+    AVPacket pkt = packetOf(100, 0);
+    fakeCodec.cloneFailAfter = 2;
+    EXPECT_TRUE(cache.addPacket(&pkt));
+    EXPECT_TRUE(cache.addPacket(&pkt));
+    EXPECT_FALSE(cache.addPacket(&pkt));
+    EXPECT_TRUE(cache.packetsFailed());
+    EXPECT_EQ(cache.bytes(), 0u);
+    fakeCodec.cloneFailAfter = 0;
+    AVFrame frame = videoFrame(0);
+    EXPECT_FALSE(cache.addFrame(LoopStream::Video, &frame));
+    EXPECT_TRUE(cache.framesFailed(LoopStream::Video));
+    EXPECT_EQ(cache.bytes(), 0u);
+    EXPECT_EQ(fakeCodec.liveRefs.load(), 0);
+    fakeCodec.reset();
+}
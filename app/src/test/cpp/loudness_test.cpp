@@ -0,0 +1,62 @@
+#include <cmath>
+#include <vector>
+#include "loudness.h"
+#include "unit_test.h"
+
+namespace {
+
+#define TEST_RATE 48000
+#define TEST_BLOCK 480      // 10ms
+
+// 常数输入经过归一化器，返回输出相邻样本之间的最大变化
+float process(LoudnessNormalizer &loudness, float value, size_t blocks, float &last) {
+    std::vector<float> buf(TEST_BLOCK * 2);
+    float maxStep = 0.0f;
+    for (size_t b = 0; b < blocks; ++b) {
+        std::fill(buf.begin(), buf.end(), value);
+        loudness.process(buf.data(), TEST_BLOCK);
+        for (float s : buf) {
+            maxStep = std::max(maxStep, std::fabs(s - last));
+            last = s;
+        }
+    }
+    return maxStep;
+}
+
+}  // namespace
+
+// 元数据增益与估计的增益一样平滑过渡，不在设置的位置突变
+TEST(Loudness, TrackGainRampsFromCurrentGain) {
+    LoudnessNormalizer loudness;
+    loudness.configure(TEST_RATE, 2);
+    float last = 0.0f;
+    // 先填满前视延迟线，输出稳定在输入值
+    process(loudness, 0.1f, 10, last);
+    EXPECT_NEAR(last, 0.1f, 1e-6);
+
+    loudness.setTrackGain(-12.0f);
+    EXPECT_TRUE(loudness.usingMetadata());
+    EXPECT_NEAR(loudness.gainDb(), 0.0f, 1e-6);
+    float step = process(loudness, 0.1f, 1, last);
+    float perBlock = LOUDNESS_TRACK_GAIN_SLEW_DB * TEST_BLOCK / TEST_RATE;
+    EXPECT_NEAR(loudness.gainDb(), -perBlock, 1e-4);
+    // 直接跳到 -12dB 时一个样本就变化 0.075
+    EXPECT_LT(step, 0.001f);
+
+    step = process(loudness, 0.1f, 10, last);
+    EXPECT_LT(step, 0.001f);
+    EXPECT_NEAR(loudness.gainDb(), -12.0f, 1e-4);
+    EXPECT_NEAR(last, 0.1f * std::pow(10.0f, -12.0f / 20.0f), 1e-4);
+}
+
+// 超出范围的元数据增益被限制，过渡的速度不变
+TEST(Loudness, TrackGainIsClamped) {
+    LoudnessNormalizer loudness;
+    loudness.configure(TEST_RATE, 2);
+    float last = 0.0f;
+    loudness.setTrackGain(30.0f);
+    process(loudness, 0.001f, 1, last);
+    EXPECT_NEAR(loudness.gainDb(), LOUDNESS_TRACK_GAIN_SLEW_DB * TEST_BLOCK / TEST_RATE, 1e-4);
+    process(loudness, 0.001f, 20, last);
+    EXPECT_NEAR(loudness.gainDb(), LOUDNESS_MAX_BOOST_DB, 1e-4);
+}
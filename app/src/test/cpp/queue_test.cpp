@@ -0,0 +1,22 @@
+#include "unit_test.h"
+#include "queue.hpp"
+
+// 跳转时队列处于暂停状态，drain 仍然要取出全部元素交给调用者释放
+TEST(Queue, DrainIgnoresPause) {
+    Queue<int *> q(8);
+    for (int i = 0; i < 5; ++i) ASSERT_TRUE(q.tryPush(new int(i)));
+    q.pause();
+    int *p = nullptr;
+    EXPECT_FALSE(q.tryPop(p));
+    int freed = 0;
+    q.drain([&freed](int *&ele) {
+        delete ele;
+        ele = nullptr;
+        freed++;
+    });
+    EXPECT_EQ(freed, 5);
+    EXPECT_TRUE(q.empty());
+    q.resume();
+    EXPECT_TRUE(q.tryPush(new int(5)));
+    q.drain([](int *&ele) { delete ele; });
+}
@@ -0,0 +1,111 @@
+#include <thread>
+#include <vector>
+#include "unit_test.h"
+#include "ring_buffer.hpp"
+
+namespace {
+
+std::vector<uint8_t> sequence(uint8_t first, size_t len) {
+    std::vector<uint8_t> v(len);
+    for (size_t i = 0; i < len; ++i) v[i] = static_cast<uint8_t>(first + i);
+    return v;
+}
+
+}
+
+TEST(RingBuffer, RoundsCapacityUpToPowerOfTwo) {
+    RingBuffer ring(100);
+    EXPECT_EQ(ring.capacity(), 128u);
+    EXPECT_EQ(ring.readable(), 0u);
+    EXPECT_EQ(ring.writable(), 128u);
+}
+
+// 写满之后拒绝写入；读写位置跨过缓冲区末尾时数据保持顺序
+TEST(RingBuffer, WrapsAround) {
+    RingBuffer ring(16);
+    auto a = sequence(0, 12);
+    ASSERT_TRUE(ring.write(a.data(), a.size()));
+    EXPECT_FALSE(ring.write(a.data(), 5));
+    uint8_t out[16];
+    ASSERT_EQ(ring.read(out, 10), 10u);
+    for (int i = 0; i < 10; ++i) EXPECT_EQ(out[i], i);
+
+    auto b = sequence(100, 14);
+    EXPECT_EQ(ring.writable(), 14u);
+    ASSERT_TRUE(ring.write(b.data(), b.size()));
+    EXPECT_EQ(ring.readable(), 16u);
+    EXPECT_EQ(ring.writable(), 0u);
+    ASSERT_EQ(ring.read(out, sizeof(out)), 16u);
+    EXPECT_EQ(out[0], 10);
+    EXPECT_EQ(out[1], 11);
+    for (int i = 0; i < 14; ++i) EXPECT_EQ(out[2 + i], 100 + i) << "byte " << i;
+    EXPECT_EQ(ring.read(out, sizeof(out)), 0u);
+}
+
+// clear() 之后 readable()/writable() 立即不再计算丢弃的数据，之后的 read() 只返回新写入的数据
+TEST(RingBuffer, ClearDiscardsWrittenData) {
+    RingBuffer ring(16);
+    auto a = sequence(0, 13);
+    ASSERT_TRUE(ring.write(a.data(), a.size()));
+    uint8_t out[16];
+    ASSERT_EQ(ring.read(out, 3), 3u);
+    ring.clear();
+    EXPECT_EQ(ring.readable(), 0u);
+    EXPECT_EQ(ring.writable(), 16u);
+
+    // 新数据覆盖丢弃的位置并跨过末尾
+    auto b = sequence(50, 16);
+    ASSERT_TRUE(ring.write(b.data(), b.size()));
+    EXPECT_EQ(ring.readable(), 16u);
+    ASSERT_EQ(ring.read(out, sizeof(out)), 16u);
+    for (int i = 0; i < 16; ++i) EXPECT_EQ(out[i], 50 + i) << "byte " << i;
+    EXPECT_EQ(ring.readable(), 0u);
+}
+
+// 没有数据时 clear() 什么也不丢；连续 clear() 以最后一次为准
+TEST(RingBuffer, ClearTwice) {
+    RingBuffer ring(8);
+    ring.clear();
+    auto a = sequence(0, 4);
+    ASSERT_TRUE(ring.write(a.data(), a.size()));
+    ring.clear();
+    auto b = sequence(20, 2);
+    ASSERT_TRUE(ring.write(b.data(), b.size()));
+    ring.clear();
+    auto c = sequence(40, 3);
+    ASSERT_TRUE(ring.write(c.data(), c.size()));
+    EXPECT_EQ(ring.readable(), 3u);
+    EXPECT_EQ(ring.writable(), 5u);
+    uint8_t out[8];
+    ASSERT_EQ(ring.read(out, sizeof(out)), 3u);
+    for (int i = 0; i < 3; ++i) EXPECT_EQ(out[i], 40 + i);
+}
+
+// 生产者边写边 clear()，消费者读到的每一块都是完整的：块内字节相同，不会混进被覆盖的数据
+TEST(RingBuffer, ConcurrentClearNeverTearsBlocks) {
+    RingBuffer ring(64);
+    const int blocks = 20000;
+    const size_t blockBytes = 8;
+    std::atomic<bool> done{false};
+    int torn = 0;
+    std::thread consumer([&] {
+        uint8_t out[blockBytes];
+        while (!done || ring.readable() > 0) {
+            if (ring.read(out, blockBytes) != blockBytes) continue;
+            for (size_t i = 1; i < blockBytes; ++i) {
+                if (out[i] != out[0]) {
+                    torn++;
+                    break;
+                }
+            }
+        }
+    });
+    for (int i = 0; i < blocks; ++i) {
+        std::vector<uint8_t> block(blockBytes, static_cast<uint8_t>(i));
+        while (!ring.write(block.data(), block.size())) std::this_thread::yield();
+        if (i % 7 == 0) ring.clear();
+    }
+    done = true;
+    consumer.join();
+    EXPECT_EQ(torn, 0);
+}
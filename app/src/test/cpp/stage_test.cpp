@@ -0,0 +1,69 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "unit_test.h"
+#include "stage.h"
+
+using namespace std::chrono;
+
+// stop() 返回时单步函数已经结束，之后不会再被调用
+TEST(Stage, StopWaitsForRunningStep) {
+    WorkerPool pool(2);
+    std::atomic<bool> inStep{false};
+    std::atomic<int> calls{0};
+    auto stage = Stage::create(&pool, [&] {
+        inStep = true;
+        std::this_thread::sleep_for(milliseconds(20));
+        calls++;
+        inStep = false;
+        return Stage::kProgress;
+    });
+    stage->start();
+    while (!inStep) std::this_thread::yield();
+    stage->stop();
+    EXPECT_FALSE(inStep.load());
+    int after = calls.load();
+    std::this_thread::sleep_for(milliseconds(50));
+    EXPECT_EQ(calls.load(), after);
+}
+
+// stop() 之前投递的延时任务在重新 start() 之后不能提前执行单步
+TEST(Stage, StaleDelayedRunDoesNotClaimNewSchedule) {
+    WorkerPool pool(2);
+    std::atomic<int> calls{0};
+    std::atomic<int64_t> delayUs{50000};
+    auto stage = Stage::create(&pool, [&] {
+        calls++;
+        return delayUs.load();
+    });
+    // 第一轮执行后投递一个 50ms 后的延时任务
+    stage->start();
+    while (calls.load() == 0) std::this_thread::yield();
+    stage->stop();
+    // 重新启动，这一轮之后改成 500ms 的延时
+    delayUs = 500000;
+    stage->start();
+    while (calls.load() == 1) std::this_thread::yield();
+    // 旧的 50ms 任务到期时不能抢走新的 500ms 调度
+    std::this_thread::sleep_for(milliseconds(150));
+    EXPECT_EQ(calls.load(), 2);
+    stage->stop();
+}
+
+// 空闲的阶段在 wake() 后再执行，stop() 对空闲和已停止的阶段立即返回
+TEST(Stage, WakeAndStopWhenIdle) {
+    WorkerPool pool(1);
+    std::atomic<int> calls{0};
+    auto stage = Stage::create(&pool, [&] {
+        calls++;
+        return Stage::kIdle;
+    });
+    stage->start();
+    while (calls.load() < 1) std::this_thread::yield();
+    stage->wake();
+    while (calls.load() < 2) std::this_thread::yield();
+    auto begin = steady_clock::now();
+    stage->stop();
+    stage->stop();
+    EXPECT_LT(steady_clock::now() - begin, milliseconds(100));
+}
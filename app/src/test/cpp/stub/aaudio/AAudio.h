@@ -0,0 +1,117 @@
+#ifndef TINY_PLAYER_STUB_AAUDIO_H
+#define TINY_PLAYER_STUB_AAUDIO_H
+
+#include <cstdint>
+
+// 代替 NDK 的 <aaudio/AAudio.h>，只声明播放器用到的部分，常量与 NDK 一致。
+// AAudioStreamStruct 的定义和这些函数由测试中的 fake_aaudio.cpp 实现
+
+typedef int32_t aaudio_result_t;
+typedef int32_t aaudio_format_t;
+typedef int32_t aaudio_stream_state_t;
+typedef int32_t aaudio_sharing_mode_t;
+typedef int32_t aaudio_performance_mode_t;
+typedef int32_t aaudio_data_callback_result_t;
+
+typedef struct AAudioStreamStruct AAudioStream;
+typedef struct AAudioStreamBuilderStruct AAudioStreamBuilder;
+
+enum {
+    AAUDIO_OK = 0,
+    AAUDIO_ERROR_DISCONNECTED = -899,
+    AAUDIO_ERROR_ILLEGAL_ARGUMENT = -898,
+    AAUDIO_ERROR_INTERNAL = -896,
+    AAUDIO_ERROR_INVALID_STATE = -895,
+    AAUDIO_ERROR_TIMEOUT = -885,
+    AAUDIO_ERROR_UNAVAILABLE = -889,
+};
+
+enum {
+    AAUDIO_UNSPECIFIED = 0,
+};
+
+enum {
+    AAUDIO_FORMAT_INVALID = -1,
+    AAUDIO_FORMAT_UNSPECIFIED = 0,
+    AAUDIO_FORMAT_PCM_I16 = 1,
+    AAUDIO_FORMAT_PCM_FLOAT = 2,
+};
+
+enum {
+    AAUDIO_STREAM_STATE_UNINITIALIZED = 0,
+    AAUDIO_STREAM_STATE_UNKNOWN,
+    AAUDIO_STREAM_STATE_OPEN,
+    AAUDIO_STREAM_STATE_STARTING,
+    AAUDIO_STREAM_STATE_STARTED,
+    AAUDIO_STREAM_STATE_PAUSING,
+    AAUDIO_STREAM_STATE_PAUSED,
+    AAUDIO_STREAM_STATE_FLUSHING,
+    AAUDIO_STREAM_STATE_FLUSHED,
+    AAUDIO_STREAM_STATE_STOPPING,
+    AAUDIO_STREAM_STATE_STOPPED,
+    AAUDIO_STREAM_STATE_CLOSING,
+    AAUDIO_STREAM_STATE_CLOSED,
+    AAUDIO_STREAM_STATE_DISCONNECTED,
+};
+
+enum {
+    AAUDIO_SHARING_MODE_EXCLUSIVE = 0,
+    AAUDIO_SHARING_MODE_SHARED = 1,
+};
+
+enum {
+    AAUDIO_PERFORMANCE_MODE_NONE = 10,
+    AAUDIO_PERFORMANCE_MODE_POWER_SAVING = 11,
+    AAUDIO_PERFORMANCE_MODE_LOW_LATENCY = 12,
+};
+
+enum {
+    AAUDIO_CALLBACK_RESULT_CONTINUE = 0,
+    AAUDIO_CALLBACK_RESULT_STOP = 1,
+};
+
+typedef aaudio_data_callback_result_t (*AAudioStream_dataCallback)(AAudioStream *stream, void *userData,
+                                                                   void *audioData, int32_t numFrames);
+typedef void (*AAudioStream_errorCallback)(AAudioStream *stream, void *userData, aaudio_result_t error);
+
+extern "C" {
+
+const char *AAudio_convertResultToText(aaudio_result_t returnCode);
+aaudio_result_t AAudio_createStreamBuilder(AAudioStreamBuilder **builder);
+
+void AAudioStreamBuilder_setSampleRate(AAudioStreamBuilder *builder, int32_t sampleRate);
+void AAudioStreamBuilder_setChannelCount(AAudioStreamBuilder *builder, int32_t channelCount);
+void AAudioStreamBuilder_setFormat(AAudioStreamBuilder *builder, aaudio_format_t format);
+void AAudioStreamBuilder_setPerformanceMode(AAudioStreamBuilder *builder, aaudio_performance_mode_t mode);
+void AAudioStreamBuilder_setSharingMode(AAudioStreamBuilder *builder, aaudio_sharing_mode_t sharingMode);
+void AAudioStreamBuilder_setDataCallback(AAudioStreamBuilder *builder, AAudioStream_dataCallback callback,
+                                         void *userData);
+void AAudioStreamBuilder_setErrorCallback(AAudioStreamBuilder *builder, AAudioStream_errorCallback callback,
+                                          void *userData);
+aaudio_result_t AAudioStreamBuilder_openStream(AAudioStreamBuilder *builder, AAudioStream **stream);
+aaudio_result_t AAudioStreamBuilder_delete(AAudioStreamBuilder *builder);
+
+aaudio_result_t AAudioStream_close(AAudioStream *stream);
+aaudio_result_t AAudioStream_requestStart(AAudioStream *stream);
+aaudio_result_t AAudioStream_requestPause(AAudioStream *stream);
+aaudio_result_t AAudioStream_requestFlush(AAudioStream *stream);
+aaudio_result_t AAudioStream_requestStop(AAudioStream *stream);
+aaudio_stream_state_t AAudioStream_getState(AAudioStream *stream);
+aaudio_format_t AAudioStream_getFormat(AAudioStream *stream);
+int32_t AAudioStream_getChannelCount(AAudioStream *stream);
+int32_t AAudioStream_getSampleRate(AAudioStream *stream);
+aaudio_sharing_mode_t AAudioStream_getSharingMode(AAudioStream *stream);
+aaudio_performance_mode_t AAudioStream_getPerformanceMode(AAudioStream *stream);
+int32_t AAudioStream_getFramesPerBurst(AAudioStream *stream);
+int32_t AAudioStream_getBufferSizeInFrames(AAudioStream *stream);
+int32_t AAudioStream_getBufferCapacityInFrames(AAudioStream *stream);
+aaudio_result_t AAudioStream_setBufferSizeInFrames(AAudioStream *stream, int32_t numFrames);
+int32_t AAudioStream_getXRunCount(AAudioStream *stream);
+int64_t AAudioStream_getFramesWritten(AAudioStream *stream);
+int64_t AAudioStream_getFramesRead(AAudioStream *stream);
+aaudio_result_t AAudioStream_getTimestamp(AAudioStream *stream, int32_t clockid, int64_t *framePosition,
+                                          int64_t *timeNanoseconds);
+
+}
+
+#endif //TINY_PLAYER_STUB_AAUDIO_H
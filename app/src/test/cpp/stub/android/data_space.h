@@ -0,0 +1,16 @@
+#ifndef TINY_PLAYER_STUB_ANDROID_DATA_SPACE_H
+#define TINY_PLAYER_STUB_ANDROID_DATA_SPACE_H
+
+// 代替 NDK 的 <android/data_space.h>，只定义播放器用到的值，与 NDK 相同
+
+enum ADataSpace {
+    ADATASPACE_UNKNOWN = 0,
+    ADATASPACE_STANDARD_BT709 = 1 << 16,
+    ADATASPACE_STANDARD_BT2020 = 6 << 16,
+    ADATASPACE_TRANSFER_SMPTE_170M = 3 << 22,
+    ADATASPACE_TRANSFER_SRGB = 2 << 22,
+    ADATASPACE_RANGE_FULL = 1 << 27,
+    ADATASPACE_RANGE_LIMITED = 2 << 27,
+};
+
+#endif //TINY_PLAYER_STUB_ANDROID_DATA_SPACE_H
@@ -0,0 +1,21 @@
+#ifndef TINY_PLAYER_STUB_ANDROID_LOG_H
+#define TINY_PLAYER_STUB_ANDROID_LOG_H
+
+// 代替 NDK 的 <android/log.h>，实现见 android_log.cpp
+
+enum {
+    ANDROID_LOG_UNKNOWN = 0,
+    ANDROID_LOG_DEFAULT,
+    ANDROID_LOG_VERBOSE,
+    ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO,
+    ANDROID_LOG_WARN,
+    ANDROID_LOG_ERROR,
+    ANDROID_LOG_FATAL,
+    ANDROID_LOG_SILENT,
+};
+
+extern "C" int __android_log_print(int prio, const char *tag, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#endif //TINY_PLAYER_STUB_ANDROID_LOG_H
@@ -0,0 +1,47 @@
+#ifndef TINY_PLAYER_STUB_ANDROID_NATIVE_WINDOW_H
+#define TINY_PLAYER_STUB_ANDROID_NATIVE_WINDOW_H
+
+#include <cstdint>
+
+// 代替 NDK 的 <android/native_window.h>，只声明播放器用到的部分。
+// ANativeWindow 的定义和这些函数由测试中的 fake_window.cpp 实现
+
+struct ANativeWindow;
+
+struct ARect {
+    int32_t left;
+    int32_t top;
+    int32_t right;
+    int32_t bottom;
+};
+
+typedef struct ANativeWindow_Buffer {
+    int32_t width;
+    int32_t height;
+    int32_t stride;     // 以像素为单位
+    int32_t format;
+    void *bits;
+    uint32_t reserved[6];
+} ANativeWindow_Buffer;
+
+enum {
+    WINDOW_FORMAT_RGBA_8888 = 1,
+    WINDOW_FORMAT_RGBX_8888 = 2,
+    WINDOW_FORMAT_RGB_565 = 4,
+};
+
+extern "C" {
+void ANativeWindow_acquire(ANativeWindow *window);
+void ANativeWindow_release(ANativeWindow *window);
+int32_t ANativeWindow_getWidth(ANativeWindow *window);
+int32_t ANativeWindow_getHeight(ANativeWindow *window);
+int32_t ANativeWindow_getFormat(ANativeWindow *window);
+int32_t ANativeWindow_setBuffersGeometry(ANativeWindow *window, int32_t width, int32_t height,
+                                         int32_t format);
+int32_t ANativeWindow_setBuffersDataSpace(ANativeWindow *window, int32_t dataSpace);
+int32_t ANativeWindow_lock(ANativeWindow *window, ANativeWindow_Buffer *outBuffer,
+                           ARect *inOutDirtyBounds);
+int32_t ANativeWindow_unlockAndPost(ANativeWindow *window);
+}
+
+#endif //TINY_PLAYER_STUB_ANDROID_NATIVE_WINDOW_H
@@ -0,0 +1,7 @@
+#ifndef TINY_PLAYER_STUB_ANDROID_NATIVE_WINDOW_JNI_H
+#define TINY_PLAYER_STUB_ANDROID_NATIVE_WINDOW_JNI_H
+
+// 主机测试不经过 JNI，ANativeWindow_fromSurface 不需要声明
+#include <android/native_window.h>
+
+#endif //TINY_PLAYER_STUB_ANDROID_NATIVE_WINDOW_JNI_H
@@ -0,0 +1,18 @@
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <android/log.h>
+
+// 默认只输出警告和错误，设置环境变量 TINYPLAYER_LOG=verbose 时输出全部日志
+extern "C" int __android_log_print(int prio, const char *tag, const char *fmt, ...) {
+    static const bool verbose = getenv("TINYPLAYER_LOG") != nullptr;
+    if (prio < ANDROID_LOG_WARN && !verbose) return 0;
+    static const char levels[] = "??VDIWEF";
+    fprintf(stderr, "%c/%s: ", prio >= 0 && prio < 8 ? levels[prio] : '?', tag);
+    va_list args;
+    va_start(args, fmt);
+    int n = vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+    return n;
+}
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "unit_test.h"
+#include "tempo_processor.h"
+
+namespace {
+
+#define RATE 48000
+#define CHUNK_FRAMES 1024
+#define TONE_HZ 440.0
+#define AMPLITUDE 0.5
+
+// 从 phase 帧开始的一段单声道正弦
+std::vector<float> sine(size_t phase, size_t frames) {
+    std::vector<float> pcm(frames);
+    for (size_t i = 0; i < frames; ++i) {
+        pcm[i] = static_cast<float>(AMPLITUDE * sin(2 * M_PI * TONE_HZ * (phase + i) / RATE));
+    }
+    return pcm;
+}
+
+// 按解码阶段的方式分块送入 seconds 秒正弦，返回输入的帧数
+size_t feed(TempoProcessor &proc, size_t &phase, double seconds, std::vector<float> &out) {
+    size_t frames = static_cast<size_t>(seconds * RATE);
+    for (size_t pos = 0; pos < frames; pos += CHUNK_FRAMES) {
+        size_t n = std::min<size_t>(CHUNK_FRAMES, frames - pos);
+        std::vector<float> pcm = sine(phase, n);
+        phase += n;
+        proc.process(pcm.data(), n, out);
+    }
+    return frames;
+}
+
+// 上升过零点之间的平均间隔（帧），线性插值求过零位置
+double meanPeriod(const std::vector<float> &pcm) {
+    double first = -1, last = -1;
+    int crossings = 0;
+    for (size_t i = 1; i < pcm.size(); ++i) {
+        if (pcm[i - 1] < 0 && pcm[i] >= 0) {
+            double at = i - 1 + pcm[i - 1] / (pcm[i - 1] - pcm[i]);
+            if (first < 0) first = at;
+            last = at;
+            crossings++;
+        }
+    }
+    return crossings > 1 ? (last - first) / (crossings - 1) : 0;
+}
+
+float maxStep(const std::vector<float> &pcm) {
+    float step = 0;
+    for (size_t i = 1; i < pcm.size(); ++i) step = std::max(step, std::fabs(pcm[i] - pcm[i - 1]));
+    return step;
+}
+
+}
+
+// 速度从 1 逐段逼近目标值，到 3 倍速要消耗约 2.5 秒输入，先送 3 秒让速度稳定
+#define WARM_SECONDS 3.0
+
+// 速度稳定之后，输出长度是消耗的输入除以速度
+TEST(TempoProcessor, OutputLengthFollowsTempo) {
+    const float tempos[] = {0.5f, 0.75f, 1.0f, 1.25f, 1.5f, 2.0f, 3.0f};
+    for (float tempo : tempos) {
+        TempoProcessor proc;
+        proc.configure(RATE, 1);
+        proc.setTempo(tempo);
+        std::vector<float> out;
+        size_t phase = 0;
+        feed(proc, phase, WARM_SECONDS, out);
+        out.clear();
+        size_t bufferedBefore = proc.bufferedFrames();
+        size_t in = feed(proc, phase, 4.0, out);
+        double consumed = static_cast<double>(in) + bufferedBefore - proc.bufferedFrames();
+        double expected = consumed / tempo;
+        EXPECT_NEAR(out.size() / expected, 1.0, 0.005) << "tempo " << tempo << " out " << out.size()
+                                                       << " expected " << expected;
+    }
+}
+
+// 变速不变调：输出的正弦周期与输入相同
+TEST(TempoProcessor, KeepsPitch) {
+    const float tempos[] = {0.5f, 0.75f, 1.5f, 2.0f, 3.0f};
+    double period = RATE / TONE_HZ;
+    for (float tempo : tempos) {
+        TempoProcessor proc;
+        proc.configure(RATE, 1);
+        proc.setTempo(tempo);
+        std::vector<float> out;
+        size_t phase = 0;
+        feed(proc, phase, WARM_SECONDS, out);
+        out.clear();
+        feed(proc, phase, 3.0, out);
+        EXPECT_NEAR(meanPeriod(out) / period, 1.0, 0.01) << "tempo " << tempo;
+    }
+}
+
+// 速度逐段逼近目标值，拼接处没有跳变：相邻样本之差不超过纯正弦最大斜率的 1.1 倍
+TEST(TempoProcessor, RampHasNoDiscontinuity) {
+    TempoProcessor proc;
+    proc.configure(RATE, 1);
+    std::vector<float> out;
+    size_t phase = 0;
+    feed(proc, phase, 0.5, out);
+    const float tempos[] = {2.0f, 0.5f, 3.0f, 1.0f};
+    for (float tempo : tempos) {
+        proc.setTempo(tempo);
+        feed(proc, phase, 1.0, out);
+    }
+    double slope = 2 * M_PI * TONE_HZ / RATE * AMPLITUDE;
+    EXPECT_LT(maxStep(out), slope * 1.1) << "max step " << maxStep(out) << " sine slope " << slope;
+}
@@ -0,0 +1,126 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "unit_test.h"
+#include "thread_policy.h"
+
+namespace {
+
+// 临时目录下模拟的 /sys/devices/system/cpu，析构时删除
+class FakeSysfs {
+public:
+    FakeSysfs() {
+        char tmpl[] = "/tmp/cpu_topology_XXXXXX";
+        root = mkdtemp(tmpl);
+        // 与 cpuN 并列的其他目录和文件，detect() 要跳过
+        mkdir((root + "/cpufreq").c_str(), 0755);
+        mkdir((root + "/cpuidle").c_str(), 0755);
+        writeFile(root + "/possible", "0-7");
+    }
+
+    ~FakeSysfs() {
+        std::string cmd = "rm -rf '" + root + "'";
+        if (system(cmd.c_str()) != 0) perror("rm");
+    }
+
+    // freqKHz < 0 表示没有 cpufreq 目录（读不到频率）
+    void addCpu(int cpu, long freqKHz) {
+        std::string dir = root + "/cpu" + std::to_string(cpu);
+        mkdir(dir.c_str(), 0755);
+        if (freqKHz < 0) return;
+        mkdir((dir + "/cpufreq").c_str(), 0755);
+        writeFile(dir + "/cpufreq/cpuinfo_max_freq", std::to_string(freqKHz) + "\n");
+    }
+
+    std::string root;
+
+private:
+    static void writeFile(const std::string &path, const std::string &content) {
+        FILE *fp = fopen(path.c_str(), "w");
+        if (fp == nullptr) return;
+        fputs(content.c_str(), fp);
+        fclose(fp);
+    }
+};
+
+std::vector<int> range(int first, int last) {
+    std::vector<int> v;
+    for (int i = first; i <= last; ++i) v.push_back(i);
+    return v;
+}
+
+std::vector<int> roleCpus(const CpuTopology &topo, ThreadRole role) {
+    return topo.cpus(ThreadPolicy::preferredClass(role));
+}
+
+}
+
+// 4 小核 + 4 大核
+TEST(CpuTopology, BigLittle) {
+    FakeSysfs sys;
+    for (int i = 0; i < 4; ++i) sys.addCpu(i, 1800000);
+    for (int i = 4; i < 8; ++i) sys.addCpu(i, 2400000);
+    CpuTopology topo = CpuTopology::detect(sys.root);
+    ASSERT_EQ(topo.clusters().size(), 2u);
+    EXPECT_EQ(topo.clusters()[0].maxFreqKHz, 1800000);
+    EXPECT_TRUE(topo.clusters()[0].cpus == range(0, 3));
+    EXPECT_EQ(topo.clusters()[1].maxFreqKHz, 2400000);
+    EXPECT_TRUE(topo.clusters()[1].cpus == range(4, 7));
+    EXPECT_TRUE(topo.isHeterogeneous());
+
+    EXPECT_TRUE(topo.cpus(CoreClass::Little) == range(0, 3));
+    EXPECT_TRUE(topo.cpus(CoreClass::Big) == range(4, 7));
+    EXPECT_TRUE(topo.cpus(CoreClass::Any) == range(0, 7));
+    EXPECT_TRUE(roleCpus(topo, ThreadRole::Demux) == range(0, 3));
+    EXPECT_TRUE(roleCpus(topo, ThreadRole::VideoDecode) == range(4, 7));
+    EXPECT_TRUE(roleCpus(topo, ThreadRole::VideoRender) == range(4, 7));
+    EXPECT_TRUE(roleCpus(topo, ThreadRole::VideoConvert) == range(4, 7));
+}
+
+// 1 超大核 + 3 大核 + 4 小核，超大核和大核一起算作大核；cpu 编号按数值而不是目录名排序
+TEST(CpuTopology, PrimeBigLittle) {
+    FakeSysfs sys;
+    sys.addCpu(7, 3200000);
+    for (int i = 4; i < 7; ++i) sys.addCpu(i, 2800000);
+    for (int i = 0; i < 4; ++i) sys.addCpu(i, 2000000);
+    CpuTopology topo = CpuTopology::detect(sys.root);
+    ASSERT_EQ(topo.clusters().size(), 3u);
+    EXPECT_TRUE(topo.clusters()[0].cpus == range(0, 3));
+    EXPECT_TRUE(topo.clusters()[1].cpus == range(4, 6));
+    EXPECT_EQ(topo.clusters()[2].maxFreqKHz, 3200000);
+    EXPECT_TRUE(topo.clusters()[2].cpus == std::vector<int>{7});
+    EXPECT_TRUE(topo.isHeterogeneous());
+
+    EXPECT_TRUE(topo.cpus(CoreClass::Little) == range(0, 3));
+    EXPECT_TRUE(topo.cpus(CoreClass::Big) == range(4, 7));
+    EXPECT_TRUE(roleCpus(topo, ThreadRole::Demux) == range(0, 3));
+    EXPECT_TRUE(roleCpus(topo, ThreadRole::VideoDecode) == range(4, 7));
+}
+
+// 同构 CPU 或读不到频率时不区分大小核，每类都是全部核心
+TEST(CpuTopology, HomogeneousOrUnknown) {
+    {
+        FakeSysfs sys;
+        for (int i = 0; i < 12; ++i) sys.addCpu(i, 2000000);
+        CpuTopology topo = CpuTopology::detect(sys.root);
+        ASSERT_EQ(topo.clusters().size(), 1u);
+        EXPECT_FALSE(topo.isHeterogeneous());
+        EXPECT_TRUE(topo.clusters()[0].cpus == range(0, 11));
+        EXPECT_TRUE(topo.cpus(CoreClass::Little) == range(0, 11));
+        EXPECT_TRUE(topo.cpus(CoreClass::Big) == range(0, 11));
+    }
+    {
+        FakeSysfs sys;
+        for (int i = 0; i < 2; ++i) sys.addCpu(i, -1);
+        for (int i = 2; i < 4; ++i) sys.addCpu(i, 2000000);
+        CpuTopology topo = CpuTopology::detect(sys.root);
+        EXPECT_FALSE(topo.isHeterogeneous());
+        EXPECT_TRUE(topo.cpus(CoreClass::Big) == range(0, 3));
+    }
+    CpuTopology missing = CpuTopology::detect("/nonexistent/cpu");
+    EXPECT_TRUE(missing.clusters().empty());
+    EXPECT_TRUE(missing.cpus(CoreClass::Any).empty());
+}
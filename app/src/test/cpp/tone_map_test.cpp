@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "unit_test.h"
+#include "tone_map.h"
+
+namespace {
+
+// 按定义用双精度计算的 BT.2020 -> BT.709 转换结果
+void referenceBt709(const uint8_t *in, double *out) {
+    static const double m[3][3] = {
+            {1.6605, -0.5876, -0.0728},
+            {-0.1246, 1.1329, -0.0083},
+            {-0.0182, -0.1006, 1.1187},
+    };
+    double linear[3];
+    for (int c = 0; c < 3; ++c) linear[c] = std::pow(in[c] / 255.0, 2.4);
+    for (int c = 0; c < 3; ++c) {
+        double v = m[c][0] * linear[0] + m[c][1] * linear[1] + m[c][2] * linear[2];
+        out[c] = 255 * std::pow(std::min(std::max(v, 0.0), 1.0), 1 / 2.4);
+    }
+}
+
+}
+
+// 查表实现与双精度参考相差不超过 1，alpha 不变
+TEST(ToneMapper, Bt709MatchesReference) {
+    ToneMapper mapper;
+    std::vector<uint8_t> rgba;
+    for (int r = 0; r < 256; r += 15) {
+        for (int g = 0; g < 256; g += 15) {
+            for (int b = 0; b < 256; b += 15) {
+                rgba.insert(rgba.end(), {static_cast<uint8_t>(r), static_cast<uint8_t>(g),
+                                         static_cast<uint8_t>(b), static_cast<uint8_t>(r ^ b)});
+            }
+        }
+    }
+    std::vector<uint8_t> in = rgba;
+    mapper.toBt709(rgba.data(), static_cast<int>(rgba.size() / 4));
+    double worst = 0;
+    int alphaChanged = 0;
+    for (size_t i = 0; i < in.size(); i += 4) {
+        double ref[3];
+        referenceBt709(&in[i], ref);
+        for (int c = 0; c < 3; ++c) worst = std::max(worst, std::fabs(rgba[i + c] - ref[c]));
+        if (rgba[i + 3] != in[i + 3]) alphaChanged++;
+    }
+    EXPECT_LE(worst, 1.0);
+    EXPECT_EQ(alphaChanged, 0);
+}
+
+// 灰色不变；BT.2020 的纯绿超出 BT.709 色域，红、蓝分量截断为 0
+TEST(ToneMapper, Bt709KeepsGrayAndClipsOutOfGamut) {
+    ToneMapper mapper;
+    for (int v = 0; v < 256; ++v) {
+        uint8_t px[4] = {static_cast<uint8_t>(v), static_cast<uint8_t>(v), static_cast<uint8_t>(v), 255};
+        mapper.toBt709(px, 1);
+        for (int c = 0; c < 3; ++c) EXPECT_NEAR(px[c], v, 1) << "gray " << v;
+    }
+    uint8_t green[4] = {0, 255, 0, 255};
+    mapper.toBt709(green, 1);
+    EXPECT_EQ(green[0], 0);
+    EXPECT_EQ(green[1], 255);
+    EXPECT_EQ(green[2], 0);
+}
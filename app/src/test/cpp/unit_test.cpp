@@ -0,0 +1,54 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "unit_test.h"
+
+namespace unit_test {
+
+struct TestCase {
+    std::string name;
+    TestFunc fn;
+};
+
+static std::vector<TestCase> &registry() {
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+static int failures = 0;
+
+Registrar::Registrar(const char *suite, const char *name, TestFunc fn) {
+    registry().push_back({std::string(suite) + "." + name, fn});
+}
+
+Failure::Failure(const char *file, int line, const std::string &expr):
+file(file), line(line), expr(expr) {}
+
+Failure::~Failure() {
+    failures++;
+    std::string text = message.str();
+    fprintf(stderr, "%s:%d: failed: %s%s%s\n", file, line, expr.c_str(),
+            text.empty() ? "" : " -- ", text.c_str());
+}
+
+}  // namespace unit_test
+
+// 参数是用例名的子串时只运行匹配的用例
+int main(int argc, char **argv) {
+    using namespace unit_test;
+    int failedCases = 0;
+    int ran = 0;
+    for (const TestCase &c : registry()) {
+        if (argc > 1 && strstr(c.name.c_str(), argv[1]) == nullptr) continue;
+        int before = failures;
+        printf("[ RUN  ] %s\n", c.name.c_str());
+        fflush(stdout);
+        c.fn();
+        ran++;
+        bool ok = failures == before;
+        if (!ok) failedCases++;
+        printf("[ %s ] %s\n", ok ? " OK " : "FAIL", c.name.c_str());
+    }
+    printf("%d of %d cases failed\n", failedCases, ran);
+    return failedCases == 0 ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+#ifndef TINY_PLAYER_UNIT_TEST_H
+#define TINY_PLAYER_UNIT_TEST_H
+
+#include <cmath>
+#include <sstream>
+#include <string>
+
+// 主机测试用的最小测试框架，只依赖标准库，不需要在开发机上另外安装测试库。
+// 写法与 GoogleTest 相同的一个子集：TEST 定义用例，EXPECT_* 失败后继续，ASSERT_* 失败后结束当前用例，
+// 都可以用 << 附加说明。每个测试程序运行其中的全部用例，有失败时返回非 0
+
+namespace unit_test {
+
+using TestFunc = void (*)();
+
+struct Registrar {
+    Registrar(const char *suite, const char *name, TestFunc fn);
+};
+
+// 记录一次失败，附加的说明在表达式结束析构时一起输出
+class Failure {
+public:
+    Failure(const char *file, int line, const std::string &expr);
+    ~Failure();
+
+    template <typename T>
+    Failure &operator<<(const T &value) {
+        message << value;
+        return *this;
+    }
+
+private:
+    const char *file;
+    int line;
+    std::string expr;
+    std::ostringstream message;
+};
+
+// ASSERT_* 借助它在 return 语句中使用 <<
+struct Fatal {
+    void operator=(const Failure &) {}
+};
+
+}  // namespace unit_test
+
+#define TEST(suite, name) \
+    static void suite##_##name(); \
+    static unit_test::Registrar suite##_##name##_registrar(#suite, #name, suite##_##name); \
+    static void suite##_##name()
+
+#define UNIT_TEST_CHECK(cond, text) \
+    if (cond) {} else unit_test::Failure(__FILE__, __LINE__, text)
+#define UNIT_TEST_REQUIRE(cond, text) \
+    if (cond) {} else return unit_test::Fatal() = unit_test::Failure(__FILE__, __LINE__, text)
+
+#define EXPECT_TRUE(c) UNIT_TEST_CHECK(c, #c)
+#define EXPECT_FALSE(c) UNIT_TEST_CHECK(!(c), "!(" #c ")")
+#define EXPECT_EQ(a, b) UNIT_TEST_CHECK((a) == (b), #a " == " #b)
+#define EXPECT_NE(a, b) UNIT_TEST_CHECK((a) != (b), #a " != " #b)
+#define EXPECT_LT(a, b) UNIT_TEST_CHECK((a) < (b), #a " < " #b)
+#define EXPECT_LE(a, b) UNIT_TEST_CHECK((a) <= (b), #a " <= " #b)
+#define EXPECT_GT(a, b) UNIT_TEST_CHECK((a) > (b), #a " > " #b)
+#define EXPECT_GE(a, b) UNIT_TEST_CHECK((a) >= (b), #a " >= " #b)
+#define EXPECT_NEAR(a, b, tol) UNIT_TEST_CHECK(std::abs((a) - (b)) <= (tol), "|" #a " - " #b "| <= " #tol)
+
+#define ASSERT_TRUE(c) UNIT_TEST_REQUIRE(c, #c)
+#define ASSERT_FALSE(c) UNIT_TEST_REQUIRE(!(c), "!(" #c ")")
+#define ASSERT_EQ(a, b) UNIT_TEST_REQUIRE((a) == (b), #a " == " #b)
+#define ASSERT_NE(a, b) UNIT_TEST_REQUIRE((a) != (b), #a " != " #b)
+#define ASSERT_LT(a, b) UNIT_TEST_REQUIRE((a) < (b), #a " < " #b)
+#define ASSERT_LE(a, b) UNIT_TEST_REQUIRE((a) <= (b), #a " <= " #b)
+#define ASSERT_GT(a, b) UNIT_TEST_REQUIRE((a) > (b), #a " > " #b)
+#define ASSERT_GE(a, b) UNIT_TEST_REQUIRE((a) >= (b), #a " >= " #b)
+
+#endif //TINY_PLAYER_UNIT_TEST_H
@@ -0,0 +1,69 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include "unit_test.h"
+#include "worker_pool.h"
+
+using namespace std::chrono;
+
+namespace {
+
+// 在 pool 的工作线程中执行 fn 并等待它结束
+void runInPool(WorkerPool &pool, const std::function<void()> &fn) {
+    std::promise<void> done;
+    pool.post([&] {
+        fn();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+// 每个分片各执行一次
+void expectEachOnce(WorkerPool &pool, int count) {
+    std::vector<std::atomic<int>> hits(count);
+    pool.parallelFor(count, [&](int i) { hits[i]++; });
+    for (int i = 0; i < count; ++i) EXPECT_EQ(hits[i].load(), 1) << "slice " << i;
+}
+
+}
+
+TEST(WorkerPool, ParallelForCoversEverySlice) {
+    WorkerPool pool(3);
+    for (int count : {0, 1, 2, 3, 7, 32}) expectEachOnce(pool, count);
+    runInPool(pool, [&] {
+        for (int count : {2, 3, 7, 32}) expectEachOnce(pool, count);
+    });
+}
+
+// 在池内调用时分片也要同时在不同的线程上执行：每个分片等到所有分片都开始后才返回
+TEST(WorkerPool, ParallelForInPoolRunsSlicesConcurrently) {
+    const int threads = 4;
+    WorkerPool pool(threads);
+    std::atomic<int> started{0};
+    std::atomic<int> timeouts{0};
+    std::mutex mtx;
+    std::set<std::thread::id> ids;
+    runInPool(pool, [&] {
+        pool.parallelFor(threads, [&](int) {
+            {
+                std::lock_guard<std::mutex> lck(mtx);
+                ids.insert(std::this_thread::get_id());
+            }
+            started++;
+            auto deadline = steady_clock::now() + seconds(2);
+            while (started.load() < threads) {
+                if (steady_clock::now() > deadline) {
+                    timeouts++;
+                    break;
+                }
+                std::this_thread::yield();
+            }
+        });
+    });
+    EXPECT_EQ(timeouts.load(), 0);
+    EXPECT_EQ(ids.size(), static_cast<size_t>(threads));
+}
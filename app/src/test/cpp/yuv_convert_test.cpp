@@ -0,0 +1,191 @@
+#include <cmath>
+#include <random>
+#include <vector>
+#include "unit_test.h"
+#include "yuv_convert.h"
+
+#ifdef HAVE_SWSCALE
+extern "C" {
+#include "libswscale/swscale.h"
+#include "libavutil/pixfmt.h"
+}
+#endif
+
+namespace {
+
+// 随机内容的 4:2:0 测试图像，宽高可以是奇数，色度宽高向上取整
+struct TestImage {
+    std::vector<uint8_t> y;
+    std::vector<uint8_t> u;
+    std::vector<uint8_t> v;
+    YuvImage image{};
+
+    TestImage(int width, int height, ChromaLayout layout, uint32_t seed) {
+        std::mt19937 rng(seed);
+        int cw = (width + 1) / 2;
+        int ch = (height + 1) / 2;
+        // 行距大于宽度，检查行距的处理
+        int yStride = width + 13;
+        int uvStride = (layout == ChromaLayout::Planar ? cw : cw * 2) + 7;
+        y.resize(static_cast<size_t>(yStride) * height);
+        u.resize(static_cast<size_t>(uvStride) * ch);
+        v.resize(static_cast<size_t>(uvStride) * ch);
+        for (auto &b : y) b = static_cast<uint8_t>(rng());
+        for (auto &b : u) b = static_cast<uint8_t>(rng());
+        for (auto &b : v) b = static_cast<uint8_t>(rng());
+        image = YuvImage{y.data(), u.data(), v.data(), yStride, uvStride, width, height, layout};
+    }
+
+    void chroma(int x, int r, int &cu, int &cv) const {
+        const uint8_t *c = image.u + (r / 2) * image.uvStride;
+        switch (image.layout) {
+            case ChromaLayout::Planar:
+                cu = c[x / 2];
+                cv = image.v[(r / 2) * image.uvStride + x / 2];
+                break;
+            case ChromaLayout::NV12:
+                cu = c[x / 2 * 2];
+                cv = c[x / 2 * 2 + 1];
+                break;
+            case ChromaLayout::NV21:
+                cv = c[x / 2 * 2];
+                cu = c[x / 2 * 2 + 1];
+                break;
+        }
+    }
+};
+
+// 浮点的参考实现，色度取最近的样本（与转换器相同，不做插值）
+void reference(const TestImage &t, YuvMatrix matrix, bool fullRange, std::vector<uint8_t> &out) {
+    double kr = 0.299, kb = 0.114;
+    if (matrix == YuvMatrix::BT709) {
+        kr = 0.2126;
+        kb = 0.0722;
+    } else if (matrix == YuvMatrix::BT2020) {
+        kr = 0.2627;
+        kb = 0.0593;
+    }
+    double kg = 1.0 - kr - kb;
+    double ys = fullRange ? 1.0 : 255.0 / 219.0;
+    double cs = fullRange ? 1.0 : 255.0 / 224.0;
+    double yo = fullRange ? 0.0 : 16.0;
+    const YuvImage &img = t.image;
+    out.assign(static_cast<size_t>(img.width) * img.height * 4, 0);
+    auto pixel = [](double x) {
+        return static_cast<uint8_t>(std::lround(std::min(std::max(x, 0.0), 255.0)));
+    };
+    for (int r = 0; r < img.height; ++r) {
+        for (int x = 0; x < img.width; ++x) {
+            int cu = 0, cv = 0;
+            t.chroma(x, r, cu, cv);
+            double yy = (img.y[r * img.yStride + x] - yo) * ys;
+            double uu = (cu - 128) * cs;
+            double vv = (cv - 128) * cs;
+            uint8_t *p = &out[(static_cast<size_t>(r) * img.width + x) * 4];
+            p[0] = pixel(yy + 2.0 * (1.0 - kr) * vv);
+            p[1] = pixel(yy - 2.0 * kb * (1.0 - kb) / kg * uu - 2.0 * kr * (1.0 - kr) / kg * vv);
+            p[2] = pixel(yy + 2.0 * (1.0 - kb) * uu);
+            p[3] = 255;
+        }
+    }
+}
+
+std::vector<SimdLevel> availableLevels() {
+    std::vector<SimdLevel> levels{SimdLevel::Scalar};
+    SimdLevel best = YuvConverter::detect();
+    if (best == SimdLevel::Neon) levels.push_back(SimdLevel::Neon);
+    if (best == SimdLevel::Sse41 || best == SimdLevel::Avx2) levels.push_back(SimdLevel::Sse41);
+    if (best == SimdLevel::Avx2) levels.push_back(SimdLevel::Avx2);
+    return levels;
+}
+
+int maxDiff(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b) {
+    int diff = 0;
+    for (size_t i = 0; i < a.size(); ++i) diff = std::max(diff, std::abs(a[i] - b[i]));
+    return diff;
+}
+
+const ChromaLayout kLayouts[] = {ChromaLayout::Planar, ChromaLayout::NV12, ChromaLayout::NV21};
+const YuvMatrix kMatrices[] = {YuvMatrix::BT601, YuvMatrix::BT709, YuvMatrix::BT2020};
+
+}  // namespace
+
+// 所有 SIMD 实现与标量实现逐字节一致，标量实现与浮点公式相差不超过 3
+TEST(YuvConvert, MatchesReferenceWithinTolerance) {
+    const int width = 67;   // 覆盖 SIMD 主循环之后的行尾
+    const int height = 9;
+    for (ChromaLayout layout : kLayouts) {
+        TestImage t(width, height, layout, 1234);
+        for (YuvMatrix matrix : kMatrices) {
+            for (bool full : {false, true}) {
+                std::vector<uint8_t> ref;
+                reference(t, matrix, full, ref);
+                std::vector<uint8_t> scalar;
+                for (SimdLevel level : availableLevels()) {
+                    YuvConverter conv(level);
+                    conv.setColor(matrix, full);
+                    std::vector<uint8_t> out(ref.size());
+                    conv.convert(t.image, out.data(), width * 4);
+                    if (level == SimdLevel::Scalar) {
+                        scalar = out;
+                        EXPECT_LE(maxDiff(out, ref), 3)
+                            << "matrix " << static_cast<int>(matrix) << " full " << full
+                            << " layout " << static_cast<int>(layout);
+                    } else {
+                        EXPECT_EQ(out, scalar) << YuvConverter::levelName(level);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// 按行分片转换的结果与整幅转换相同
+TEST(YuvConvert, RowSlicesMatchWholeImage) {
+    TestImage t(64, 33, ChromaLayout::NV12, 99);
+    YuvConverter conv;
+    conv.setColor(YuvMatrix::BT709, false);
+    std::vector<uint8_t> whole(64 * 33 * 4), sliced(whole.size());
+    conv.convert(t.image, whole.data(), 64 * 4);
+    for (int r = 0; r < 33; r += 5) {
+        conv.convertRows(t.image, sliced.data(), 64 * 4, r, r + 5);
+    }
+    EXPECT_EQ(whole, sliced);
+}
+
+#ifdef HAVE_SWSCALE
+// 与 swscale 同尺寸转换的输出比较。swscale 本身与浮点公式也有 2 左右的舍入误差
+TEST(YuvConvert, MatchesSwscaleWithinTolerance) {
+    const int width = 64;
+    const int height = 16;
+    const AVPixelFormat formats[] = {AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12, AV_PIX_FMT_NV21};
+    const int spaces[] = {SWS_CS_ITU601, SWS_CS_ITU709, SWS_CS_BT2020};
+    for (int l = 0; l < 3; ++l) {
+        TestImage t(width, height, kLayouts[l], 77);
+        for (int m = 0; m < 3; ++m) {
+            for (int full = 0; full < 2; ++full) {
+                SwsContext *sws = sws_getContext(width, height, formats[l], width, height,
+                                                 AV_PIX_FMT_RGBA, SWS_POINT | SWS_ACCURATE_RND,
+                                                 nullptr, nullptr, nullptr);
+                ASSERT_NE(sws, nullptr);
+                const int *coefs = sws_getCoefficients(spaces[m]);
+                sws_setColorspaceDetails(sws, coefs, full, coefs, 1, 0, 1 << 16, 1 << 16);
+                std::vector<uint8_t> expected(width * height * 4);
+                const uint8_t *src[3] = {t.image.y, t.image.u, t.image.v};
+                int srcStride[3] = {t.image.yStride, t.image.uvStride, t.image.uvStride};
+                uint8_t *dst[1] = {expected.data()};
+                int dstStride[1] = {width * 4};
+                sws_scale(sws, src, srcStride, 0, height, dst, dstStride);
+                sws_freeContext(sws);
+
+                YuvConverter conv;
+                conv.setColor(kMatrices[m], full != 0);
+                std::vector<uint8_t> out(expected.size());
+                conv.convert(t.image, out.data(), width * 4);
+                EXPECT_LE(maxDiff(out, expected), 5) << "format " << l << " matrix " << m
+                                                     << " full " << full;
+            }
+        }
+    }
+}
+#endif